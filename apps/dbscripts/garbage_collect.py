@@ -0,0 +1,26 @@
+#!/usr/bin/env python
+# Script that deletes orphans and duplicates from the database
+
+from __future__ import print_function
+from object_recognition_core.db import GarbageCollector, ObjectDb
+import object_recognition_core.db.tools as dbtools
+import argparse
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Delete the orphans (observations, sessions, models of objects that '
+                                     'do not exist anymore) and the duplicates from the database.')
+    dbtools.add_db_arguments(parser)
+    args = parser.parse_args()
+    return args
+
+if __name__ == "__main__":
+    args = parse_args()
+    db = ObjectDb(dbtools.args_to_db_params(args))
+    gc = GarbageCollector(db)
+    gc.scan()
+    print(gc.report())
+    if args.commit:
+        print('Deleting the orphans and duplicates ...')
+        gc.collect()
+    else:
+        print('just kidding. --commit to actually do it.')
@@ -0,0 +1,88 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ecto/ecto.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include "Aggregator.h"
+#include "depth_filter.h"
+
+using object_recognition_core::common::PoseResult;
+
+namespace
+{
+  /** Aggregate the results of a given number of pipelines, each having found 10 objects */
+  void
+  AggregatorProcess(benchmark::State& state)
+  {
+    unsigned int n_inputs = state.range(0);
+    ecto::cell::ptr cell(new ecto::cell_<object_recognition_core::voters::Aggregator>());
+    cell->declare_params();
+    cell->parameters["n_inputs"] << n_inputs;
+    cell->declare_io();
+    cell->configure();
+    for (unsigned int i = 0; i < n_inputs; ++i)
+      cell->inputs[object_recognition_core::voters::Aggregator::get_input_string("pose_results", i)]
+          << std::vector<PoseResult>(10);
+
+    while (state.KeepRunning())
+      cell->process();
+  }
+  BENCHMARK(AggregatorProcess)->Arg(1)->Arg(4)->Arg(16);
+
+  /** Filter a VGA cloud of 3d points */
+  void
+  DepthFilterProcess(benchmark::State& state)
+  {
+    ecto::cell::ptr cell(new ecto::cell_<object_recognition_core::filters::DepthFilter>());
+    cell->declare_params();
+    cell->parameters["d_min"] << 0.5f;
+    cell->parameters["d_max"] << 1.5f;
+    cell->declare_io();
+    cell->configure();
+    cv::Mat points3d(480, 640, CV_32FC3);
+    cv::randu(points3d, cv::Scalar::all(0), cv::Scalar::all(2));
+    cell->inputs["points3d"] << points3d;
+
+    while (state.KeepRunning())
+      cell->process();
+  }
+  BENCHMARK(DepthFilterProcess);
+}
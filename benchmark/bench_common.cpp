@@ -0,0 +1,101 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <fstream>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <object_recognition_core/common/pose_result.h>
+
+#include "csv.h"
+
+using object_recognition_core::common::PoseResult;
+
+namespace
+{
+  PoseResult
+  pose_result()
+  {
+    PoseResult pose_result;
+    pose_result.set_R(cv::Mat(cv::Mat::eye(3, 3, CV_32F)));
+    pose_result.set_T(cv::Mat(cv::Mat::ones(3, 1, CV_32F)));
+    pose_result.set_confidence(0.5);
+    return pose_result;
+  }
+
+  void
+  PoseResultCopy(benchmark::State& state)
+  {
+    PoseResult original = pose_result();
+    while (state.KeepRunning())
+    {
+      PoseResult copy(original);
+      benchmark::DoNotOptimize(copy);
+    }
+  }
+  BENCHMARK(PoseResultCopy);
+
+  /** The rotation is given as a matrix or as a Rodrigues vector */
+  void
+  PoseResultSetR(benchmark::State& state)
+  {
+    cv::Mat R = (state.range(0) == 9) ? cv::Mat(cv::Mat::eye(3, 3, CV_64F)) : cv::Mat(cv::Mat::ones(3, 1, CV_64F));
+    PoseResult pose_result;
+    while (state.KeepRunning())
+      pose_result.set_R(R);
+  }
+  BENCHMARK(PoseResultSetR)->Arg(3)->Arg(9);
+
+  void
+  WriteCSV(benchmark::State& state)
+  {
+    object_recognition_core::io::CSVOutput out(new std::ofstream("/dev/null"));
+    object_recognition_core::io::PoseInfo pose_info;
+    pose_info.ts.set();
+    pose_info.run = 1;
+    pose_info.frame = 12;
+    pose_info.dID = 3;
+    pose_info.oID = "0123456789abcdef0123456789abcdef";
+    for (int i = 0; i < 9; ++i)
+      pose_info.Rot[i] = (i % 4 == 0);
+    pose_info.Tx = pose_info.Ty = pose_info.Tz = 0.5;
+    while (state.KeepRunning())
+      object_recognition_core::io::writeCSV(out, pose_info);
+  }
+  BENCHMARK(WriteCSV);
+}
@@ -0,0 +1,181 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** Benchmarks of ObjectDbCouch against an HttpStub serving a CouchTape: they measure the client (JSON, curl, HTTP
+ * round trips on the loopback) without any server, hence can run anywhere and be compared across changes.
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/document.h>
+#include <object_recognition_core/db/view.h>
+
+#include "couch_tape.h"
+#include "http_stub.h"
+
+using object_recognition_core::benchmark::COUCH_TAPE_DOCUMENT_ID;
+using object_recognition_core::benchmark::COUCH_TAPE_REVISION_ID;
+using object_recognition_core::benchmark::CouchTape;
+using object_recognition_core::db::Document;
+using object_recognition_core::db::DocumentId;
+using object_recognition_core::db::ObjectDbParameters;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::RevisionId;
+using object_recognition_core::db::View;
+using object_recognition_core::db::ViewIterator;
+using object_recognition_core::test::HttpStub;
+
+namespace
+{
+  const std::string COLLECTION = "ork_benchmark";
+
+  ObjectDbPtr
+  couch_db(const HttpStub & stub)
+  {
+    ObjectDbParameters parameters(ObjectDbParameters::COUCHDB);
+    parameters.set_parameter("root", stub.root());
+    parameters.set_parameter("collection", COLLECTION);
+    return parameters.generateDb();
+  }
+
+  or_json::mObject
+  observation_fields()
+  {
+    or_json::mObject fields;
+    fields["Type"] = "Observation";
+    fields["object_id"] = "object_0";
+    fields["session_id"] = "session";
+    fields["frame_number"] = 0;
+    return fields;
+  }
+
+  void
+  CouchInsert(benchmark::State& state)
+  {
+    HttpStub stub(CouchTape(COLLECTION, "", 0));
+    ObjectDbPtr db = couch_db(stub);
+    or_json::mObject fields = observation_fields();
+    while (state.KeepRunning())
+    {
+      DocumentId document_id;
+      RevisionId revision_id;
+      db->insert_object(fields, document_id, revision_id);
+    }
+    if (stub.n_unmatched())
+      state.SkipWithError("unexpected request");
+  }
+  BENCHMARK(CouchInsert);
+
+  void
+  CouchLoad(benchmark::State& state)
+  {
+    HttpStub stub(CouchTape(COLLECTION, "", 0));
+    ObjectDbPtr db = couch_db(stub);
+    while (state.KeepRunning())
+    {
+      or_json::mObject fields;
+      db->load_fields(COUCH_TAPE_DOCUMENT_ID, fields);
+      benchmark::DoNotOptimize(fields);
+    }
+    if (stub.n_unmatched())
+      state.SkipWithError("unexpected request");
+  }
+  BENCHMARK(CouchLoad);
+
+  /** Go over all the documents of a view, in pages of ViewIterator::BATCH_SIZE */
+  void
+  CouchViewPaging(benchmark::State& state)
+  {
+    HttpStub stub(CouchTape(COLLECTION, "", state.range(0)));
+    ObjectDbPtr db = couch_db(stub);
+    View view(View::VIEW_OBSERVATION_WHERE_OBJECT_ID);
+    view.set_key("object_0");
+    while (state.KeepRunning())
+    {
+      int total_rows = 1;
+      for (int offset = 0; offset < total_rows;)
+      {
+        std::vector<Document> view_elements;
+        db->QueryView(view, ViewIterator::BATCH_SIZE, offset, total_rows, offset, view_elements);
+        benchmark::DoNotOptimize(view_elements);
+      }
+    }
+    if (stub.n_unmatched())
+      state.SkipWithError("unexpected request");
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK(CouchViewPaging)->Arg(10)->Arg(100)->Arg(1000);
+
+  void
+  CouchAttachmentPut(benchmark::State& state)
+  {
+    HttpStub stub(CouchTape(COLLECTION, "", 0));
+    ObjectDbPtr db = couch_db(stub);
+    std::string attachment(state.range(0), 'a');
+    while (state.KeepRunning())
+    {
+      std::stringstream stream(attachment);
+      RevisionId revision_id = COUCH_TAPE_REVISION_ID;
+      db->set_attachment_stream(COUCH_TAPE_DOCUMENT_ID, "data", "application/octet-stream", stream, revision_id);
+    }
+    if (stub.n_unmatched())
+      state.SkipWithError("unexpected request");
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK(CouchAttachmentPut)->Arg(1024)->Arg(1024 * 1024);
+
+  void
+  CouchAttachmentGet(benchmark::State& state)
+  {
+    HttpStub stub(CouchTape(COLLECTION, std::string(state.range(0), 'a'), 0));
+    ObjectDbPtr db = couch_db(stub);
+    while (state.KeepRunning())
+    {
+      std::stringstream stream;
+      db->get_attachment_stream(COUCH_TAPE_DOCUMENT_ID, COUCH_TAPE_REVISION_ID, "data", "application/octet-stream",
+                                stream);
+      benchmark::DoNotOptimize(stream);
+    }
+    if (stub.n_unmatched())
+      state.SkipWithError("unexpected request");
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK(CouchAttachmentGet)->Arg(1024)->Arg(1024 * 1024);
+}
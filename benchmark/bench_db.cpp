@@ -0,0 +1,263 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/document.h>
+#include <object_recognition_core/db/opencv.h>
+#include <object_recognition_core/db/view.h>
+
+#include "mock_db.h"
+
+using object_recognition_core::benchmark::ObjectDbMock;
+using object_recognition_core::benchmark::model_document;
+using object_recognition_core::db::Document;
+using object_recognition_core::db::DummyDocument;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::View;
+using object_recognition_core::db::ViewIterator;
+
+namespace object_recognition_core
+{
+  namespace benchmark
+  {
+    or_json::mObject
+    model_document(const std::string & object_id)
+    {
+      or_json::mObject feature, search, parameters;
+      feature["type"] = "ORB";
+      feature["n_features"] = 1000;
+      feature["n_levels"] = 3;
+      feature["scale_factor"] = 1.2;
+      search["type"] = "LSH";
+      search["key_size"] = 16;
+      search["n_tables"] = 8;
+      search["radius"] = 35.0;
+      parameters["feature"] = feature;
+      parameters["search"] = search;
+      parameters["use_depth"] = true;
+
+      or_json::mArray session_ids;
+      for (int i = 0; i < 3; ++i)
+        session_ids.push_back("fedcba9876543210fedcba987654321" + boost::lexical_cast<std::string>(i));
+
+      or_json::mObject attachments;
+      const char * names[] = { "descriptors", "points", "colors" };
+      for (int i = 0; i < 3; ++i)
+      {
+        or_json::mObject attachment;
+        attachment["content_type"] = "text/x-yaml";
+        attachment["digest"] = "md5-0H/NyTmFQJ3qG4vDnBmCgQ==";
+        attachment["length"] = 2456789 + i;
+        attachment["revpos"] = 2 + i;
+        attachment["stub"] = true;
+        attachments[names[i]] = attachment;
+      }
+
+      or_json::mObject document;
+      document["_id"] = "00112233445566778899aabbccddeeff";
+      document["_rev"] = "4-0123456789abcdef0123456789abcdef";
+      document["Type"] = "Model";
+      document["object_id"] = object_id;
+      document["method"] = "TOD";
+      document["session_ids"] = session_ids;
+      document["parameters"] = parameters;
+      document["_attachments"] = attachments;
+      return document;
+    }
+  }
+}
+
+namespace
+{
+  void
+  JsonWrite(benchmark::State& state)
+  {
+    or_json::mValue document(model_document());
+    while (state.KeepRunning())
+      benchmark::DoNotOptimize(or_json::write(document));
+  }
+  BENCHMARK(JsonWrite);
+
+  void
+  JsonRead(benchmark::State& state)
+  {
+    std::string json = or_json::write(or_json::mValue(model_document()));
+    while (state.KeepRunning())
+    {
+      or_json::mValue value;
+      or_json::read(json, value);
+      benchmark::DoNotOptimize(value);
+    }
+    state.SetBytesProcessed(state.iterations() * json.size());
+  }
+  BENCHMARK(JsonRead);
+
+  void
+  DocumentCopy(benchmark::State& state)
+  {
+    Document document;
+    document.set_fields(model_document());
+    std::stringstream attachment("some binary blob");
+    document.set_attachment_stream("blob", attachment);
+    while (state.KeepRunning())
+    {
+      Document copy(document);
+      benchmark::DoNotOptimize(copy);
+    }
+  }
+  BENCHMARK(DocumentCopy);
+
+  void
+  DocumentSetFields(benchmark::State& state)
+  {
+    or_json::mObject fields = model_document();
+    while (state.KeepRunning())
+    {
+      Document document;
+      document.set_fields(fields);
+      benchmark::DoNotOptimize(document);
+    }
+  }
+  BENCHMARK(DocumentSetFields);
+
+  /** Go over all the documents of a view, as the model loaders do */
+  void
+  ViewIteratorPaging(benchmark::State& state)
+  {
+    ObjectDbPtr db(new ObjectDbMock(state.range(0), model_document()));
+    View view(View::VIEW_MODEL_WHERE_OBJECT_ID_AND_MODEL_TYPE);
+    view.Initialize("TOD");
+    while (state.KeepRunning())
+    {
+      ViewIterator view_iterator(view, db);
+      for (ViewIterator iter = view_iterator.begin(), end = view_iterator.end(); iter != end; ++iter)
+        benchmark::DoNotOptimize(*iter);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK(ViewIteratorPaging)->Arg(10)->Arg(100)->Arg(1000);
+
+  /** @return a matrix like the ones stored in models: descriptors or 3d points */
+  cv::Mat
+  model_matrix(int n_rows, int type)
+  {
+    cv::Mat mat(n_rows, 32, type);
+    cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(255));
+    return mat;
+  }
+
+  void
+  Mats2Yaml(benchmark::State& state)
+  {
+    std::map<std::string, cv::Mat> mats;
+    mats["descriptors"] = model_matrix(state.range(0), CV_8U);
+    mats["points"] = model_matrix(state.range(0), CV_32F);
+    while (state.KeepRunning())
+    {
+      std::stringstream stream;
+      object_recognition_core::db::mats2yaml(mats, stream);
+      benchmark::DoNotOptimize(stream);
+    }
+  }
+  BENCHMARK(Mats2Yaml)->Arg(100)->Arg(1000);
+
+  void
+  Yaml2Mats(benchmark::State& state)
+  {
+    std::map<std::string, cv::Mat> mats;
+    mats["descriptors"] = model_matrix(state.range(0), CV_8U);
+    mats["points"] = model_matrix(state.range(0), CV_32F);
+    std::stringstream yaml;
+    object_recognition_core::db::mats2yaml(mats, yaml);
+    std::string yaml_str = yaml.str();
+    while (state.KeepRunning())
+    {
+      std::stringstream stream(yaml_str);
+      std::map<std::string, cv::Mat> loaded_mats;
+      loaded_mats["descriptors"] = cv::Mat();
+      loaded_mats["points"] = cv::Mat();
+      object_recognition_core::db::yaml2mats(loaded_mats, stream);
+      benchmark::DoNotOptimize(loaded_mats);
+    }
+    state.SetBytesProcessed(state.iterations() * yaml_str.size());
+  }
+  BENCHMARK(Yaml2Mats)->Arg(100)->Arg(1000);
+
+  /** @return a VGA color image with some structure, to not be trivial to compress */
+  cv::Mat
+  vga_image()
+  {
+    cv::Mat image(480, 640, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(64));
+    for (int i = 0; i < image.rows; ++i)
+      image.row(i) += cv::Scalar(i % 256, (2 * i) % 256, 128);
+    return image;
+  }
+
+  void
+  PngAttach(benchmark::State& state)
+  {
+    cv::Mat image = vga_image();
+    while (state.KeepRunning())
+    {
+      DummyDocument document;
+      object_recognition_core::db::png_attach(image, document, "image");
+      benchmark::DoNotOptimize(document);
+    }
+  }
+  BENCHMARK(PngAttach);
+
+  void
+  GetPngAttachment(benchmark::State& state)
+  {
+    DummyDocument document;
+    object_recognition_core::db::png_attach(vga_image(), document, "image");
+    while (state.KeepRunning())
+    {
+      cv::Mat image;
+      object_recognition_core::db::get_png_attachment(image, document, "image");
+      benchmark::DoNotOptimize(image);
+    }
+  }
+  BENCHMARK(GetPngAttachment);
+}
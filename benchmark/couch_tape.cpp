@@ -0,0 +1,128 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/lexical_cast.hpp>
+
+#include <object_recognition_core/db/view.h>
+
+#include "couch_tape.h"
+
+using object_recognition_core::test::HttpExchange;
+using object_recognition_core::test::HttpTape;
+
+namespace
+{
+  /** @return the JSON of an observation as stored in CouchDB */
+  std::string
+  observation_json(int index)
+  {
+    return "{\"Type\":\"Observation\",\"object_id\":\"object_0\",\"session_id\":\"session\",\"frame_number\":"
+           + boost::lexical_cast<std::string>(index) + "}";
+  }
+
+  /** @return the answer of CouchDB to a view query */
+  std::string
+  view_json(int total_rows, int offset, int n_rows)
+  {
+    std::string rows;
+    for (int i = offset; i < offset + n_rows; ++i)
+    {
+      if (!rows.empty())
+        rows += ",";
+      rows += "{\"id\":\"" + object_recognition_core::benchmark::COUCH_TAPE_DOCUMENT_ID
+              + "\",\"key\":\"object_0\",\"value\":" + observation_json(i) + "}";
+    }
+    return "{\"total_rows\":" + boost::lexical_cast<std::string>(total_rows) + ",\"offset\":"
+           + boost::lexical_cast<std::string>(offset) + ",\"rows\":[" + rows + "]}";
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace benchmark
+  {
+    const std::string COUCH_TAPE_DOCUMENT_ID = "0123456789abcdef0123456789abcdef";
+    const std::string COUCH_TAPE_REVISION_ID = "1-0123456789abcdef0123456789abcdef";
+
+    HttpTape
+    CouchTape(const std::string & collection, const std::string & attachment, int n_view_rows)
+    {
+      const std::string path = "/" + collection;
+      const std::string document_path = path + "/" + COUCH_TAPE_DOCUMENT_ID;
+      const std::string id_rev = "\"id\":\"" + COUCH_TAPE_DOCUMENT_ID + "\",\"rev\":\"" + COUCH_TAPE_REVISION_ID
+                                 + "\"";
+
+      HttpTape tape;
+      tape.set_is_looping(true);
+      tape.Add(HttpExchange("GET", path, "", HttpExchange::JsonResponse("200 OK", "{\"db_name\":\"" + collection
+                                                                                  + "\"}")));
+      tape.Add(HttpExchange("DELETE", path, "", HttpExchange::JsonResponse("200 OK", "{\"ok\":true}")));
+      tape.Add(HttpExchange("POST", path, "", HttpExchange::JsonResponse("201 Created", "{\"ok\":true," + id_rev + "}")));
+      tape.Add(HttpExchange("PUT", document_path, "",
+                            HttpExchange::JsonResponse("201 Created", "{\"ok\":true," + id_rev + "}")));
+      tape.Add(
+          HttpExchange("GET", document_path, "",
+                       HttpExchange::JsonResponse("200 OK", "{\"_id\":\"" + COUCH_TAPE_DOCUMENT_ID + "\",\"_rev\":\""
+                                                            + COUCH_TAPE_REVISION_ID + "\","
+                                                            + observation_json(0).substr(1))));
+      tape.Add(HttpExchange("DELETE", document_path + "?rev=" + COUCH_TAPE_REVISION_ID, "",
+                            HttpExchange::JsonResponse("200 OK", "{\"ok\":true," + id_rev + "}")));
+      tape.Add(HttpExchange("PUT", document_path + "/data?rev=" + COUCH_TAPE_REVISION_ID, "",
+                            HttpExchange::JsonResponse("201 Created", "{\"ok\":true," + id_rev + "}")));
+      tape.Add(
+          HttpExchange("GET", document_path + "/data", "",
+                       "HTTP/1.1 200 OK\r\nServer: ork-http-stub\r\nContent-Type: application/octet-stream\r\n"
+                       "Content-Length: " + boost::lexical_cast<std::string>(attachment.size()) + "\r\n\r\n"
+                       + attachment));
+
+      // The views whatever their key: all at once or in the pages of a ViewIterator
+      const std::string view_path = path + "/_design/observations/_view/by_object_id";
+      tape.Add(HttpExchange("GET",
+                            view_path + "?limit=" + boost::lexical_cast<std::string>(std::numeric_limits<int>::max())
+                            + "&skip=0&*",
+                            "", HttpExchange::JsonResponse("200 OK", view_json(n_view_rows, 0, n_view_rows))));
+      const int batch_size = db::ViewIterator::BATCH_SIZE;
+      for (int offset = 0; offset < n_view_rows; offset += batch_size)
+        tape.Add(HttpExchange("GET", view_path + "?limit=" + boost::lexical_cast<std::string>(batch_size) + "&skip="
+                                     + boost::lexical_cast<std::string>(offset) + "&*",
+                              "", HttpExchange::JsonResponse(
+                                  "200 OK", view_json(n_view_rows, offset, std::min(batch_size, n_view_rows - offset)))));
+      return tape;
+    }
+  }
+}
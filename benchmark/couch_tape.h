@@ -0,0 +1,64 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_BENCHMARK_COUCH_TAPE_H_
+#define ORK_CORE_BENCHMARK_COUCH_TAPE_H_
+
+#include <string>
+
+#include "http_stub.h"
+
+namespace object_recognition_core
+{
+  namespace benchmark
+  {
+    /** The id and revision of any document created through a CouchTape */
+    extern const std::string COUCH_TAPE_DOCUMENT_ID;
+    extern const std::string COUCH_TAPE_REVISION_ID;
+
+    /** @return a looping tape that answers what ObjectDbCouch asks for one collection, to serve it with a
+     * test::HttpStub as a stand-in for CouchDB: the collection always exists, every document inserted gets the same
+     * id and revision, its "data" attachment is the given one and the observation views return n_view_rows rows, in
+     * pages of any size. It measures the client and the HTTP round trips, not a server.
+     * @param collection the collection of the DB
+     * @param attachment what GET returns for the "data" attachment of the document
+     * @param n_view_rows the number of documents of the collection as far as the views are concerned
+     */
+    test::HttpTape
+    CouchTape(const std::string & collection, const std::string & attachment, int n_view_rows);
+  }
+}
+
+#endif /* ORK_CORE_BENCHMARK_COUCH_TAPE_H_ */
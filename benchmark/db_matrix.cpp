@@ -0,0 +1,538 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** Run the same workloads against several ObjectDb backends and report the throughput and latency of each operation,
+ * e.g.:
+ *   db_matrix --documents 100,1000 --attachment-sizes 1024,1048576 --threads 1,4 --couch http://localhost:5984
+ * Any backend can be added with --backend name='{"type": ...}'. Without --couch, the CouchDB client is run against a
+ * local stub answering canned responses ("couch_stub"), which measures the client and the HTTP round trips only.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <object_recognition_core/common/json.hpp>
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/document.h>
+#include <object_recognition_core/db/view.h>
+
+#include "couch_tape.h"
+#include "http_stub.h"
+
+namespace po = boost::program_options;
+
+using object_recognition_core::db::Document;
+using object_recognition_core::db::DocumentId;
+using object_recognition_core::db::ObjectDbParameters;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::RevisionId;
+using object_recognition_core::db::View;
+using object_recognition_core::test::HttpStub;
+
+namespace
+{
+  /** The collection all the backends work in: it is wiped before each run */
+  const std::string COLLECTION = "ork_db_matrix";
+  /** The number of different object ids, hence the number of documents returned by a view is documents/N_OBJECTS */
+  const int N_OBJECTS = 10;
+  /** The maximum number of view queries per run: they are way more expensive than the other operations */
+  const int MAX_VIEW_QUERIES = 100;
+
+  struct Backend
+  {
+    Backend()
+        :
+          is_couch_stub_(false)
+    {
+    }
+
+    std::string name_;
+    ObjectDbParameters parameters_;
+    /** If true, the "root" of the CouchDB parameters is set to a stub created for each run */
+    bool is_couch_stub_;
+  };
+
+  /** One cell of the matrix */
+  struct Run
+  {
+    Backend backend_;
+    int n_documents_;
+    size_t attachment_size_;
+    int n_threads_;
+  };
+
+  /** The result of one operation over one run */
+  struct Result
+  {
+    Result()
+        :
+          n_ops_(0),
+          ops_per_second_(0),
+          p50_ms_(0),
+          p99_ms_(0)
+    {
+    }
+
+    std::string operation_;
+    size_t n_ops_;
+    double ops_per_second_;
+    double p50_ms_, p99_ms_;
+    /** If not empty, the operation failed (e.g. it is not implemented by the backend) */
+    std::string error_;
+  };
+
+  /** The state shared by the threads of a run: each thread only touches the documents of its own indices */
+  struct Workload
+  {
+    Run run_;
+    std::vector<ObjectDbPtr> dbs_;
+    std::vector<DocumentId> ids_;
+    std::vector<RevisionId> revs_;
+    std::string attachment_;
+  };
+
+  typedef boost::function<void
+  (Workload &, ObjectDbPtr, int)> Operation;
+
+  std::string
+  object_id(int index)
+  {
+    return boost::str(boost::format("object_%d") % (index % N_OBJECTS));
+  }
+
+  or_json::mObject
+  fields(int index, int version)
+  {
+    or_json::mObject fields;
+    fields["Type"] = "Observation";
+    fields["object_id"] = object_id(index);
+    fields["session_id"] = "session";
+    fields["frame_number"] = index;
+    fields["version"] = version;
+    return fields;
+  }
+
+  void
+  insert(Workload & workload, ObjectDbPtr db, int index)
+  {
+    db->insert_object(fields(index, 0), workload.ids_[index], workload.revs_[index]);
+  }
+
+  void
+  persist(Workload & workload, ObjectDbPtr db, int index)
+  {
+    or_json::mObject new_fields = fields(index, 1);
+    if (!workload.revs_[index].empty())
+      new_fields["_rev"] = workload.revs_[index];
+    db->persist_fields(workload.ids_[index], new_fields, workload.revs_[index]);
+  }
+
+  void
+  load(Workload & workload, ObjectDbPtr db, int index)
+  {
+    or_json::mObject fields;
+    db->load_fields(workload.ids_[index], fields);
+  }
+
+  void
+  attachment_put(Workload & workload, ObjectDbPtr db, int index)
+  {
+    std::stringstream stream(workload.attachment_);
+    db->set_attachment_stream(workload.ids_[index], "data", "application/octet-stream", stream, workload.revs_[index]);
+  }
+
+  void
+  attachment_get(Workload & workload, ObjectDbPtr db, int index)
+  {
+    std::stringstream stream;
+    db->get_attachment_stream(workload.ids_[index], workload.revs_[index], "data", "application/octet-stream", stream);
+  }
+
+  void
+  view(Workload & workload, ObjectDbPtr db, int index)
+  {
+    View view(View::VIEW_OBSERVATION_WHERE_OBJECT_ID);
+    view.set_key(object_id(index));
+    int total_rows, offset;
+    std::vector<Document> view_elements;
+    db->QueryView(view, 0, 0, total_rows, offset, view_elements);
+  }
+
+  void
+  delete_document(Workload & workload, ObjectDbPtr db, int index)
+  {
+    db->Delete(workload.ids_[index]);
+  }
+
+  /** Run an operation on the indices thread_index, thread_index + n_threads ... and time each call */
+  void
+  run_thread(const Operation & operation, Workload & workload, int n_ops, int thread_index,
+             std::vector<double> & latencies_ms, std::string & error)
+  {
+    ObjectDbPtr db = workload.dbs_[thread_index];
+    try
+    {
+      for (int index = thread_index; index < n_ops; index += workload.run_.n_threads_)
+      {
+        boost::chrono::high_resolution_clock::time_point start = boost::chrono::high_resolution_clock::now();
+        operation(workload, db, index);
+        boost::chrono::duration<double, boost::milli> duration = boost::chrono::high_resolution_clock::now() - start;
+        latencies_ms.push_back(duration.count());
+      }
+    } catch (const std::exception & e)
+    {
+      error = e.what();
+    }
+  }
+
+  /** @return the latency under which a ratio of the operations are */
+  double
+  percentile(std::vector<double> & latencies_ms, double ratio)
+  {
+    if (latencies_ms.empty())
+      return 0;
+    std::vector<double>::iterator nth = latencies_ms.begin()
+        + std::min(latencies_ms.size() - 1, size_t(ratio * latencies_ms.size()));
+    std::nth_element(latencies_ms.begin(), nth, latencies_ms.end());
+    return *nth;
+  }
+
+  Result
+  run_operation(const std::string & name, const Operation & operation, Workload & workload, int n_ops)
+  {
+    int n_threads = workload.run_.n_threads_;
+    std::vector<std::vector<double> > thread_latencies(n_threads);
+    std::vector<std::string> thread_errors(n_threads);
+
+    boost::chrono::high_resolution_clock::time_point start = boost::chrono::high_resolution_clock::now();
+    boost::thread_group threads;
+    for (int i = 0; i < n_threads; ++i)
+      threads.create_thread(
+          boost::bind(run_thread, boost::cref(operation), boost::ref(workload), n_ops, i,
+                      boost::ref(thread_latencies[i]), boost::ref(thread_errors[i])));
+    threads.join_all();
+    boost::chrono::duration<double> duration = boost::chrono::high_resolution_clock::now() - start;
+
+    Result result;
+    result.operation_ = name;
+    std::vector<double> latencies_ms;
+    for (int i = 0; i < n_threads; ++i)
+    {
+      latencies_ms.insert(latencies_ms.end(), thread_latencies[i].begin(), thread_latencies[i].end());
+      if (result.error_.empty())
+        result.error_ = thread_errors[i];
+    }
+    result.n_ops_ = latencies_ms.size();
+    if (duration.count() > 0)
+      result.ops_per_second_ = result.n_ops_ / duration.count();
+    result.p50_ms_ = percentile(latencies_ms, 0.5);
+    result.p99_ms_ = percentile(latencies_ms, 0.99);
+    return result;
+  }
+
+  /** Run all the operations of a cell of the matrix, in an order where each one has documents to work on */
+  std::vector<Result>
+  run_workload(const Run & run)
+  {
+    Workload workload;
+    workload.run_ = run;
+    workload.ids_.resize(run.n_documents_);
+    workload.revs_.resize(run.n_documents_);
+    workload.attachment_.resize(run.attachment_size_);
+    for (size_t i = 0; i < run.attachment_size_; ++i)
+      workload.attachment_[i] = char(i * 2654435761u >> 24);
+
+    ObjectDbParameters parameters = run.backend_.parameters_;
+    boost::scoped_ptr<HttpStub> stub;
+    if (run.backend_.is_couch_stub_)
+    {
+      stub.reset(
+          new HttpStub(object_recognition_core::benchmark::CouchTape(COLLECTION, workload.attachment_,
+                                                                     run.n_documents_ / N_OBJECTS)));
+      parameters.set_parameter("root", stub->root());
+    }
+
+    ObjectDbPtr db = parameters.generateDb();
+    db->DeleteCollection(COLLECTION);
+    db->CreateCollection(COLLECTION);
+    for (int i = 0; i < run.n_threads_; ++i)
+      workload.dbs_.push_back(parameters.generateDb());
+
+    std::vector<Result> results;
+    results.push_back(run_operation("insert", insert, workload, run.n_documents_));
+    if (!results.back().error_.empty())
+      return results;
+    results.push_back(run_operation("persist", persist, workload, run.n_documents_));
+    results.push_back(run_operation("attachment_put", attachment_put, workload, run.n_documents_));
+    results.push_back(run_operation("load", load, workload, run.n_documents_));
+    results.push_back(run_operation("attachment_get", attachment_get, workload, run.n_documents_));
+    results.push_back(run_operation("view", view, workload, std::min(run.n_documents_, MAX_VIEW_QUERIES)));
+    results.push_back(run_operation("delete", delete_document, workload, run.n_documents_));
+
+    db->DeleteCollection(COLLECTION);
+    return results;
+  }
+
+  /** The parameters of a backend with its collection set to COLLECTION */
+  ObjectDbParameters
+  backend_parameters(or_json::mObject parameters)
+  {
+    parameters["collection"] = COLLECTION;
+    return ObjectDbParameters(parameters);
+  }
+
+  /** The backends of object_recognition_core, in a setup that works on a single machine */
+  std::vector<Backend>
+  default_backends(const boost::filesystem::path & root, const std::string & couch_root)
+  {
+    std::vector<Backend> backends;
+    Backend backend;
+
+    backend.name_ = "empty";
+    backend.parameters_ = ObjectDbParameters(ObjectDbParameters::EMPTY);
+    backends.push_back(backend);
+
+    // The filesystem DB expects its folder to exist
+    boost::filesystem::create_directories(root / "filesystem");
+    or_json::mObject filesystem = ObjectDbParameters(ObjectDbParameters::FILESYSTEM).raw();
+    filesystem["path"] = (root / "filesystem").string();
+    backend.name_ = "filesystem";
+    backend.parameters_ = backend_parameters(filesystem);
+    backends.push_back(backend);
+
+    or_json::mObject couch = ObjectDbParameters(ObjectDbParameters::COUCHDB).raw();
+    couch["root"] = couch_root;
+    backend.name_ = couch_root.empty() ? "couch_stub" : "CouchDB";
+    backend.parameters_ = backend_parameters(couch);
+    backend.is_couch_stub_ = couch_root.empty();
+    backends.push_back(backend);
+    backend.is_couch_stub_ = false;
+
+    or_json::mObject sharded = ObjectDbParameters(ObjectDbParameters::SHARDED).raw();
+    or_json::mArray shards;
+    for (int i = 0; i < 4; ++i)
+    {
+      or_json::mObject shard = filesystem;
+      shard["path"] = (root / boost::str(boost::format("shard_%d") % i)).string();
+      boost::filesystem::create_directories(shard["path"].get_str());
+      shard["collection"] = COLLECTION;
+      shards.push_back(shard);
+    }
+    sharded["shards"] = shards;
+    backend.name_ = "sharded";
+    backend.parameters_ = ObjectDbParameters(sharded);
+    backends.push_back(backend);
+
+    // A remote DB is emulated by a filesystem one behind a LAN like latency
+    or_json::mObject remote = ObjectDbParameters(ObjectDbParameters::LATENCY).raw();
+    or_json::mObject remote_filesystem = filesystem;
+    remote_filesystem["path"] = (root / "remote").string();
+    boost::filesystem::create_directories(root / "remote");
+    remote_filesystem["collection"] = COLLECTION;
+    remote["db"] = remote_filesystem;
+    remote["latency_ms"] = 1;
+    backend.name_ = "latency";
+    backend.parameters_ = ObjectDbParameters(remote);
+    backends.push_back(backend);
+
+    or_json::mObject tiered = ObjectDbParameters(ObjectDbParameters::TIERED).raw();
+    or_json::mObject local = filesystem;
+    local["path"] = (root / "local").string();
+    boost::filesystem::create_directories(root / "local");
+    local["collection"] = COLLECTION;
+    tiered["local"] = local;
+    tiered["remote"] = remote;
+    backend.name_ = "tiered";
+    backend.parameters_ = ObjectDbParameters(tiered);
+    backends.push_back(backend);
+
+    return backends;
+  }
+
+  template<typename T>
+  std::vector<T>
+  parse_list(const std::string & list)
+  {
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+    std::vector<T> res;
+    BOOST_FOREACH(const std::string & item, items)
+      res.push_back(boost::lexical_cast<T>(item));
+    return res;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  std::string documents, attachment_sizes, threads, couch_root, only, csv_path, root;
+  std::vector<std::string> extra_backends;
+
+  po::options_description desc("Run the same workloads against several DB backends");
+  desc.add_options()
+    ("help,h", "Print this help message")
+    ("documents", po::value<std::string>(&documents)->default_value("100,1000"),
+     "The comma separated numbers of documents")
+    ("attachment-sizes", po::value<std::string>(&attachment_sizes)->default_value("1024,1048576"),
+     "The comma separated sizes of the attachments, in bytes")
+    ("threads", po::value<std::string>(&threads)->default_value("1,4"), "The comma separated numbers of threads")
+    ("couch", po::value<std::string>(&couch_root)->default_value(""),
+     "The root of a CouchDB (or compatible) server to benchmark, e.g. http://localhost:5984. A stub stands in for "
+     "it otherwise")
+    ("backend", po::value<std::vector<std::string> >(&extra_backends),
+     "An extra backend as name='{JSON parameters}', can be repeated")
+    ("only", po::value<std::string>(&only)->default_value(""), "The comma separated backends to run, all by default")
+    ("root", po::value<std::string>(&root)->default_value(
+        (boost::filesystem::temp_directory_path() / "ork_db_matrix").string()),
+     "The folder where the file based backends store their data")
+    ("csv", po::value<std::string>(&csv_path)->default_value(""), "A file to also write the results to, as CSV");
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (const po::error & error)
+  {
+    std::cerr << error.what() << std::endl << desc << std::endl;
+    return 1;
+  }
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  std::vector<Backend> backends = default_backends(root, couch_root);
+  BOOST_FOREACH(const std::string & extra_backend, extra_backends)
+  {
+    size_t equal = extra_backend.find('=');
+    if (equal == std::string::npos)
+    {
+      std::cerr << "A backend must be given as name='{JSON parameters}': " << extra_backend << std::endl;
+      return 1;
+    }
+    Backend backend;
+    backend.name_ = extra_backend.substr(0, equal);
+    backend.parameters_ = backend_parameters(
+        object_recognition_core::to_json(extra_backend.substr(equal + 1)).get_obj());
+    backends.push_back(backend);
+  }
+  if (!only.empty())
+  {
+    std::vector<std::string> names;
+    boost::split(names, only, boost::is_any_of(","));
+    std::vector<Backend> selected;
+    BOOST_FOREACH(const Backend & backend, backends)
+      if (std::find(names.begin(), names.end(), backend.name_) != names.end())
+        selected.push_back(backend);
+    backends = selected;
+  }
+
+  std::ofstream csv;
+  if (!csv_path.empty())
+  {
+    csv.open(csv_path.c_str());
+    csv << "backend,documents,attachment_size,threads,operation,ops,ops_per_second,p50_ms,p99_ms,error" << std::endl;
+  }
+
+  std::cout << std::left << std::setw(12) << "backend" << std::setw(10) << "documents" << std::setw(12) << "attachment"
+            << std::setw(9) << "threads" << std::setw(16) << "operation" << std::right << std::setw(12) << "ops/s"
+            << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::endl;
+  BOOST_FOREACH(const Backend & backend, backends)
+  {
+    BOOST_FOREACH(int n_documents, parse_list<int>(documents))
+    {
+      BOOST_FOREACH(size_t attachment_size, parse_list<size_t>(attachment_sizes))
+      {
+        BOOST_FOREACH(int n_threads, parse_list<int>(threads))
+        {
+          Run run;
+          run.backend_ = backend;
+          run.n_documents_ = n_documents;
+          run.attachment_size_ = attachment_size;
+          run.n_threads_ = std::max(1, n_threads);
+
+          std::vector<Result> results;
+          try
+          {
+            results = run_workload(run);
+          } catch (const std::exception & e)
+          {
+            std::cerr << backend.name_ << " could not be set up: " << e.what() << std::endl;
+            continue;
+          }
+
+          BOOST_FOREACH(const Result & result, results)
+          {
+            std::cout << std::left << std::setw(12) << backend.name_ << std::setw(10) << n_documents << std::setw(12)
+                      << attachment_size << std::setw(9) << run.n_threads_ << std::setw(16) << result.operation_
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(12) << result.ops_per_second_
+                      << std::setprecision(3) << std::setw(10) << result.p50_ms_ << std::setw(10) << result.p99_ms_;
+            if (!result.error_.empty())
+              std::cout << "  failed: " << result.error_;
+            std::cout << std::endl;
+            if (csv.is_open())
+              csv << backend.name_ << "," << n_documents << "," << attachment_size << "," << run.n_threads_ << ","
+                  << result.operation_ << "," << result.n_ops_ << "," << result.ops_per_second_ << ","
+                  << result.p50_ms_ << "," << result.p99_ms_ << ",\"" << boost::replace_all_copy(result.error_, "\"", "\"\"")
+                  << "\"" << std::endl;
+          }
+        }
+      }
+    }
+  }
+
+  return 0;
+}
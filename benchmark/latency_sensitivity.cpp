@@ -0,0 +1,382 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** Measure how the DB accesses of the pipelines degrade with the round trip time of the DB, e.g.:
+ *   latency_sensitivity --latencies 0,1,10,80 --objects 10
+ * A filesystem DB is filled with synthetic data and wrapped in a "latency" DB of constant latency. For each latency,
+ * three paths are timed:
+ *  - model_fetch: a ModelReaderBase cell finding the models of all the objects and downloading their attachments
+ *  - object_info: ObjectInfo::load_fields_and_attachments of each object, first uncached then cached
+ *  - observation_insert: what ObservationInserter does for each frame, an Observation written to a Document that is
+ *    persisted
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+#include <ecto/ecto.hpp>
+
+#include <object_recognition_core/common/json.hpp>
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/document.h>
+#include <object_recognition_core/db/ModelReader.h>
+#include <object_recognition_core/db/model_utils.h>
+#include <object_recognition_core/db/prototypes/object_info.h>
+#include <object_recognition_core/db/prototypes/observations.hpp>
+
+#include "synthetic_db.h"
+
+namespace po = boost::program_options;
+
+using object_recognition_core::benchmark::SyntheticDbConfig;
+using object_recognition_core::benchmark::SyntheticDbGenerator;
+using object_recognition_core::db::Document;
+using object_recognition_core::db::Documents;
+using object_recognition_core::db::ObjectDbParameters;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::ObjectId;
+using object_recognition_core::prototypes::Observation;
+using object_recognition_core::prototypes::ObjectInfo;
+
+namespace
+{
+  /** The collection the synthetic data is written to */
+  const std::string COLLECTION = "ork_latency_sensitivity";
+  /** The attachments of the synthetic models */
+  const char* MODEL_ATTACHMENTS[] = { "descriptors", "points" };
+
+  /** A model reader that downloads all the attachments of its models, like a detector would before training */
+  struct ModelFetcher: public object_recognition_core::db::bases::ModelReaderBase
+  {
+    static void
+    declare_params(ecto::tendrils & params)
+    {
+      object_recognition_core::db::bases::declare_params_impl(params, "");
+    }
+
+    static void
+    declare_io(const ecto::tendrils & params, ecto::tendrils & inputs, ecto::tendrils & outputs)
+    {
+    }
+
+    void
+    configure(const ecto::tendrils & params, const ecto::tendrils & inputs, const ecto::tendrils & outputs)
+    {
+      configure_impl();
+    }
+
+    void
+    parameter_callback(const Documents & db_documents)
+    {
+      BOOST_FOREACH(const Document & document, db_documents)
+      {
+        for (size_t i = 0; i < sizeof(MODEL_ATTACHMENTS) / sizeof(MODEL_ATTACHMENTS[0]); ++i)
+        {
+          std::stringstream stream;
+          document.get_attachment_stream(MODEL_ATTACHMENTS[i], stream);
+        }
+      }
+    }
+
+    int
+    process(const ecto::tendrils & inputs, const ecto::tendrils & outputs)
+    {
+      return ecto::OK;
+    }
+  };
+
+  /** The timings of one path at one latency */
+  struct Result
+  {
+    Result()
+        :
+          total_ms_(0),
+          p50_ms_(0),
+          p99_ms_(0)
+    {
+    }
+
+    std::string path_;
+    std::vector<double> latencies_ms_;
+    double total_ms_;
+    double p50_ms_, p99_ms_;
+    /** If not empty, the path failed */
+    std::string error_;
+  };
+
+  typedef boost::chrono::high_resolution_clock Clock;
+
+  double
+  elapsed_ms(const Clock::time_point & start)
+  {
+    boost::chrono::duration<double, boost::milli> duration = Clock::now() - start;
+    return duration.count();
+  }
+
+  /** @return the latency under which a ratio of the calls are */
+  double
+  percentile(std::vector<double> latencies_ms, double ratio)
+  {
+    if (latencies_ms.empty())
+      return 0;
+    std::vector<double>::iterator nth = latencies_ms.begin()
+        + std::min(latencies_ms.size() - 1, size_t(ratio * latencies_ms.size()));
+    std::nth_element(latencies_ms.begin(), nth, latencies_ms.end());
+    return *nth;
+  }
+
+  void
+  finish(Result & result)
+  {
+    result.total_ms_ = 0;
+    BOOST_FOREACH(double latency_ms, result.latencies_ms_)
+      result.total_ms_ += latency_ms;
+    result.p50_ms_ = percentile(result.latencies_ms_, 0.5);
+    result.p99_ms_ = percentile(result.latencies_ms_, 0.99);
+  }
+
+  /** The startup of a ModelReaderBase cell: the models are found and downloaded in the callbacks of the parameters,
+   * which ecto triggers on the first process(). Like for a real reader, that includes the reload of each callback
+   */
+  Result
+  model_fetch(const ObjectDbParameters & parameters, const std::string & method)
+  {
+    Result result;
+    result.path_ = "model_fetch";
+    try
+    {
+      Clock::time_point start = Clock::now();
+      ecto::cell::ptr cell(new ecto::cell_<ModelFetcher>());
+      cell->declare_params();
+      cell->parameters["json_db"] << object_recognition_core::from_json(or_json::mValue(parameters.raw()));
+      cell->parameters["method"] << method;
+      cell->declare_io();
+      cell->configure();
+      cell->process();
+      result.latencies_ms_.push_back(elapsed_ms(start));
+    } catch (const std::exception & e)
+    {
+      result.error_ = e.what();
+    }
+    finish(result);
+    return result;
+  }
+
+  /** What is done for each found object: the uncached path goes to the DB, the cached one should not */
+  Result
+  object_info(const ObjectDbPtr & db, const std::vector<ObjectId> & object_ids, bool is_cached)
+  {
+    Result result;
+    result.path_ = is_cached ? "object_info_cached" : "object_info";
+    try
+    {
+      BOOST_FOREACH(const ObjectId & object_id, object_ids)
+      {
+        Clock::time_point start = Clock::now();
+        ObjectInfo info(object_id, db);
+        info.load_fields_and_attachments();
+        result.latencies_ms_.push_back(elapsed_ms(start));
+      }
+    } catch (const std::exception & e)
+    {
+      result.error_ = e.what();
+    }
+    finish(result);
+    return result;
+  }
+
+  /** What ObservationInserter does for each frame */
+  Result
+  observation_insert(const ObjectDbPtr & db, const SyntheticDbConfig & config, const std::vector<ObjectId> & object_ids,
+                     int n_observations)
+  {
+    Result result;
+    result.path_ = "observation_insert";
+    try
+    {
+      for (int frame_number = 0; frame_number < n_observations; ++frame_number)
+      {
+        Observation observation;
+        SyntheticDbGenerator::FillObservation(config, 0, 0, frame_number, observation);
+        observation.object_id = object_ids.empty() ? "object" : object_ids[frame_number % object_ids.size()];
+        observation.session_id = COLLECTION;
+
+        Clock::time_point start = Clock::now();
+        Document document;
+        document.set_db(db);
+        observation >> &document;
+        document.Persist();
+        result.latencies_ms_.push_back(elapsed_ms(start));
+      }
+    } catch (const std::exception & e)
+    {
+      result.error_ = e.what();
+    }
+    finish(result);
+    return result;
+  }
+
+  /** The object ids of the models of a method, read from the DB without added latency */
+  std::vector<ObjectId>
+  model_object_ids(ObjectDbPtr db, const std::string & method)
+  {
+    std::vector<ObjectId> object_ids;
+    BOOST_FOREACH(const Document & document, object_recognition_core::db::ModelDocuments(db, method))
+    {
+      ObjectId object_id = document.get_field<ObjectId>("object_id");
+      if (std::find(object_ids.begin(), object_ids.end(), object_id) == object_ids.end())
+        object_ids.push_back(object_id);
+    }
+    return object_ids;
+  }
+
+  template<typename T>
+  std::vector<T>
+  parse_list(const std::string & list)
+  {
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+    std::vector<T> res;
+    BOOST_FOREACH(const std::string & item, items)
+      res.push_back(boost::lexical_cast<T>(item));
+    return res;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  SyntheticDbConfig config;
+  std::string latencies, root, method;
+  int n_inserts;
+
+  po::options_description desc("Time the DB accesses of the pipelines against DBs of increasing latency");
+  desc.add_options()
+    ("help,h", "Print this help message")
+    ("latencies", po::value<std::string>(&latencies)->default_value("0,1,10,80"),
+     "The comma separated latencies added to each DB call, in ms")
+    ("objects", po::value<int>(&config.n_objects_)->default_value(10), "The number of objects")
+    ("models", po::value<int>(&config.n_models_)->default_value(1), "The number of models per object")
+    ("points", po::value<int>(&config.n_model_points_)->default_value(1000),
+     "The number of descriptors/3d points per model")
+    ("inserts", po::value<int>(&n_inserts)->default_value(10), "The number of observations inserted per latency")
+    ("width", po::value<int>(&config.width_)->default_value(640), "The width of the images")
+    ("height", po::value<int>(&config.height_)->default_value(480), "The height of the images")
+    ("method", po::value<std::string>(&method)->default_value("TOD"), "The training method of the models")
+    ("root", po::value<std::string>(&root)->default_value(
+        (boost::filesystem::temp_directory_path() / "ork_latency_sensitivity").string()),
+     "The folder where the filesystem DB stores its data");
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (const po::error & error)
+  {
+    std::cerr << error.what() << std::endl << desc << std::endl;
+    return 1;
+  }
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  // the observations of the DB are not read: only the inserted ones matter
+  config.n_sessions_ = 0;
+  config.methods_.assign(1, method);
+
+  or_json::mObject filesystem = ObjectDbParameters(ObjectDbParameters::FILESYSTEM).raw();
+  filesystem["path"] = root;
+  filesystem["collection"] = COLLECTION;
+  std::vector<ObjectId> object_ids;
+  try
+  {
+    boost::filesystem::remove_all(root);
+    boost::filesystem::create_directories(root);
+    ObjectDbParameters filesystem_parameters(filesystem);
+    SyntheticDbGenerator generator(filesystem_parameters, config);
+    std::cout << generator.Populate() << std::endl;
+    object_ids = model_object_ids(filesystem_parameters.generateDb(), method);
+  } catch (const std::exception & error)
+  {
+    std::cerr << "The DB could not be filled: " << error.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << std::left << std::setw(12) << "latency ms" << std::setw(20) << "path" << std::right << std::setw(8)
+            << "calls" << std::setw(12) << "total ms" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms"
+            << std::endl;
+  BOOST_FOREACH(double latency_ms, parse_list<double>(latencies))
+  {
+    or_json::mObject latency = ObjectDbParameters(ObjectDbParameters::LATENCY).raw();
+    latency["db"] = filesystem;
+    latency["latency_ms"] = latency_ms;
+    ObjectDbParameters parameters(latency);
+    ObjectDbPtr db = parameters.generateDb();
+
+    std::vector<Result> results;
+    results.push_back(model_fetch(parameters, method));
+    results.push_back(object_info(db, object_ids, false));
+    results.push_back(object_info(db, object_ids, true));
+    results.push_back(observation_insert(db, config, object_ids, n_inserts));
+
+    BOOST_FOREACH(const Result & result, results)
+    {
+      std::cout << std::left << std::setw(12) << latency_ms << std::setw(20) << result.path_ << std::right
+                << std::setw(8) << result.latencies_ms_.size() << std::fixed << std::setprecision(2) << std::setw(12)
+                << result.total_ms_ << std::setw(10) << result.p50_ms_ << std::setw(10) << result.p99_ms_;
+      std::cout.unsetf(std::ios::floatfield);
+      if (!result.error_.empty())
+        std::cout << "  " << result.error_;
+      std::cout << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_BENCHMARK_MOCK_DB_H_
+#define ORK_CORE_BENCHMARK_MOCK_DB_H_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/document.h>
+
+namespace object_recognition_core
+{
+  namespace benchmark
+  {
+    /** @return a model document as written by the training pipelines: a few fields, some nested parameters and the
+     * stubs of its attachments
+     */
+    or_json::mObject
+    model_document(const std::string & object_id = "0123456789abcdef0123456789abcdef");
+
+    /** A DB that keeps nothing and answers views with copies of a given document, to measure the cost of the core
+     * code around the DB and not the DB itself
+     */
+    class ObjectDbMock: public db::ObjectDb
+    {
+    public:
+      /**
+       * @param n_documents the number of documents the views return
+       * @param fields the fields of these documents
+       */
+      ObjectDbMock(int n_documents, const or_json::mObject & fields)
+          :
+            n_documents_(n_documents),
+            fields_(fields)
+      {
+      }
+
+      virtual db::ObjectDbParametersRaw
+      default_raw_parameters() const
+      {
+        db::ObjectDbParametersRaw res;
+        res["type"] = type();
+        return res;
+      }
+
+      virtual void
+      insert_object(const or_json::mObject &fields, db::DocumentId & document_id, db::RevisionId & revision_id)
+      {
+        document_id = "0";
+        revision_id = "0";
+      }
+
+      virtual void
+      persist_fields(const db::DocumentId & document_id, const or_json::mObject &fields,
+                     db::RevisionId & revision_id)
+      {
+        revision_id = "0";
+      }
+
+      virtual void
+      load_fields(const db::DocumentId & document_id, or_json::mObject &fields)
+      {
+        fields = fields_;
+      }
+
+      virtual void
+      Delete(const db::ObjectId & id)
+      {
+      }
+
+      virtual void
+      QueryView(const db::View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
+                std::vector<db::Document> & view_elements)
+      {
+        QueryGeneric(std::vector<std::string>(), limit_rows, start_offset, total_rows, offset, view_elements);
+      }
+
+      virtual void
+      QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset, int& total_rows,
+                   int& offset, std::vector<db::Document> & view_elements)
+      {
+        int end = (limit_rows > 0) ? std::min(n_documents_, start_offset + limit_rows) : n_documents_;
+        view_elements.clear();
+        for (int i = start_offset; i < end; ++i)
+        {
+          db::Document document;
+          document.SetIdRev(boost::lexical_cast<std::string>(i), "1-0");
+          document.set_fields(fields_);
+          view_elements.push_back(document);
+        }
+        total_rows = n_documents_;
+        offset = std::max(start_offset, end);
+      }
+
+      virtual void
+      set_attachment_stream(const db::DocumentId & document_id, const db::AttachmentName& attachment_name,
+                            const db::MimeType& mime_type, const std::istream& stream, db::RevisionId & revision_id)
+      {
+      }
+
+      virtual void
+      get_attachment_stream(const db::DocumentId & document_id, const db::RevisionId & revision_id,
+                            const db::AttachmentName& attachment_name, const db::MimeType& mime_type,
+                            std::ostream& stream)
+      {
+      }
+
+      virtual std::string
+      Status() const
+      {
+        return "{\"mock\":\"Welcome\"}";
+      }
+
+      virtual std::string
+      Status(const db::CollectionName& collection) const
+      {
+        return "{\"db_name\":\"" + collection + "\"}";
+      }
+
+      virtual void
+      CreateCollection(const db::CollectionName &collection)
+      {
+      }
+
+      virtual void
+      DeleteCollection(const db::CollectionName &collection)
+      {
+      }
+
+      virtual db::DbType
+      type() const
+      {
+        return "mock";
+      }
+    private:
+      int n_documents_;
+      or_json::mObject fields_;
+    };
+  }
+}
+
+#endif /* ORK_CORE_BENCHMARK_MOCK_DB_H_ */
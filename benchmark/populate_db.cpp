@@ -0,0 +1,112 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** Fill a DB with synthetic objects, e.g.:
+ *   populate_db --db '{"type": "CouchDB", "root": "http://localhost:5984", "collection": "synthetic"}' --objects 100
+ */
+
+#include <iostream>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/program_options.hpp>
+
+#include <object_recognition_core/common/json.hpp>
+#include <object_recognition_core/db/db.h>
+
+#include "synthetic_db.h"
+
+namespace po = boost::program_options;
+
+using object_recognition_core::benchmark::SyntheticDbConfig;
+using object_recognition_core::benchmark::SyntheticDbGenerator;
+using object_recognition_core::db::ObjectDbParameters;
+
+int
+main(int argc, char** argv)
+{
+  SyntheticDbConfig config;
+  std::string db_json, methods;
+
+  po::options_description desc("Fill a DB with synthetic objects, sessions, observations and models");
+  desc.add_options()
+    ("help,h", "Print this help message")
+    ("db", po::value<std::string>(&db_json)->default_value("{\"type\": \"filesystem\", \"path\": \"/tmp/synthetic_db\"}"),
+     "The JSON parameters of the DB to fill")
+    ("objects", po::value<int>(&config.n_objects_)->default_value(10), "The number of objects")
+    ("sessions", po::value<int>(&config.n_sessions_)->default_value(1), "The number of sessions per object")
+    ("observations", po::value<int>(&config.n_observations_)->default_value(10),
+     "The number of observations per session")
+    ("methods", po::value<std::string>(&methods)->default_value("TOD"),
+     "The comma separated training methods of the models")
+    ("models", po::value<int>(&config.n_models_)->default_value(1), "The number of models per object and method")
+    ("points", po::value<int>(&config.n_model_points_)->default_value(1000),
+     "The number of descriptors/3d points per model")
+    ("width", po::value<int>(&config.width_)->default_value(640), "The width of the images")
+    ("height", po::value<int>(&config.height_)->default_value(480), "The height of the images")
+    ("threads", po::value<int>(&config.n_threads_)->default_value(1), "The number of threads writing to the DB")
+    ("seed", po::value<unsigned int>(&config.seed_)->default_value(0), "The seed of the random data");
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (const po::error & error)
+  {
+    std::cerr << error.what() << std::endl << desc << std::endl;
+    return 1;
+  }
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  config.methods_.clear();
+  boost::split(config.methods_, methods, boost::is_any_of(","));
+
+  try
+  {
+    ObjectDbParameters db_parameters(object_recognition_core::to_json(db_json).get_obj());
+    SyntheticDbGenerator generator(db_parameters, config);
+    std::cout << generator.Populate() << std::endl;
+  } catch (const std::exception & error)
+  {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
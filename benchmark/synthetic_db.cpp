@@ -0,0 +1,269 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <map>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <object_recognition_core/db/document.h>
+#include <object_recognition_core/db/model_utils.h>
+#include <object_recognition_core/db/opencv.h>
+
+#include "synthetic_db.h"
+
+using object_recognition_core::db::Document;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::prototypes::Observation;
+
+namespace
+{
+  /** @return the seed of the random generator of a part of the DB: it does not depend on the order of creation */
+  boost::uint32_t
+  seed(unsigned int global_seed, int object_index, int session_index = -1, int frame_number = -1)
+  {
+    boost::uint32_t seed = global_seed;
+    seed = seed * 1000003u + object_index;
+    seed = seed * 1000003u + session_index + 1;
+    seed = seed * 1000003u + frame_number + 1;
+    return seed;
+  }
+
+  /** Fill an image with OpenCV's random functions seeded from our generator */
+  void
+  randomize(cv::Mat & mat, boost::random::mt19937 & generator, double low, double high)
+  {
+    cv::RNG rng(boost::random::uniform_int_distribution<boost::uint32_t>()(generator));
+    rng.fill(mat, cv::RNG::UNIFORM, cv::Scalar::all(low), cv::Scalar::all(high));
+  }
+
+  /** Attach matrices as YAML
+   * @return the size of the attachment
+   */
+  size_t
+  yaml_attach(const std::map<std::string, cv::Mat> & mats, Document & document, const std::string & name)
+  {
+    std::stringstream stream;
+    object_recognition_core::db::mats2yaml(mats, stream);
+    document.set_attachment_stream(name, stream, "text/x-yaml");
+    return stream.str().size();
+  }
+
+  /** @return the size of the raw data of a matrix */
+  size_t
+  mat_size(const cv::Mat & mat)
+  {
+    return mat.total() * mat.elemSize();
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace benchmark
+  {
+    std::ostream &
+    operator<<(std::ostream & stream, const SyntheticDbStats & stats)
+    {
+      size_t n_documents = stats.n_objects_ + stats.n_sessions_ + stats.n_observations_ + stats.n_models_;
+      stream << stats.n_objects_ << " objects, " << stats.n_sessions_ << " sessions, " << stats.n_observations_
+             << " observations, " << stats.n_models_ << " models (" << (stats.n_bytes_ / (1024 * 1024))
+             << " MB of attachments) in " << stats.seconds_ << " s";
+      if (stats.seconds_ > 0)
+        stream << " (" << (n_documents / stats.seconds_) << " documents/s)";
+      return stream;
+    }
+
+    SyntheticDbGenerator::SyntheticDbGenerator(const db::ObjectDbParameters & db_parameters,
+                                               const SyntheticDbConfig & config)
+        :
+          db_parameters_(db_parameters),
+          config_(config)
+    {
+      if (config_.n_threads_ < 1)
+        config_.n_threads_ = 1;
+    }
+
+    SyntheticDbStats
+    SyntheticDbGenerator::Populate()
+    {
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+      std::vector<SyntheticDbStats> thread_stats(config_.n_threads_);
+      boost::thread_group threads;
+      for (int i = 0; i < config_.n_threads_; ++i)
+        threads.create_thread(
+            boost::bind(&SyntheticDbGenerator::PopulateObjects, this, i, boost::ref(thread_stats[i])));
+      threads.join_all();
+
+      SyntheticDbStats stats;
+      BOOST_FOREACH(const SyntheticDbStats & thread_stat, thread_stats)
+      {
+        stats.n_objects_ += thread_stat.n_objects_;
+        stats.n_sessions_ += thread_stat.n_sessions_;
+        stats.n_observations_ += thread_stat.n_observations_;
+        stats.n_models_ += thread_stat.n_models_;
+        stats.n_bytes_ += thread_stat.n_bytes_;
+      }
+      stats.seconds_ = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+      return stats;
+    }
+
+    void
+    SyntheticDbGenerator::FillObservation(const SyntheticDbConfig & config, int object_index, int session_index,
+                                          int frame_number, Observation & observation)
+    {
+      boost::random::mt19937 generator(seed(config.seed_, object_index, session_index, frame_number));
+      boost::random::uniform_real_distribution<double> uniform(-1, 1);
+      int width = config.width_, height = config.height_;
+
+      // The object is a blob somewhere in the middle of the image
+      cv::Point center(width / 2 + uniform(generator) * width / 4, height / 2 + uniform(generator) * height / 4);
+      cv::Size axes(width / 10 + uniform(generator) * width / 20, height / 8 + uniform(generator) * height / 16);
+      double angle = 180 * uniform(generator);
+
+      // A textured background with some light gradient, like a table top, and a colored object
+      observation.mask = cv::Mat::zeros(height, width, CV_8UC1);
+      cv::ellipse(observation.mask, center, axes, angle, 0, 360, cv::Scalar(255), -1);
+      cv::Mat noise(height, width, CV_8UC3);
+      randomize(noise, generator, 0, 32);
+      observation.image.create(height, width, CV_8UC3);
+      for (int y = 0; y < height; ++y)
+        observation.image.row(y).setTo(cv::Scalar(96 + 64 * y / height, 96, 128 - 64 * y / height));
+      observation.image += noise;
+      cv::Scalar color(128 + 127 * uniform(generator), 128 + 127 * uniform(generator), 128 + 127 * uniform(generator));
+      observation.image.setTo(color, observation.mask);
+      cv::add(observation.image, noise, observation.image, observation.mask);
+
+      // A tilted plane around 1 m, with the object sticking out, in millimeters and with sensor noise
+      observation.depth.create(height, width, CV_16UC1);
+      for (int y = 0; y < height; ++y)
+        observation.depth.row(y).setTo(cv::Scalar(800 + 400 * y / height));
+      cv::Mat object_depth = observation.depth - 100;
+      object_depth.copyTo(observation.depth, observation.mask);
+      cv::Mat depth_noise(height, width, CV_16UC1);
+      randomize(depth_noise, generator, 0, 8);
+      observation.depth += depth_noise;
+
+      // A Kinect like calibration and a camera looking at the object
+      observation.K = (cv::Mat_<double>(3, 3) << 525, 0, width / 2 - 0.5, 0, 525, height / 2 - 0.5, 0, 0, 1);
+      cv::Mat rvec = (cv::Mat_<double>(3, 1) << uniform(generator), uniform(generator), uniform(generator));
+      cv::Rodrigues(rvec, observation.R);
+      observation.T = (cv::Mat_<double>(3, 1) << 0.1 * uniform(generator), 0.1 * uniform(generator),
+          1 + 0.2 * uniform(generator));
+      observation.frame_number = frame_number;
+    }
+
+    void
+    SyntheticDbGenerator::PopulateObjects(int first_object_index, SyntheticDbStats & stats) const
+    {
+      ObjectDbPtr db = db_parameters_.generateDb();
+      for (int object_index = first_object_index; object_index < config_.n_objects_; object_index +=
+          config_.n_threads_)
+      {
+        Document object;
+        object.set_db(db);
+        object.set_field("Type", "Object");
+        object.set_field("object_name", boost::str(boost::format("synthetic_%06d") % object_index));
+        object.set_field("description", "A synthetic object to benchmark the DB");
+        or_json::mArray tags;
+        tags.push_back("synthetic");
+        object.set_field("tags", tags);
+        object.set_field("author_name", "object_recognition_core");
+        object.set_field("author_email", "ork@example.com");
+        object.Persist();
+        ++stats.n_objects_;
+
+        for (int session_index = 0; session_index < config_.n_sessions_; ++session_index)
+        {
+          Document session;
+          session.set_db(db);
+          session.set_field("Type", "Session");
+          session.set_field("object_id", object.id());
+          session.set_field("bag_id", boost::str(boost::format("synthetic_%06d_%03d") % object_index % session_index));
+          session.Persist();
+          ++stats.n_sessions_;
+
+          for (int frame_number = 0; frame_number < config_.n_observations_; ++frame_number)
+          {
+            Observation observation;
+            FillObservation(config_, object_index, session_index, frame_number, observation);
+            observation.object_id = object.id();
+            observation.session_id = session.id();
+
+            Document document;
+            document.set_db(db);
+            observation >> &document;
+            document.Persist();
+            stats.n_bytes_ += mat_size(observation.image) + mat_size(observation.depth) + mat_size(observation.mask);
+            ++stats.n_observations_;
+          }
+        }
+
+        // Models with the size of feature based ones: binary descriptors and their 3d positions
+        BOOST_FOREACH(const std::string & method, config_.methods_)
+        {
+          for (int model_index = 0; model_index < config_.n_models_; ++model_index)
+          {
+            boost::random::mt19937 generator(seed(config_.seed_, object_index, -2 - model_index));
+            Document model;
+            PopulateModel(db, object.id(), method,
+                          boost::str(boost::format("{\"type\": \"%s\", \"index\": %d}") % method % model_index),
+                          model);
+            std::map<std::string, cv::Mat> descriptors, points;
+            descriptors["descriptors"].create(config_.n_model_points_, 32, CV_8UC1);
+            randomize(descriptors["descriptors"], generator, 0, 256);
+            points["points"].create(config_.n_model_points_, 1, CV_32FC3);
+            randomize(points["points"], generator, -0.2, 0.2);
+            stats.n_bytes_ += yaml_attach(descriptors, model, "descriptors");
+            stats.n_bytes_ += yaml_attach(points, model, "points");
+            model.Persist();
+            ++stats.n_models_;
+          }
+        }
+      }
+    }
+  }
+}
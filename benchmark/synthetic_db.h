@@ -0,0 +1,144 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_BENCHMARK_SYNTHETIC_DB_H_
+#define ORK_CORE_BENCHMARK_SYNTHETIC_DB_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/prototypes/observations.hpp>
+
+namespace object_recognition_core
+{
+  namespace benchmark
+  {
+    /** What to put in a synthetic DB */
+    struct SyntheticDbConfig
+    {
+      SyntheticDbConfig()
+          :
+            n_objects_(10),
+            n_sessions_(1),
+            n_observations_(10),
+            n_models_(1),
+            width_(640),
+            height_(480),
+            n_model_points_(1000),
+            seed_(0),
+            n_threads_(1)
+      {
+        methods_.push_back("TOD");
+      }
+
+      /** The number of objects */
+      int n_objects_;
+      /** The number of sessions per object */
+      int n_sessions_;
+      /** The number of observations per session */
+      int n_observations_;
+      /** The training methods, each object gets n_models_ models per method */
+      std::vector<std::string> methods_;
+      int n_models_;
+      /** The size of the images/depth maps/masks of the observations */
+      int width_, height_;
+      /** The number of descriptors/3d points in a model */
+      int n_model_points_;
+      /** The same seed gives the same data */
+      unsigned int seed_;
+      /** Each thread writes the documents of different objects with its own DB */
+      int n_threads_;
+    };
+
+    /** What was put in a synthetic DB */
+    struct SyntheticDbStats
+    {
+      SyntheticDbStats()
+          :
+            n_objects_(0),
+            n_sessions_(0),
+            n_observations_(0),
+            n_models_(0),
+            n_bytes_(0),
+            seconds_(0)
+      {
+      }
+
+      size_t n_objects_, n_sessions_, n_observations_, n_models_;
+      /** The size of the attachments, before PNG compression for the images */
+      size_t n_bytes_;
+      double seconds_;
+    };
+
+    std::ostream &
+    operator<<(std::ostream & stream, const SyntheticDbStats & stats);
+
+    /** Fill a DB with objects, sessions, observations and models that look like real ones: the observations have a VGA
+     * color image, a 16 bit depth map, a mask and YAML calibration, the models have YAML descriptors and 3d points
+     */
+    class SyntheticDbGenerator
+    {
+    public:
+      /**
+       * @param db_parameters the DB to fill: each thread creates its own DB from them
+       * @param config what to put in the DB
+       */
+      SyntheticDbGenerator(const db::ObjectDbParameters & db_parameters, const SyntheticDbConfig & config);
+
+      /** Add all the documents to the DB
+       * @return what was added
+       */
+      SyntheticDbStats
+      Populate();
+
+      /** Fill an observation: it only depends on the seed and on the indices of the object, session and frame
+       */
+      static void
+      FillObservation(const SyntheticDbConfig & config, int object_index, int session_index, int frame_number,
+                      prototypes::Observation & observation);
+    private:
+      /** Add the documents of the objects object_index, object_index + n_threads ... */
+      void
+      PopulateObjects(int first_object_index, SyntheticDbStats & stats) const;
+
+      db::ObjectDbParameters db_parameters_;
+      SyntheticDbConfig config_;
+    };
+  }
+}
+
+#endif /* ORK_CORE_BENCHMARK_SYNTHETIC_DB_H_ */
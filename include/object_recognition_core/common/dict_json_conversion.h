@@ -45,11 +45,23 @@ namespace object_recognition_core
 {
   namespace common
   {
+    /** Convert a Python dictionary to a JSON object: the values can be None, bools, ints, floats, strings, lists,
+     * tuples and dictionaries, recursively. Keys have to be strings
+     */
     or_json::mObject
     BpDictToJson(const boost::python::dict &bp_dict);
 
+    /** Convert any Python object supported by BpDictToJson to a JSON value */
+    or_json::mValue
+    BpObjectToJson(const boost::python::object &bp_object);
+
+    /** Convert a JSON object to a Python dictionary, recursively */
     boost::python::dict
     JsonToBpDict(const or_json::mObject & map);
+
+    /** Convert any JSON value to the matching Python object, recursively */
+    boost::python::object
+    JsonToBpObject(const or_json::mValue & value);
   }
 }
 
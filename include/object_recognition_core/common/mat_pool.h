@@ -0,0 +1,110 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** A pool of cv::Mat buffers for the per-frame outputs of the cells, so that long running pipelines do not allocate
+ * (and page fault) the same big images at every frame.
+ * Buffers are grouped by size class (rows, cols and type). A buffer is handed out again once every cv::Mat that
+ * referenced it (downstream cells, queues ...) has been released: the pool checks the OpenCV reference count, so the
+ * consumers do not have to do anything.
+ * Usage:
+ *   cv::Mat mask = MatPool::Instance().Acquire(rows, cols, CV_8UC1);
+ *   // fill all of mask: its content is undefined
+ *   outputs["mask"] << mask;
+ */
+
+#ifndef ORK_CORE_COMMON_MAT_POOL_H_
+#define ORK_CORE_COMMON_MAT_POOL_H_
+
+#include <map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    class MatPool: boost::noncopyable
+    {
+    public:
+      /** @param max_buffers_per_class the maximum number of buffers kept for one size class: once they are all in
+       * use, Acquire allocates buffers that are not pooled
+       */
+      explicit
+      MatPool(size_t max_buffers_per_class = 8);
+
+      /** @return the pool shared by the cells of the process */
+      static MatPool &
+      Instance();
+
+      /** Get a buffer that nobody else references. Its content is undefined
+       * @param rows the number of rows of the buffer
+       * @param cols the number of columns of the buffer
+       * @param type the OpenCV type of the buffer, e.g. CV_8UC1
+       */
+      cv::Mat
+      Acquire(int rows, int cols, int type);
+
+      cv::Mat
+      Acquire(const cv::Size & size, int type)
+      {
+        return Acquire(size.height, size.width, type);
+      }
+
+      /** Forget all the buffers: the ones in use stay valid until they are released */
+      void
+      Clear();
+
+      /** @return the number of buffers in the pool, in use or not */
+      size_t
+      size() const;
+
+    private:
+      /** rows, cols, type */
+      typedef boost::tuple<int, int, int> SizeClass;
+
+      size_t max_buffers_per_class_;
+      std::map<SizeClass, std::vector<cv::Mat> > buffers_;
+      mutable boost::mutex mutex_;
+    };
+  }
+}
+
+#endif /* ORK_CORE_COMMON_MAT_POOL_H_ */
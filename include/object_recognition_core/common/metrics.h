@@ -0,0 +1,283 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** A registry of production metrics (counters, gauges and latency histograms) that can be written in the Prometheus
+ * text format. Updating a metric is lock-free: only the registration of a new metric and the export take a lock.
+ * If the ORK_METRICS_FILE environment variable is set, the metrics are written to that file every ORK_METRICS_PERIOD
+ * seconds (10 by default) by a background thread, and once more when the program exits.
+ * A name is the name of one kind of metric and its help text is given when its metrics are created.
+ * Usage:
+ *   ORK_METRICS_CELL_LATENCY("MyCell");
+ *   static Counter & n_hits = MetricsRegistry::Instance().counter("my_cache_total", "result=\"hit\"",
+ *                                                                 "Lookups of my cache, by result");
+ *   n_hits.Increment();
+ */
+
+#ifndef ORK_CORE_COMMON_METRICS_H_
+#define ORK_CORE_COMMON_METRICS_H_
+
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    /** A value that only goes up, e.g. a number of requests */
+    class Counter: boost::noncopyable
+    {
+    public:
+      Counter()
+          :
+            value_(0)
+      {
+      }
+
+      void
+      Increment(boost::uint64_t n = 1)
+      {
+        value_.fetch_add(n, boost::memory_order_relaxed);
+      }
+
+      boost::uint64_t
+      value() const
+      {
+        return value_.load(boost::memory_order_relaxed);
+      }
+    private:
+      boost::atomic<boost::uint64_t> value_;
+    };
+
+    /** A value that goes up and down, e.g. a queue depth or a rate */
+    class Gauge: boost::noncopyable
+    {
+    public:
+      Gauge()
+          :
+            value_(0)
+      {
+      }
+
+      void
+      Set(double value)
+      {
+        value_.store(value, boost::memory_order_relaxed);
+      }
+
+      void
+      Add(double delta)
+      {
+        double value = value_.load(boost::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(value, value + delta, boost::memory_order_relaxed))
+        {
+        }
+      }
+
+      double
+      value() const
+      {
+        return value_.load(boost::memory_order_relaxed);
+      }
+    private:
+      boost::atomic<double> value_;
+    };
+
+    /** A histogram of durations in microseconds with log-linear buckets (like HdrHistogram): each power of two is
+     * split in 2^SUB_BUCKET_BITS buckets, hence a relative error of at most 1/2^SUB_BUCKET_BITS on the quantiles
+     */
+    class Histogram: boost::noncopyable
+    {
+    public:
+      static const int SUB_BUCKET_BITS = 4;
+      static const int N_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+      static const int N_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * N_SUB_BUCKETS;
+
+      Histogram();
+
+      /** @param microseconds the value to add to the histogram */
+      void
+      Record(boost::uint64_t microseconds);
+
+      boost::uint64_t
+      count() const
+      {
+        return count_.load(boost::memory_order_relaxed);
+      }
+
+      /** @return the sum of the recorded values, in microseconds */
+      boost::uint64_t
+      sum() const
+      {
+        return sum_.load(boost::memory_order_relaxed);
+      }
+
+      /** @param quantile between 0 and 1
+       * @return the value under which that quantile of the recorded values are, in microseconds
+       */
+      double
+      Quantile(double quantile) const;
+
+      /** @return the bucket of a value */
+      static int
+      BucketIndex(boost::uint64_t value);
+    private:
+      boost::atomic<boost::uint64_t> buckets_[N_BUCKETS];
+      boost::atomic<boost::uint64_t> count_, sum_;
+    };
+
+    /** Records the time between its construction and its destruction in a histogram */
+    class ScopedLatency: boost::noncopyable
+    {
+    public:
+      explicit
+      ScopedLatency(Histogram & histogram);
+
+      ~ScopedLatency();
+    private:
+      Histogram & histogram_;
+      boost::uint64_t start_;
+    };
+
+    /** All the metrics of the process. They are identified by a name and by Prometheus labels (e.g.
+     * method="load_fields",backend="CouchDB") and are never deleted, so references to them can be kept
+     */
+    class MetricsRegistry: boost::noncopyable
+    {
+    public:
+      static MetricsRegistry &
+      Instance();
+
+      /** @param help the help text of the metrics of that name, kept if empty
+       * @return the counter of a given name and labels, created on the first call
+       * @throw std::runtime_error if the name is already used by another kind of metric
+       */
+      Counter &
+      counter(const std::string & name, const std::string & labels = "", const std::string & help = "");
+
+      /** @param help the help text of the metrics of that name, kept if empty
+       * @return the gauge of a given name and labels, created on the first call
+       * @throw std::runtime_error if the name is already used by another kind of metric
+       */
+      Gauge &
+      gauge(const std::string & name, const std::string & labels = "", const std::string & help = "");
+
+      /** @param help the help text of the metrics of that name, kept if empty
+       * @return the histogram of a given name and labels, created on the first call. It is exported in seconds
+       * @throw std::runtime_error if the name is already used by another kind of metric
+       */
+      Histogram &
+      histogram(const std::string & name, const std::string & labels = "", const std::string & help = "");
+
+      /** Write all the metrics in the Prometheus text format
+       * @param stream the stream to write to
+       */
+      void
+      WritePrometheus(std::ostream & stream) const;
+
+      /** Write all the metrics in the Prometheus text format. The file is replaced atomically so that a scraper never
+       * reads half of it
+       * @param path the file to write to
+       */
+      void
+      WritePrometheus(const std::string & path) const;
+
+      /** Start a thread that writes the metrics to a file periodically
+       * @param path the file to write to
+       * @param period_seconds the time between two writes
+       */
+      void
+      StartExport(const std::string & path, double period_seconds);
+
+      /** Stop the export thread, after a last write */
+      void
+      StopExport();
+    private:
+      MetricsRegistry();
+
+      void
+      Export(const std::string & path, double period_seconds);
+
+      struct Family
+      {
+        /** Set the help text if it is not empty and check that the family has no metric of another kind */
+        void
+        Check(const std::string & name, const std::string & help, bool has_other_kinds);
+
+        std::string help_;
+        std::map<std::string, boost::shared_ptr<Counter> > counters_;
+        std::map<std::string, boost::shared_ptr<Gauge> > gauges_;
+        std::map<std::string, boost::shared_ptr<Histogram> > histograms_;
+      };
+
+      mutable boost::mutex mutex_;
+      std::map<std::string, Family> families_;
+
+      boost::mutex export_mutex_;
+      boost::shared_ptr<boost::thread> export_thread_;
+      std::string export_path_;
+    };
+  }
+}
+
+#define ORK_METRICS_CONCAT_IMPL(a, b) a ## b
+#define ORK_METRICS_CONCAT(a, b) ORK_METRICS_CONCAT_IMPL(a, b)
+
+/** Record the time spent in the current scope in the histogram of a given name, labels and help text (string
+ * literals)
+ */
+#define ORK_METRICS_LATENCY(name, labels, help) \
+  static ::object_recognition_core::common::Histogram & ORK_METRICS_CONCAT(ork_metrics_histogram_, __LINE__) = \
+      ::object_recognition_core::common::MetricsRegistry::Instance().histogram(name, labels, help); \
+  ::object_recognition_core::common::ScopedLatency ORK_METRICS_CONCAT(ork_metrics_latency_, __LINE__)( \
+      ORK_METRICS_CONCAT(ork_metrics_histogram_, __LINE__))
+
+/** Record the time spent in the process() function of a cell of a given name (string literal) */
+#define ORK_METRICS_CELL_LATENCY(cell) \
+  ORK_METRICS_LATENCY("ork_cell_process_seconds", "cell=\"" cell "\"", "Time spent in the process() function of a cell")
+
+/** Record the time spent in a DB request, given the backend and the method (string literals) */
+#define ORK_METRICS_DB_LATENCY(backend, method) \
+  ORK_METRICS_LATENCY("ork_db_request_seconds", "backend=\"" backend "\",method=\"" method "\"", \
+                      "Time spent in a DB request, by backend and method")
+
+#endif /* ORK_CORE_COMMON_METRICS_H_ */
@@ -36,6 +36,7 @@
 #ifndef POSE_RESULT_H_
 #define POSE_RESULT_H_
 
+#include <stdexcept>
 #include <vector>
 
 #ifdef CV_MAJOR_VERSION
@@ -199,6 +200,24 @@ namespace object_recognition_core
 
     };
 
+  template<>
+  inline void
+  PoseResult::set_R(const std::vector<float> & R)
+  {
+    if (R.size() != 9)
+      throw std::runtime_error("R must have 9 elements, stored row by row.");
+    R_ = R;
+  }
+
+  template<>
+  inline void
+  PoseResult::set_T(const std::vector<float> & T)
+  {
+    if (T.size() != 3)
+      throw std::runtime_error("T must have 3 elements.");
+    T_ = T;
+  }
+
 #ifdef CV_MAJOR_VERSION
 // OpenCV specializations
   template<>
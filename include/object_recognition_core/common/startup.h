@@ -0,0 +1,170 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** A timeline of what happens between the launch of a program and the first frames it processes: cell discovery,
+ * plasm creation, DB connection, model loading ... Phases can be recorded from C++ and from Python (through
+ * object_recognition_core.utils.startup).
+ * If the ORK_STARTUP_PROFILE environment variable is set, a breakdown table is printed when the program exits and the
+ * timeline is written to that file in the Chrome trace format.
+ * Usage:
+ *   {
+ *     ORK_STARTUP_PHASE("model_fetch");
+ *     ...
+ *   }
+ *   ORK_STARTUP_FIRST_CALL("MyCell::process");
+ */
+
+#ifndef ORK_CORE_COMMON_STARTUP_H_
+#define ORK_CORE_COMMON_STARTUP_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    class StartupTimeline: boost::noncopyable
+    {
+    public:
+      static StartupTimeline &
+      Instance();
+
+      /** Start a phase: phases can be nested
+       * @param name the name of the phase
+       */
+      void
+      Begin(const std::string & name);
+
+      /** End the last phase of that name that was started by the current thread
+       * @param name the name of the phase
+       */
+      void
+      End(const std::string & name);
+
+      /** Record an instant event, e.g. the first call to a function
+       * @param name the name of the event
+       */
+      void
+      Mark(const std::string & name);
+
+      /** Write the phases and events as a table of start times and durations, relative to the launch of the process
+       * @param stream the stream to write to
+       */
+      void
+      WriteTable(std::ostream & stream) const;
+
+      /** Write the phases and events in the Chrome trace format
+       * @param stream the stream to write to
+       */
+      void
+      WriteTrace(std::ostream & stream) const;
+
+      /** Write the phases and events in the Chrome trace format
+       * @param path the file to write to
+       */
+      void
+      WriteTrace(const std::string & path) const;
+
+      /** @return the time the process was launched, in microseconds since the epoch */
+      boost::uint64_t
+      process_start() const
+      {
+        return process_start_;
+      }
+    private:
+      StartupTimeline();
+
+      struct Phase
+      {
+        std::string name_;
+        /** In microseconds since the epoch. For an event, end_ == start_ */
+        boost::uint64_t start_, end_;
+        bool is_event_, is_open_;
+        /** The number of phases of the same thread this one is nested in */
+        int depth_;
+        std::string thread_;
+      };
+
+      mutable boost::mutex mutex_;
+      std::vector<Phase> phases_;
+      boost::uint64_t process_start_;
+    };
+
+    /** Records a phase of the startup timeline from its construction to its destruction */
+    class StartupPhase: boost::noncopyable
+    {
+    public:
+      explicit
+      StartupPhase(const std::string & name)
+          :
+            name_(name)
+      {
+        StartupTimeline::Instance().Begin(name_);
+      }
+
+      ~StartupPhase()
+      {
+        StartupTimeline::Instance().End(name_);
+      }
+    private:
+      std::string name_;
+    };
+  }
+}
+
+#define ORK_STARTUP_CONCAT_IMPL(a, b) a ## b
+#define ORK_STARTUP_CONCAT(a, b) ORK_STARTUP_CONCAT_IMPL(a, b)
+
+/** Record the current scope as a phase of the startup timeline */
+#define ORK_STARTUP_PHASE(name) \
+  ::object_recognition_core::common::StartupPhase ORK_STARTUP_CONCAT(ork_startup_phase_, __LINE__)(name)
+
+/** Record the first time the program goes through that line: it only costs an atomic read afterwards */
+#define ORK_STARTUP_FIRST_CALL(name) \
+  do \
+  { \
+    static boost::atomic<bool> ork_startup_is_called(false); \
+    if (!ork_startup_is_called.load(boost::memory_order_relaxed) && !ork_startup_is_called.exchange(true)) \
+      ::object_recognition_core::common::StartupTimeline::Instance().Mark(name); \
+  } while (0)
+
+#endif /* ORK_CORE_COMMON_STARTUP_H_ */
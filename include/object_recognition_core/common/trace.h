@@ -0,0 +1,112 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** Lightweight tracing spans that can be dumped in the Chrome trace format (chrome://tracing or ui.perfetto.dev).
+ * Spans are only compiled in when ORK_ENABLE_TRACING is defined (CMake option of the same name), and only recorded
+ * at runtime when the ORK_TRACE_FILE environment variable is set (or SetTraceEnabled(true) is called): the trace is
+ * then written to that file when the program exits.
+ * Usage:
+ *   ORK_TRACE_SCOPE("db", "ObjectDbCouch::load_fields");
+ * The names and categories must be string literals: only their address is stored.
+ */
+
+#ifndef ORK_CORE_COMMON_TRACE_H_
+#define ORK_CORE_COMMON_TRACE_H_
+
+#include <iostream>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    /** @return true if the spans are currently recorded */
+    bool
+    TraceEnabled();
+
+    /** Start/stop recording the spans
+     * @param enabled if true, spans are recorded
+     */
+    void
+    SetTraceEnabled(bool enabled);
+
+    /** Write all the recorded spans as Chrome trace JSON
+     * @param stream the stream to write to
+     */
+    void
+    DumpTrace(std::ostream & stream);
+
+    /** Write all the recorded spans as Chrome trace JSON
+     * @param path the file to write to
+     */
+    void
+    DumpTrace(const std::string & path);
+
+    /** Forget all the recorded spans. No span must be open when calling it */
+    void
+    ClearTrace();
+
+    /** Records a span from its construction to its destruction in the buffer of the current thread */
+    class TraceScope: boost::noncopyable
+    {
+    public:
+      TraceScope(const char * category, const char * name);
+
+      ~TraceScope();
+    private:
+      const char * category_;
+      const char * name_;
+      /** False if tracing was disabled when the span started */
+      bool is_recorded_;
+      /** The start time in microseconds */
+      boost::uint64_t start_;
+    };
+  }
+}
+
+#define ORK_TRACE_CONCAT_IMPL(a, b) a ## b
+#define ORK_TRACE_CONCAT(a, b) ORK_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ORK_ENABLE_TRACING
+#define ORK_TRACE_SCOPE(category, name) \
+  ::object_recognition_core::common::TraceScope ORK_TRACE_CONCAT(ork_trace_scope_, __LINE__)(category, name)
+#else
+#define ORK_TRACE_SCOPE(category, name)
+#endif
+
+#endif /* ORK_CORE_COMMON_TRACE_H_ */
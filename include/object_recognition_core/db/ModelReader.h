@@ -44,8 +44,11 @@
 #include <ecto/ecto.hpp>
 
 #include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <object_recognition_core/common/json_spirit/json_spirit_reader_template.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
 #include <object_recognition_core/common/types.h>
 #include <object_recognition_core/db/document.h>
 #include <object_recognition_core/db/parameters.h>
@@ -63,7 +66,7 @@ namespace object_recognition_core
       struct ModelReaderBase
       {
         ModelReaderBase() :
-          object_id_is_all_(false) {
+          object_id_is_all_(false), is_startup_recorded_(false) {
         }
 
         virtual
@@ -110,13 +113,27 @@ namespace object_recognition_core
         {
           if ((!db_) || (method_->empty()))
             return;
+          ORK_TRACE_SCOPE("db", "ModelReaderBase::load_models");
+
+          // only the first load is part of the startup: the parameter callbacks reload the models several times
+          bool is_startup = !is_startup_recorded_;
+          is_startup_recorded_ = true;
 
           // define the documents from the database
-          if (object_id_is_all_)
-            documents_ = ModelDocuments(db_, *method_);
-          else
-            documents_ = ModelDocuments(db_, object_ids_, *method_);
+          {
+            boost::scoped_ptr<common::StartupPhase> phase;
+            if (is_startup)
+              phase.reset(new common::StartupPhase("model_fetch"));
+            if (object_id_is_all_)
+              documents_ = ModelDocuments(db_, *method_);
+            else
+              documents_ = ModelDocuments(db_, object_ids_, *method_);
+          }
 
+          // attachments are loaded lazily so this also accounts for their download
+          boost::scoped_ptr<common::StartupPhase> phase;
+          if (is_startup)
+            phase.reset(new common::StartupPhase("model_train"));
           parameter_callback(documents_);
         }
 
@@ -127,7 +144,10 @@ namespace object_recognition_core
           if (json_db_->empty())
             return;
           if (!db_)
+          {
+            ORK_STARTUP_PHASE("db_connect");
             db_ = ObjectDbParameters(*json_db_).generateDb();
+          }
 
           parameterCallbackCommon();
         }
@@ -175,6 +195,8 @@ namespace object_recognition_core
         ecto::spore<std::string> json_object_ids_;
         /** internal bool that says if object_ids should actually be considered as all ids */
         bool object_id_is_all_;
+        /** internal bool that says if the model loading phases were already recorded in the startup timeline */
+        bool is_startup_recorded_;
       };
 
       void
@@ -137,12 +137,38 @@ namespace object_recognition_core
       virtual void
       load_fields(const DocumentId & document_id, or_json::mObject &fields) = 0;
 
+      /** Load the JSON fields of several objects at once. The default implementation calls load_fields for each
+       * document but databases that can fetch several documents in one request (e.g. CouchDB through _all_docs) or
+       * in parallel should override it
+       * @param document_ids the ids (unique identifiers) of the documents to load
+       * @param fields the returned fields, in the same order as document_ids
+       */
+      virtual void
+      load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields)
+      {
+        fields.resize(document_ids.size());
+        for (size_t i = 0; i < document_ids.size(); ++i)
+          load_fields(document_ids[i], fields[i]);
+      }
+
       /** Delete a document of a given id in the database
        * @param id the id of the document to delete
        */
       virtual void
       Delete(const ObjectId & id) = 0;
 
+      /** Delete several documents at once. The default implementation calls Delete for each document but databases
+       * that support batched deletes (e.g. CouchDB through _bulk_docs) should override it
+       * @param document_ids the ids of the documents to delete
+       * @param revision_ids the matching revisions of the documents to delete (can be empty if unknown)
+       */
+      virtual void
+      DeleteBulk(const std::vector<DocumentId> & document_ids, const std::vector<RevisionId> & revision_ids)
+      {
+        BOOST_FOREACH(const DocumentId & document_id, document_ids)
+          Delete(document_id);
+      }
+
       /** Execute a given View on the database to find some documents
        * @param view a view object defining a query
        * @param limit_rows a maximum number of queries to return (0 for infinite)
@@ -36,6 +36,7 @@
 #ifndef ORK_CORE_DB_DOCUMENT_H_
 #define ORK_CORE_DB_DOCUMENT_H_
 
+#include <algorithm>
 #include <sstream>
 #include <map>
 
@@ -153,6 +154,50 @@ typedef boost::shared_ptr<const ObjectDb> ObjectDbConstPtr;
         return fields_;
       }
 
+      /** @return the names of the attachments stored in the document itself (set or already loaded), as opposed to
+       * the ones that are only in the DB
+       */
+      std::vector<AttachmentName>
+      cached_attachment_names() const
+      {
+        std::vector<AttachmentName> attachment_names;
+        for (AttachmentMap::const_iterator iter = attachments_.begin(); iter != attachments_.end(); ++iter)
+          attachment_names.push_back(iter->first);
+        return attachment_names;
+      }
+
+      /** Get an attachment stored in the document itself
+       * @param attachment_name the name of the attachment
+       * @param mime_type the MIME type of the attachment
+       * @param data the content of the attachment
+       */
+      void
+      get_cached_attachment(const AttachmentName &attachment_name, MimeType & mime_type, std::string & data) const
+      {
+        AttachmentMap::const_iterator attachment = attachments_.find(attachment_name);
+        if (attachment == attachments_.end())
+          throw std::runtime_error("No attachment \"" + attachment_name + "\" stored in the document");
+        mime_type = attachment->second->type_;
+        data = attachment->second->buffer_.str();
+      }
+
+      /** Get an attachment stored in the document itself, without copying it
+       * @param attachment_name the name of the attachment
+       * @param mime_type the MIME type of the attachment
+       * @param size the number of bytes of the attachment
+       * @return the bytes of the attachment: they are kept alive by the pointer, even if the attachment is replaced
+       */
+      boost::shared_ptr<const char>
+      get_cached_attachment_data(const AttachmentName &attachment_name, MimeType & mime_type, size_t & size) const
+      {
+        AttachmentMap::const_iterator attachment = attachments_.find(attachment_name);
+        if (attachment == attachments_.end())
+          throw std::runtime_error("No attachment \"" + attachment_name + "\" stored in the document");
+        mime_type = attachment->second->type_;
+        size = attachment->second->buffer_.size();
+        return boost::shared_ptr<const char>(attachment->second, attachment->second->buffer_.data());
+      }
+
       /** Get a specific value */
       std::vector<std::string>
       attachment_names() const
@@ -202,22 +247,45 @@ typedef boost::shared_ptr<const ObjectDb> ObjectDbConstPtr;
       ClearField(const std::string& key);
 
     protected:
+      /** A std::stringbuf whose bytes can be read without copying them */
+      class AttachmentBuf: public std::stringbuf
+      {
+      public:
+        /** @return the first byte, NULL if nothing was written */
+        const char *
+        data() const
+        {
+          return eback();
+        }
+
+        /** @return the number of bytes: the get area only catches up with the written bytes lazily */
+        size_t
+        size() const
+        {
+          return std::max(pptr(), egptr()) - eback();
+        }
+      };
+
       /** contains the attachments: binary blobs */
       struct StreamAttachment: boost::noncopyable
       {
         StreamAttachment()
+            :
+              stream_(&buffer_)
         {
         }
 
         StreamAttachment(const MimeType &type)
             :
-              type_(type)
+              type_(type),
+              stream_(&buffer_)
         {
         }
 
         StreamAttachment(const MimeType &type, const std::istream &stream)
             :
-              type_(type)
+              type_(type),
+              stream_(&buffer_)
         {
           copy_from(stream);
         }
@@ -228,7 +296,10 @@ typedef boost::shared_ptr<const ObjectDb> ObjectDbConstPtr;
           stream_.seekg(0);
         }
         MimeType type_;
-        std::stringstream stream_;
+        /** The bytes of the attachment */
+        AttachmentBuf buffer_;
+        /** The stream reading/writing buffer_ */
+        std::iostream stream_;
         typedef boost::shared_ptr<StreamAttachment> ptr;
       };
 
@@ -309,6 +380,12 @@ typedef boost::shared_ptr<const ObjectDb> ObjectDbConstPtr;
         return revision_id_;
       }
 
+      const ObjectDbPtr &
+      db() const
+      {
+        return db_;
+      }
+
       /** Extract a specific attachment from a document in the DB
        * @param attachment_name
        * @param value
@@ -0,0 +1,139 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_DB_GC_H_
+#define ORK_CORE_DB_GC_H_
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <object_recognition_core/common/types.h>
+#include <object_recognition_core/db/db.h>
+
+namespace object_recognition_core
+{
+  namespace db
+  {
+    /** What a GarbageCollector found in the database after a scan
+     */
+    struct GarbageReport
+    {
+      GarbageReport()
+          :
+            n_documents_(0),
+            reclaimable_bytes_(0)
+      {
+      }
+
+      /** The number of documents that were scanned */
+      size_t n_documents_;
+      /** Documents referring to an object or a session that does not exist anymore */
+      std::vector<DocumentId> orphans_;
+      /** Documents with the same content as another document that is kept */
+      std::vector<DocumentId> duplicates_;
+      /** Objects that do not have any model */
+      std::vector<ObjectId> objects_without_models_;
+      /** The number of bytes (JSON and attachments) that deleting the orphans and duplicates would free */
+      size_t reclaimable_bytes_;
+    };
+
+    std::ostream &
+    operator<<(std::ostream & stream, const GarbageReport & report);
+
+    /** Class finding orphans and duplicates in a database and deleting them
+     * The whole database is scanned once (page by page) and a reference graph between objects, sessions,
+     * observations and models is built in memory: only a short summary of each document is kept.
+     * Calling Scan() alone is a dry run, Collect() actually deletes the documents.
+     * The scan uses a CouchDB temporary view through ObjectDb::QueryGeneric: the DB has to be a CouchDB one, or a
+     * sharded/tiered/latency DB on top of CouchDB ones.
+     */
+    class GarbageCollector
+    {
+    public:
+      /** The number of documents to read or delete per request */
+      static const unsigned int BATCH_SIZE;
+
+      /** @param db the DB to clean. Throws if it cannot be scanned (filesystem or empty DB) */
+      explicit
+      GarbageCollector(const ObjectDbPtr & db);
+
+      /** Go over all the documents of the database and figure out the orphans and duplicates
+       */
+      void
+      Scan();
+
+      /** Delete the orphans and duplicates found by Scan, by batches of BATCH_SIZE
+       */
+      void
+      Collect();
+
+      const GarbageReport &
+      report() const
+      {
+        return report_;
+      }
+    private:
+      /** Summary of a document in the database: that is all we keep in memory */
+      struct Node
+      {
+        RevisionId revision_id_;
+        std::string type_;
+        ObjectId object_id_;
+        std::string session_id_;
+        /** Hash of the content of the document, excluding its id and revision */
+        size_t content_hash_;
+        /** Size of the JSON and all the attachments */
+        size_t n_bytes_;
+        /** Number of documents referring to that one */
+        size_t n_references_;
+      };
+      typedef std::map<DocumentId, Node> Graph;
+
+      void
+      AddDocument(const Document & document);
+
+      bool
+      IsAlive(const Graph::const_iterator & node) const;
+
+      ObjectDbPtr db_;
+      Graph graph_;
+      GarbageReport report_;
+    };
+  }
+}
+
+#endif /* ORK_CORE_DB_GC_H_ */
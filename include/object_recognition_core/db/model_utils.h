@@ -62,6 +62,14 @@ namespace object_recognition_core
     PopulateModel(const ObjectDbPtr& db, const ObjectId& object_id, const std::string& method,
                     const std::string& parameters_str, Document& doc);
 
+    /** Create Documents from their ids and load their fields with as few requests to the DB as possible
+     * @param db the DB the documents are in
+     * @param document_ids the ids of the documents to load
+     * @return the loaded Documents, in the same order as document_ids
+     */
+    Documents
+    LoadDocuments(const ObjectDbPtr &db, const std::vector<DocumentId> & document_ids);
+
     /** Given some parameters, retrieve Documents that are models with an object_id
      * that is in object_ids and with parameters matching model_json_params
      * @param db
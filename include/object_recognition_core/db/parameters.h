@@ -55,7 +55,7 @@ typedef or_json::mObject ObjectDbParametersRaw;
     public:
       enum ObjectDbType
       {
-        EMPTY, COUCHDB, FILESYSTEM, NONCORE
+        EMPTY, COUCHDB, FILESYSTEM, SHARDED, TIERED, LATENCY, NONCORE
       };
       ObjectDbParameters();
 
@@ -148,6 +148,12 @@ typedef or_json::mObject ObjectDbParametersRaw;
 
       boost::shared_ptr<ObjectDb>
       generateDb() const;
+
+      /** @return the parameters for another instance of the same DB, e.g. in a thread or a process of its own. The
+       * tiered DBs, at any depth, write through and have no journal: only the original instance replays its journal
+       */
+      ObjectDbParameters
+      secondary() const;
     protected:
       /** The type of the collection 'CouchDB' ... */
       ObjectDbType type_;
@@ -49,6 +49,7 @@ namespace object_recognition_core
      * - std::string name: the name of the object, some string you can understand: "Can of Coke"
      * - std::string mesh_uri: the full URI of where the mesh can be retrieved (this can be useful for RViz)
      * - stream mesh: the mesh as a file
+     * - double radius: the radius of the bounding sphere of the object, in meters (if the object has one)
      */
     class ObjectInfo : public object_recognition_core::db::DummyDocument
     {
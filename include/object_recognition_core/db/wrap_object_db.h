@@ -50,29 +50,16 @@ namespace object_recognition_core
 {
   namespace db
   {
-    /** Provide a default empty pickling infrastructure
+    /** Pickle a DB through its parameters: it is re-created by calling the constructor with them. The copy is
+     * another instance of the DB so the tiered DBs are pickled without their journal (see
+     * ObjectDbParameters::secondary)
      */
     struct object_db_pickle_suite: boost::python::pickle_suite
     {
       static boost::python::tuple
-      getinitargs(const ObjectDbParameters& db_params)
+      getinitargs(const ObjectDb& db)
       {
-        return boost::python::make_tuple();
-      }
-
-      static boost::python::tuple
-      getstate(const ObjectDbParameters& db_params)
-      {
-        // TODO
-        return boost::python::make_tuple();
-      }
-
-      static
-      void
-      setstate(ObjectDbParameters& db_params, boost::python::tuple state)
-      {
-        using namespace boost::python;
-        // TODO
+        return boost::python::make_tuple(db.parameters().secondary());
       }
     };
 
@@ -3,6 +3,7 @@ Module defining several outputs for the object recognition pipeline
 '''
 
 from object_recognition_core.ecto_cells.io import GuessCsvWriter as GuessCsvWriterCpp
+from object_recognition_core.ecto_cells.io import MetricsSink as MetricsSinkCpp
 
 ########################################################################################################################
 
@@ -58,3 +59,11 @@ class GuessCsvWriter(GuessCsvWriterCpp, SinkBase):
     def __init__(self, *args, **kwargs):
         GuessCsvWriterCpp.__init__(self, *args, **kwargs)
         SinkBase.__init__(self)
+
+########################################################################################################################
+
+class MetricsSink(MetricsSinkCpp, SinkBase):
+
+    def __init__(self, *args, **kwargs):
+        MetricsSinkCpp.__init__(self, *args, **kwargs)
+        SinkBase.__init__(self)
@@ -2,7 +2,7 @@
 Module defining several voters for the object recognition pipeline
 """
 
-from object_recognition_core.ecto_cells.voter import Aggregator as AggregatorCpp
+from object_recognition_core.ecto_cells.voter import Aggregator as AggregatorCpp, PoseTracker as PoseTrackerCpp
 import ecto
 from ecto.blackbox import BlackBoxCellInfo as CellInfo
 
@@ -47,3 +47,25 @@ class Aggregator(ecto.BlackBox, VoterBase):
 
     def connections(self, _p):
         return [self.main]
+
+########################################################################################################################
+
+class PoseTracker(ecto.BlackBox, VoterBase):
+    """
+    Cell tracking the results of a detector between frames: its needs_detection output tells when the detector has to
+    run again, so that it can be skipped on most frames of a steady scene
+    """
+    def __init__(self, *args, **kwargs):
+        ecto.BlackBox.__init__(self, *args, **kwargs)
+        VoterBase.__init__(self)
+
+    @staticmethod
+    def declare_cells(_p):
+        return {'main': CellInfo(PoseTrackerCpp)}
+
+    @staticmethod
+    def declare_forwards(_p):
+        return ({'main': 'all'}, {'main': 'all'}, {'main': 'all'})
+
+    def connections(self, _p):
+        return [self.main]
@@ -0,0 +1,165 @@
+"""
+Module to run a detection plasm offline on observations stored in the DB: the observations are split over several
+worker processes, each running its own plasm, so that all the cores are busy
+"""
+from __future__ import print_function
+from object_recognition_core.boost.interface import QueryObservations
+from object_recognition_core.pipelines.plasm import create_cells_and_plasm
+import datetime
+import ecto
+import multiprocessing
+import struct
+import sys
+import time
+
+# the cells and scheduler of a worker process: the plasm is only created once per process
+_worker = {}
+
+def _create_scheduler(plasm):
+    if hasattr(ecto, 'Scheduler'):
+        return ecto.Scheduler(plasm)
+    return ecto.schedulers.Singlethreaded(plasm)
+
+def _init_worker(ork_params, source_name, results_name):
+    cells, plasm = create_cells_and_plasm(ork_params)
+    for cell_name in (source_name, results_name):
+        if cell_name not in cells:
+            raise RuntimeError('There is no cell "%s" in the configuration.' % cell_name)
+    _worker['source'] = cells[source_name]
+    _worker['results'] = cells[results_name]
+    _worker['scheduler'] = _create_scheduler(plasm)
+
+def _detect(observations):
+    """
+    Run the plasm once per observation
+
+    :param observations: a list of Document
+    :return: a list of (frame, results) where frame is (observation id, session id, frame number) and results a list
+            of (object_id, confidence, R, T)
+    """
+    frames = []
+    for observation in observations:
+        _worker['source'].inputs.document = observation
+        _worker['scheduler'].execute(niter=1)
+        fields = observation.fields()
+        frame = (observation.id(), fields.get('session_id', ''), fields.get('frame_number', -1))
+        # copy the results now as the tendril is overwritten by the next frame
+        results = [ (x.object_id(), x.confidence(), x.R(), x.T()) for x in _worker['results'].outputs.pose_results ]
+        frames.append((frame, results))
+    return frames
+
+def find_observations(db, object_ids, session_ids=None):
+    """
+    :param db: the ObjectDb to read from
+    :param object_ids: the ids of the objects whose observations to use
+    :param session_ids: if not empty, only keep the observations of those sessions
+    :return: a generator of the observations, as Documents
+    """
+    for object_id in object_ids:
+        for observation in QueryObservations(db, object_id, load_fields=True):
+            if session_ids and observation.fields().get('session_id', '') not in session_ids:
+                continue
+            yield observation
+
+class _PoseWriter(object):
+    """
+    Base class of the writers of the results in the layouts of src/io/csv.h, that evaluate_detections reads: the run
+    of a pose is the number given to the session of its observation, its frame is the frame number of the observation
+    and its timestamp is the time it is written at. Those layouts have no confidence
+    """
+    def __init__(self, session_runs):
+        """
+        :param session_runs: a dictionary from the session ids of the observations to run numbers
+        """
+        self._session_runs = session_runs
+
+    def write(self, frame, results):
+        session_id, frame_number = frame[1:]
+        if session_id not in self._session_runs:
+            raise RuntimeError('There is no run number for the session "%s".' % session_id)
+        now = datetime.datetime.now()
+        timestamp = (now.hour, now.minute, now.second, now.microsecond // 1000)
+        for detection_id, (object_id, _confidence, R, T) in enumerate(results):
+            self._write_pose(timestamp, self._session_runs[session_id], frame_number, detection_id, object_id, R, T)
+
+    def close(self):
+        self._file.close()
+
+class CsvResultWriter(_PoseWriter):
+    """
+    Write one line per detected object, as writeCSV does
+    """
+    def __init__(self, path, session_runs):
+        super(CsvResultWriter, self).__init__(session_runs)
+        self._file = open(path, 'w')
+        self._file.write('ts,Run,Frame,dID,oID,R11,R12,R13,R21,R22,R23,R31,R32,R33,Tx,Ty,Tz\n')
+
+    def _write_pose(self, timestamp, run, frame_number, detection_id, object_id, R, T):
+        # R is stored row by row, as in the file
+        self._file.write('%.2d.%.2d.%.2d.%.3d,' % timestamp + '%.4d,%.3d,%.3d,%s,' % (run, frame_number, detection_id,
+                         object_id) + ','.join(repr(float(x)) for x in list(R) + list(T)) + '\n')
+
+class BinaryResultWriter(_PoseWriter):
+    """
+    Write one record per detected object in the ORKPOSE1 binary log of writeBinary
+    """
+    def __init__(self, path, session_runs):
+        super(BinaryResultWriter, self).__init__(session_runs)
+        self._file = open(path, 'wb')
+        self._file.write(b'ORKPOSE1')
+
+    def _write_pose(self, timestamp, run, frame_number, detection_id, object_id, R, T):
+        object_id = object_id.encode('utf-8')
+        # the native layout of writeBinary, with the rotation stored column by column as in PoseInfo::Rot
+        self._file.write(struct.pack('=7iI', *(timestamp + (run, frame_number, detection_id, len(object_id)))))
+        self._file.write(object_id)
+        self._file.write(struct.pack('=12d', *([R[(i % 3) * 3 + i // 3] for i in range(9)] + list(T))))
+
+def run_batch(ork_params, observations, writer, n_workers=None, chunk_size=4, source_name='source',
+              results_name='results', report_period=10.0):
+    """
+    Run the detection on some observations with several processes
+
+    :param ork_params: the configuration of the plasm, as for create_plasm. It needs an ObservationReader cell to feed
+            the observations and a cell with a 'pose_results' output to read the results from
+    :param observations: an iterable of the observations (Documents) to process
+    :param writer: an object with a write(frame, results) function, e.g. a CsvResultWriter
+    :param n_workers: the number of worker processes, the number of cores by default
+    :param chunk_size: the number of observations sent to a worker at once
+    :param source_name: the name of the ObservationReader cell in ork_params
+    :param results_name: the name of the cell whose pose_results to write
+    :param report_period: the time between two progress reports on stderr, in seconds
+    :return: the aggregate number of frames per second
+    """
+    def chunks():
+        chunk = []
+        for observation in observations:
+            chunk.append(observation)
+            if len(chunk) == chunk_size:
+                yield chunk
+                chunk = []
+        if chunk:
+            yield chunk
+
+    pool = multiprocessing.Pool(n_workers, _init_worker, (ork_params, source_name, results_name))
+    n_frames = 0
+    start = last_report = time.time()
+    try:
+        # results come in any order: the frame ids tell what they belong to
+        for frames in pool.imap_unordered(_detect, chunks()):
+            for frame, results in frames:
+                writer.write(frame, results)
+            n_frames += len(frames)
+            now = time.time()
+            if now - last_report > report_period:
+                print('%d frames, %.1f frames per second' % (n_frames, n_frames / (now - start)), file=sys.stderr)
+                last_report = now
+        pool.close()
+    except:
+        pool.terminate()
+        raise
+    finally:
+        pool.join()
+
+    elapsed = time.time() - start
+    return n_frames / elapsed if elapsed > 0 else 0
@@ -3,7 +3,6 @@ ABC for Detection pipelines
 '''
 from ecto import BlackBoxCellInfo as CellInfo
 from object_recognition_core.ecto_cells.io import PipelineInfo
-from object_recognition_core.utils.json_helper import obj_to_cpp_json_str
 import ecto
 
 class DetectorBase(object):
@@ -58,7 +57,7 @@ class DetectorAndInfo(ecto.BlackBox):
     """
     def __init__(self, detection_class, *args, **kwargs):
         self._detector = detection_class(*args, **kwargs)
-        self._info = PipelineInfo(parameters=obj_to_cpp_json_str(kwargs))
+        self._info = PipelineInfo(parameters=kwargs)
         ecto.BlackBox.__init__(self, *args, **kwargs)
 
     def declare_cells(self, _p):
@@ -3,6 +3,7 @@ Loaders for all object recognition pipelines
 '''
 from object_recognition_core.io.voter import VoterBase
 from object_recognition_core.utils.find_classes import find_cell
+from object_recognition_core.utils.startup import phase
 import ecto
 import sys
 import traceback
@@ -10,6 +11,9 @@ import traceback
 class OrkPlasmError(RuntimeError):
     pass
 
+# the boolean outputs a gate cell can have
+GATE_OUTPUTS = ('changed', 'needs_detection')
+
 def connect_cells(cell1, cell2, plasm):
     """
     Given two cells, connect them with all the possible tendrils in the plasm
@@ -17,16 +21,49 @@ def connect_cells(cell1, cell2, plasm):
     for key in set(cell1.outputs.keys()).intersection(cell2.inputs.keys()):
         plasm.connect(cell1[key] >> cell2[key])
 
+def downstream_cells(ork_params, cell_name):
+    """
+    :return: the set of the identifiers of the cells a cell sends data to, directly or not
+    """
+    edges = {}
+    for name, parameters in ork_params.items():
+        for output_name in parameters.get('outputs', []):
+            edges.setdefault(name, set()).add(output_name)
+        for input_name in parameters.get('inputs', []):
+            edges.setdefault(input_name, set()).add(name)
+    res = set()
+    to_visit = [cell_name]
+    while to_visit:
+        for next_name in edges.get(to_visit.pop(), ()):
+            if next_name not in res:
+                res.add(next_name)
+                to_visit.append(next_name)
+    return res
+
 def create_plasm(ork_params):
     """
     Function that returns a plasm corresponding to the input arguments
+
+    :param ork_params: a dictionary of the parameters of the different cells, as for create_cells_and_plasm
+    """
+    return create_cells_and_plasm(ork_params)[1]
+
+@phase('create_plasm')
+def create_cells_and_plasm(ork_params):
+    """
+    Function that returns the cells and the plasm corresponding to the input arguments
     
     :param ork_params: a dictionary of the parameters of the different cells as explained in the documentation.
         Each key is a unique identifier of a cell (a cell being a SourceBase, SinkBase, PipelineBase, VoterBase,
         anything) and each key is a dictionary with the following keys: 'module' (a string to define the Python
         module where to find the cell), 'type' (the class name of the cell), 'inputs' and/or 'outputs' (a list
         of identifiers to know what to link the cell to) and 'parameters' (a dictionary of parameters to call
-        the constructor of the cell with)
+        the constructor of the cell with). A cell can also have a 'gate' key: the identifier of a cell with a
+        boolean 'changed' (e.g. a SceneChangeGate) or 'needs_detection' (e.g. a CascadeVoter) output. The cell is
+        then only executed when that output is True and otherwise outputs its previous results again. If the gate
+        depends on the gated cell (e.g. a PoseTracker after the detection pipeline), its output is used on the next
+        frame and its 'detected' input, if any, tells it whether the gated cell ran
+    :return: a tuple (dictionary of the cells by identifier, plasm)
     """
     cells = {}
     voter_n_inputs = {}
@@ -45,10 +82,11 @@ def create_plasm(ork_params):
         else:
             # instantiate the cell
             try:
-                if 'parameters' in parameters:
-                    cells[cell_name] = cell_class(cell_name, **parameters['parameters'])
-                else:
-                    cells[cell_name] = cell_class(cell_name)
+                with phase('create_cell %s' % cell_name):
+                    if 'parameters' in parameters:
+                        cells[cell_name] = cell_class(cell_name, **parameters['parameters'])
+                    else:
+                        cells[cell_name] = cell_class(cell_name)
             except TypeError as err:
                 exc_type, exc_value, exc_traceback = sys.exc_info()
                 err = traceback.format_exception(exc_type, exc_value, exc_traceback)
@@ -63,11 +101,47 @@ def create_plasm(ork_params):
 
     # instantiate the voters
     for cell_name, n_inputs in voter_n_inputs.items():
-        cells[cell_name] = cells[cell_name](cell_name=cell_name, n_inputs=n_inputs, **ork_params[cell_name])
+        with phase('create_cell %s' % cell_name):
+            cells[cell_name] = cells[cell_name](cell_name=cell_name, n_inputs=n_inputs, **ork_params[cell_name])
+
+    # wrap the gated cells so that they only run when their gate lets them
+    for cell_name, parameters in ork_params.items():
+        gate_name = parameters.get('gate', None)
+        if gate_name is None:
+            continue
+        if gate_name not in cells:
+            raise OrkPlasmError('You need a cell of name "%s" as it is the gate of "%s".' % (gate_name, cell_name))
+        if cell_name in voter_n_inputs:
+            raise OrkPlasmError('The voter "%s" cannot be gated.' % cell_name)
+        try:
+            cells[cell_name] = ecto.If('%s_gate' % cell_name, cell=cells[cell_name])
+        except Exception as err:
+            raise OrkPlasmError('Could not gate cell "%s" because of: %s' % (cell_name, str(err)))
 
     # build the plasm with all the connections
     plasm = ecto.Plasm()
     already_processed_connections = set()
+    for cell_name, parameters in ork_params.items():
+        gate_name = parameters.get('gate', None)
+        if gate_name is not None:
+            gate_outputs = [ key for key in GATE_OUTPUTS if key in cells[gate_name].outputs.keys() ]
+            if not gate_outputs:
+                raise OrkPlasmError('The gate "%s" of "%s" needs one of the following outputs: %s.' %
+                                    (gate_name, cell_name, ', '.join(GATE_OUTPUTS)))
+            gate_output = cells[gate_name][gate_outputs[0]]
+            if gate_name in downstream_cells(ork_params, cell_name):
+                # a plasm has no cycle: feed the decision back to the next frame, which starts with the default value
+                # of the output of the gate
+                source, sink = ecto.EntangledPair(value=cells[gate_name].outputs.at(gate_outputs[0]),
+                                                  source_name='%s_gate_feedback' % cell_name,
+                                                  sink_name='%s_gate_feedback_sink' % cell_name)
+                plasm.connect(gate_output >> sink['in'])
+                gate_output = source['out']
+                # the outputs of the gated cell are only new if it ran
+                if 'detected' in cells[gate_name].inputs.keys():
+                    plasm.connect(gate_output >> cells[gate_name]['detected'])
+            plasm.connect(gate_output >> cells[cell_name]['__test__'])
+            already_processed_connections.add((gate_name, cell_name))
     for cell_name, cell in cells.items():
         plasm.insert(cell)
         # link to inputs ...
@@ -103,4 +177,4 @@ def create_plasm(ork_params):
         if not already_processed_connections:
             raise OrkPlasmError('There are no connections in your graph.')
 
-    return plasm
+    return cells, plasm
@@ -2,7 +2,9 @@
 Function that finds classes of a certain base type on the path in certain modules
 '''
 
+from object_recognition_core.utils.startup import phase
 import inspect
+import json
 import os
 import sys
 
@@ -19,23 +21,20 @@ class CellNotFound(Exception):
 
 ########################################################################################################################
 
-def find_classes(modules, base_types):
+def __list_modules(modules):
     """
-    Given a list of python packages, or modules, find all implementations of a class.
+    List the Python modules (.py and .so files) in some packages
 
-    :param modules: The names of the modules to look into
-    :param base_type: any class type (TrainingPipeline, Sink ...). Can be empty.
-    :returns: A set of found classes
+    :param modules: The names of the packages to look into
+    :returns: the set of module names and a signature of the files (a sorted list of paths and modification times)
     """
-    classes = set()
-    modules_loaded = []
     module_names = set()
+    signature = []
     for module in modules:
         if module == '':
             continue
 
         m = __import__(module)
-        modules_loaded.append(sys.modules[module])
 
         path_list = m.__path__
         if not isinstance(path_list, list):
@@ -52,11 +51,35 @@ def find_classes(modules, base_types):
                     elif name.endswith('.py') or name.endswith('.so'):
                         path = os.path.join(root, name)
                         module_names.add(path[path_len+1:-3].replace(os.path.sep,'.'))
+                    else:
+                        continue
+                    path = os.path.join(root, name)
+                    try:
+                        signature.append([path, os.path.getmtime(path)])
+                    except OSError:
+                        continue
                 # record the files as being modules
                 for directory in dirs:
                     path = os.path.join(root, directory)
                     module_names.add(path[path_len+1:].replace(os.path.sep,'.'))
 
+    return module_names, sorted(signature)
+
+def __import_modules(modules, module_names):
+    """
+    Import the packages and the modules in them that can be imported
+
+    :param modules: The names of the packages the modules belong to
+    :param module_names: The names of the modules to import
+    :returns: the list of imported modules
+    """
+    modules_loaded = []
+    for module in modules:
+        if module == '':
+            continue
+        __import__(module)
+        modules_loaded.append(sys.modules[module])
+
     for module_name in module_names:
         try:
             m = __import__(module_name, fromlist=[module_name])
@@ -64,37 +87,157 @@ def find_classes(modules, base_types):
         except:
             continue
 
-    # Look into the modules
+    return modules_loaded
+
+def __module_classes(pymodule, modules):
+    """
+    :param pymodule: a loaded module
+    :param modules: The names of the packages the classes have to be defined in
+    :returns: the classes in a module that are defined in one of the packages
+    """
+    classes = []
+    for _name, potential_pipeline in inspect.getmembers(pymodule):
+        # check if an object is a class
+        if not inspect.isclass(potential_pipeline):
+            continue
+        # make sure the class is from the right module (with recursion, weird things can happen)
+        if not any([potential_pipeline.__module__.startswith(module_name) for module_name in modules]):
+            continue
+        classes.append(potential_pipeline)
+    return classes
+
+def __filter_classes(modules_loaded, modules, base_types, class_name):
+    """
+    :param modules_loaded: the modules to look into
+    :param modules: The names of the packages the classes have to be defined in
+    :param base_types: any class type (TrainingPipeline, Sink ...). Can be empty.
+    :param class_name: if not None, only the classes of that name are returned
+    :returns: the set of classes in the modules that inherit from the base types
+    """
+    classes = set()
     for pymodule in modules_loaded:
-        for _name, potential_pipeline in inspect.getmembers(pymodule):
-            # check if an object is a class
-            if not inspect.isclass(potential_pipeline):
-                continue
-            # make sure the class is from the right module (with recursion, weird things can happen)
-            if not any([potential_pipeline.__module__.startswith(module_name) for module_name in modules]):
+        for potential_pipeline in __module_classes(pymodule, modules):
+            if class_name is not None and potential_pipeline.__name__ != class_name:
                 continue
             # check if an object is a class that is none of the sought ones
             if potential_pipeline not in base_types:
                 # make sure the class is a subclass of the base types
                 if not base_types or any([ issubclass(potential_pipeline, base_type) for base_type in base_types]):
                     classes.add(potential_pipeline)
-
     return classes
 
 ########################################################################################################################
 
-def find_cells(modules, base_types=None):
+def __index_path():
+    """
+    :returns: the path of the file caching the class index. It can be overridden with the ORK_CELL_INDEX environment
+        variable (an empty value disables the cache)
+    """
+    if 'ORK_CELL_INDEX' in os.environ:
+        return os.environ['ORK_CELL_INDEX']
+    cache_dir = os.environ.get('XDG_CACHE_HOME', os.path.join(os.path.expanduser('~'), '.cache'))
+    return os.path.join(cache_dir, 'object_recognition_core', 'cell_index.json')
+
+def __index_key(modules):
+    return '%d.%d:%s' % (sys.version_info[0], sys.version_info[1], ','.join(sorted(modules)))
+
+def __read_index(modules, signature):
+    """
+    Read the class index of some packages from the cache
+
+    :param modules: The names of the packages
+    :param signature: the signature of the files in those packages, as returned by __list_modules
+    :returns: a dictionary of class name to list of module names, or None if the cache is missing or outdated
+    """
+    path = __index_path()
+    if not path:
+        return None
+    try:
+        with open(path) as index_file:
+            entry = json.load(index_file).get(__index_key(modules))
+    except (IOError, OSError, ValueError):
+        return None
+    if entry is None or entry['signature'] != signature:
+        return None
+    return entry['classes']
+
+def __write_index(modules, signature, modules_loaded):
+    """
+    Cache the class index of some packages: for each class name, the modules where it can be found
+
+    :param modules: The names of the packages
+    :param signature: the signature of the files in those packages, as returned by __list_modules
+    :param modules_loaded: the imported modules of those packages
+    """
+    path = __index_path()
+    if not path:
+        return
+    classes = {}
+    for pymodule in modules_loaded:
+        for class_class in __module_classes(pymodule, modules):
+            module_names = classes.setdefault(class_class.__name__, [])
+            if pymodule.__name__ not in module_names:
+                module_names.append(pymodule.__name__)
+    try:
+        with open(path) as index_file:
+            index = json.load(index_file)
+    except (IOError, OSError, ValueError):
+        index = {}
+    index[__index_key(modules)] = {'signature': signature, 'classes': classes}
+    # write to a temporary file first so that concurrent readers never see a partial index
+    try:
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path))
+        tmp_path = '%s.%d' % (path, os.getpid())
+        with open(tmp_path, 'w') as index_file:
+            json.dump(index, index_file)
+        os.rename(tmp_path, path)
+    except (IOError, OSError):
+        pass
+
+########################################################################################################################
+
+@phase('find_classes')
+def find_classes(modules, base_types, class_name=None):
+    """
+    Given a list of python packages, or modules, find all implementations of a class.
+    When looking for a specific class, an index of the classes (cached and invalidated with the modification times of
+    the files) is used to only import the modules defining a class of that name.
+
+    :param modules: The names of the modules to look into
+    :param base_type: any class type (TrainingPipeline, Sink ...). Can be empty.
+    :param class_name: if not None, only the classes of that name are returned
+    :returns: A set of found classes
+    """
+    module_names, signature = __list_modules(modules)
+
+    if class_name is not None:
+        index = __read_index(modules, signature)
+        if index is not None and class_name in index:
+            classes = __filter_classes(__import_modules(modules, index[class_name]), modules, base_types, class_name)
+            if classes:
+                return classes
+
+    modules_loaded = __import_modules(modules, module_names)
+    __write_index(modules, signature, modules_loaded)
+
+    return __filter_classes(modules_loaded, modules, base_types, class_name)
+
+########################################################################################################################
+
+def find_cells(modules, base_types=None, cell_name=None):
     """
     Given a list of python packages, or modules, find all ecto cells that also inherit from some base types.
 
     :param modules: The names of the modules to look into
     :param base_types: a list of any class type (TrainingPipeline, Sink ...)
+    :param cell_name: if not None, only the cells of that name are returned
     :returns: A set of found cell classes
     """
     if base_types is None:
-        potential_cells = find_classes(modules, [])
+        potential_cells = find_classes(modules, [], cell_name)
     else:
-        potential_cells = find_classes(modules, base_types)
+        potential_cells = find_classes(modules, base_types, cell_name)
 
     cells = set([cell_class for cell_class in potential_cells if getattr(cell_class, '__looks_like_a_cell__', False) ])
 
@@ -138,7 +281,7 @@ def find_class(modules, class_name, base_types=None):
     :param base_types: a list of any class type (TrainingPipeline, Sink ...)
     :returns: A dictionary of found classes: the key is the class name and the value the object class itself
     """
-    classes = find_cells(modules, base_types)
+    classes = find_cells(modules, base_types, class_name)
 
     return __find_unique_class(class_name, classes, base_types, modules)
 
@@ -154,6 +297,6 @@ def find_cell(modules, cell_name, base_types=None):
     :param base_types: a list of any class type (TrainingPipeline, Sink ...)
     :returns: A dictionary of found classes: the key is the class name and the value the object class itself
     """
-    cells = find_cells(modules, base_types)
+    cells = find_cells(modules, base_types, cell_name)
 
     return __find_unique_class(cell_name, cells, base_types, modules)
@@ -0,0 +1,57 @@
+"""
+Module to record the phases of the startup of a pipeline (cell discovery, plasm creation, model loading ...) in the
+same timeline as the C++ code. If the ORK_STARTUP_PROFILE environment variable is set, a breakdown table is printed
+when the program exits and the timeline is written to that file in the Chrome trace format.
+"""
+from object_recognition_core.boost.common import startup_begin, startup_end, startup_mark, startup_table, \
+    startup_write_trace
+import functools
+
+class phase(object):
+    """
+    Context manager/decorator recording a phase of the startup:
+
+        >>> with phase('create_plasm'):
+        >>>     ...
+        >>> @phase('find_classes')
+        >>> def find_classes(...):
+    """
+    def __init__(self, name):
+        self.name = name
+
+    def __enter__(self):
+        startup_begin(self.name)
+        return self
+
+    def __exit__(self, exc_type, exc_value, exc_traceback):
+        startup_end(self.name)
+        return False
+
+    def __call__(self, function):
+        @functools.wraps(function)
+        def wrapper(*args, **kwargs):
+            with phase(self.name):
+                return function(*args, **kwargs)
+        return wrapper
+
+def mark(name):
+    """
+    Record an instant event in the startup timeline
+
+    :param name: the name of the event
+    """
+    startup_mark(name)
+
+def table():
+    """
+    :return: the startup timeline as a table of start times and durations since the launch of the process
+    """
+    return startup_table()
+
+def write_trace(path):
+    """
+    Write the startup timeline in the Chrome trace format (to open in chrome://tracing or ui.perfetto.dev)
+
+    :param path: the file to write to
+    """
+    startup_write_trace(path)
@@ -53,7 +53,7 @@ def read_arguments_from_string(parameter_str):
                                     'val is the dictionary or its parameters')
 
     # Go over the different cells
-    allowed_keys = set(['type', 'module', 'parameters', 'inputs', 'outputs'])
+    allowed_keys = set(['type', 'module', 'parameters', 'inputs', 'outputs', 'gate'])
     for cell_name, cell_params in params.items():
         # Make sure we can find the cell:
         if 'type' not in cell_params or 'module' not in cell_params:
@@ -7,8 +7,8 @@ d = generate_distutils_setup(
                 'object_recognition_core.io', 'object_recognition_core.pipelines',
                 'object_recognition_core.utils', 'couchdb'],
     package_dir={'': 'python'},
-    scripts=['apps/detection', 'apps/training', 'apps/dbscripts/copy_db.py',
-             'apps/dbscripts/mesh_add.py', 'apps/dbscripts/object_add.py',
+    scripts=['apps/batch_detection', 'apps/detection', 'apps/training', 'apps/dbscripts/copy_db.py',
+             'apps/dbscripts/garbage_collect.py', 'apps/dbscripts/mesh_add.py', 'apps/dbscripts/object_add.py',
              'apps/dbscripts/object_delete.py', 'apps/dbscripts/object_search.py']
 )
 
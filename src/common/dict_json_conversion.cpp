@@ -35,9 +35,12 @@
 #include <map>
 #include <string>
 
+#include <boost/cstdint.hpp>
+#include <boost/foreach.hpp>
 #include <boost/python.hpp>
 
 #include <object_recognition_core/common/json.hpp>
+#include <object_recognition_core/common/dict_json_conversion.h>
 
 namespace bp = boost::python;
 
@@ -45,35 +48,140 @@ namespace object_recognition_core
 {
   namespace common
   {
+    /** @return the UTF-8 content of a Python string (str or unicode), or throw if it is not one */
+    static std::string
+    PyStringToString(PyObject * object)
+    {
+#if PY_MAJOR_VERSION < 3
+      if (PyString_Check(object))
+        return std::string(PyString_AS_STRING(object), PyString_GET_SIZE(object));
+#endif
+      if (PyUnicode_Check(object))
+      {
+        bp::handle<> utf8(PyUnicode_AsUTF8String(object));
+        return std::string(PyBytes_AS_STRING(utf8.get()), PyBytes_GET_SIZE(utf8.get()));
+      }
+      if (PyBytes_Check(object))
+        return std::string(PyBytes_AS_STRING(object), PyBytes_GET_SIZE(object));
+      throw std::runtime_error(std::string("BpObjectToJson: keys must be strings, not ") + Py_TYPE(object)->tp_name);
+    }
+
+    static or_json::mValue
+    PyObjectToJson(PyObject * object);
+
+    static or_json::mObject
+    PyDictToJson(PyObject * dict)
+    {
+      or_json::mObject json_object;
+      PyObject * key, * value;
+      Py_ssize_t position = 0;
+      while (PyDict_Next(dict, &position, &key, &value))
+        json_object[PyStringToString(key)] = PyObjectToJson(value);
+      return json_object;
+    }
+
+    /** Convert a Python object by checking its type directly (and not by trying several bp::extract) */
+    static or_json::mValue
+    PyObjectToJson(PyObject * object)
+    {
+      if (object == Py_None)
+        return or_json::mValue();
+      // bool is a subclass of int so it has to be checked first
+      if (PyBool_Check(object))
+        return or_json::mValue(object == Py_True);
+#if PY_MAJOR_VERSION < 3
+      if (PyInt_Check(object))
+        return or_json::mValue(boost::int64_t(PyInt_AS_LONG(object)));
+#endif
+      if (PyLong_Check(object))
+      {
+        int overflow;
+        long long value = PyLong_AsLongLongAndOverflow(object, &overflow);
+        if (overflow == 0)
+          return or_json::mValue(boost::int64_t(value));
+        unsigned long long unsigned_value = PyLong_AsUnsignedLongLong(object);
+        if (PyErr_Occurred())
+          bp::throw_error_already_set();
+        return or_json::mValue(boost::uint64_t(unsigned_value));
+      }
+      if (PyFloat_Check(object))
+        return or_json::mValue(PyFloat_AS_DOUBLE(object));
+#if PY_MAJOR_VERSION < 3
+      if (PyString_Check(object) || PyUnicode_Check(object))
+#else
+      if (PyUnicode_Check(object) || PyBytes_Check(object))
+#endif
+        return or_json::mValue(PyStringToString(object));
+      if (PyDict_Check(object))
+        return or_json::mValue(PyDictToJson(object));
+      if (PyList_Check(object) || PyTuple_Check(object))
+      {
+        bp::handle<> sequence(PySequence_Fast(object, "BpObjectToJson: expected a sequence"));
+        Py_ssize_t size = PySequence_Fast_GET_SIZE(sequence.get());
+        PyObject ** items = PySequence_Fast_ITEMS(sequence.get());
+        or_json::mArray array;
+        array.reserve(size);
+        for (Py_ssize_t i = 0; i < size; ++i)
+          array.push_back(PyObjectToJson(items[i]));
+        return or_json::mValue(array);
+      }
+      // anything else that can be used as an integer (e.g. numpy integers) keeps its exact value
+      if (PyIndex_Check(object))
+      {
+        bp::handle<> index(PyNumber_Index(object));
+        return PyObjectToJson(index.get());
+      }
+      // anything else that behaves like a number (e.g. numpy floats)
+      if (PyNumber_Check(object))
+      {
+        bp::handle<> number(PyNumber_Float(object));
+        return or_json::mValue(PyFloat_AS_DOUBLE(number.get()));
+      }
+      throw std::runtime_error(std::string("BpObjectToJson: unimplemented type ") + Py_TYPE(object)->tp_name);
+    }
+
+    or_json::mValue
+    BpObjectToJson(const bp::object &bp_object)
+    {
+      return PyObjectToJson(bp_object.ptr());
+    }
+
     or_json::mObject
     BpDictToJson(const bp::dict &bp_dict)
     {
-      or_json::mObject params;
-      bp::list l = bp_dict.items();
-      for (int j = 0, end = bp::len(l); j < end; ++j)
+      return PyDictToJson(bp_dict.ptr());
+    }
+
+    bp::object
+    JsonToBpObject(const or_json::mValue & value)
+    {
+      switch (value.type())
       {
-        std::string key = bp::extract<std::string>(l[j][0]);
-        // Try to extract a string
-        {
-          bp::extract<std::string> extract(l[j][1]);
-          if (extract.check())
-          {
-            params[key] = or_json::mValue(std::string(extract));
-            continue;
-          }
-        }
-        // Try to extract an int
+        case or_json::null_type:
+          return bp::object();
+        case or_json::bool_type:
+          return bp::object(value.get_bool());
+        case or_json::int_type:
+          if (value.is_uint64())
+            return bp::object(bp::handle<>(PyLong_FromUnsignedLongLong(value.get_uint64())));
+          return bp::object(bp::handle<>(PyLong_FromLongLong(value.get_int64())));
+        case or_json::real_type:
+          return bp::object(bp::handle<>(PyFloat_FromDouble(value.get_real())));
+        case or_json::str_type:
+          return bp::object(value.get_str());
+        case or_json::obj_type:
+          return JsonToBpDict(value.get_obj());
+        case or_json::array_type:
         {
-          bp::extract<int> extract(l[j][1]);
-          if (extract.check())
-          {
-            params[key] = or_json::mValue(int(extract));
-            continue;
-          }
+          const or_json::mArray & array = value.get_array();
+          bp::handle<> bp_list(PyList_New(array.size()));
+          for (size_t i = 0; i < array.size(); ++i)
+            // PyList_SET_ITEM steals the reference
+            PyList_SET_ITEM(bp_list.get(), i, bp::incref(JsonToBpObject(array[i]).ptr()));
+          return bp::object(bp_list);
         }
-        throw std::runtime_error("BpDictToJson: unimplemented type");
       }
-      return params;
+      throw std::runtime_error("JsonToBpObject: unimplemented type");
     }
 
     bp::dict
@@ -81,19 +189,8 @@ namespace object_recognition_core
     {
       bp::dict bp_dict;
       for (or_json::mObject::const_iterator iter = map.begin(), end = map.end(); iter != end; ++iter)
-      {
-        switch (iter->second.type())
-        {
-          case or_json::int_type:
-            bp_dict[iter->first] = iter->second.get_int();
-            break;
-          case or_json::str_type:
-            bp_dict[iter->first] = iter->second.get_str();
-            break;
-          default:
-            throw std::runtime_error("MapToBpDict unimplemented type");
-        }
-      }
+        if (PyDict_SetItemString(bp_dict.ptr(), iter->first.c_str(), JsonToBpObject(iter->second).ptr()) < 0)
+          bp::throw_error_already_set();
       return bp_dict;
     }
   }
@@ -0,0 +1,112 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <object_recognition_core/common/mat_pool.h>
+#include <object_recognition_core/common/metrics.h>
+
+namespace
+{
+  /** @return true if the pool holds the only reference to a buffer */
+  bool
+  IsUnused(const cv::Mat & buffer)
+  {
+#if OPENCV3
+    return buffer.u && (buffer.u->refcount == 1) && (buffer.u->urefcount == 0);
+#else
+    return buffer.refcount && (*buffer.refcount == 1);
+#endif
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    MatPool::MatPool(size_t max_buffers_per_class)
+        :
+          max_buffers_per_class_(max_buffers_per_class)
+    {
+    }
+
+    MatPool &
+    MatPool::Instance()
+    {
+      // Never deleted as cells can release their outputs until the very end of the program
+      static MatPool * pool = new MatPool();
+      return *pool;
+    }
+
+    cv::Mat
+    MatPool::Acquire(int rows, int cols, int type)
+    {
+      static const char * const help = "Buffers of the cv::Mat pool that were recycled (hit) or allocated (miss)";
+      static Counter & n_hits = MetricsRegistry::Instance().counter("ork_mat_pool_total", "result=\"hit\"", help);
+      static Counter & n_misses = MetricsRegistry::Instance().counter("ork_mat_pool_total", "result=\"miss\"", help);
+
+      boost::mutex::scoped_lock lock(mutex_);
+      std::vector<cv::Mat> & buffers = buffers_[SizeClass(rows, cols, type)];
+      for (size_t i = 0; i < buffers.size(); ++i)
+        if (IsUnused(buffers[i]))
+        {
+          n_hits.Increment();
+          return buffers[i];
+        }
+
+      n_misses.Increment();
+      cv::Mat buffer(rows, cols, type);
+      if (buffers.size() < max_buffers_per_class_)
+        buffers.push_back(buffer);
+      return buffer;
+    }
+
+    void
+    MatPool::Clear()
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      buffers_.clear();
+    }
+
+    size_t
+    MatPool::size() const
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      size_t size = 0;
+      for (std::map<SizeClass, std::vector<cv::Mat> >::const_iterator iter = buffers_.begin(); iter != buffers_.end();
+          ++iter)
+        size += iter->second.size();
+      return size;
+    }
+  }
+}
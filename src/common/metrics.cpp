@@ -0,0 +1,331 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+
+namespace
+{
+  /** @return the time in microseconds */
+  boost::uint64_t
+  now()
+  {
+    static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+  }
+
+  /** @return the labels of a metric with an extra label */
+  std::string
+  with_label(const std::string & labels, const std::string & label)
+  {
+    return "{" + labels + (labels.empty() ? "" : ",") + label + "}";
+  }
+
+  std::string
+  braces(const std::string & labels)
+  {
+    return labels.empty() ? "" : "{" + labels + "}";
+  }
+
+  /** Starts the export if ORK_METRICS_FILE is set and makes sure the last metrics are written at exit */
+  struct MetricsFile
+  {
+    MetricsFile()
+    {
+      const char * path = std::getenv("ORK_METRICS_FILE");
+      if (!path || !*path)
+        return;
+      const char * period = std::getenv("ORK_METRICS_PERIOD");
+      object_recognition_core::common::MetricsRegistry::Instance().StartExport(
+          path, (period && *period) ? std::atof(period) : 10);
+    }
+
+    ~MetricsFile()
+    {
+      object_recognition_core::common::MetricsRegistry::Instance().StopExport();
+    }
+  };
+
+  MetricsFile metrics_file;
+}
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    Histogram::Histogram()
+        :
+          count_(0),
+          sum_(0)
+    {
+      for (int i = 0; i < N_BUCKETS; ++i)
+        buckets_[i].store(0, boost::memory_order_relaxed);
+    }
+
+    int
+    Histogram::BucketIndex(boost::uint64_t value)
+    {
+      if (value < boost::uint64_t(N_SUB_BUCKETS))
+        return int(value);
+      // The highest bit gives the power of two, the next SUB_BUCKET_BITS bits give the bucket within it
+      int msb = 63 - __builtin_clzll(value);
+      int shift = msb - SUB_BUCKET_BITS;
+      return (shift + 1) * N_SUB_BUCKETS + int((value >> shift) & (N_SUB_BUCKETS - 1));
+    }
+
+    void
+    Histogram::Record(boost::uint64_t microseconds)
+    {
+      buckets_[BucketIndex(microseconds)].fetch_add(1, boost::memory_order_relaxed);
+      count_.fetch_add(1, boost::memory_order_relaxed);
+      sum_.fetch_add(microseconds, boost::memory_order_relaxed);
+    }
+
+    double
+    Histogram::Quantile(double quantile) const
+    {
+      boost::uint64_t count = this->count();
+      if (count == 0)
+        return 0;
+      boost::uint64_t rank = std::max<boost::uint64_t>(1, boost::uint64_t(quantile * count + 0.5));
+      boost::uint64_t n_seen = 0;
+      for (int i = 0; i < N_BUCKETS; ++i)
+      {
+        n_seen += buckets_[i].load(boost::memory_order_relaxed);
+        if (n_seen < rank)
+          continue;
+        // Return the middle of the bucket
+        if (i < N_SUB_BUCKETS)
+          return i;
+        int shift = i / N_SUB_BUCKETS - 1;
+        double lower = double((N_SUB_BUCKETS + i % N_SUB_BUCKETS)) * double(boost::uint64_t(1) << shift);
+        return lower + double(boost::uint64_t(1) << shift) / 2;
+      }
+      // The buckets are read while being written: the last values might not be in the count yet
+      return Quantile(1.0 * n_seen / count);
+    }
+
+    ScopedLatency::ScopedLatency(Histogram & histogram)
+        :
+          histogram_(histogram),
+          start_(now())
+    {
+    }
+
+    ScopedLatency::~ScopedLatency()
+    {
+      histogram_.Record(now() - start_);
+    }
+
+    MetricsRegistry &
+    MetricsRegistry::Instance()
+    {
+      // Never deleted so that the metrics can be updated until the very end of the program
+      static MetricsRegistry * registry = new MetricsRegistry();
+      return *registry;
+    }
+
+    MetricsRegistry::MetricsRegistry()
+    {
+    }
+
+    void
+    MetricsRegistry::Family::Check(const std::string & name, const std::string & help, bool has_other_kinds)
+    {
+      // Prometheus only allows one type per name
+      if (has_other_kinds)
+        throw std::runtime_error("The metric " + name + " is already used by another kind of metric.");
+      if (!help.empty())
+        help_ = help;
+    }
+
+    Counter &
+    MetricsRegistry::counter(const std::string & name, const std::string & labels, const std::string & help)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      Family & family = families_[name];
+      family.Check(name, help, !family.gauges_.empty() || !family.histograms_.empty());
+      boost::shared_ptr<Counter> & counter = family.counters_[labels];
+      if (!counter)
+        counter.reset(new Counter());
+      return *counter;
+    }
+
+    Gauge &
+    MetricsRegistry::gauge(const std::string & name, const std::string & labels, const std::string & help)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      Family & family = families_[name];
+      family.Check(name, help, !family.counters_.empty() || !family.histograms_.empty());
+      boost::shared_ptr<Gauge> & gauge = family.gauges_[labels];
+      if (!gauge)
+        gauge.reset(new Gauge());
+      return *gauge;
+    }
+
+    Histogram &
+    MetricsRegistry::histogram(const std::string & name, const std::string & labels, const std::string & help)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      Family & family = families_[name];
+      family.Check(name, help, !family.counters_.empty() || !family.gauges_.empty());
+      boost::shared_ptr<Histogram> & histogram = family.histograms_[labels];
+      if (!histogram)
+        histogram.reset(new Histogram());
+      return *histogram;
+    }
+
+    void
+    MetricsRegistry::WritePrometheus(std::ostream & stream) const
+    {
+      static const double QUANTILES[] =
+      { 0.5, 0.9, 0.99, 0.999 };
+      static const char * const QUANTILE_LABELS[] =
+      { "quantile=\"0.5\"", "quantile=\"0.9\"", "quantile=\"0.99\"", "quantile=\"0.999\"" };
+
+      boost::mutex::scoped_lock lock(mutex_);
+      for (std::map<std::string, Family>::const_iterator family = families_.begin(); family != families_.end();
+          ++family)
+      {
+        const std::string & name = family->first;
+        const Family & metrics = family->second;
+        if (metrics.counters_.empty() && metrics.gauges_.empty() && metrics.histograms_.empty())
+          continue;
+
+        // The registry only lets one kind of metric use a name but each kind is written if it has metrics
+        if (!metrics.help_.empty())
+          stream << "# HELP " << name << " " << metrics.help_ << "\n";
+        if (!metrics.counters_.empty())
+        {
+          stream << "# TYPE " << name << " counter\n";
+          for (std::map<std::string, boost::shared_ptr<Counter> >::const_iterator counter = metrics.counters_.begin();
+              counter != metrics.counters_.end(); ++counter)
+            stream << name << braces(counter->first) << " " << counter->second->value() << "\n";
+        }
+        if (!metrics.gauges_.empty())
+        {
+          stream << "# TYPE " << name << " gauge\n";
+          for (std::map<std::string, boost::shared_ptr<Gauge> >::const_iterator gauge = metrics.gauges_.begin();
+              gauge != metrics.gauges_.end(); ++gauge)
+            stream << name << braces(gauge->first) << " " << gauge->second->value() << "\n";
+        }
+        if (!metrics.histograms_.empty())
+        {
+          stream << "# TYPE " << name << " summary\n";
+          for (std::map<std::string, boost::shared_ptr<Histogram> >::const_iterator histogram =
+              metrics.histograms_.begin(); histogram != metrics.histograms_.end(); ++histogram)
+          {
+            for (size_t i = 0; i < sizeof(QUANTILES) / sizeof(QUANTILES[0]); ++i)
+              stream << name << with_label(histogram->first, QUANTILE_LABELS[i]) << " "
+                     << histogram->second->Quantile(QUANTILES[i]) / 1e6 << "\n";
+            stream << name << "_sum" << braces(histogram->first) << " " << histogram->second->sum() / 1e6 << "\n";
+            stream << name << "_count" << braces(histogram->first) << " " << histogram->second->count() << "\n";
+          }
+        }
+      }
+    }
+
+    void
+    MetricsRegistry::WritePrometheus(const std::string & path) const
+    {
+      std::string tmp_path = path + ".tmp";
+      {
+        std::ofstream file(tmp_path.c_str());
+        WritePrometheus(file);
+        file.close();
+        if (!file)
+          throw std::runtime_error("Could not write the metrics to " + tmp_path);
+      }
+      if (std::rename(tmp_path.c_str(), path.c_str()))
+        throw std::runtime_error("Could not write the metrics to " + path);
+    }
+
+    void
+    MetricsRegistry::StartExport(const std::string & path, double period_seconds)
+    {
+      StopExport();
+      boost::mutex::scoped_lock lock(export_mutex_);
+      export_path_ = path;
+      export_thread_.reset(new boost::thread(boost::bind(&MetricsRegistry::Export, this, path, period_seconds)));
+    }
+
+    void
+    MetricsRegistry::StopExport()
+    {
+      boost::mutex::scoped_lock lock(export_mutex_);
+      if (!export_thread_)
+        return;
+      export_thread_->interrupt();
+      export_thread_->join();
+      export_thread_.reset();
+      try
+      {
+        WritePrometheus(export_path_);
+      } catch (const std::exception & e)
+      {
+        std::cerr << e.what() << std::endl;
+      }
+    }
+
+    void
+    MetricsRegistry::Export(const std::string & path, double period_seconds)
+    {
+      try
+      {
+        while (true)
+        {
+          boost::this_thread::sleep(boost::posix_time::microseconds(boost::int64_t(period_seconds * 1e6)));
+          try
+          {
+            WritePrometheus(path);
+          } catch (const std::exception & e)
+          {
+            std::cerr << e.what() << std::endl;
+          }
+        }
+      } catch (const boost::thread_interrupted &)
+      {
+      }
+    }
+  }
+}
@@ -6,6 +6,10 @@ namespace object_recognition_core
   {
     void
     wrap_db_pose_result();
+  wrap_startup();
+
+    void
+    wrap_startup();
   }
 }
 
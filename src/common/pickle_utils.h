@@ -0,0 +1,148 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_COMMON_PICKLE_UTILS_H_
+#define ORK_CORE_COMMON_PICKLE_UTILS_H_
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/python.hpp>
+
+/** Helpers for the binary pickling of the wrapped classes: the values are written in the native layout, which is fine
+ * as pickles are meant to be exchanged between processes of the same machine (e.g. multiprocessing workers)
+ */
+namespace object_recognition_core
+{
+  namespace common
+  {
+    /** Append values to a binary string */
+    class BinaryWriter
+    {
+    public:
+      template<typename T>
+      void
+      Write(const T & value)
+      {
+        data_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+      }
+
+      void
+      WriteString(const std::string & value)
+      {
+        Write<boost::uint32_t>(value.size());
+        data_.append(value);
+      }
+
+      std::string &
+      data()
+      {
+        return data_;
+      }
+    private:
+      std::string data_;
+    };
+
+    /** Read values from any Python object supporting the buffer protocol (str/bytes, memoryview, PickleBuffer ...)
+     * without copying it
+     */
+    class BinaryReader: boost::noncopyable
+    {
+    public:
+      BinaryReader(const boost::python::object & object)
+      {
+        if (PyObject_GetBuffer(object.ptr(), &view_, PyBUF_SIMPLE) < 0)
+          boost::python::throw_error_already_set();
+        current_ = static_cast<const char *>(view_.buf);
+        end_ = current_ + view_.len;
+      }
+
+      ~BinaryReader()
+      {
+        PyBuffer_Release(&view_);
+      }
+
+      template<typename T>
+      T
+      Read()
+      {
+        T value;
+        std::memcpy(&value, Advance(sizeof(T)), sizeof(T));
+        return value;
+      }
+
+      std::string
+      ReadString()
+      {
+        size_t size = Read<boost::uint32_t>();
+        return std::string(Advance(size), size);
+      }
+
+      /** @return the number of bytes left to read */
+      size_t
+      remaining() const
+      {
+        return end_ - current_;
+      }
+
+      /** @return a pointer to the next size bytes, that are skipped */
+      const char *
+      Advance(size_t size)
+      {
+        if (size_t(end_ - current_) < size)
+          throw std::runtime_error("The pickled data is truncated.");
+        const char * data = current_;
+        current_ += size;
+        return data;
+      }
+    private:
+      Py_buffer view_;
+      const char * current_;
+      const char * end_;
+    };
+
+    /** @return a Python bytes object (a str in Python 2) with a copy of data */
+    inline boost::python::object
+    PickleBytes(const std::string & data)
+    {
+      return boost::python::object(boost::python::handle<>(PyBytes_FromStringAndSize(data.data(), data.size())));
+    }
+  }
+}
+
+#endif /* ORK_CORE_COMMON_PICKLE_UTILS_H_ */
@@ -0,0 +1,280 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <unistd.h>
+
+#include <object_recognition_core/common/startup.h>
+
+namespace
+{
+  /** @return the current time in microseconds since the epoch */
+  boost::uint64_t
+  now()
+  {
+    static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+  }
+
+  /** @return the time the process was launched in microseconds since the epoch, or 0 if it cannot be known */
+  boost::uint64_t
+  process_launch()
+  {
+    // The start of the process in clock ticks after boot is the 22nd field of /proc/self/stat (after the command name
+    // in parentheses, which can contain spaces), the time since boot is in /proc/uptime
+    std::ifstream self_stat("/proc/self/stat");
+    std::string line;
+    std::getline(self_stat, line);
+    size_t command_end = line.rfind(')');
+    if (command_end == std::string::npos)
+      return 0;
+    std::istringstream fields(line.substr(command_end + 2));
+    std::string field;
+    // The state is the 3rd field overall
+    for (int i = 3; i < 22; ++i)
+      fields >> field;
+    double start_ticks = 0, uptime = 0;
+    std::ifstream uptime_file("/proc/uptime");
+    if (!(fields >> start_ticks) || !(uptime_file >> uptime))
+      return 0;
+    double age = uptime - start_ticks / sysconf(_SC_CLK_TCK);
+    return now() - boost::uint64_t(std::max(0.0, age) * 1e6);
+  }
+
+  std::string
+  thread_name()
+  {
+    return boost::lexical_cast<std::string>(boost::this_thread::get_id());
+  }
+
+  /** Escape a string for JSON */
+  std::string
+  json_string(const std::string & str)
+  {
+    std::string res = "\"";
+    for (std::string::const_iterator c = str.begin(); c != str.end(); ++c)
+    {
+      if ((*c == '"') || (*c == '\\'))
+        res += '\\';
+      res += *c;
+    }
+    return res + "\"";
+  }
+
+  /** Prints the breakdown and writes the timeline to ORK_STARTUP_PROFILE, if set, when the program exits */
+  struct StartupFile
+  {
+    StartupFile()
+    {
+      const char * path = std::getenv("ORK_STARTUP_PROFILE");
+      if (path && *path)
+        path_ = path;
+      // Make sure the timeline outlives this object
+      object_recognition_core::common::StartupTimeline::Instance();
+    }
+
+    ~StartupFile()
+    {
+      if (path_.empty())
+        return;
+      try
+      {
+        object_recognition_core::common::StartupTimeline::Instance().WriteTable(std::cerr);
+        object_recognition_core::common::StartupTimeline::Instance().WriteTrace(path_);
+      } catch (const std::exception & e)
+      {
+        std::cerr << e.what() << std::endl;
+      }
+    }
+
+    std::string path_;
+  };
+
+  StartupFile startup_file;
+}
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    StartupTimeline &
+    StartupTimeline::Instance()
+    {
+      // Never deleted so that it can be used until the very end of the program
+      static StartupTimeline * timeline = new StartupTimeline();
+      return *timeline;
+    }
+
+    StartupTimeline::StartupTimeline()
+        :
+          process_start_(process_launch())
+    {
+      if (!process_start_)
+        process_start_ = now();
+    }
+
+    void
+    StartupTimeline::Begin(const std::string & name)
+    {
+      Phase phase;
+      phase.name_ = name;
+      phase.start_ = now();
+      phase.end_ = phase.start_;
+      phase.is_event_ = false;
+      phase.is_open_ = true;
+      phase.depth_ = 0;
+      phase.thread_ = thread_name();
+
+      boost::mutex::scoped_lock lock(mutex_);
+      for (std::vector<Phase>::const_iterator other = phases_.begin(); other != phases_.end(); ++other)
+        if (other->is_open_ && (other->thread_ == phase.thread_))
+          ++phase.depth_;
+      phases_.push_back(phase);
+    }
+
+    void
+    StartupTimeline::End(const std::string & name)
+    {
+      boost::uint64_t end = now();
+      std::string thread = thread_name();
+
+      boost::mutex::scoped_lock lock(mutex_);
+      for (std::vector<Phase>::reverse_iterator phase = phases_.rbegin(); phase != phases_.rend(); ++phase)
+        if (phase->is_open_ && (phase->name_ == name) && (phase->thread_ == thread))
+        {
+          phase->end_ = end;
+          phase->is_open_ = false;
+          return;
+        }
+    }
+
+    void
+    StartupTimeline::Mark(const std::string & name)
+    {
+      Phase phase;
+      phase.name_ = name;
+      phase.start_ = now();
+      phase.end_ = phase.start_;
+      phase.is_event_ = true;
+      phase.is_open_ = false;
+      phase.depth_ = 0;
+      phase.thread_ = thread_name();
+
+      boost::mutex::scoped_lock lock(mutex_);
+      for (std::vector<Phase>::const_iterator other = phases_.begin(); other != phases_.end(); ++other)
+        if (other->is_open_ && (other->thread_ == phase.thread_))
+          ++phase.depth_;
+      phases_.push_back(phase);
+    }
+
+    void
+    StartupTimeline::WriteTable(std::ostream & stream) const
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      boost::uint64_t end = process_start_;
+      for (std::vector<Phase>::const_iterator phase = phases_.begin(); phase != phases_.end(); ++phase)
+        end = std::max(end, phase->is_open_ ? now() : phase->end_);
+
+      stream << std::left << std::setw(60) << "Startup phase" << std::right << std::setw(12) << "start (s)"
+             << std::setw(14) << "duration (s)" << std::setw(8) << "%" << std::endl;
+      std::ios::fmtflags flags = stream.flags();
+      stream << std::fixed << std::setprecision(3);
+      for (std::vector<Phase>::const_iterator phase = phases_.begin(); phase != phases_.end(); ++phase)
+      {
+        std::string name = std::string(2 * phase->depth_, ' ') + (phase->is_event_ ? "* " : "") + phase->name_;
+        stream << std::left << std::setw(60) << name << std::right << std::setw(12)
+               << (phase->start_ - process_start_) / 1e6;
+        if (phase->is_event_)
+          stream << std::endl;
+        else if (phase->is_open_)
+          stream << std::setw(14) << "running" << std::endl;
+        else
+          stream << std::setw(14) << (phase->end_ - phase->start_) / 1e6 << std::setw(8) << std::setprecision(1)
+                 << ((end > process_start_) ? 100.0 * (phase->end_ - phase->start_) / (end - process_start_) : 0)
+                 << std::setprecision(3) << std::endl;
+      }
+      stream << std::left << std::setw(60) << "total" << std::right << std::setw(12) << 0.0 << std::setw(14)
+             << (end - process_start_) / 1e6 << std::endl;
+      stream.flags(flags);
+    }
+
+    void
+    StartupTimeline::WriteTrace(std::ostream & stream) const
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      int pid = getpid();
+      std::map<std::string, int> tids;
+
+      stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+      stream << "{\"ph\": \"i\", \"s\": \"p\", \"pid\": " << pid << ", \"tid\": 1, \"ts\": 0, \"cat\": \"startup\", "
+             << "\"name\": \"process launch\"}";
+      for (std::vector<Phase>::const_iterator phase = phases_.begin(); phase != phases_.end(); ++phase)
+      {
+        if (!tids.count(phase->thread_))
+        {
+          int tid = tids.size() + 1;
+          tids[phase->thread_] = tid;
+        }
+        stream << ",\n{\"pid\": " << pid << ", \"tid\": " << tids[phase->thread_] << ", \"ts\": "
+               << (phase->start_ - process_start_) << ", \"cat\": \"startup\", \"name\": " << json_string(phase->name_);
+        if (phase->is_event_)
+          stream << ", \"ph\": \"i\", \"s\": \"t\"}";
+        else
+          stream << ", \"ph\": \"X\", \"dur\": " << ((phase->is_open_ ? now() : phase->end_) - phase->start_) << "}";
+      }
+      stream << "\n]}" << std::endl;
+    }
+
+    void
+    StartupTimeline::WriteTrace(const std::string & path) const
+    {
+      std::ofstream file(path.c_str());
+      if (!file)
+        throw std::runtime_error("Could not open the startup profile " + path);
+      WriteTrace(file);
+    }
+  }
+}
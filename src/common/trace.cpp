@@ -0,0 +1,270 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <unistd.h>
+
+#include <object_recognition_core/common/trace.h>
+
+namespace
+{
+  /** The number of spans a thread can record before new ones are dropped */
+  const size_t BUFFER_SIZE = 1 << 16;
+
+  struct Event
+  {
+    const char * category_;
+    const char * name_;
+    boost::uint64_t start_, duration_;
+  };
+
+  /** The spans of a thread: only that thread writes to it and it publishes them through size_, so that the dump does
+   * not need to lock anything
+   */
+  struct ThreadBuffer
+  {
+    ThreadBuffer(int tid)
+        :
+          events_(BUFFER_SIZE),
+          size_(0),
+          n_dropped_(0),
+          tid_(tid)
+    {
+    }
+
+    void
+    push(const Event & event)
+    {
+      size_t size = size_.load(boost::memory_order_relaxed);
+      if (size == events_.size())
+      {
+        ++n_dropped_;
+        return;
+      }
+      events_[size] = event;
+      size_.store(size + 1, boost::memory_order_release);
+    }
+
+    std::vector<Event> events_;
+    boost::atomic<size_t> size_;
+    size_t n_dropped_;
+    int tid_;
+  };
+
+  /** Writes the trace to ORK_TRACE_FILE, if set, when the program exits */
+  struct TraceFile
+  {
+    TraceFile()
+    {
+      const char * path = std::getenv("ORK_TRACE_FILE");
+      if (path && *path)
+        path_ = path;
+    }
+
+    ~TraceFile()
+    {
+      if (path_.empty())
+        return;
+      try
+      {
+        object_recognition_core::common::DumpTrace(path_);
+      } catch (const std::exception & e)
+      {
+        std::cerr << e.what() << std::endl;
+      }
+    }
+
+    std::string path_;
+  };
+
+  /** The buffers of all the threads: they are never freed so that the spans of finished threads (and of the ones
+   * still running when the program exits) can be dumped
+   */
+  std::vector<boost::shared_ptr<ThreadBuffer> > &
+  buffers()
+  {
+    static std::vector<boost::shared_ptr<ThreadBuffer> > * buffers = new std::vector<boost::shared_ptr<ThreadBuffer> >();
+    return *buffers;
+  }
+
+  boost::mutex buffers_mutex;
+
+  /** The thread_specific_ptr does not own the buffers: they outlive their thread */
+  void
+  no_cleanup(ThreadBuffer *)
+  {
+  }
+
+  boost::thread_specific_ptr<ThreadBuffer> thread_buffer(no_cleanup);
+
+  ThreadBuffer &
+  current_buffer()
+  {
+    ThreadBuffer * buffer = thread_buffer.get();
+    if (!buffer)
+    {
+      boost::mutex::scoped_lock lock(buffers_mutex);
+      buffers().push_back(boost::shared_ptr<ThreadBuffer>(new ThreadBuffer(buffers().size() + 1)));
+      buffer = buffers().back().get();
+      thread_buffer.reset(buffer);
+    }
+    return *buffer;
+  }
+
+  const boost::posix_time::ptime epoch = boost::posix_time::microsec_clock::universal_time();
+
+  /** @return the time in microseconds since the library was loaded */
+  boost::uint64_t
+  now()
+  {
+    return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+  }
+
+  TraceFile trace_file;
+
+  boost::atomic<bool> enabled(!trace_file.path_.empty());
+
+  /** Escape a string for JSON: names are literals but they could contain templates or quotes */
+  void
+  write_string(std::ostream & stream, const char * str)
+  {
+    stream << '"';
+    for (; *str; ++str)
+    {
+      if ((*str == '"') || (*str == '\\'))
+        stream << '\\';
+      stream << *str;
+    }
+    stream << '"';
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    bool
+    TraceEnabled()
+    {
+      return enabled.load(boost::memory_order_relaxed);
+    }
+
+    void
+    SetTraceEnabled(bool is_enabled)
+    {
+      enabled.store(is_enabled);
+    }
+
+    void
+    DumpTrace(std::ostream & stream)
+    {
+      boost::mutex::scoped_lock lock(buffers_mutex);
+      int pid = getpid();
+      size_t n_dropped = 0;
+      bool is_first = true;
+
+      stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+      BOOST_FOREACH(const boost::shared_ptr<ThreadBuffer> & buffer, buffers())
+      {
+        size_t size = buffer->size_.load(boost::memory_order_acquire);
+        for (size_t i = 0; i < size; ++i)
+        {
+          const Event & event = buffer->events_[i];
+          stream << (is_first ? "\n" : ",\n") << "{\"ph\": \"X\", \"pid\": " << pid << ", \"tid\": " << buffer->tid_
+                 << ", \"ts\": " << event.start_ << ", \"dur\": " << event.duration_ << ", \"cat\": ";
+          write_string(stream, event.category_);
+          stream << ", \"name\": ";
+          write_string(stream, event.name_);
+          stream << "}";
+          is_first = false;
+        }
+        n_dropped += buffer->n_dropped_;
+      }
+      stream << "\n], \"otherData\": {\"dropped_events\": " << n_dropped << "}}" << std::endl;
+    }
+
+    void
+    DumpTrace(const std::string & path)
+    {
+      std::ofstream file(path.c_str());
+      if (!file)
+        throw std::runtime_error("Could not open the trace file " + path);
+      DumpTrace(file);
+    }
+
+    void
+    ClearTrace()
+    {
+      boost::mutex::scoped_lock lock(buffers_mutex);
+      BOOST_FOREACH(const boost::shared_ptr<ThreadBuffer> & buffer, buffers())
+      {
+        buffer->size_.store(0);
+        buffer->n_dropped_ = 0;
+      }
+    }
+
+    TraceScope::TraceScope(const char * category, const char * name)
+        :
+          category_(category),
+          name_(name),
+          is_recorded_(TraceEnabled()),
+          start_(is_recorded_ ? now() : 0)
+    {
+    }
+
+    TraceScope::~TraceScope()
+    {
+      if (!is_recorded_)
+        return;
+      Event event;
+      event.category_ = category_;
+      event.name_ = name_;
+      event.start_ = start_;
+      event.duration_ = now() - event.start_;
+      current_buffer().push(event);
+    }
+  }
+}
@@ -32,8 +32,11 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  *
  */
+#include <algorithm>
 #include <string>
 
+#include <boost/cstdint.hpp>
+#include <boost/foreach.hpp>
 #include <boost/function.hpp>
 #include <boost/python.hpp>
 #include <boost/python/stl_iterator.hpp>
@@ -42,6 +45,8 @@
 
 #include <object_recognition_core/common/pose_result.h>
 
+#include "pickle_utils.h"
+
 namespace bp = boost::python;
 
 namespace object_recognition_core
@@ -69,28 +74,146 @@ namespace object_recognition_core
       return p;
     }
 
+    /** The version of the binary layout of the pickled PoseResults */
+    static const boost::uint32_t POSE_RESULTS_PICKLE_VERSION = 1;
+
+    /** Write PoseResults in a compact binary layout: the distinct DB parameters as JSON, then one fixed-size record
+     * (R, T, confidence, index of the DB) and the object id per result. The point clouds are not pickled
+     * @param pose_results the results to write
+     * @return the binary data
+     */
+    std::string
+    SerializePoseResults(const PoseResults & pose_results)
+    {
+      // the results usually share very few DBs: only write their parameters once
+      std::vector<db::ObjectDbPtr> dbs;
+      std::vector<boost::int32_t> db_indices(pose_results.size(), -1);
+      for (size_t i = 0; i < pose_results.size(); ++i)
+      {
+        const db::ObjectDbPtr & db = pose_results[i].db();
+        if (!db)
+          continue;
+        db_indices[i] = std::find(dbs.begin(), dbs.end(), db) - dbs.begin();
+        if (db_indices[i] == boost::int32_t(dbs.size()))
+          dbs.push_back(db);
+      }
+
+      BinaryWriter writer;
+      writer.Write<boost::uint32_t>(POSE_RESULTS_PICKLE_VERSION);
+      writer.Write<boost::uint32_t>(dbs.size());
+      BOOST_FOREACH(const db::ObjectDbPtr & db, dbs)
+        writer.WriteString(or_json::write(db->parameters().raw()));
+
+      writer.Write<boost::uint32_t>(pose_results.size());
+      for (size_t i = 0; i < pose_results.size(); ++i)
+      {
+        const PoseResultType & pose_result = pose_results[i];
+        std::vector<float> R = pose_result.R(), T = pose_result.T();
+        for (size_t j = 0; j < 9; ++j)
+          writer.Write<float>(R[j]);
+        for (size_t j = 0; j < 3; ++j)
+          writer.Write<float>(T[j]);
+        writer.Write<float>(pose_result.confidence());
+        writer.Write<boost::int32_t>(db_indices[i]);
+        writer.WriteString(pose_result.object_id());
+      }
+
+      return writer.data();
+    }
+
+    /** Read PoseResults written by SerializePoseResults
+     * @param data a Python object supporting the buffer protocol
+     * @param pose_results the read results
+     */
+    void
+    DeserializePoseResults(const bp::object & data, PoseResults & pose_results)
+    {
+      BinaryReader reader(data);
+      if (reader.Read<boost::uint32_t>() != POSE_RESULTS_PICKLE_VERSION)
+        throw std::runtime_error("Unsupported version of pickled PoseResults.");
+
+      // the unpickled results live in another process: leave the journals of the tiered DBs to the original one
+      std::vector<db::ObjectDbPtr> dbs(reader.Read<boost::uint32_t>());
+      for (size_t i = 0; i < dbs.size(); ++i)
+        dbs[i] = db::ObjectDbParameters(reader.ReadString()).secondary().generateDb();
+
+      pose_results.resize(reader.Read<boost::uint32_t>());
+      std::vector<float> R(9), T(3);
+      BOOST_FOREACH(PoseResultType & pose_result, pose_results)
+      {
+        for (size_t j = 0; j < 9; ++j)
+          R[j] = reader.Read<float>();
+        for (size_t j = 0; j < 3; ++j)
+          T[j] = reader.Read<float>();
+        pose_result.set_R(R);
+        pose_result.set_T(T);
+        pose_result.set_confidence(reader.Read<float>());
+        boost::int32_t db_index = reader.Read<boost::int32_t>();
+        if ((db_index < -1) || (db_index >= boost::int32_t(dbs.size())))
+          throw std::runtime_error("Invalid DB in pickled PoseResults.");
+        pose_result.set_object_id((db_index >= 0) ? dbs[db_index] : db::ObjectDbPtr(), reader.ReadString());
+      }
+    }
+
+    static void
+    CheckPickleState(const bp::tuple & state)
+    {
+      if (bp::len(state) != 1)
+      {
+        PyErr_SetObject(PyExc_ValueError, ("expected 1-item tuple in call to __setstate__; got %s" % state).ptr());
+        bp::throw_error_already_set();
+      }
+    }
+
     // Define the pickling of the object
     struct pose_results_pickle_suite: boost::python::pickle_suite
     {
       static boost::python::tuple
-      getinitargs(const PoseResults& db_params)
+      getinitargs(const PoseResults& pose_results)
       {
         return boost::python::make_tuple();
       }
 
       static boost::python::tuple
-      getstate(const PoseResults& db_params)
+      getstate(const PoseResults& pose_results)
+      {
+        return boost::python::make_tuple(PickleBytes(SerializePoseResults(pose_results)));
+      }
+
+      static
+      void
+      setstate(PoseResults& pose_results, boost::python::tuple state)
+      {
+        CheckPickleState(state);
+        DeserializePoseResults(state[0], pose_results);
+      }
+    };
+
+    // Define the pickling of a single result, with the same layout
+    struct pose_result_pickle_suite: boost::python::pickle_suite
+    {
+      static boost::python::tuple
+      getinitargs(const PoseResultType& pose_result)
       {
-        // TODO
         return boost::python::make_tuple();
       }
 
+      static boost::python::tuple
+      getstate(const PoseResultType& pose_result)
+      {
+        return boost::python::make_tuple(PickleBytes(SerializePoseResults(PoseResults(1, pose_result))));
+      }
+
       static
       void
-      setstate(PoseResults& db_params, boost::python::tuple state)
+      setstate(PoseResultType& pose_result, boost::python::tuple state)
       {
-        using namespace boost::python;
-        // TODO
+        CheckPickleState(state);
+        PoseResults pose_results;
+        DeserializePoseResults(state[0], pose_results);
+        if (pose_results.size() != 1)
+          throw std::runtime_error("Expected a single pickled PoseResult.");
+        pose_result = pose_results[0];
       }
     };
 
@@ -130,9 +253,11 @@ namespace object_recognition_core
       bp::class_<PoseResultType> PoseResultClass("PoseResult");
       PoseResultClass.def(bp::init<>()).def(bp::init<PoseResultType>());
       PoseResultClass.def("object_id", object_id);
+      PoseResultClass.def("confidence", &PoseResultType::confidence);
       PoseResultClass.def("db_parameters", db_parameters);
       PoseResultClass.def("R", R);
       PoseResultClass.def("T", T);
+      PoseResultClass.def_pickle(pose_result_pickle_suite());
 
       bp::class_<PoseResults, PoseResultsPtr> PoseResultsClass("PoseResults");
       PoseResultsClass.def("__init__", bp::make_constructor(PoseResultsConstructor));
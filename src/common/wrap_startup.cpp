@@ -0,0 +1,92 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <sstream>
+#include <string>
+
+#include <boost/python.hpp>
+
+#include <object_recognition_core/common/startup.h>
+
+namespace bp = boost::python;
+
+namespace object_recognition_core
+{
+  namespace common
+  {
+    void
+    startup_begin(const std::string & name)
+    {
+      StartupTimeline::Instance().Begin(name);
+    }
+
+    void
+    startup_end(const std::string & name)
+    {
+      StartupTimeline::Instance().End(name);
+    }
+
+    void
+    startup_mark(const std::string & name)
+    {
+      StartupTimeline::Instance().Mark(name);
+    }
+
+    std::string
+    startup_table()
+    {
+      std::stringstream stream;
+      StartupTimeline::Instance().WriteTable(stream);
+      return stream.str();
+    }
+
+    void
+    startup_write_trace(const std::string & path)
+    {
+      StartupTimeline::Instance().WriteTrace(path);
+    }
+
+    void
+    wrap_startup()
+    {
+      bp::def("startup_begin", startup_begin, "Start a phase of the startup timeline.");
+      bp::def("startup_end", startup_end, "End a phase of the startup timeline.");
+      bp::def("startup_mark", startup_mark, "Record an instant event in the startup timeline.");
+      bp::def("startup_table", startup_table, "Return the startup timeline as a table.");
+      bp::def("startup_write_trace", startup_write_trace,
+              "Write the startup timeline to a file in the Chrome trace format.");
+    }
+  }
+}
@@ -37,6 +37,9 @@
 
 #include <object_recognition_core/common/json.hpp>
 #include <object_recognition_core/common/json_spirit/json_spirit_reader_template.h>
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
 #include <object_recognition_core/common/types.h>
 #include <object_recognition_core/db/db.h>
 #include <object_recognition_core/db/model_utils.h>
@@ -78,6 +81,9 @@ namespace object_recognition_core
       int
       process(const ecto::tendrils& inputs, const ecto::tendrils& outputs)
       {
+        ORK_TRACE_SCOPE("cell", "ModelWriter::process");
+        ORK_METRICS_CELL_LATENCY("ModelWriter");
+        ORK_STARTUP_FIRST_CALL("ModelWriter::process");
         db_ = ObjectDbParameters(*json_db_).generateDb();
 
         Document doc_new = *db_document_;
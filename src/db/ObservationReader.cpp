@@ -7,6 +7,9 @@
 #include <boost/lexical_cast.hpp>
 #include <string>
 
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
 #include <object_recognition_core/common/types.h>
 #include <object_recognition_core/db/document.h>
 #include <object_recognition_core/db/opencv.h>
@@ -33,6 +36,9 @@ namespace object_recognition_core
       int
       process(const tendrils& inputs, const tendrils& outputs)
       {
+        ORK_TRACE_SCOPE("cell", "ObservationReader::process");
+        ORK_METRICS_CELL_LATENCY("ObservationReader");
+        ORK_STARTUP_FIRST_CALL("ObservationReader::process");
         Observation obs;
         obs << &(*observation_);
         obs >> outputs;
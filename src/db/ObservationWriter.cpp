@@ -4,6 +4,9 @@
 #include <boost/format.hpp>
 #include <string>
 
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
 #include <object_recognition_core/db/db.h>
 #include <object_recognition_core/db/opencv.h>
 #include <object_recognition_core/db/prototypes/observations.hpp>
@@ -60,6 +63,9 @@ namespace object_recognition_core
       int
       process(const tendrils& inputs, const tendrils& outputs)
       {
+        ORK_TRACE_SCOPE("cell", "ObservationInserter::process");
+        ORK_METRICS_CELL_LATENCY("ObservationInserter");
+        ORK_STARTUP_FIRST_CALL("ObservationInserter::process");
         Observation obs;
         obs << inputs;
         // Use the frame_number tendril if provided
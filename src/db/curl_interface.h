@@ -50,6 +50,8 @@
 
 #include <curl/curl.h>
 
+#include <object_recognition_core/common/trace.h>
+
 namespace object_recognition_core
 {
 namespace curl
@@ -130,6 +132,7 @@ namespace curl
     void
     perform()
     {
+      ORK_TRACE_SCOPE("http", "cURL::perform");
       //need to reset stream.
       header_writer_stream_.str("");
       curl_easy_perform(curl_);
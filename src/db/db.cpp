@@ -35,6 +35,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
@@ -42,6 +43,10 @@
 #include "db_default.h"
 #include "db_empty.h"
 #include "db_filesystem.h"
+#include "db_latency.h"
+#include "db_sharded.h"
+#include "db_tiered.h"
+#include <object_recognition_core/common/trace.h>
 #include <object_recognition_core/db/db.h>
 #include <object_recognition_core/db/opencv.h>
 
@@ -96,6 +101,21 @@ namespace object_recognition_core
           raw_ = object_recognition_core::db::ObjectDbDefaults<ObjectDbFilesystem>::default_raw_parameters();
           break;
         }
+        case ObjectDbParameters::SHARDED:
+        {
+          raw_ = object_recognition_core::db::ObjectDbDefaults<ObjectDbSharded>::default_raw_parameters();
+          break;
+        }
+        case ObjectDbParameters::TIERED:
+        {
+          raw_ = object_recognition_core::db::ObjectDbDefaults<ObjectDbTiered>::default_raw_parameters();
+          break;
+        }
+        case ObjectDbParameters::LATENCY:
+        {
+          raw_ = object_recognition_core::db::ObjectDbDefaults<ObjectDbLatency>::default_raw_parameters();
+          break;
+        }
         case ObjectDbParameters::NONCORE:
         default:
         {
@@ -135,6 +155,12 @@ namespace object_recognition_core
         return EMPTY;
       else if (type_str_lower == "filesystem")
         return FILESYSTEM;
+      else if (type_str_lower == "sharded")
+        return SHARDED;
+      else if (type_str_lower == "tiered")
+        return TIERED;
+      else if (type_str_lower == "latency")
+        return LATENCY;
       else
         return NONCORE;
     }
@@ -150,6 +176,12 @@ namespace object_recognition_core
           return "empty";
         case FILESYSTEM:
           return "filesystem";
+        case SHARDED:
+          return "sharded";
+        case TIERED:
+          return "tiered";
+        case LATENCY:
+          return "latency";
         default:
           return "noncore";
       }
@@ -173,6 +205,15 @@ namespace object_recognition_core
         case ObjectDbParameters::FILESYSTEM:
           res.reset(new ObjectDbFilesystem());
           break;
+        case ObjectDbParameters::SHARDED:
+          res.reset(new ObjectDbSharded());
+          break;
+        case ObjectDbParameters::TIERED:
+          res.reset(new ObjectDbTiered());
+          break;
+        case ObjectDbParameters::LATENCY:
+          res.reset(new ObjectDbLatency());
+          break;
         default:
           std::cerr << "Cannot generate DB for non-core" << std::endl;
           break;
@@ -184,6 +225,56 @@ namespace object_recognition_core
       return res;
     }
 
+    /** Switch the tiered DBs of some raw parameters, and of the DBs they contain, to write-through without journal
+     */
+    static void
+    SecondaryRaw(ObjectDbParametersRaw & raw)
+    {
+      ObjectDbParametersRaw::const_iterator type = raw.find("type");
+      if ((type == raw.end()) || (type->second.type() != or_json::str_type))
+        return;
+
+      std::vector<std::string> keys;
+      switch (ObjectDbParameters::StringToType(type->second.get_str()))
+      {
+        case ObjectDbParameters::TIERED:
+          raw["write_mode"] = "through";
+          raw["queue_path"] = "";
+          keys.push_back("local");
+          keys.push_back("remote");
+          break;
+        case ObjectDbParameters::LATENCY:
+          keys.push_back("db");
+          break;
+        case ObjectDbParameters::SHARDED:
+        {
+          ObjectDbParametersRaw::iterator shards = raw.find("shards");
+          if ((shards != raw.end()) && (shards->second.type() == or_json::array_type))
+            BOOST_FOREACH(or_json::mValue & shard, shards->second.get_array())
+              if (shard.type() == or_json::obj_type)
+                SecondaryRaw(shard.get_obj());
+          break;
+        }
+        default:
+          break;
+      }
+
+      BOOST_FOREACH(const std::string & key, keys)
+      {
+        ObjectDbParametersRaw::iterator db = raw.find(key);
+        if ((db != raw.end()) && (db->second.type() == or_json::obj_type))
+          SecondaryRaw(db->second.get_obj());
+      }
+    }
+
+    ObjectDbParameters
+    ObjectDbParameters::secondary() const
+    {
+      ObjectDbParameters parameters = *this;
+      SecondaryRaw(parameters.raw_);
+      return parameters;
+    }
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     Document::Document()
@@ -209,6 +300,7 @@ namespace object_recognition_core
 
     void
     Document::load_fields() {
+      ORK_TRACE_SCOPE("db", "Document::load_fields");
       // Load all fields from the DB (not the attachments)
       db_->load_fields(document_id_, fields_);
     }
@@ -220,6 +312,7 @@ namespace object_recognition_core
     void
     Document::Persist()
     {
+      ORK_TRACE_SCOPE("db", "Document::Persist");
       // Persist the object if it does not exist in the DB
       if (document_id_.empty())
         db_->insert_object(fields_, document_id_, revision_id_);
@@ -34,6 +34,10 @@
  */
 
 #include <sstream>
+
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/trace.h>
+
 #include "db_couch.h"
 
 object_recognition_core::curl::cURL_GS curl_init_cleanup;
@@ -66,6 +70,8 @@ ObjectDbCouch::set_parameters(object_recognition_core::db::ObjectDbParameters &
 void
 ObjectDbCouch::insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::insert_object");
+  ORK_METRICS_DB_LATENCY("CouchDB", "insert_object");
   CreateCollection(collection_);
   std::string url = url_id("");
   upload_json(fields, url, "POST");
@@ -75,6 +81,8 @@ ObjectDbCouch::insert_object(const or_json::mObject &fields, DocumentId & docume
 void
 ObjectDbCouch::persist_fields(const DocumentId & document_id, const or_json::mObject &fields, RevisionId & revision_id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::persist_fields");
+  ORK_METRICS_DB_LATENCY("CouchDB", "persist_fields");
   precondition_id(document_id);
   upload_json(fields, url_id(document_id), "PUT");
   //need to update the revision here.
@@ -84,6 +92,8 @@ ObjectDbCouch::persist_fields(const DocumentId & document_id, const or_json::mOb
 void
 ObjectDbCouch::load_fields(const DocumentId & document_id, or_json::mObject &fields)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::load_fields");
+  ORK_METRICS_DB_LATENCY("CouchDB", "load_fields");
   precondition_id(document_id);
   curl_.reset();
   json_writer_stream_.str("");
@@ -102,10 +112,62 @@ ObjectDbCouch::load_fields(const DocumentId & document_id, or_json::mObject &fie
   read_json(json_writer_stream_, fields);
 }
 
+void
+ObjectDbCouch::load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields)
+{
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::load_fields_bulk");
+  ORK_METRICS_DB_LATENCY("CouchDB", "load_fields_bulk");
+  fields.clear();
+  if (document_ids.empty())
+    return;
+
+  // Get all the documents in one _all_docs request
+  or_json::mArray keys;
+  keys.reserve(document_ids.size());
+  BOOST_FOREACH(const DocumentId & document_id, document_ids)
+  {
+    precondition_id(document_id);
+    keys.push_back(document_id);
+  }
+  or_json::mObject params;
+  params["keys"] = keys;
+
+  upload_json(params, url_id("_all_docs") + "?include_docs=true", "POST");
+  if (curl_.get_response_code() != object_recognition_core::curl::cURL::OK)
+  {
+    throw std::runtime_error(curl_.get_response_reason_phrase() + " : " + curl_.getURL());
+  }
+
+  // The rows are in the order of the keys; missing or deleted documents have no "doc"
+  or_json::mObject result;
+  read_json(json_writer_stream_, result);
+  const or_json::mArray & rows = result["rows"].get_array();
+  fields.resize(document_ids.size());
+  std::string failed_ids;
+  for (size_t i = 0; i < document_ids.size(); ++i)
+  {
+    if (i >= rows.size())
+    {
+      failed_ids += " " + document_ids[i];
+      continue;
+    }
+    const or_json::mObject & row = rows[i].get_obj();
+    or_json::mObject::const_iterator doc = row.find("doc");
+    if ((doc == row.end()) || (doc->second.type() != or_json::obj_type))
+      failed_ids += " " + document_ids[i];
+    else
+      fields[i] = doc->second.get_obj();
+  }
+  if (!failed_ids.empty())
+    throw std::runtime_error("Could not load the documents:" + failed_ids);
+}
+
 void
 ObjectDbCouch::set_attachment_stream(const DocumentId & document_id, const AttachmentName& attachment_name,
                                      const MimeType& mime_type, const std::istream& stream, RevisionId & revision_id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::set_attachment_stream");
+  ORK_METRICS_DB_LATENCY("CouchDB", "set_attachment_stream");
   precondition_id(document_id);
   precondition_rev(revision_id);
 
@@ -125,6 +187,8 @@ void
 ObjectDbCouch::get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id, const std::string& attachment_name,
                                      const std::string& content_type, std::ostream& stream)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::get_attachment_stream");
+  ORK_METRICS_DB_LATENCY("CouchDB", "get_attachment_stream");
   object_recognition_core::curl::writer binary_writer(stream);
   curl_.reset();
   json_writer_stream_.str("");
@@ -164,6 +228,8 @@ ObjectDbCouch::GetRevisionId(RevisionId & revision_id)
 void
 ObjectDbCouch::Delete(const ObjectId & id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::Delete");
+  ORK_METRICS_DB_LATENCY("CouchDB", "Delete");
   std::string status = Status(collection_ + "/" + id);
   if (curl_.get_response_code() == object_recognition_core::curl::cURL::OK)
   {
@@ -198,10 +264,61 @@ ObjectDbCouch::Delete(const ObjectId & id)
   }
 }
 
+void
+ObjectDbCouch::DeleteBulk(const std::vector<DocumentId> & document_ids, const std::vector<RevisionId> & revision_ids)
+{
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::DeleteBulk");
+  ORK_METRICS_DB_LATENCY("CouchDB", "DeleteBulk");
+  // Without the revisions, CouchDB needs a request per document anyway
+  if (revision_ids.size() != document_ids.size())
+  {
+    object_recognition_core::db::ObjectDb::DeleteBulk(document_ids, revision_ids);
+    return;
+  }
+  if (document_ids.empty())
+    return;
+
+  // Mark all the documents as deleted in one _bulk_docs request
+  or_json::mArray docs;
+  docs.reserve(document_ids.size());
+  for (size_t i = 0; i < document_ids.size(); ++i)
+  {
+    precondition_id(document_ids[i]);
+    or_json::mObject doc;
+    doc["_id"] = document_ids[i];
+    doc["_rev"] = revision_ids[i];
+    doc["_deleted"] = true;
+    docs.push_back(doc);
+  }
+  or_json::mObject params;
+  params["docs"] = docs;
+
+  upload_json(params, url_id("_bulk_docs"), "POST");
+  if (curl_.get_response_code() != object_recognition_core::curl::cURL::Created)
+  {
+    throw std::runtime_error(curl_.get_response_reason_phrase() + " : " + curl_.getURL());
+  }
+
+  // Each document has its own status in the answer
+  or_json::mValue value;
+  or_json::read(json_writer_stream_, value);
+  std::string failed_ids;
+  BOOST_FOREACH(const or_json::mValue & result, value.get_array())
+  {
+    const or_json::mObject & object = result.get_obj();
+    if (object.find("error") != object.end())
+      failed_ids += " " + object.find("id")->second.get_str();
+  }
+  if (!failed_ids.empty())
+    throw std::runtime_error("Could not delete the documents:" + failed_ids);
+}
+
 void
 ObjectDbCouch::QueryView(const object_recognition_core::db::View & view, int limit_rows, int start_offset, int& total_rows,
                      int& offset, std::vector<Document> & view_elements)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::QueryView");
+  ORK_METRICS_DB_LATENCY("CouchDB", "QueryView");
   json_reader_stream_.str("");
   or_json::mObject parameters = view.parameters();
   std::string url;
@@ -233,6 +350,8 @@ void
 ObjectDbCouch::QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset, int& total_rows,
                      int& offset, std::vector<Document> & view_elements)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::QueryGeneric");
+  ORK_METRICS_DB_LATENCY("CouchDB", "QueryGeneric");
   {
     or_json::mObject fields;
     BOOST_FOREACH(const std::string& query, queries)
@@ -265,7 +384,11 @@ ObjectDbCouch::QueryView(const std::string & in_url, int limit_rows, int start_o
 
   curl_.setURL(url);
   curl_.setHeader("Content-Type: application/json");
-  curl_.setCustomRequest("GET");
+  // temporary views send their map function in the body and need to be POSTed
+  if (json_reader_stream_.str().empty())
+    curl_.setCustomRequest("GET");
+  else
+    curl_.setCustomRequest("POST");
   curl_.perform();
 
   if (curl_.get_response_code() != object_recognition_core::curl::cURL::OK)
@@ -304,6 +427,8 @@ ObjectDbCouch::QueryView(const std::string & in_url, int limit_rows, int start_o
 void
 ObjectDbCouch::CreateCollection(const CollectionName &collection)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::CreateCollection");
+  ORK_METRICS_DB_LATENCY("CouchDB", "CreateCollection");
   or_json::mObject params;
   std::string status = Status(collection);
   std::stringstream ss(status);
@@ -345,6 +470,8 @@ ObjectDbCouch::CreateCollection(const CollectionName &collection)
 std::string
 ObjectDbCouch::Status() const
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::Status");
+  ORK_METRICS_DB_LATENCY("CouchDB", "Status");
   json_writer_stream_.str("");
   json_reader_stream_.str("");
   curl_.setWriter(&json_writer_);
@@ -363,6 +490,8 @@ ObjectDbCouch::Status() const
 std::string
 ObjectDbCouch::Status(const CollectionName& collection) const
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::Status");
+  ORK_METRICS_DB_LATENCY("CouchDB", "Status");
   json_writer_stream_.str("");
   json_reader_stream_.str("");
   curl_.setWriter(&json_writer_);
@@ -381,6 +510,8 @@ ObjectDbCouch::Status(const CollectionName& collection) const
 void
 ObjectDbCouch::DeleteCollection(const CollectionName &collection)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbCouch::DeleteCollection");
+  ORK_METRICS_DB_LATENCY("CouchDB", "DeleteCollection");
   std::string status = Status(collection);
   if (curl_.get_response_code() == object_recognition_core::curl::cURL::OK)
   {
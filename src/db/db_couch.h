@@ -36,6 +36,7 @@
 #ifndef DB_COUCH_H_
 #define DB_COUCH_H_
 
+#include <object_recognition_core/common/trace.h>
 #include <object_recognition_core/common/types.h>
 #include <object_recognition_core/db/db.h>
 
@@ -99,6 +100,9 @@ public:
   virtual void
   load_fields(const DocumentId & document_id, or_json::mObject &fields);
 
+  virtual void
+  load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields);
+
   virtual void
   get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id, const std::string& attachment_name,
                         const std::string& content_type, std::ostream& stream);
@@ -111,6 +115,9 @@ public:
   void
   Delete(const ObjectId & id);
 
+  virtual void
+  DeleteBulk(const std::vector<DocumentId> & document_ids, const std::vector<RevisionId> & revision_ids);
+
   virtual
   void
   QueryView(const View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
@@ -157,8 +164,11 @@ private:
   void
   read_json(T &reader, or_json::mObject& object)
   {
+    ORK_TRACE_SCOPE("json", "ObjectDbCouch::read_json");
     or_json::mValue value;
     or_json::read(reader, value);
+    // The stream is read up to its end: clear its eof flag or it could not be written again by the next request
+    reader.clear();
     object = value.get_obj();
   }
 
@@ -166,6 +176,7 @@ private:
   void
   write_json(const or_json::mObject& object, T &writer)
   {
+    ORK_TRACE_SCOPE("json", "ObjectDbCouch::write_json");
     or_json::mValue value(object);
     or_json::write(value, writer);
   }
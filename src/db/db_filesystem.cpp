@@ -39,6 +39,9 @@
 #include <iterator>
 #include <sstream>
 
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/trace.h>
+
 #include "db_filesystem.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -68,6 +71,8 @@ ObjectDbFilesystem::default_raw_parameters() const
 void
 ObjectDbFilesystem::insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::insert_object");
+  ORK_METRICS_DB_LATENCY("filesystem", "insert_object");
   // Find a hash key that is not on disk
   std::string hexa_values = "0123456789abcdef";
   while (true)
@@ -89,6 +94,8 @@ void
 ObjectDbFilesystem::persist_fields(const DocumentId & document_id, const or_json::mObject &fields,
                                    RevisionId & revision_id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::persist_fields");
+  ORK_METRICS_DB_LATENCY("filesystem", "persist_fields");
   precondition_id(document_id);
 
   // Save the JSON to disk
@@ -105,6 +112,8 @@ ObjectDbFilesystem::persist_fields(const DocumentId & document_id, const or_json
 void
 ObjectDbFilesystem::load_fields(const DocumentId & document_id, or_json::mObject &fields)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::load_fields");
+  ORK_METRICS_DB_LATENCY("filesystem", "load_fields");
   Status();
   precondition_id(document_id);
 
@@ -121,6 +130,8 @@ ObjectDbFilesystem::set_attachment_stream(const DocumentId & document_id, const
                                           const MimeType& mime_type, const std::istream& stream,
                                           RevisionId & revision_id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::set_attachment_stream");
+  ORK_METRICS_DB_LATENCY("filesystem", "set_attachment_stream");
   precondition_id(document_id);
 
   // Write the stream to a file
@@ -146,6 +157,8 @@ void
 ObjectDbFilesystem::get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id, const std::string& attachment_name,
                                           const std::string& content_type, std::ostream& stream)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::get_attachment_stream");
+  ORK_METRICS_DB_LATENCY("filesystem", "get_attachment_stream");
   // Write the stream to a file
   boost::filesystem::path path = url_attachments(document_id) / attachment_name;
   std::ifstream file(path.string().c_str(), std::ios::binary);
@@ -156,6 +169,8 @@ ObjectDbFilesystem::get_attachment_stream(const DocumentId & document_id, const
 void
 ObjectDbFilesystem::Delete(const DocumentId & id)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::Delete");
+  ORK_METRICS_DB_LATENCY("filesystem", "Delete");
   boost::filesystem::remove_all(url_id(id));
 
   // For each pre-defined view, figure out the potential keys, and delete those
@@ -177,6 +192,8 @@ void
 ObjectDbFilesystem::QueryView(const object_recognition_core::db::View & view, int limit_rows, int start_offset,
                           int& total_rows, int& offset, std::vector<Document> & view_elements)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::QueryView");
+  ORK_METRICS_DB_LATENCY("filesystem", "QueryView");
   or_json::mObject parameters = view.parameters();
   boost::filesystem::path path;
   switch (view.type())
@@ -201,12 +218,16 @@ void
 ObjectDbFilesystem::QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset, int& total_rows,
                           int& offset, std::vector<Document> & view_elements)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::QueryGeneric");
+  ORK_METRICS_DB_LATENCY("filesystem", "QueryGeneric");
   throw std::runtime_error("Function not implemented in the Filesystem DB.");
 }
 
 void
 ObjectDbFilesystem::CreateCollection(const CollectionName &collection)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::CreateCollection");
+  ORK_METRICS_DB_LATENCY("filesystem", "CreateCollection");
   std::string status;
   Status(status);
   boost::filesystem::create_directories(path_ / collection);
@@ -215,6 +236,8 @@ ObjectDbFilesystem::CreateCollection(const CollectionName &collection)
 std::string
 ObjectDbFilesystem::Status() const
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::Status");
+  ORK_METRICS_DB_LATENCY("filesystem", "Status");
   // To comply the CouchDB status function
   if (boost::filesystem::exists(path_))
   {
@@ -227,6 +250,8 @@ ObjectDbFilesystem::Status() const
 std::string
 ObjectDbFilesystem::Status(const CollectionName& collection) const
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::Status");
+  ORK_METRICS_DB_LATENCY("filesystem", "Status");
   Status();
   if (!boost::filesystem::exists(path_ / collection))
     return "{\"error\":\"not_found\",\"reason\":\"no_db_file\"}";
@@ -237,6 +262,8 @@ ObjectDbFilesystem::Status(const CollectionName& collection) const
 void
 ObjectDbFilesystem::DeleteCollection(const CollectionName &collection)
 {
+  ORK_TRACE_SCOPE("db", "ObjectDbFilesystem::DeleteCollection");
+  ORK_METRICS_DB_LATENCY("filesystem", "DeleteCollection");
   std::string status;
   Status(status);
   if (boost::filesystem::exists(path_ / collection))
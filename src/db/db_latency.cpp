@@ -0,0 +1,311 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cmath>
+#include <sstream>
+
+#include <boost/foreach.hpp>
+#include <boost/random/exponential_distribution.hpp>
+#include <boost/random/lognormal_distribution.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+
+#include "db_latency.h"
+
+using object_recognition_core::common::MetricsRegistry;
+using object_recognition_core::db::ObjectDbParameters;
+
+namespace
+{
+  /** @return the size of some fields once sent as JSON */
+  size_t
+  JsonSize(const or_json::mObject &fields)
+  {
+    return or_json::write(or_json::mValue(fields)).size();
+  }
+
+  /** @return the size of the data left in a stream, without consuming it */
+  size_t
+  StreamSize(const std::istream& stream)
+  {
+    std::istream & un_const_stream = const_cast<std::istream &>(stream);
+    std::streampos stream_position = un_const_stream.tellg();
+    un_const_stream.seekg(0, std::ios::end);
+    std::streampos stream_end = un_const_stream.tellg();
+    un_const_stream.seekg(stream_position);
+    if ((stream_position < 0) || (stream_end < 0))
+      return 0;
+    return stream_end - stream_position;
+  }
+
+  void
+  CheckDistribution(const std::string & distribution)
+  {
+    if ((distribution != "constant") && (distribution != "uniform") && (distribution != "normal")
+        && (distribution != "lognormal") && (distribution != "exponential"))
+      throw std::runtime_error("Unknown latency distribution \"" + distribution + "\".");
+  }
+}
+
+ObjectDbLatency::ObjectDbLatency()
+    :
+      bandwidth_(0)
+{
+  object_recognition_core::db::ObjectDbParameters parameters(default_raw_parameters());
+  this->set_parameters(parameters);
+}
+
+ObjectDbParametersRaw
+ObjectDbLatency::default_raw_parameters() const
+{
+  return object_recognition_core::db::ObjectDbDefaults<ObjectDbLatency>::default_raw_parameters();
+}
+
+void
+ObjectDbLatency::set_parameters(object_recognition_core::db::ObjectDbParameters & parameters)
+{
+  parameters_ = parameters;
+
+  ObjectDbParameters db_parameters(parameters.at("db").get_obj());
+  if (db_parameters.type() == ObjectDbParameters::NONCORE)
+    throw std::runtime_error("The DB wrapped by the latency DB must be of a core type.");
+  db_ = db_parameters.generateDb();
+
+  default_behavior_.distribution_ = parameters.at("distribution").get_str();
+  default_behavior_.latency_ms_ = parameters.at("latency_ms").get_real();
+  default_behavior_.latency_stddev_ms_ = parameters.at("latency_stddev_ms").get_real();
+  default_behavior_.error_rate_ = parameters.at("error_rate").get_real();
+  CheckDistribution(default_behavior_.distribution_);
+  bandwidth_ = parameters.at("bandwidth").get_real();
+
+  behaviors_.clear();
+  // at() returns a copy: keep it
+  const or_json::mObject methods = parameters.at("methods").get_obj();
+  for (or_json::mObject::const_iterator method = methods.begin(); method != methods.end(); ++method)
+  {
+    Behavior behavior = default_behavior_;
+    const or_json::mObject & overrides = method->second.get_obj();
+    for (or_json::mObject::const_iterator iter = overrides.begin(); iter != overrides.end(); ++iter)
+    {
+      if (iter->first == "distribution")
+        behavior.distribution_ = iter->second.get_str();
+      else if (iter->first == "latency_ms")
+        behavior.latency_ms_ = iter->second.get_real();
+      else if (iter->first == "latency_stddev_ms")
+        behavior.latency_stddev_ms_ = iter->second.get_real();
+      else if (iter->first == "error_rate")
+        behavior.error_rate_ = iter->second.get_real();
+      else
+        throw std::runtime_error("Key \"" + iter->first + "\" cannot be set for the method " + method->first);
+    }
+    CheckDistribution(behavior.distribution_);
+    behaviors_[method->first] = behavior;
+  }
+
+  generator_.seed(static_cast<boost::uint32_t>(parameters.at("seed").get_int()));
+}
+
+void
+ObjectDbLatency::Inject(const std::string & method, size_t n_bytes) const
+{
+  std::map<std::string, Behavior>::const_iterator iter = behaviors_.find(method);
+  const Behavior & behavior = (iter == behaviors_.end()) ? default_behavior_ : iter->second;
+
+  double latency_ms = behavior.latency_ms_;
+  bool is_error = false;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    double mean = behavior.latency_ms_, stddev = behavior.latency_stddev_ms_;
+    if ((behavior.distribution_ == "uniform") && (stddev > 0))
+    {
+      // A uniform distribution on [a, b] has a standard deviation of (b - a) / sqrt(12)
+      double half_width = std::sqrt(3.0) * stddev;
+      latency_ms = boost::random::uniform_real_distribution<double>(mean - half_width, mean + half_width)(generator_);
+    }
+    else if ((behavior.distribution_ == "normal") && (stddev > 0))
+      latency_ms = boost::random::normal_distribution<double>(mean, stddev)(generator_);
+    else if ((behavior.distribution_ == "lognormal") && (stddev > 0) && (mean > 0))
+    {
+      // Parameters of the underlying normal distribution giving that mean and standard deviation
+      double s2 = std::log(1 + (stddev * stddev) / (mean * mean));
+      latency_ms = boost::random::lognormal_distribution<double>(std::log(mean) - s2 / 2, std::sqrt(s2))(generator_);
+    }
+    else if ((behavior.distribution_ == "exponential") && (mean > 0))
+      latency_ms = boost::random::exponential_distribution<double>(1 / mean)(generator_);
+
+    if (behavior.error_rate_ > 0)
+      is_error = boost::random::uniform_01<double>()(generator_) < behavior.error_rate_;
+  }
+
+  if (bandwidth_ > 0)
+    latency_ms += 1000 * n_bytes / bandwidth_;
+  if (latency_ms > 0)
+    boost::this_thread::sleep(boost::posix_time::microseconds(static_cast<long>(1000 * latency_ms)));
+
+  if (is_error)
+  {
+    MetricsRegistry::Instance().counter("ork_latency_injected_failures_total", "method=\"" + method + "\"",
+                                        "Number of failures injected by the latency DB, by method").Increment();
+    throw std::runtime_error("Injected failure in " + method);
+  }
+}
+
+void
+ObjectDbLatency::insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id)
+{
+  Inject("insert_object", JsonSize(fields));
+  db_->insert_object(fields, document_id, revision_id);
+}
+
+void
+ObjectDbLatency::persist_fields(const DocumentId & document_id, const or_json::mObject &fields,
+                                RevisionId & revision_id)
+{
+  Inject("persist_fields", JsonSize(fields));
+  db_->persist_fields(document_id, fields, revision_id);
+}
+
+void
+ObjectDbLatency::load_fields(const DocumentId & document_id, or_json::mObject &fields)
+{
+  // The size is only known once loaded, and the delay does not depend on where the time is spent
+  db_->load_fields(document_id, fields);
+  Inject("load_fields", JsonSize(fields));
+}
+
+void
+ObjectDbLatency::load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields)
+{
+  // One request for all the documents, as with DeleteBulk
+  db_->load_fields_bulk(document_ids, fields);
+  size_t n_bytes = 0;
+  BOOST_FOREACH(const or_json::mObject & object, fields)
+    n_bytes += JsonSize(object);
+  Inject("load_fields_bulk", n_bytes);
+}
+
+void
+ObjectDbLatency::get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id,
+                                       const std::string& attachment_name, const std::string& content_type,
+                                       std::ostream& stream)
+{
+  std::stringstream attachment;
+  db_->get_attachment_stream(document_id, revision_id, attachment_name, content_type, attachment);
+  Inject("get_attachment_stream", attachment.str().size());
+  stream << attachment.rdbuf();
+}
+
+void
+ObjectDbLatency::set_attachment_stream(const DocumentId & document_id, const AttachmentName& attachment_name,
+                                       const MimeType& mime_type, const std::istream& stream,
+                                       RevisionId & revision_id)
+{
+  Inject("set_attachment_stream", StreamSize(stream));
+  db_->set_attachment_stream(document_id, attachment_name, mime_type, stream, revision_id);
+}
+
+void
+ObjectDbLatency::Delete(const ObjectId & id)
+{
+  Inject("Delete");
+  db_->Delete(id);
+}
+
+void
+ObjectDbLatency::DeleteBulk(const std::vector<DocumentId> & document_ids, const std::vector<RevisionId> & revision_ids)
+{
+  Inject("DeleteBulk");
+  db_->DeleteBulk(document_ids, revision_ids);
+}
+
+void
+ObjectDbLatency::QueryView(const View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
+                           std::vector<Document> & view_elements)
+{
+  db_->QueryView(view, limit_rows, start_offset, total_rows, offset, view_elements);
+  size_t n_bytes = 0;
+  BOOST_FOREACH(const Document & document, view_elements)
+    n_bytes += JsonSize(document.fields());
+  Inject("QueryView", n_bytes);
+}
+
+void
+ObjectDbLatency::QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset,
+                              int& total_rows, int& offset, std::vector<Document> & view_elements)
+{
+  db_->QueryGeneric(queries, limit_rows, start_offset, total_rows, offset, view_elements);
+  size_t n_bytes = 0;
+  BOOST_FOREACH(const Document & document, view_elements)
+    n_bytes += JsonSize(document.fields());
+  Inject("QueryGeneric", n_bytes);
+}
+
+std::string
+ObjectDbLatency::Status() const
+{
+  Inject("Status");
+  return db_->Status();
+}
+
+std::string
+ObjectDbLatency::Status(const CollectionName& collection) const
+{
+  Inject("Status");
+  return db_->Status(collection);
+}
+
+void
+ObjectDbLatency::CreateCollection(const CollectionName &collection)
+{
+  Inject("CreateCollection");
+  db_->CreateCollection(collection);
+}
+
+void
+ObjectDbLatency::DeleteCollection(const CollectionName &collection)
+{
+  Inject("DeleteCollection");
+  db_->DeleteCollection(collection);
+}
+
+DbType
+ObjectDbLatency::type() const
+{
+  return object_recognition_core::db::ObjectDbDefaults<ObjectDbLatency>::type();
+}
@@ -0,0 +1,195 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DB_LATENCY_H_
+#define DB_LATENCY_H_
+
+#include <map>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <object_recognition_core/common/types.h>
+#include <object_recognition_core/db/db.h>
+
+#include "db_default.h"
+#include "db_empty.h"
+
+using object_recognition_core::db::AttachmentName;
+using object_recognition_core::db::CollectionName;
+using object_recognition_core::db::DbType;
+using object_recognition_core::db::Document;
+using object_recognition_core::db::DocumentId;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::ObjectId;
+using object_recognition_core::db::MimeType;
+using object_recognition_core::db::ObjectDbParametersRaw;
+using object_recognition_core::db::RevisionId;
+using object_recognition_core::db::View;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ObjectDbLatency;
+
+namespace object_recognition_core {
+namespace db {
+
+template<>
+struct ObjectDbDefaults<ObjectDbLatency> {
+  static object_recognition_core::db::ObjectDbParametersRaw default_raw_parameters() {
+    ObjectDbParametersRaw res;
+    res["db"] = ObjectDbDefaults<ObjectDbEmpty>::default_raw_parameters();
+    res["distribution"] = "constant";
+    res["latency_ms"] = 0;
+    res["latency_stddev_ms"] = 0;
+    res["error_rate"] = 0;
+    res["bandwidth"] = 0;
+    res["seed"] = 0;
+    res["methods"] = or_json::mObject();
+    res["type"] = type();
+
+    return res;
+  }
+  static object_recognition_core::db::DbType type() {
+    return "latency";
+  }
+};
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/** This class wraps the DB given in "db" and slows it down and makes it fail, to measure how the pipelines behave
+ * with a slow or unreliable DB. Each call waits for a random delay before reaching the wrapped DB:
+ *  - "distribution" is one of "constant", "uniform", "normal", "lognormal" or "exponential", of mean "latency_ms"
+ *    and standard deviation "latency_stddev_ms" (delays are never negative)
+ *  - "bandwidth", in bytes per second (0 for infinite), adds the time it takes to transfer the fields/attachments
+ *  - "error_rate" is the probability for a call to throw a std::runtime_error instead of reaching the wrapped DB
+ *  - "methods" overrides these per method, e.g. {"load_fields": {"latency_ms": 80}, "QueryView": {"error_rate": 0.1}}
+ *  - "seed" makes the delays and errors reproducible
+ */
+class ObjectDbLatency: public object_recognition_core::db::ObjectDb
+{
+public:
+  ObjectDbLatency();
+
+  virtual ObjectDbParametersRaw
+  default_raw_parameters() const;
+
+  virtual void
+  set_parameters(object_recognition_core::db::ObjectDbParameters & parameters);
+
+  virtual void
+  insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id);
+
+  virtual void
+  persist_fields(const DocumentId & document_id, const or_json::mObject &fields, RevisionId & revision_id);
+
+  virtual void
+  load_fields(const DocumentId & document_id, or_json::mObject &fields);
+
+  virtual void
+  load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields);
+
+  virtual void
+  get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id, const std::string& attachment_name,
+                        const std::string& content_type, std::ostream& stream);
+
+  virtual void
+  set_attachment_stream(const DocumentId & document_id, const AttachmentName& attachment_name,
+                        const MimeType& mime_type, const std::istream& stream, RevisionId & revision_id);
+
+  virtual
+  void
+  Delete(const ObjectId & id);
+
+  virtual void
+  DeleteBulk(const std::vector<DocumentId> & document_ids, const std::vector<RevisionId> & revision_ids);
+
+  virtual
+  void
+  QueryView(const View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
+            std::vector<Document> & view_elements);
+
+  virtual void
+  QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset, int& total_rows, int& offset,
+               std::vector<Document> & view_elements);
+
+  virtual std::string
+  Status() const;
+
+  virtual std::string
+  Status(const CollectionName& collection) const;
+
+  virtual void
+  CreateCollection(const CollectionName &collection);
+
+  virtual void
+  DeleteCollection(const CollectionName &collection);
+
+  virtual DbType
+  type() const;
+private:
+  /** How a method is slowed down */
+  struct Behavior
+  {
+    std::string distribution_;
+    double latency_ms_;
+    double latency_stddev_ms_;
+    double error_rate_;
+  };
+
+  /** Wait for the delay of a method and throw if it is picked to fail
+   * @param method the name of the method, as in "methods"
+   * @param n_bytes the number of bytes that are transferred
+   */
+  void
+  Inject(const std::string & method, size_t n_bytes = 0) const;
+
+  /** The DB that does the actual work */
+  ObjectDbPtr db_;
+  /** The behavior of the methods that are not in "methods" */
+  Behavior default_behavior_;
+  /** The behavior of the methods in "methods" */
+  std::map<std::string, Behavior> behaviors_;
+  /** In bytes per second, 0 for infinite */
+  double bandwidth_;
+
+  /** The random draws are shared between the threads using the DB */
+  mutable boost::mutex mutex_;
+  mutable boost::random::mt19937 generator_;
+};
+
+#endif /* DB_LATENCY_H_ */
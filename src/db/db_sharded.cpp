@@ -0,0 +1,472 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+
+#include "db_sharded.h"
+
+using object_recognition_core::common::MetricsRegistry;
+using object_recognition_core::db::ObjectDbParameters;
+
+namespace
+{
+  /** 32 bit FNV-1a hash: unlike boost::hash, it is the same on every machine and with every compiler, which is what
+   * several robots sharing the same shards need
+   */
+  boost::uint32_t
+  HashFnv1a(const std::string & str)
+  {
+    boost::uint32_t hash = 2166136261u;
+    for (std::string::const_iterator iter = str.begin(), end = str.end(); iter != end; ++iter)
+    {
+      hash ^= static_cast<unsigned char>(*iter);
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  /** @return a random id in the CouchDB format (32 lower case hexadecimal characters) */
+  DocumentId
+  RandomDocumentId(boost::uuids::random_generator & generator)
+  {
+    std::string id = boost::uuids::to_string(generator());
+    id.erase(std::remove(id.begin(), id.end(), '-'), id.end());
+    return id;
+  }
+
+  /** Order in which the view elements of several shards are merged: by key (stored as the revision), then by id */
+  bool
+  CompareByKey(const Document & document_1, const Document & document_2)
+  {
+    if (document_1.rev() != document_2.rev())
+      return document_1.rev() < document_2.rev();
+    return document_1.id() < document_2.id();
+  }
+
+  void
+  ShardQueryView(const View & view, int limit_rows, const ObjectDbPtr & db, int & total_rows, int & offset,
+                 std::vector<Document> & view_elements)
+  {
+    db->QueryView(view, limit_rows, 0, total_rows, offset, view_elements);
+  }
+
+  void
+  ShardQueryGeneric(const std::vector<std::string> & queries, int limit_rows, const ObjectDbPtr & db, int & total_rows,
+                    int & offset, std::vector<Document> & view_elements)
+  {
+    db->QueryGeneric(queries, limit_rows, 0, total_rows, offset, view_elements);
+  }
+}
+
+ObjectDbSharded::ObjectDbSharded()
+{
+  object_recognition_core::db::ObjectDbParameters parameters(default_raw_parameters());
+  this->set_parameters(parameters);
+}
+
+ObjectDbParametersRaw
+ObjectDbSharded::default_raw_parameters() const
+{
+  return object_recognition_core::db::ObjectDbDefaults<ObjectDbSharded>::default_raw_parameters();
+}
+
+void
+ObjectDbSharded::set_parameters(object_recognition_core::db::ObjectDbParameters & parameters)
+{
+  parameters_ = parameters;
+
+  shards_.clear();
+  collections_.clear();
+  is_collection_created_.clear();
+  requests_.clear();
+  ring_.clear();
+
+  int n_virtual_nodes = parameters.at("virtual_nodes").get_int();
+  if (n_virtual_nodes <= 0)
+    throw std::runtime_error("\"virtual_nodes\" must be strictly positive for the sharded DB.");
+
+  // at() returns a copy: keep it
+  const or_json::mArray shards = parameters.at("shards").get_array();
+  for (size_t i = 0; i < shards.size(); ++i)
+  {
+    const or_json::mObject & shard_raw = shards[i].get_obj();
+    ObjectDbParameters shard_parameters(shard_raw);
+    if (shard_parameters.type() == ObjectDbParameters::NONCORE)
+      throw std::runtime_error("The shards of a sharded DB must be of a core type.");
+    shards_.push_back(shard_parameters.generateDb());
+
+    or_json::mObject::const_iterator collection = shard_raw.find("collection");
+    if ((collection != shard_raw.end()) && (collection->second.type() == or_json::str_type))
+      collections_.push_back(collection->second.get_str());
+    else
+      collections_.push_back(CollectionName());
+    is_collection_created_.push_back(false);
+    requests_.push_back(
+        &MetricsRegistry::Instance().counter("ork_sharded_requests_total",
+                                             "shard=\"" + boost::lexical_cast<std::string>(i) + "\"",
+                                             "Number of requests sent to each shard of a sharded DB"));
+
+    // The position of a shard on the ring only depends on where it is, not on its index in "shards": adding a shard
+    // only moves the documents that now belong to it
+    std::string shard_name = or_json::write(or_json::mValue(shard_raw));
+    for (int virtual_node = 0; virtual_node < n_virtual_nodes; ++virtual_node)
+      ring_[HashFnv1a(shard_name + "#" + boost::lexical_cast<std::string>(virtual_node))] = i;
+  }
+}
+
+size_t
+ObjectDbSharded::shard_index(const std::string & id) const
+{
+  precondition_shards();
+
+  std::map<boost::uint32_t, size_t>::const_iterator node = ring_.lower_bound(HashFnv1a(id));
+  if (node == ring_.end())
+    node = ring_.begin();
+  return node->second;
+}
+
+void
+ObjectDbSharded::CreateShardCollection(size_t index)
+{
+  if (is_collection_created_[index] || collections_[index].empty())
+    return;
+  shards_[index]->CreateCollection(collections_[index]);
+  is_collection_created_[index] = true;
+}
+
+void
+ObjectDbSharded::insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id)
+{
+  precondition_shards();
+
+  // Documents referring to an object go with the object, the others go wherever their id falls
+  boost::uuids::random_generator generator;
+  or_json::mObject::const_iterator object_id = fields.find("object_id");
+  if ((object_id != fields.end()) && (object_id->second.type() == or_json::str_type))
+  {
+    size_t index = shard_index(object_id->second.get_str());
+    // Each try falls on the right shard with a probability of 1/n_shards
+    do
+      document_id = RandomDocumentId(generator);
+    while ((shards_.size() > 1) && (shard_index(document_id) != index));
+  }
+  else
+    document_id = RandomDocumentId(generator);
+
+  size_t index = shard_index(document_id);
+  CreateShardCollection(index);
+  shard(index)->persist_fields(document_id, fields, revision_id);
+}
+
+void
+ObjectDbSharded::persist_fields(const DocumentId & document_id, const or_json::mObject &fields,
+                                RevisionId & revision_id)
+{
+  size_t index = shard_index(document_id);
+  CreateShardCollection(index);
+  shard(index)->persist_fields(document_id, fields, revision_id);
+}
+
+void
+ObjectDbSharded::load_fields(const DocumentId & document_id, or_json::mObject &fields)
+{
+  shard(shard_index(document_id))->load_fields(document_id, fields);
+}
+
+namespace
+{
+  /** Load the documents of one shard in its own thread: exceptions cannot cross threads so they are kept as a message
+   */
+  void
+  RunShardLoad(const ObjectDbPtr & db, const std::vector<DocumentId> & document_ids,
+               std::vector<or_json::mObject> & fields, std::string & error)
+  {
+    try
+    {
+      db->load_fields_bulk(document_ids, fields);
+    } catch (std::exception & e)
+    {
+      error = e.what();
+    }
+  }
+}
+
+void
+ObjectDbSharded::load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields)
+{
+  precondition_shards();
+
+  // Split the documents by shard, remembering where they came from
+  std::vector<std::vector<DocumentId> > shard_document_ids(shards_.size());
+  std::vector<std::vector<size_t> > shard_positions(shards_.size());
+  for (size_t i = 0; i < document_ids.size(); ++i)
+  {
+    size_t index = shard_index(document_ids[i]);
+    shard_document_ids[index].push_back(document_ids[i]);
+    shard_positions[index].push_back(i);
+  }
+
+  // Load from all the shards in parallel
+  std::vector<std::vector<or_json::mObject> > shard_fields(shards_.size());
+  std::vector<std::string> errors(shards_.size());
+  boost::thread_group threads;
+  for (size_t index = 0; index < shards_.size(); ++index)
+  {
+    if (shard_document_ids[index].empty())
+      continue;
+    if (shard_document_ids[index].size() == document_ids.size())
+      RunShardLoad(shard(index), shard_document_ids[index], shard_fields[index], errors[index]);
+    else
+      threads.create_thread(
+          boost::bind(RunShardLoad, boost::cref(shard(index)), boost::cref(shard_document_ids[index]),
+                      boost::ref(shard_fields[index]), boost::ref(errors[index])));
+  }
+  threads.join_all();
+
+  fields.clear();
+  fields.resize(document_ids.size());
+  for (size_t index = 0; index < shards_.size(); ++index)
+  {
+    if (!errors[index].empty())
+      throw std::runtime_error("A shard of the sharded DB failed: " + errors[index]);
+    for (size_t i = 0; i < shard_positions[index].size(); ++i)
+      fields[shard_positions[index][i]].swap(shard_fields[index][i]);
+  }
+}
+
+void
+ObjectDbSharded::get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id,
+                                       const std::string& attachment_name, const std::string& content_type,
+                                       std::ostream& stream)
+{
+  shard(shard_index(document_id))->get_attachment_stream(document_id, revision_id, attachment_name, content_type,
+                                                         stream);
+}
+
+void
+ObjectDbSharded::set_attachment_stream(const DocumentId & document_id, const AttachmentName& attachment_name,
+                                       const MimeType& mime_type, const std::istream& stream,
+                                       RevisionId & revision_id)
+{
+  shard(shard_index(document_id))->set_attachment_stream(document_id, attachment_name, mime_type, stream,
+                                                         revision_id);
+}
+
+void
+ObjectDbSharded::Delete(const ObjectId & id)
+{
+  shard(shard_index(id))->Delete(id);
+}
+
+void
+ObjectDbSharded::DeleteBulk(const std::vector<DocumentId> & document_ids, const std::vector<RevisionId> & revision_ids)
+{
+  precondition_shards();
+
+  bool has_revisions = (revision_ids.size() == document_ids.size());
+  std::vector<std::vector<DocumentId> > shard_document_ids(shards_.size());
+  std::vector<std::vector<RevisionId> > shard_revision_ids(shards_.size());
+  for (size_t i = 0; i < document_ids.size(); ++i)
+  {
+    size_t index = shard_index(document_ids[i]);
+    shard_document_ids[index].push_back(document_ids[i]);
+    if (has_revisions)
+      shard_revision_ids[index].push_back(revision_ids[i]);
+  }
+
+  for (size_t index = 0; index < shards_.size(); ++index)
+    if (!shard_document_ids[index].empty())
+      shard(index)->DeleteBulk(shard_document_ids[index], shard_revision_ids[index]);
+}
+
+void
+ObjectDbSharded::QueryView(const View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
+                           std::vector<Document> & view_elements)
+{
+  precondition_shards();
+
+  // The core views are keyed by object id: all the matching documents are on the shard of the object
+  View::Key key;
+  if (view.key(key) && (key.type() == or_json::str_type))
+  {
+    shard(shard_index(key.get_str()))->QueryView(view, limit_rows, start_offset, total_rows, offset, view_elements);
+    return;
+  }
+
+  // Each shard needs to return enough elements to fill the page once merged
+  int shard_limit_rows = (limit_rows > 0) ? start_offset + limit_rows : 0;
+  ScatterGather(boost::bind(ShardQueryView, boost::cref(view), shard_limit_rows, _1, _2, _3, _4), limit_rows,
+                start_offset, total_rows, offset, view_elements);
+}
+
+void
+ObjectDbSharded::QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset,
+                              int& total_rows, int& offset, std::vector<Document> & view_elements)
+{
+  precondition_shards();
+
+  int shard_limit_rows = (limit_rows > 0) ? start_offset + limit_rows : 0;
+  ScatterGather(boost::bind(ShardQueryGeneric, boost::cref(queries), shard_limit_rows, _1, _2, _3, _4), limit_rows,
+                start_offset, total_rows, offset, view_elements);
+}
+
+namespace
+{
+  /** Run the query of one shard in its own thread: exceptions cannot cross threads so they are kept as a message */
+  void
+  RunShardQuery(const boost::function<void(const ObjectDbPtr &, int &, int &, std::vector<Document> &)> & function,
+                const ObjectDbPtr & db, int & total_rows, int & offset, std::vector<Document> & view_elements,
+                std::string & error)
+  {
+    try
+    {
+      function(db, total_rows, offset, view_elements);
+    } catch (std::exception & e)
+    {
+      error = e.what();
+    }
+  }
+}
+
+void
+ObjectDbSharded::ScatterGather(const ShardFunction & function, int limit_rows, int start_offset, int& total_rows,
+                               int& offset, std::vector<Document> & view_elements)
+{
+  std::vector<ShardQuery> queries(shards_.size());
+  for (size_t i = 0; i < shards_.size(); ++i)
+    requests_[i]->Increment();
+
+  if (shards_.size() == 1)
+    RunShardQuery(function, shards_[0], queries[0].total_rows_, queries[0].offset_, queries[0].view_elements_,
+                  queries[0].error_);
+  else
+  {
+    boost::thread_group threads;
+    for (size_t i = 0; i < shards_.size(); ++i)
+      threads.create_thread(
+          boost::bind(RunShardQuery, boost::cref(function), boost::cref(shards_[i]),
+                      boost::ref(queries[i].total_rows_), boost::ref(queries[i].offset_),
+                      boost::ref(queries[i].view_elements_), boost::ref(queries[i].error_)));
+    threads.join_all();
+  }
+
+  // Merge the results of all the shards
+  total_rows = 0;
+  std::vector<Document> elements;
+  BOOST_FOREACH(const ShardQuery & query, queries)
+  {
+    if (!query.error_.empty())
+      throw std::runtime_error("A shard of the sharded DB failed: " + query.error_);
+    total_rows += query.total_rows_;
+    elements.insert(elements.end(), query.view_elements_.begin(), query.view_elements_.end());
+  }
+  std::stable_sort(elements.begin(), elements.end(), CompareByKey);
+
+  // Only keep the asked page
+  std::vector<Document>::iterator begin = elements.begin() + std::min<size_t>(start_offset, elements.size());
+  std::vector<Document>::iterator end = elements.end();
+  if ((limit_rows > 0) && (end - begin > limit_rows))
+    end = begin + limit_rows;
+  view_elements.assign(begin, end);
+  offset = start_offset + view_elements.size();
+}
+
+std::string
+ObjectDbSharded::Status() const
+{
+  precondition_shards();
+
+  std::string status = "{\"sharded\":\"Welcome\",\"shards\":[";
+  for (size_t i = 0; i < shards_.size(); ++i)
+  {
+    if (i)
+      status += ",";
+    status += shards_[i]->Status();
+  }
+  return status + "]}";
+}
+
+std::string
+ObjectDbSharded::Status(const CollectionName& collection) const
+{
+  precondition_shards();
+
+  // Report the first shard in trouble as the collection is only usable if it is fine everywhere
+  BOOST_FOREACH(const ObjectDbPtr & shard, shards_)
+  {
+    std::string status = shard->Status(collection);
+    if (status.find("\"error\"") != std::string::npos)
+      return status;
+  }
+  return shards_[0]->Status(collection);
+}
+
+void
+ObjectDbSharded::CreateCollection(const CollectionName &collection)
+{
+  precondition_shards();
+
+  BOOST_FOREACH(const ObjectDbPtr & shard, shards_)
+    shard->CreateCollection(collection);
+}
+
+void
+ObjectDbSharded::DeleteCollection(const CollectionName &collection)
+{
+  precondition_shards();
+
+  BOOST_FOREACH(const ObjectDbPtr & shard, shards_)
+    shard->DeleteCollection(collection);
+  for (size_t i = 0; i < shards_.size(); ++i)
+    if (collections_[i] == collection)
+      is_collection_created_[i] = false;
+}
+
+DbType
+ObjectDbSharded::type() const
+{
+  return object_recognition_core::db::ObjectDbDefaults<ObjectDbSharded>::type();
+}
@@ -0,0 +1,224 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DB_SHARDED_H_
+#define DB_SHARDED_H_
+
+#include <map>
+
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/types.h>
+#include <object_recognition_core/db/db.h>
+
+#include "db_default.h"
+
+using object_recognition_core::db::AttachmentName;
+using object_recognition_core::db::CollectionName;
+using object_recognition_core::db::DbType;
+using object_recognition_core::db::Document;
+using object_recognition_core::db::DocumentId;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::ObjectId;
+using object_recognition_core::db::MimeType;
+using object_recognition_core::db::ObjectDbParametersRaw;
+using object_recognition_core::db::RevisionId;
+using object_recognition_core::db::View;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ObjectDbSharded;
+
+namespace object_recognition_core {
+namespace db {
+
+template<>
+struct ObjectDbDefaults<ObjectDbSharded> {
+  static object_recognition_core::db::ObjectDbParametersRaw default_raw_parameters() {
+    ObjectDbParametersRaw res;
+    res["shards"] = or_json::mArray();
+    res["virtual_nodes"] = 64;
+    res["type"] = type();
+
+    return res;
+  }
+  static object_recognition_core::db::DbType type() {
+    return "sharded";
+  }
+};
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/** This class spreads the documents over several databases (the shards), e.g.:
+ *   {"type": "sharded", "shards": [{"type": "CouchDB", "root": "http://lab1:5984", "collection": "object_recognition"},
+ *                                  {"type": "CouchDB", "root": "http://lab2:5984", "collection": "object_recognition"}]}
+ * A document lives on the shard given by a consistent hash of its id. When a document refers to an object (it has
+ * an "object_id" field), its id is chosen so that it hashes to the shard of the object: the observations and models
+ * of an object are therefore on the same shard as the object and views keyed by object id only query that shard.
+ * Other view queries are sent to all the shards in parallel and the results are merged by key.
+ */
+class ObjectDbSharded: public object_recognition_core::db::ObjectDb
+{
+public:
+  ObjectDbSharded();
+
+  virtual ObjectDbParametersRaw
+  default_raw_parameters() const;
+
+  virtual void
+  set_parameters(object_recognition_core::db::ObjectDbParameters & parameters);
+
+  virtual void
+  insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id);
+
+  virtual void
+  persist_fields(const DocumentId & document_id, const or_json::mObject &fields, RevisionId & revision_id);
+
+  virtual void
+  load_fields(const DocumentId & document_id, or_json::mObject &fields);
+
+  virtual void
+  load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields);
+
+  virtual void
+  get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id, const std::string& attachment_name,
+                        const std::string& content_type, std::ostream& stream);
+
+  virtual void
+  set_attachment_stream(const DocumentId & document_id, const AttachmentName& attachment_name,
+                        const MimeType& mime_type, const std::istream& stream, RevisionId & revision_id);
+
+  virtual
+  void
+  Delete(const ObjectId & id);
+
+  virtual void
+  DeleteBulk(const std::vector<DocumentId> & document_ids, const std::vector<RevisionId> & revision_ids);
+
+  virtual
+  void
+  QueryView(const View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
+            std::vector<Document> & view_elements);
+
+  virtual void
+  QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset, int& total_rows, int& offset,
+               std::vector<Document> & view_elements);
+
+  virtual std::string
+  Status() const;
+
+  virtual std::string
+  Status(const CollectionName& collection) const;
+
+  virtual void
+  CreateCollection(const CollectionName &collection);
+
+  virtual void
+  DeleteCollection(const CollectionName &collection);
+
+  virtual DbType
+  type() const;
+
+  /** @return the index of the shard a document or an object of that id lives on
+   */
+  size_t
+  shard_index(const std::string & id) const;
+
+  /** @return the databases the documents are spread over
+   */
+  const std::vector<ObjectDbPtr> &
+  shards() const
+  {
+    return shards_;
+  }
+private:
+  /** What each shard returns for a query */
+  struct ShardQuery
+  {
+    ShardQuery()
+        :
+          total_rows_(0),
+          offset_(0)
+    {
+    }
+    int total_rows_;
+    int offset_;
+    std::vector<Document> view_elements_;
+    std::string error_;
+  };
+  typedef boost::function<void(const ObjectDbPtr &, int &, int &, std::vector<Document> &)> ShardFunction;
+
+  inline void
+  precondition_shards() const
+  {
+    if (shards_.empty())
+      throw std::runtime_error("The sharded DB needs at least one shard in \"shards\".");
+  }
+
+  /** Run a query on all the shards in parallel, merge the results by key and keep the asked page
+   */
+  void
+  ScatterGather(const ShardFunction & function, int limit_rows, int start_offset, int& total_rows, int& offset,
+                std::vector<Document> & view_elements);
+
+  /** @return a shard, counting the request sent to it */
+  inline const ObjectDbPtr &
+  shard(size_t index) const
+  {
+    requests_[index]->Increment();
+    return shards_[index];
+  }
+
+  /** Make sure the collection of a shard exists before writing to it for the first time */
+  void
+  CreateShardCollection(size_t index);
+
+  /** The databases the documents are spread over */
+  std::vector<ObjectDbPtr> shards_;
+  /** The collection of each shard, if the shard has one */
+  std::vector<CollectionName> collections_;
+  /** Whether the collection of a shard is known to exist */
+  std::vector<bool> is_collection_created_;
+  /** The number of requests sent to each shard */
+  std::vector<object_recognition_core::common::Counter *> requests_;
+  /** The hash ring: each shard has several virtual nodes on it */
+  std::map<boost::uint32_t, size_t> ring_;
+};
+
+#endif /* DB_SHARDED_H_ */
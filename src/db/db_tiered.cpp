@@ -0,0 +1,765 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+
+#include "db_tiered.h"
+
+using object_recognition_core::common::Counter;
+using object_recognition_core::common::Gauge;
+using object_recognition_core::common::MetricsRegistry;
+using object_recognition_core::db::ObjectDbParameters;
+
+namespace
+{
+  void
+  QueryViewOn(const View & view, int limit_rows, int start_offset, const ObjectDbPtr & db, int & total_rows,
+              int & offset, std::vector<Document> & view_elements)
+  {
+    db->QueryView(view, limit_rows, start_offset, total_rows, offset, view_elements);
+  }
+
+  void
+  QueryGenericOn(const std::vector<std::string> & queries, int limit_rows, int start_offset, const ObjectDbPtr & db,
+                 int & total_rows, int & offset, std::vector<Document> & view_elements)
+  {
+    db->QueryGeneric(queries, limit_rows, start_offset, total_rows, offset, view_elements);
+  }
+
+  /** @return the counter of the reads answered by the local tier (hits) or by the remote one (misses) */
+  Counter &
+  reads(bool is_hit)
+  {
+    static const char * const help = "Reads of a tiered DB answered by its local tier (hit) or by its remote one "
+                                     "(miss)";
+    static Counter & hits = MetricsRegistry::Instance().counter("ork_tiered_reads_total", "result=\"hit\"", help);
+    static Counter & misses = MetricsRegistry::Instance().counter("ork_tiered_reads_total", "result=\"miss\"", help);
+    return is_hit ? hits : misses;
+  }
+
+  /** @return the counter of the queries answered a given way: "hit", "miss", "stale" or "local" */
+  Counter &
+  view_cache(const std::string & result)
+  {
+    static const char * const name = "ork_tiered_view_cache_total";
+    static const char * const help = "Queries of a tiered DB answered by its cache (hit, stale), by the remote DB "
+                                     "(miss) or by its local tier (local)";
+    static Counter & hits = MetricsRegistry::Instance().counter(name, "result=\"hit\"", help);
+    static Counter & misses = MetricsRegistry::Instance().counter(name, "result=\"miss\"", help);
+    static Counter & stale = MetricsRegistry::Instance().counter(name, "result=\"stale\"", help);
+    static Counter & local = MetricsRegistry::Instance().counter(name, "result=\"local\"", help);
+    if (result == "hit")
+      return hits;
+    if (result == "miss")
+      return misses;
+    return (result == "stale") ? stale : local;
+  }
+
+  /** @return the number of operations in the journals of all the tiered DBs */
+  Gauge &
+  queue_depth()
+  {
+    static Gauge & gauge = MetricsRegistry::Instance().gauge(
+        "ork_tiered_queue_depth", "", "Number of operations waiting in the write-back journals of the tiered DBs");
+    return gauge;
+  }
+
+  /** @return the revision stored in the fields of a document, empty if there is none */
+  RevisionId
+  FieldsRevision(const or_json::mObject & fields)
+  {
+    or_json::mObject::const_iterator revision = fields.find("_rev");
+    if ((revision == fields.end()) || (revision->second.type() != or_json::str_type))
+      return RevisionId();
+    return revision->second.get_str();
+  }
+
+  /** @return true if the local copy of a document has the same content as the remote one. The revisions are not
+   * compared as not all DBs have meaningful ones, but the fields of CouchDB also describe the attachments
+   */
+  bool
+  IsSameDocument(or_json::mObject local_fields, or_json::mObject remote_fields)
+  {
+    local_fields.erase("_id");
+    local_fields.erase("_rev");
+    remote_fields.erase("_id");
+    remote_fields.erase("_rev");
+    return local_fields == remote_fields;
+  }
+
+  /** @return the path of the file holding the attachment data of a journaled operation */
+  boost::filesystem::path
+  DataPath(const boost::filesystem::path & operation_path)
+  {
+    boost::filesystem::path path = operation_path;
+    return path.replace_extension(".data");
+  }
+}
+
+ObjectDbTiered::ObjectDbTiered()
+    :
+      is_local_collection_created_(false),
+      queue_index_(0),
+      flush_size_(0),
+      max_staleness_(0)
+{
+  object_recognition_core::db::ObjectDbParameters parameters(default_raw_parameters());
+  this->set_parameters(parameters);
+}
+
+ObjectDbTiered::~ObjectDbTiered()
+{
+  if (queue_.empty())
+    return;
+  try
+  {
+    if (Flush())
+      std::cerr << queue_.size() << " operations could not be sent to the remote DB, they are kept in "
+                << queue_path_.string() << std::endl;
+  } catch (...)
+  {
+  }
+  queue_depth().Add(-double(queue_.size()));
+}
+
+ObjectDbParametersRaw
+ObjectDbTiered::default_raw_parameters() const
+{
+  return object_recognition_core::db::ObjectDbDefaults<ObjectDbTiered>::default_raw_parameters();
+}
+
+void
+ObjectDbTiered::set_parameters(object_recognition_core::db::ObjectDbParameters & parameters)
+{
+  parameters_ = parameters;
+
+  ObjectDbParameters local_parameters(parameters.at("local").get_obj());
+  ObjectDbParameters remote_parameters(parameters.at("remote").get_obj());
+  if ((local_parameters.type() == ObjectDbParameters::NONCORE)
+      || (remote_parameters.type() == ObjectDbParameters::NONCORE))
+    throw std::runtime_error("The local and remote DBs of a tiered DB must be of a core type.");
+  if (local_parameters.type() != ObjectDbParameters::FILESYSTEM)
+    throw std::runtime_error("The local DB of a tiered DB must be a filesystem one.");
+  local_ = local_parameters.generateDb();
+  remote_ = remote_parameters.generateDb();
+
+  // at() returns a copy: keep it
+  const or_json::mObject local_raw = parameters.at("local").get_obj();
+  or_json::mObject::const_iterator collection = local_raw.find("collection");
+  if ((collection != local_raw.end()) && (collection->second.type() == or_json::str_type))
+    local_collection_ = collection->second.get_str();
+  else
+    local_collection_.clear();
+  is_local_collection_created_ = false;
+
+  write_mode_ = parameters.at("write_mode").get_str();
+  if ((write_mode_ != "through") && (write_mode_ != "back"))
+    throw std::runtime_error("\"write_mode\" must be \"through\" or \"back\", not \"" + write_mode_ + "\".");
+  max_staleness_ = parameters.at("max_staleness").get_int();
+  flush_size_ = std::max(1, parameters.at("flush_size").get_int());
+  query_cache_.clear();
+  check_times_.clear();
+  remote_revisions_.clear();
+
+  // Pick up the operations a previous instance could not replay
+  queue_depth().Add(-double(queue_.size()));
+  queue_.clear();
+  queue_index_ = 0;
+  queue_path_ = parameters.at("queue_path").get_str();
+  if (queue_path_.empty())
+  {
+    if (is_write_back())
+      throw std::runtime_error("A tiered DB in \"back\" write mode needs a \"queue_path\".");
+    return;
+  }
+  boost::filesystem::create_directories(queue_path_);
+  for (boost::filesystem::directory_iterator iter(queue_path_), end; iter != end; ++iter)
+    if (iter->path().extension() == ".json")
+      queue_.push_back(iter->path());
+  // The file names are zero padded indices: sorting them gives the order of the operations
+  std::sort(queue_.begin(), queue_.end());
+  queue_depth().Add(queue_.size());
+  if (!queue_.empty())
+  {
+    std::istringstream index(queue_.back().stem().string());
+    index >> queue_index_;
+    ++queue_index_;
+    Flush();
+  }
+}
+
+void
+ObjectDbTiered::CacheFields(const DocumentId & document_id, const or_json::mObject &fields,
+                            const RevisionId & revision_id)
+{
+  if (!is_local_collection_created_ && !local_collection_.empty())
+  {
+    local_->CreateCollection(local_collection_);
+    is_local_collection_created_ = true;
+  }
+
+  or_json::mObject cached_fields = fields;
+  cached_fields["_id"] = document_id;
+  if (!revision_id.empty())
+    cached_fields["_rev"] = revision_id;
+  RevisionId local_revision_id;
+  local_->persist_fields(document_id, cached_fields, local_revision_id);
+  check_times_[document_id] = std::time(NULL);
+}
+
+void
+ObjectDbTiered::StampLocalRevision(const DocumentId & document_id, const RevisionId & revision_id)
+{
+  or_json::mObject fields;
+  try
+  {
+    local_->load_fields(document_id, fields);
+  } catch (std::runtime_error & e)
+  {
+    return;
+  }
+  CacheFields(document_id, fields, revision_id);
+}
+
+bool
+ObjectDbTiered::IsFresh(const DocumentId & document_id) const
+{
+  // While writes wait in the journal, the remote DB is behind the local one
+  if (!queue_.empty())
+    return true;
+  std::map<DocumentId, std::time_t>::const_iterator check_time = check_times_.find(document_id);
+  return (check_time != check_times_.end()) && (std::time(NULL) - check_time->second <= max_staleness_);
+}
+
+bool
+ObjectDbTiered::LoadFields(const DocumentId & document_id, or_json::mObject &fields)
+{
+  bool is_local = false;
+  try
+  {
+    local_->load_fields(document_id, fields);
+    is_local = true;
+  } catch (std::runtime_error & e)
+  {
+  }
+  if (is_local && IsFresh(document_id))
+  {
+    reads(true).Increment();
+    return true;
+  }
+
+  or_json::mObject remote_fields;
+  try
+  {
+    remote_->load_fields(document_id, remote_fields);
+  } catch (std::runtime_error & e)
+  {
+    // Like for the views, an old copy is better than nothing
+    if (!is_local)
+    {
+      reads(false).Increment();
+      throw;
+    }
+    reads(true).Increment();
+    return true;
+  }
+  bool is_hit = UpdateLocal(document_id, is_local, fields, remote_fields);
+  reads(is_hit).Increment();
+  return is_hit;
+}
+
+bool
+ObjectDbTiered::UpdateLocal(const DocumentId & document_id, bool is_local, or_json::mObject &fields,
+                            or_json::mObject &remote_fields)
+{
+  if (is_local && IsSameDocument(fields, remote_fields))
+  {
+    check_times_[document_id] = std::time(NULL);
+    return true;
+  }
+
+  // The local attachments are as old as the local fields
+  if (is_local)
+    local_->Delete(document_id);
+  fields.swap(remote_fields);
+  CacheFields(document_id, fields, FieldsRevision(fields));
+  return false;
+}
+
+void
+ObjectDbTiered::insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id)
+{
+  if (is_write_back())
+  {
+    // The id has to be known before the remote DB is reached
+    boost::uuids::random_generator generator;
+    document_id = boost::uuids::to_string(generator());
+    document_id.erase(std::remove(document_id.begin(), document_id.end(), '-'), document_id.end());
+    persist_fields(document_id, fields, revision_id);
+    return;
+  }
+
+  remote_->insert_object(fields, document_id, revision_id);
+  CacheFields(document_id, fields, revision_id);
+  query_cache_.clear();
+}
+
+void
+ObjectDbTiered::persist_fields(const DocumentId & document_id, const or_json::mObject &fields,
+                               RevisionId & revision_id)
+{
+  if (is_write_back())
+  {
+    CacheFields(document_id, fields, "");
+    revision_id = "0";
+    query_cache_.clear();
+
+    or_json::mObject operation;
+    operation["op"] = "persist";
+    operation["id"] = document_id;
+    operation["fields"] = fields;
+    Enqueue(operation);
+    return;
+  }
+
+  remote_->persist_fields(document_id, fields, revision_id);
+  CacheFields(document_id, fields, revision_id);
+  query_cache_.clear();
+}
+
+void
+ObjectDbTiered::load_fields(const DocumentId & document_id, or_json::mObject &fields)
+{
+  LoadFields(document_id, fields);
+}
+
+void
+ObjectDbTiered::load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields)
+{
+  fields.clear();
+  fields.resize(document_ids.size());
+
+  // Serve what can be served locally and get the rest (missing or stale) from the remote DB in one go
+  std::vector<DocumentId> remote_document_ids;
+  std::vector<size_t> remote_positions;
+  std::vector<bool> is_local(document_ids.size(), false);
+  for (size_t i = 0; i < document_ids.size(); ++i)
+  {
+    try
+    {
+      local_->load_fields(document_ids[i], fields[i]);
+      is_local[i] = true;
+    } catch (std::runtime_error & e)
+    {
+    }
+    if (is_local[i] && IsFresh(document_ids[i]))
+    {
+      reads(true).Increment();
+      continue;
+    }
+    remote_document_ids.push_back(document_ids[i]);
+    remote_positions.push_back(i);
+  }
+  if (remote_document_ids.empty())
+    return;
+
+  std::vector<or_json::mObject> remote_fields;
+  try
+  {
+    remote_->load_fields_bulk(remote_document_ids, remote_fields);
+  } catch (std::runtime_error & e)
+  {
+    // The stale local copies are served if all the documents have one
+    for (size_t i = 0; i < remote_positions.size(); ++i)
+      if (!is_local[remote_positions[i]])
+      {
+        reads(false).Increment();
+        throw;
+      }
+    reads(true).Increment(remote_positions.size());
+    return;
+  }
+  for (size_t i = 0; i < remote_positions.size(); ++i)
+    reads(UpdateLocal(remote_document_ids[i], is_local[remote_positions[i]], fields[remote_positions[i]],
+                      remote_fields[i])).Increment();
+}
+
+void
+ObjectDbTiered::get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id,
+                                      const std::string& attachment_name, const std::string& content_type,
+                                      std::ostream& stream)
+{
+  // Not all DBs report missing attachments: an empty one is considered missing
+  std::stringstream attachment;
+  try
+  {
+    local_->get_attachment_stream(document_id, revision_id, attachment_name, content_type, attachment);
+  } catch (std::runtime_error & e)
+  {
+  }
+
+  // The local attachment is as old as the local copy of its document: it is downloaded again if that one changed
+  if (!attachment.str().empty() && !IsFresh(document_id))
+  {
+    or_json::mObject fields;
+    try
+    {
+      if (!LoadFields(document_id, fields))
+        attachment.str("");
+    } catch (std::runtime_error & e)
+    {
+    }
+  }
+
+  reads(!attachment.str().empty()).Increment();
+  if (attachment.str().empty())
+  {
+    attachment.clear();
+    attachment.str("");
+    remote_->get_attachment_stream(document_id, revision_id, attachment_name, content_type, attachment);
+
+    RevisionId local_revision_id = revision_id;
+    local_->set_attachment_stream(document_id, attachment_name, content_type, attachment, local_revision_id);
+    attachment.seekg(0);
+  }
+
+  stream << attachment.rdbuf();
+}
+
+void
+ObjectDbTiered::set_attachment_stream(const DocumentId & document_id, const AttachmentName& attachment_name,
+                                      const MimeType& mime_type, const std::istream& stream,
+                                      RevisionId & revision_id)
+{
+  // The stream is read twice
+  std::stringstream attachment;
+  attachment << stream.rdbuf();
+
+  // Any write can change the results of any view: the next queries go to the remote DB
+  query_cache_.clear();
+
+  if (is_write_back())
+  {
+    RevisionId local_revision_id = revision_id;
+    local_->set_attachment_stream(document_id, attachment_name, mime_type, attachment, local_revision_id);
+
+    or_json::mObject operation;
+    operation["op"] = "attachment";
+    operation["id"] = document_id;
+    operation["name"] = attachment_name;
+    operation["mime_type"] = mime_type;
+    Enqueue(operation, attachment.str());
+    return;
+  }
+
+  remote_->set_attachment_stream(document_id, attachment_name, mime_type, attachment, revision_id);
+  attachment.seekg(0);
+  RevisionId local_revision_id = revision_id;
+  local_->set_attachment_stream(document_id, attachment_name, mime_type, attachment, local_revision_id);
+
+  // Keep the local copy of the fields at the revision of the remote DB
+  StampLocalRevision(document_id, revision_id);
+}
+
+void
+ObjectDbTiered::Delete(const ObjectId & id)
+{
+  query_cache_.clear();
+  if (is_write_back())
+  {
+    or_json::mObject operation;
+    operation["op"] = "delete";
+    operation["id"] = id;
+    Enqueue(operation);
+  }
+  else
+    remote_->Delete(id);
+  local_->Delete(id);
+  check_times_.erase(id);
+}
+
+void
+ObjectDbTiered::QueryCached(const std::string & query_key, const QueryFunction & query, int& total_rows,
+                            int& offset, std::vector<Document> & view_elements)
+{
+  std::time_t now = std::time(NULL);
+  std::map<std::string, QueryResult>::iterator cached = query_cache_.find(query_key);
+  if ((cached == query_cache_.end()) || (now - cached->second.time_ > max_staleness_))
+  {
+    // Make sure the remote DB knows about what was written locally
+    if (!queue_.empty())
+      Flush();
+
+    QueryResult result;
+    try
+    {
+      query(remote_, result.total_rows_, result.offset_, result.view_elements_);
+      result.time_ = now;
+      query_cache_[query_key] = result;
+      cached = query_cache_.find(query_key);
+      view_cache("miss").Increment();
+    } catch (std::runtime_error & e)
+    {
+      if (cached == query_cache_.end())
+      {
+        // Nothing to serve: fall back on the local DB
+        view_cache("local").Increment();
+        query(local_, total_rows, offset, view_elements);
+        return;
+      }
+      view_cache("stale").Increment();
+    }
+  }
+  else
+    view_cache("hit").Increment();
+
+  total_rows = cached->second.total_rows_;
+  offset = cached->second.offset_;
+  view_elements = cached->second.view_elements_;
+}
+
+void
+ObjectDbTiered::QueryView(const View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
+                          std::vector<Document> & view_elements)
+{
+  or_json::mObject query_key;
+  query_key["view"] = view.type();
+  query_key["parameters"] = view.parameters();
+  View::Key key;
+  if (view.key(key))
+    query_key["key"] = key;
+  query_key["limit_rows"] = limit_rows;
+  query_key["start_offset"] = start_offset;
+
+  QueryCached(or_json::write(or_json::mValue(query_key)),
+              boost::bind(QueryViewOn, boost::cref(view), limit_rows, start_offset, _1, _2, _3, _4), total_rows,
+              offset, view_elements);
+}
+
+void
+ObjectDbTiered::QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset,
+                             int& total_rows, int& offset, std::vector<Document> & view_elements)
+{
+  or_json::mObject query_key;
+  query_key["queries"] = or_json::mArray(queries.begin(), queries.end());
+  query_key["limit_rows"] = limit_rows;
+  query_key["start_offset"] = start_offset;
+
+  QueryCached(or_json::write(or_json::mValue(query_key)),
+              boost::bind(QueryGenericOn, boost::cref(queries), limit_rows, start_offset, _1, _2, _3, _4), total_rows,
+              offset, view_elements);
+}
+
+void
+ObjectDbTiered::Enqueue(const or_json::mObject & operation, const std::string & data)
+{
+  char file_name[32];
+  std::sprintf(file_name, "%012u.json", queue_index_++);
+  boost::filesystem::path operation_path = queue_path_ / file_name;
+
+  // The data goes first: an operation is only valid once its JSON is on disk
+  if (!data.empty())
+  {
+    std::ofstream file(DataPath(operation_path).string().c_str(), std::ios::binary);
+    file << data;
+    file.close();
+    if (!file)
+      throw std::runtime_error("Could not write to the journal " + DataPath(operation_path).string());
+  }
+  {
+    std::ofstream file(operation_path.string().c_str());
+    or_json::write(or_json::mValue(operation), file);
+    file.close();
+    if (!file)
+      throw std::runtime_error("Could not write to the journal " + operation_path.string());
+  }
+  queue_.push_back(operation_path);
+  queue_depth().Add(1);
+
+  if (queue_.size() >= flush_size_)
+    Flush();
+}
+
+RevisionId
+ObjectDbTiered::RemoteRevision(const DocumentId & document_id)
+{
+  std::map<DocumentId, RevisionId>::const_iterator revision = remote_revisions_.find(document_id);
+  if (revision != remote_revisions_.end())
+    return revision->second;
+
+  or_json::mObject fields;
+  try
+  {
+    remote_->load_fields(document_id, fields);
+  } catch (std::runtime_error & e)
+  {
+    return RevisionId();
+  }
+  if ((fields.find("_rev") == fields.end()) || (fields["_rev"].type() != or_json::str_type))
+    return RevisionId();
+  return fields["_rev"].get_str();
+}
+
+void
+ObjectDbTiered::Replay(const boost::filesystem::path & operation_path)
+{
+  or_json::mObject operation;
+  {
+    std::ifstream file(operation_path.string().c_str());
+    or_json::mValue value;
+    or_json::read(file, value);
+    operation = value.get_obj();
+  }
+  const std::string & op = operation["op"].get_str();
+  const DocumentId & document_id = operation["id"].get_str();
+
+  if (op == "persist")
+  {
+    // Last writer wins: the document replaces whatever revision the remote DB has
+    or_json::mObject fields = operation["fields"].get_obj();
+    RevisionId revision_id = RemoteRevision(document_id);
+    if (revision_id.empty())
+      fields.erase("_rev");
+    else
+      fields["_rev"] = revision_id;
+    fields.erase("_attachments");
+    remote_->persist_fields(document_id, fields, revision_id);
+    remote_revisions_[document_id] = revision_id;
+    StampLocalRevision(document_id, revision_id);
+  }
+  else if (op == "attachment")
+  {
+    RevisionId revision_id = RemoteRevision(document_id);
+    std::ifstream data(DataPath(operation_path).string().c_str(), std::ios::binary);
+    remote_->set_attachment_stream(document_id, operation["name"].get_str(), operation["mime_type"].get_str(), data,
+                                   revision_id);
+    remote_revisions_[document_id] = revision_id;
+    StampLocalRevision(document_id, revision_id);
+  }
+  else if (op == "delete")
+  {
+    remote_->Delete(document_id);
+    remote_revisions_.erase(document_id);
+  }
+  else
+    throw std::runtime_error("Unknown operation \"" + op + "\" in the journal " + operation_path.string());
+}
+
+size_t
+ObjectDbTiered::Flush()
+{
+  size_t n_replayed = 0;
+  try
+  {
+    for (; n_replayed < queue_.size(); ++n_replayed)
+    {
+      Replay(queue_[n_replayed]);
+      boost::filesystem::remove(DataPath(queue_[n_replayed]));
+      boost::filesystem::remove(queue_[n_replayed]);
+    }
+  } catch (std::runtime_error & e)
+  {
+    std::cerr << "Could not replay the journal on the remote DB: " << e.what() << std::endl;
+  }
+  queue_.erase(queue_.begin(), queue_.begin() + n_replayed);
+  queue_depth().Add(-double(n_replayed));
+  if (queue_.empty())
+    remote_revisions_.clear();
+
+  return queue_.size();
+}
+
+std::string
+ObjectDbTiered::Status() const
+{
+  std::string remote_status;
+  try
+  {
+    remote_status = remote_->Status();
+  } catch (std::runtime_error & e)
+  {
+    or_json::mObject error;
+    error["error"] = e.what();
+    remote_status = or_json::write(or_json::mValue(error));
+  }
+  return "{\"tiered\":\"Welcome\",\"local\":" + local_->Status() + ",\"remote\":" + remote_status + "}";
+}
+
+std::string
+ObjectDbTiered::Status(const CollectionName& collection) const
+{
+  try
+  {
+    return remote_->Status(collection);
+  } catch (std::runtime_error & e)
+  {
+    return local_->Status(collection);
+  }
+}
+
+void
+ObjectDbTiered::CreateCollection(const CollectionName &collection)
+{
+  remote_->CreateCollection(collection);
+  local_->CreateCollection(collection);
+}
+
+void
+ObjectDbTiered::DeleteCollection(const CollectionName &collection)
+{
+  remote_->DeleteCollection(collection);
+  local_->DeleteCollection(collection);
+  if (collection == local_collection_)
+    is_local_collection_created_ = false;
+  query_cache_.clear();
+}
+
+DbType
+ObjectDbTiered::type() const
+{
+  return object_recognition_core::db::ObjectDbDefaults<ObjectDbTiered>::type();
+}
@@ -0,0 +1,280 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DB_TIERED_H_
+#define DB_TIERED_H_
+
+#include <ctime>
+#include <map>
+
+#include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+
+#include <object_recognition_core/common/types.h>
+#include <object_recognition_core/db/db.h>
+
+#include "db_couch.h"
+#include "db_default.h"
+#include "db_filesystem.h"
+
+using object_recognition_core::db::AttachmentName;
+using object_recognition_core::db::CollectionName;
+using object_recognition_core::db::DbType;
+using object_recognition_core::db::Document;
+using object_recognition_core::db::DocumentId;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::ObjectId;
+using object_recognition_core::db::MimeType;
+using object_recognition_core::db::ObjectDbParametersRaw;
+using object_recognition_core::db::RevisionId;
+using object_recognition_core::db::View;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ObjectDbTiered;
+
+namespace object_recognition_core {
+namespace db {
+
+template<>
+struct ObjectDbDefaults<ObjectDbTiered> {
+  static object_recognition_core::db::ObjectDbParametersRaw default_raw_parameters() {
+    ObjectDbParametersRaw res;
+    res["local"] = ObjectDbDefaults<ObjectDbFilesystem>::default_raw_parameters();
+    res["remote"] = ObjectDbDefaults<ObjectDbCouch>::default_raw_parameters();
+    res["write_mode"] = "through";
+    res["queue_path"] = "";
+    res["max_staleness"] = 60;
+    res["flush_size"] = 100;
+    res["type"] = type();
+
+    return res;
+  }
+  static object_recognition_core::db::DbType type() {
+    return "tiered";
+  }
+};
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/** This class puts a fast "local" DB (e.g. on the disk of a robot) in front of a "remote" one (e.g. the CouchDB of
+ * the lab):
+ *  - documents and attachments are read from the local DB first. If they are not there, they are read from the
+ *    remote DB and copied to the local one. A local copy is checked against the remote DB when it was last checked
+ *    more than "max_staleness" seconds ago: if the document changed, its fields are copied again and its attachments
+ *    are downloaded again when read. The local copies are served as they are if the remote DB cannot be reached, or
+ *    while writes wait in the journal
+ *  - with "write_mode" set to "through", writes go to the remote DB and are copied to the local one. With "back",
+ *    they go to the local DB and are journaled in the folder "queue_path": the journal is replayed on the remote DB
+ *    once it holds "flush_size" operations, when Flush is called, when the DB is destroyed and when it is created
+ *    again (so nothing is lost if the robot stops before the remote DB could be reached)
+ *  - views are queried on the remote DB and their results are kept for "max_staleness" seconds, or until the next
+ *    write through this DB. If the remote DB cannot be reached, the last results are served, however old they are,
+ *    and the local DB is queried otherwise
+ * The local DB has to be a filesystem one: the local copies are stamped with the revisions of the remote DB, which
+ * only the filesystem DB accepts as is.
+ */
+class ObjectDbTiered: public object_recognition_core::db::ObjectDb
+{
+public:
+  ObjectDbTiered();
+
+  virtual
+  ~ObjectDbTiered();
+
+  virtual ObjectDbParametersRaw
+  default_raw_parameters() const;
+
+  virtual void
+  set_parameters(object_recognition_core::db::ObjectDbParameters & parameters);
+
+  virtual void
+  insert_object(const or_json::mObject &fields, DocumentId & document_id, RevisionId & revision_id);
+
+  virtual void
+  persist_fields(const DocumentId & document_id, const or_json::mObject &fields, RevisionId & revision_id);
+
+  virtual void
+  load_fields(const DocumentId & document_id, or_json::mObject &fields);
+
+  virtual void
+  load_fields_bulk(const std::vector<DocumentId> & document_ids, std::vector<or_json::mObject> &fields);
+
+  virtual void
+  get_attachment_stream(const DocumentId & document_id, const RevisionId & revision_id, const std::string& attachment_name,
+                        const std::string& content_type, std::ostream& stream);
+
+  virtual void
+  set_attachment_stream(const DocumentId & document_id, const AttachmentName& attachment_name,
+                        const MimeType& mime_type, const std::istream& stream, RevisionId & revision_id);
+
+  virtual
+  void
+  Delete(const ObjectId & id);
+
+  virtual
+  void
+  QueryView(const View & view, int limit_rows, int start_offset, int& total_rows, int& offset,
+            std::vector<Document> & view_elements);
+
+  virtual void
+  QueryGeneric(const std::vector<std::string> & queries, int limit_rows, int start_offset, int& total_rows, int& offset,
+               std::vector<Document> & view_elements);
+
+  virtual std::string
+  Status() const;
+
+  virtual std::string
+  Status(const CollectionName& collection) const;
+
+  virtual void
+  CreateCollection(const CollectionName &collection);
+
+  virtual void
+  DeleteCollection(const CollectionName &collection);
+
+  virtual DbType
+  type() const;
+
+  /** Replay the journaled writes on the remote DB. It stops at the first operation that fails (e.g. when the
+   * remote DB cannot be reached), which is kept with the following ones for the next flush
+   * @return the number of operations still in the journal
+   */
+  size_t
+  Flush();
+
+  /** @return the number of journaled operations that still have to be replayed on the remote DB
+   */
+  size_t
+  n_queued() const
+  {
+    return queue_.size();
+  }
+private:
+  /** The results of a query, as cached for views */
+  struct QueryResult
+  {
+    std::time_t time_;
+    int total_rows_;
+    int offset_;
+    std::vector<Document> view_elements_;
+  };
+
+  inline bool
+  is_write_back() const
+  {
+    return write_mode_ == "back";
+  }
+
+  /** Copy some fields to the local DB, stamped with the id/revision they have in the remote DB */
+  void
+  CacheFields(const DocumentId & document_id, const or_json::mObject &fields, const RevisionId & revision_id);
+
+  /** Keep the local copy of the fields of a document at a given revision of the remote DB */
+  void
+  StampLocalRevision(const DocumentId & document_id, const RevisionId & revision_id);
+
+  /** @return true if the local copy of a document can be served without checking it against the remote DB */
+  bool
+  IsFresh(const DocumentId & document_id) const;
+
+  /** Load the fields of a document from the local DB, or from the remote one if the local copy is missing or stale
+   * @return true if the local copy was served, false if it was replaced by the remote one
+   */
+  bool
+  LoadFields(const DocumentId & document_id, or_json::mObject &fields);
+
+  /** Replace the local copy of a document by the remote one, unless it is up to date
+   * @param is_local true if fields holds a local copy
+   * @param fields the local fields, replaced by the remote ones if they differ
+   * @param remote_fields the fields of the document in the remote DB
+   * @return true if the local copy was up to date
+   */
+  bool
+  UpdateLocal(const DocumentId & document_id, bool is_local, or_json::mObject &fields, or_json::mObject &remote_fields);
+
+  /** Write an operation to the journal. The attachment data (if any) is stored next to it
+   */
+  void
+  Enqueue(const or_json::mObject & operation, const std::string & data = std::string());
+
+  /** Perform a journaled operation on the remote DB */
+  void
+  Replay(const boost::filesystem::path & operation_path);
+
+  /** @return the revision of a document in the remote DB, empty if it is not there */
+  RevisionId
+  RemoteRevision(const DocumentId & document_id);
+
+  typedef boost::function<void(const ObjectDbPtr &, int &, int &, std::vector<Document> &)> QueryFunction;
+
+  /** Query the remote DB unless the cached results are recent enough
+   * @param query_key a unique description of the query and page
+   * @param query a function performing the query on a given DB
+   */
+  void
+  QueryCached(const std::string & query_key, const QueryFunction & query, int& total_rows, int& offset,
+              std::vector<Document> & view_elements);
+
+  /** The fast DB the documents are read from */
+  ObjectDbPtr local_;
+  /** The reference DB */
+  ObjectDbPtr remote_;
+  /** The collection of the local DB, if it has one */
+  CollectionName local_collection_;
+  bool is_local_collection_created_;
+  /** "through" or "back" */
+  std::string write_mode_;
+  /** The folder of the journal of the writes to replay on the remote DB */
+  boost::filesystem::path queue_path_;
+  /** The journaled operations, in order */
+  std::vector<boost::filesystem::path> queue_;
+  /** The index of the next journaled operation */
+  unsigned int queue_index_;
+  /** The number of operations after which the journal is replayed */
+  size_t flush_size_;
+  /** The number of seconds the results of a view and the local copies of the documents are considered fresh */
+  int max_staleness_;
+  /** The results of the last view queries */
+  std::map<std::string, QueryResult> query_cache_;
+  /** The last time the local copy of each document was known to match the remote DB */
+  std::map<DocumentId, std::time_t> check_times_;
+  /** The revisions of the documents in the remote DB, as learnt while replaying the journal */
+  std::map<DocumentId, RevisionId> remote_revisions_;
+};
+
+#endif /* DB_TIERED_H_ */
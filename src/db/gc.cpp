@@ -0,0 +1,255 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <object_recognition_core/db/gc.h>
+
+namespace
+{
+  /** Return a string field of a JSON object, or an empty string if it does not exist
+   */
+  std::string
+  string_field(const or_json::mObject & fields, const std::string & key)
+  {
+    or_json::mObject::const_iterator iter = fields.find(key);
+    if ((iter == fields.end()) || (iter->second.type() != or_json::str_type))
+      return std::string();
+    return iter->second.get_str();
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace db
+  {
+    const unsigned int GarbageCollector::BATCH_SIZE = 100;
+
+    GarbageCollector::GarbageCollector(const ObjectDbPtr & db)
+        :
+          db_(db)
+    {
+      // The scan goes through a temporary view (QueryGeneric): filesystem DBs do not implement it and empty ones
+      // would look empty
+      ObjectDbParameters::ObjectDbType type = db->parameters().type();
+      if ((type == ObjectDbParameters::FILESYSTEM) || (type == ObjectDbParameters::EMPTY))
+        throw std::runtime_error("The garbage collector needs a DB supporting QueryGeneric, e.g. CouchDB.");
+    }
+
+    void
+    GarbageCollector::AddDocument(const Document & document)
+    {
+      const or_json::mObject & fields = document.fields();
+      Node & node = graph_[document.id()];
+      node.revision_id_ = document.rev();
+      node.type_ = string_field(fields, "Type");
+      node.object_id_ = string_field(fields, "object_id");
+      node.session_id_ = string_field(fields, "session_id");
+      node.n_references_ = 0;
+
+      // The content of a document is everything but its id and revision. Attachments are only compared through
+      // their digest so that they do not have to be downloaded
+      or_json::mObject content = fields;
+      content.erase("_id");
+      content.erase("_rev");
+      size_t n_attachment_bytes = 0;
+      or_json::mObject::iterator attachments = content.find("_attachments");
+      if ((attachments != content.end()) && (attachments->second.type() == or_json::obj_type))
+      {
+        or_json::mObject digests;
+        BOOST_FOREACH(const or_json::mObject::value_type & attachment, attachments->second.get_obj())
+        {
+          const or_json::mObject & stub = attachment.second.get_obj();
+          or_json::mObject digest;
+          digest["content_type"] = string_field(stub, "content_type");
+          digest["digest"] = string_field(stub, "digest");
+          or_json::mObject::const_iterator length = stub.find("length");
+          if (length != stub.end())
+          {
+            digest["length"] = length->second;
+            n_attachment_bytes += length->second.get_uint64();
+          }
+          digests[attachment.first] = digest;
+        }
+        attachments->second = digests;
+      }
+
+      // or_json::mObject is sorted by key so the JSON string is canonical
+      std::string json = or_json::write(content);
+      node.content_hash_ = boost::hash<std::string>()(json);
+      node.n_bytes_ = json.size() + n_attachment_bytes;
+
+      ++report_.n_documents_;
+    }
+
+    bool
+    GarbageCollector::IsAlive(const Graph::const_iterator & node) const
+    {
+      const std::string & type = node->second.type_;
+      if ((type != "Session") && (type != "Observation") && (type != "Model"))
+        return true;
+
+      // Sessions, observations and models only make sense for an existing object ...
+      Graph::const_iterator object = graph_.find(node->second.object_id_);
+      if ((object == graph_.end()) || (object->second.type_ != "Object"))
+        return false;
+
+      // ... and observations also need their session, if they have one
+      if ((type != "Observation") || (node->second.session_id_.empty()))
+        return true;
+      Graph::const_iterator session = graph_.find(node->second.session_id_);
+      if ((session == graph_.end()) || (session->second.type_ != "Session"))
+        return false;
+      return IsAlive(session);
+    }
+
+    void
+    GarbageCollector::Scan()
+    {
+      graph_.clear();
+      report_ = GarbageReport();
+
+      // Go over the whole database, one page at a time
+      std::vector<std::string> queries(1, "function(doc) { emit(doc._rev, doc); }");
+      std::vector<Document> documents;
+      int start_offset = 0, total_rows = 0, offset = 0;
+      do
+      {
+        db_->QueryGeneric(queries, BATCH_SIZE, start_offset, total_rows, offset, documents);
+        BOOST_FOREACH(const Document & document, documents)
+          AddDocument(document);
+        start_offset = offset;
+      } while ((!documents.empty()) && (start_offset < total_rows));
+
+      // Count the references to each document
+      std::set<ObjectId> objects_with_models;
+      for (Graph::const_iterator node = graph_.begin(); node != graph_.end(); ++node)
+      {
+        Graph::iterator object = graph_.find(node->second.object_id_);
+        if (object != graph_.end())
+          ++object->second.n_references_;
+        Graph::iterator session = graph_.find(node->second.session_id_);
+        if (session != graph_.end())
+          ++session->second.n_references_;
+        if (node->second.type_ == "Model")
+          objects_with_models.insert(node->second.object_id_);
+      }
+
+      // Find the orphans and group the other documents by content
+      typedef std::pair<size_t, size_t> ContentKey;
+      std::map<ContentKey, std::vector<Graph::const_iterator> > contents;
+      for (Graph::const_iterator node = graph_.begin(); node != graph_.end(); ++node)
+      {
+        if (!IsAlive(node))
+        {
+          report_.orphans_.push_back(node->first);
+          report_.reclaimable_bytes_ += node->second.n_bytes_;
+          continue;
+        }
+        contents[ContentKey(node->second.content_hash_, node->second.n_bytes_)].push_back(node);
+
+        if ((node->second.type_ == "Object") && (!objects_with_models.count(node->first)))
+          report_.objects_without_models_.push_back(node->first);
+      }
+
+      // In each group of identical documents, keep the most referenced one and delete the unreferenced others
+      typedef std::map<ContentKey, std::vector<Graph::const_iterator> >::value_type ContentGroup;
+      BOOST_FOREACH(const ContentGroup & group, contents)
+      {
+        if (group.second.size() < 2)
+          continue;
+        Graph::const_iterator kept = group.second.front();
+        BOOST_FOREACH(const Graph::const_iterator & node, group.second)
+          if (node->second.n_references_ > kept->second.n_references_)
+            kept = node;
+        BOOST_FOREACH(const Graph::const_iterator & node, group.second)
+        {
+          if ((node == kept) || (node->second.n_references_ > 0))
+            continue;
+          report_.duplicates_.push_back(node->first);
+          report_.reclaimable_bytes_ += node->second.n_bytes_;
+        }
+      }
+    }
+
+    void
+    GarbageCollector::Collect()
+    {
+      std::vector<DocumentId> garbage = report_.orphans_;
+      garbage.insert(garbage.end(), report_.duplicates_.begin(), report_.duplicates_.end());
+
+      for (size_t begin = 0; begin < garbage.size(); begin += BATCH_SIZE)
+      {
+        size_t end = std::min(begin + BATCH_SIZE, garbage.size());
+        std::vector<DocumentId> document_ids(garbage.begin() + begin, garbage.begin() + end);
+        std::vector<RevisionId> revision_ids;
+        revision_ids.reserve(document_ids.size());
+        BOOST_FOREACH(const DocumentId & document_id, document_ids)
+          revision_ids.push_back(graph_[document_id].revision_id_);
+
+        db_->DeleteBulk(document_ids, revision_ids);
+        BOOST_FOREACH(const DocumentId & document_id, document_ids)
+          graph_.erase(document_id);
+      }
+
+      report_.orphans_.clear();
+      report_.duplicates_.clear();
+      report_.reclaimable_bytes_ = 0;
+    }
+
+    std::ostream &
+    operator<<(std::ostream & stream, const GarbageReport & report)
+    {
+      stream << "Scanned " << report.n_documents_ << " documents" << std::endl;
+      stream << report.orphans_.size() << " orphans:" << std::endl;
+      BOOST_FOREACH(const DocumentId & document_id, report.orphans_)
+        stream << "  " << document_id << std::endl;
+      stream << report.duplicates_.size() << " duplicates:" << std::endl;
+      BOOST_FOREACH(const DocumentId & document_id, report.duplicates_)
+        stream << "  " << document_id << std::endl;
+      stream << report.objects_without_models_.size() << " objects without models:" << std::endl;
+      BOOST_FOREACH(const ObjectId & object_id, report.objects_without_models_)
+        stream << "  " << object_id << std::endl;
+      stream << "Reclaimable: " << report.reclaimable_bytes_ << " bytes" << std::endl;
+      return stream;
+    }
+  }
+}
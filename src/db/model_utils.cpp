@@ -2,6 +2,7 @@
 
 #include <object_recognition_core/common/json_spirit/json_spirit_reader_template.h>
 #include <object_recognition_core/common/json.hpp>
+#include <object_recognition_core/db/db.h>
 #include <object_recognition_core/db/model_utils.h>
 #include <object_recognition_core/db/view.h>
 
@@ -95,13 +96,31 @@ namespace object_recognition_core
       doc.set_field("parameters", parameters);
     }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    Documents
+    LoadDocuments(const ObjectDbPtr &db, const std::vector<DocumentId> & document_ids)
+    {
+      std::vector<or_json::mObject> fields;
+      db->load_fields_bulk(document_ids, fields);
+
+      Documents documents(document_ids.size());
+      for (size_t i = 0; i < document_ids.size(); ++i)
+      {
+        documents[i].set_db(db);
+        documents[i].set_document_id(document_ids[i]);
+        documents[i].set_fields(fields[i]);
+      }
+      return documents;
+    }
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     Documents
     ModelDocuments(ObjectDbPtr &db, const std::vector<ObjectId> & object_ids, const std::string & method)
     {
-      Documents model_documents;
-      model_documents.reserve(object_ids.size());
+      std::vector<DocumentId> model_ids;
+      model_ids.reserve(object_ids.size());
 
       // ext, for each object id, find the models (if any) that fit the parameters
       BOOST_FOREACH(const ModelId & object_id, object_ids)
@@ -114,17 +133,14 @@ namespace object_recognition_core
         while (view_iterator != ViewIterator::end())
         {
           const or_json::mObject & obj = (*view_iterator).fields();
-          // Compare the parameters to the input ones
-          Document doc;
-          doc.set_db(db);
-          doc.set_document_id(obj.find("_id")->second.get_str());
-          doc.load_fields();
-          model_documents.push_back(doc);
+          model_ids.push_back(obj.find("_id")->second.get_str());
 
           ++view_iterator;
         }
       }
-      return model_documents;
+
+      // load all the models at once
+      return LoadDocuments(db, model_ids);
     }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -132,7 +148,7 @@ namespace object_recognition_core
     Documents
     ModelDocuments(ObjectDbPtr &db, const std::string & method)
     {
-      Documents model_documents;
+      std::vector<DocumentId> model_ids;
 
       // ext, for each object id, find the models (if any) that fit the parameters
       View view(View::VIEW_MODEL_WHERE_OBJECT_ID_AND_MODEL_TYPE);
@@ -145,17 +161,13 @@ namespace object_recognition_core
       while (view_iterator != ViewIterator::end())
       {
         const or_json::mObject & obj = (*view_iterator).fields();
-        // Compare the parameters to the input ones
-        Document doc;
-        doc.set_db(db);
-        doc.set_document_id(obj.find("_id")->second.get_str());
-        doc.load_fields();
-        model_documents.push_back(doc);
+        model_ids.push_back(obj.find("_id")->second.get_str());
 
         ++view_iterator;
       }
 
-      return model_documents;
+      // load all the models at once
+      return LoadDocuments(db, model_ids);
     }
   }
 }
@@ -4,13 +4,19 @@ namespace object_recognition_core
 {
   namespace db
   {
+    void
+    wrap_db_buffers();
     void
     wrap_db_documents();
     void
+    wrap_db_gc();
+    void
     wrap_db_models();
     void
     wrap_db_parameters();
     void
+    wrap_db_query();
+    void
     wrap_object_db_local();
   }
 }
@@ -18,8 +24,11 @@ namespace object_recognition_core
 BOOST_PYTHON_MODULE(interface)
 {
   using namespace object_recognition_core::db;
+  wrap_db_buffers();
   wrap_db_documents();
+  wrap_db_gc();
   wrap_db_models();
   wrap_object_db_local();
   wrap_db_parameters();
+  wrap_db_query();
 }
@@ -84,6 +84,10 @@ namespace object_recognition_core
   if (fields.find("mesh_uri") != fields.end())
     set_field("mesh_uri", fields.find("mesh_uri")->second.get_str());
 
+  // Get the size of the object, if known
+  if (fields.find("radius") != fields.end())
+    set_field("radius", fields.find("radius")->second.get_real());
+
   // Get the mesh id
   std::string mesh_id;
   db::View view = db::View(db::View::VIEW_MODEL_WHERE_OBJECT_ID_AND_MODEL_TYPE);
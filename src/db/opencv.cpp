@@ -2,9 +2,12 @@
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 
+#include <object_recognition_core/common/mat_pool.h>
+#include <object_recognition_core/common/trace.h>
 #include <object_recognition_core/db/opencv.h>
 
 namespace fs = boost::filesystem;
@@ -32,9 +35,55 @@ namespace object_recognition_core
       return fname;
     }
 
+    /** The biggest side of a PNG decoded in a buffer of the pool: the bigger ones are not worth pooling */
+    static const boost::uint32_t PNG_POOL_MAX_SIDE = 16384;
+
+    /** @return the big-endian 32 bit unsigned integer at the beginning of some data */
+    static boost::uint32_t
+    BigEndianUint32(const unsigned char * data)
+    {
+      return (boost::uint32_t(data[0]) << 24) | (boost::uint32_t(data[1]) << 16) | (boost::uint32_t(data[2]) << 8)
+             | boost::uint32_t(data[3]);
+    }
+
+    /** Read the size and the type of the image decoded from a PNG, from its IHDR chunk
+     * @return false if the data is not a PNG or if its size is invalid or too big for the pool
+     */
+    static bool
+    PngSizeType(const std::string & data, int & rows, int & cols, int & type)
+    {
+      static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+      if ((data.size() < 26) || (data.compare(0, 8, reinterpret_cast<const char*>(signature), 8) != 0)
+          || (data.compare(12, 4, "IHDR") != 0))
+        return false;
+
+      // The header comes from the DB: do not trust it to allocate the buffer
+      const unsigned char * header = reinterpret_cast<const unsigned char*>(data.data());
+      boost::uint32_t width = BigEndianUint32(header + 16), height = BigEndianUint32(header + 20);
+      if ((width == 0) || (height == 0) || (width > PNG_POOL_MAX_SIDE) || (height > PNG_POOL_MAX_SIDE))
+        return false;
+      cols = int(width);
+      rows = int(height);
+      int depth = (header[24] == 16) ? CV_16U : CV_8U;
+      // PNG color types: 0 gray, 2 RGB, 3 palette, 4 gray + alpha, 6 RGB + alpha. imdecode with ANYCOLOR drops the
+      // alpha channel
+      switch (header[25])
+      {
+        case 0:
+        case 4:
+          type = CV_MAKETYPE(depth, 1);
+          break;
+        default:
+          type = CV_MAKETYPE(depth, 3);
+          break;
+      }
+      return true;
+    }
+
     void
     mats2yaml(const std::map<std::string, cv::Mat>& mm,std::ostream& out, bool do_gzip)
     {
+      ORK_TRACE_SCOPE("opencv", "mats2yaml");
       std::string fname = temporary_yml_file_name(do_gzip);
       {
         cv::FileStorage fs(fname, cv::FileStorage::WRITE);
@@ -54,6 +103,7 @@ namespace object_recognition_core
     void
     yaml2mats(std::map<std::string, cv::Mat>& mm,std::istream& in, bool do_gzip)
     {
+      ORK_TRACE_SCOPE("opencv", "yaml2mats");
       std::string fname = temporary_yml_file_name(do_gzip);
       {
         std::ofstream writer(fname.c_str());
@@ -74,6 +124,7 @@ namespace object_recognition_core
     void
     png_attach(cv::Mat image, db::DummyDocument& doc, const std::string& name)
     {
+      ORK_TRACE_SCOPE("opencv", "png_attach");
       std::vector<uint8_t> buffer;
       std::stringstream ss;
       cv::imencode(".png", image, buffer);
@@ -84,16 +135,29 @@ namespace object_recognition_core
     void
     get_png_attachment(cv::Mat& image, const db::DummyDocument& doc, const std::string& name)
     {
+      ORK_TRACE_SCOPE("opencv", "get_png_attachment");
       std::stringstream ss;
       doc.get_attachment_stream(name, ss);
-      std::streampos length = ss.tellp();
-      std::vector<uint8_t> buffer(length);
-      ss.read((char*) buffer.data(), length);
+      std::string data = ss.str();
+      if (data.empty())
+      {
+        image = cv::Mat();
+        return;
+      }
+      cv::Mat buffer(1, data.size(), CV_8UC1, &data[0]);
+
+      // Decode in a buffer of the pool if the PNG header gives a sane size: imdecode only reallocates it if the guess
+      // was wrong
+      int rows, cols, type;
+      cv::Mat destination;
+      if (PngSizeType(data, rows, cols, type))
+        destination = common::MatPool::Instance().Acquire(rows, cols, type);
 #if OPENCV3
-      image = cv::imdecode(buffer, cv::IMREAD_ANYDEPTH | cv::IMREAD_ANYCOLOR);
+      cv::imdecode(buffer, cv::IMREAD_ANYDEPTH | cv::IMREAD_ANYCOLOR, &destination);
 #else
-      image = cv::imdecode(buffer, CV_LOAD_IMAGE_ANYDEPTH | CV_LOAD_IMAGE_ANYCOLOR);
+      cv::imdecode(buffer, CV_LOAD_IMAGE_ANYDEPTH | CV_LOAD_IMAGE_ANYCOLOR, &destination);
 #endif
+      image = destination;
     }
   }
 
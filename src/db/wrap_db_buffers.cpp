@@ -0,0 +1,295 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <sstream>
+#include <string>
+
+#include <boost/python.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/opencv.h>
+
+namespace bp = boost::python;
+
+namespace object_recognition_core
+{
+  namespace db
+  {
+    typedef boost::shared_ptr<Document> DocumentPtr;
+
+    /** The memory behind a buffer given to Python: either the raw bytes of an attachment or a decoded cv::Mat. It
+     * also keeps the Document alive for as long as Python uses the buffer
+     */
+    struct AttachmentBuffer
+    {
+      AttachmentBuffer()
+          :
+            is_readonly_(false)
+      {
+      }
+
+      DocumentPtr document_;
+      std::string bytes_;
+      /** The bytes stored in the Document itself */
+      boost::shared_ptr<const char> data_;
+      cv::Mat mat_;
+
+      bool is_readonly_;
+
+      char * buf_;
+      Py_ssize_t len_;
+      Py_ssize_t item_size_;
+      const char * format_;
+      int ndim_;
+      Py_ssize_t shape_[3];
+      Py_ssize_t strides_[3];
+    };
+
+    /** The Python object exporting an AttachmentBuffer through the buffer protocol */
+    struct AttachmentBufferObject
+    {
+      PyObject_HEAD
+      AttachmentBuffer * buffer_;
+    };
+
+    static PyTypeObject AttachmentBufferType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+    static int
+    AttachmentBufferGetBuffer(PyObject * self, Py_buffer * view, int flags)
+    {
+      const AttachmentBuffer & buffer = *reinterpret_cast<AttachmentBufferObject *>(self)->buffer_;
+
+      if (buffer.is_readonly_ && (flags & PyBUF_WRITABLE))
+      {
+        PyErr_SetString(PyExc_BufferError, "The attachment buffer is read-only");
+        view->obj = NULL;
+        return -1;
+      }
+
+      view->obj = self;
+      Py_INCREF(self);
+      view->buf = buffer.buf_;
+      view->len = buffer.len_;
+      view->readonly = buffer.is_readonly_;
+      view->itemsize = buffer.item_size_;
+      view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>(buffer.format_) : NULL;
+      // the data is always C contiguous so a consumer can ignore the shape and/or the strides
+      view->ndim = buffer.ndim_;
+      view->shape = (flags & PyBUF_ND) ? const_cast<Py_ssize_t *>(buffer.shape_) : NULL;
+      view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? const_cast<Py_ssize_t *>(buffer.strides_) : NULL;
+      view->suboffsets = NULL;
+      view->internal = NULL;
+      return 0;
+    }
+
+    static void
+    AttachmentBufferDealloc(PyObject * self)
+    {
+      delete reinterpret_cast<AttachmentBufferObject *>(self)->buffer_;
+      Py_TYPE(self)->tp_free(self);
+    }
+
+    static PyBufferProcs AttachmentBufferProcs;
+
+    /** Wrap a buffer in a Python memoryview: the memory is shared, not copied
+     * @param buffer the buffer, owned by the returned object
+     */
+    static bp::object
+    MakeMemoryView(AttachmentBuffer * buffer)
+    {
+      AttachmentBufferObject * exporter = PyObject_New(AttachmentBufferObject, &AttachmentBufferType);
+      if (!exporter)
+      {
+        delete buffer;
+        bp::throw_error_already_set();
+      }
+      exporter->buffer_ = buffer;
+      bp::object owner = bp::object(bp::handle<>(reinterpret_cast<PyObject *>(exporter)));
+
+      return bp::object(bp::handle<>(PyMemoryView_FromObject(owner.ptr())));
+    }
+
+    /** @return the struct module format of the elements of a cv::Mat */
+    static const char *
+    MatFormat(int depth)
+    {
+      switch (depth)
+      {
+        case CV_8U:
+          return "B";
+        case CV_8S:
+          return "b";
+        case CV_16U:
+          return "H";
+        case CV_16S:
+          return "h";
+        case CV_32S:
+          return "i";
+        case CV_32F:
+          return "f";
+        case CV_64F:
+          return "d";
+        default:
+          throw std::runtime_error("Unsupported cv::Mat depth");
+      }
+    }
+
+    /** Expose a decoded cv::Mat as a memoryview of shape (rows, cols) or (rows, cols, channels)
+     * @param document the Document the cv::Mat comes from
+     * @param mat the matrix whose data is shared
+     */
+    static bp::object
+    MatMemoryView(const DocumentPtr & document, const cv::Mat & mat)
+    {
+      if (mat.dims > 2)
+        throw std::runtime_error("Only 2d cv::Mat can be exported to Python");
+
+      AttachmentBuffer * buffer = new AttachmentBuffer();
+      buffer->document_ = document;
+      // the decoded matrices are continuous but make sure the strides can be described simply
+      buffer->mat_ = mat.isContinuous() ? mat : mat.clone();
+      buffer->buf_ = reinterpret_cast<char *>(buffer->mat_.data);
+      buffer->item_size_ = buffer->mat_.elemSize1();
+      buffer->len_ = buffer->mat_.total() * buffer->mat_.elemSize();
+      buffer->format_ = MatFormat(buffer->mat_.depth());
+      buffer->ndim_ = (buffer->mat_.channels() == 1) ? 2 : 3;
+      buffer->shape_[0] = buffer->mat_.rows;
+      buffer->shape_[1] = buffer->mat_.cols;
+      buffer->shape_[2] = buffer->mat_.channels();
+      buffer->strides_[2] = buffer->item_size_;
+      buffer->strides_[1] = buffer->mat_.elemSize();
+      buffer->strides_[0] = buffer->strides_[1] * buffer->mat_.cols;
+
+      return MakeMemoryView(buffer);
+    }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    /** Give a string to Python as a memoryview, without copying it
+     * @param bytes the string to share: it is swapped with an empty one
+     * @param document the Document the string comes from, if any
+     */
+    bp::object
+    StringMemoryView(std::string & bytes, const DocumentPtr & document)
+    {
+      AttachmentBuffer * buffer = new AttachmentBuffer();
+      buffer->document_ = document;
+      buffer->bytes_.swap(bytes);
+      buffer->buf_ = const_cast<char *>(buffer->bytes_.data());
+      buffer->len_ = buffer->bytes_.size();
+      buffer->item_size_ = 1;
+      buffer->format_ = "B";
+      buffer->ndim_ = 1;
+      buffer->shape_[0] = buffer->len_;
+      buffer->strides_[0] = 1;
+
+      return MakeMemoryView(buffer);
+    }
+
+    /** @return the raw bytes of an attachment as a read-only memoryview of the ones stored in the Document, fetching
+     * them from the DB first if they are not cached
+     */
+    bp::object
+    DocumentAttachmentBuffer(const DocumentPtr & document, const AttachmentName & attachment_name)
+    {
+      if (!document->has_attachment(attachment_name))
+      {
+        // a stream without a buffer: the attachment is only cached, not copied
+        std::ostream null_stream(NULL);
+        document->get_attachment_stream_and_cache(attachment_name, null_stream);
+      }
+
+      AttachmentBuffer * buffer = new AttachmentBuffer();
+      buffer->document_ = document;
+      MimeType mime_type;
+      size_t size;
+      try
+      {
+        buffer->data_ = document->get_cached_attachment_data(attachment_name, mime_type, size);
+      } catch (...)
+      {
+        delete buffer;
+        throw;
+      }
+      buffer->is_readonly_ = true;
+      buffer->buf_ = const_cast<char *>(buffer->data_.get());
+      buffer->len_ = size;
+      buffer->item_size_ = 1;
+      buffer->format_ = "B";
+      buffer->ndim_ = 1;
+      buffer->shape_[0] = buffer->len_;
+      buffer->strides_[0] = 1;
+
+      return MakeMemoryView(buffer);
+    }
+
+    /** @return a cv::Mat attachment (stored as YAML, e.g. with set_attachment<cv::Mat>) as a memoryview */
+    bp::object
+    DocumentAttachmentMat(const DocumentPtr & document, const AttachmentName & attachment_name)
+    {
+      cv::Mat mat;
+      document->get_attachment<cv::Mat>(attachment_name, mat);
+      return MatMemoryView(document, mat);
+    }
+
+    /** @return an image attachment (stored as PNG, e.g. with png_attach) as a memoryview */
+    bp::object
+    DocumentAttachmentImage(const DocumentPtr & document, const AttachmentName & attachment_name)
+    {
+      cv::Mat image;
+      get_png_attachment(image, *document, attachment_name);
+      return MatMemoryView(document, image);
+    }
+
+    void
+    wrap_db_buffers()
+    {
+      AttachmentBufferProcs.bf_getbuffer = AttachmentBufferGetBuffer;
+      AttachmentBufferType.tp_name = "object_recognition_core.boost.interface.AttachmentBuffer";
+      AttachmentBufferType.tp_basicsize = sizeof(AttachmentBufferObject);
+      AttachmentBufferType.tp_dealloc = AttachmentBufferDealloc;
+      AttachmentBufferType.tp_as_buffer = &AttachmentBufferProcs;
+#if PY_MAJOR_VERSION < 3
+      AttachmentBufferType.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#else
+      AttachmentBufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+#endif
+      if (PyType_Ready(&AttachmentBufferType) < 0)
+        bp::throw_error_already_set();
+    }
+  }
+}
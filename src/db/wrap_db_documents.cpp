@@ -32,17 +32,25 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  *
  */
+#include <algorithm>
 #include <string>
 
+#include <boost/foreach.hpp>
 #include <boost/function.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
 #include <boost/python.hpp>
 #include <boost/python/stl_iterator.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <object_recognition_core/common/dict_json_conversion.h>
 #include <object_recognition_core/db/db.h>
 #include <object_recognition_core/db/model_utils.h>
 
+#include "../common/pickle_utils.h"
+#include "python_gil.h"
+
 namespace bp = boost::python;
 
 namespace object_recognition_core
@@ -52,6 +60,16 @@ namespace object_recognition_core
     typedef boost::shared_ptr<Document> DocumentPtr;
     typedef boost::shared_ptr<Documents> DocumentsPtr;
 
+    // Defined in wrap_db_buffers.cpp
+    bp::object
+    DocumentAttachmentBuffer(const DocumentPtr & document, const AttachmentName & attachment_name);
+    bp::object
+    DocumentAttachmentMat(const DocumentPtr & document, const AttachmentName & attachment_name);
+    bp::object
+    DocumentAttachmentImage(const DocumentPtr & document, const AttachmentName & attachment_name);
+    bp::object
+    StringMemoryView(std::string & bytes, const DocumentPtr & document);
+
     /** Function used to create a vector of db Document's from Python
      * @param db_params
      * @param python_document_ids
@@ -63,52 +81,216 @@ namespace object_recognition_core
       bp::list ids_list = bp::extract<bp::list>(python_document_ids);
       size_t ids_nbr = bp::len(ids_list);
 
-      // Create the Documents from the ids
-      DocumentsPtr p(new Documents());
-      p->reserve(ids_nbr);
-
+      // Get the ids while holding the GIL
+      std::vector<DocumentId> document_ids;
+      document_ids.reserve(ids_nbr);
       for(size_t i = 0; i < ids_nbr; ++i) {
         std::string object_classname = boost::python::extract<std::string>(ids_list[i].attr("__class__").attr("__name__"));
-        DocumentId document_id;
         if (object_classname == "str")
-          document_id = bp::extract<std::string>(ids_list[i]);
+          document_ids.push_back(bp::extract<std::string>(ids_list[i]));
         else
-          document_id = bp::extract<std::string>(bp::str(ids_list[i]).encode("utf-8"));
+          document_ids.push_back(bp::extract<std::string>(bp::str(ids_list[i]).encode("utf-8")));
+      }
 
-        Document doc;
-        doc.set_db(db);
-        doc.set_document_id(document_id);
-        doc.load_fields();
-        p->push_back(doc);
+      // Create the Documents from the ids, loading them all at once without blocking the other Python threads
+      DocumentsPtr p(new Documents());
+      {
+        ScopedGILRelease gil_release;
+        *p = LoadDocuments(db, document_ids);
       }
 
       return p;
     }
 
-    // Define the pickling of the object
-    struct db_documents_pickle_suite: boost::python::pickle_suite
+    /** @return the JSON fields of a Document as a Python dictionary */
+    bp::dict
+    DocumentFields(const Document & document)
     {
-      static boost::python::tuple
-      getinitargs(const ObjectDbParameters& db_params)
+      return common::JsonToBpDict(document.fields());
+    }
+
+    /** Set a JSON field of a Document from any Python value (None, bool, int, float, string, list, tuple or dict) */
+    void
+    DocumentSetField(Document & document, const std::string & key, const bp::object & value)
+    {
+      document.set_field(key, common::BpObjectToJson(value));
+    }
+
+    /** Set several JSON fields of a Document from a Python dictionary, overwriting the existing ones like dict.update
+     */
+    void
+    DocumentSetFields(Document & document, const bp::dict & fields)
+    {
+      // Document::set_fields does not overwrite the existing keys
+      or_json::mObject json_fields = common::BpDictToJson(fields);
+      for (or_json::mObject::const_iterator iter = json_fields.begin(); iter != json_fields.end(); ++iter)
+        document.set_field(iter->first, iter->second);
+    }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    /** The version of the layout of the pickled Documents */
+    static const int DOCUMENTS_PICKLE_VERSION = 1;
+
+    static const or_json::mValue &
+    JsonMember(const or_json::mObject & object, const std::string & key)
+    {
+      or_json::mObject::const_iterator iter = object.find(key);
+      if (iter == object.end())
+        throw std::runtime_error("Invalid pickled Documents: missing \"" + key + "\"");
+      return iter->second;
+    }
+
+    /** Get the pickle state of Documents: a JSON header with the ids, revisions, fields, DB parameters and the names
+     * and types of the attachments stored in the documents, and one buffer per attachment. With pickle protocol 5,
+     * the buffers are PickleBuffers sharing the C++ memory so that they can be sent out-of-band
+     * @param documents the documents to pickle
+     * @param protocol the pickle protocol
+     * @return the state as a (header, buffers) tuple
+     */
+    bp::tuple
+    PickleDocuments(const Documents & documents, int protocol)
+    {
+      bp::object pickle_buffer;
+      if (protocol >= 5)
+      {
+        bp::object pickle = bp::import("pickle");
+        if (PyObject_HasAttrString(pickle.ptr(), "PickleBuffer"))
+          pickle_buffer = pickle.attr("PickleBuffer");
+      }
+
+      // the documents usually share the same DB: only write its parameters once
+      std::vector<ObjectDbPtr> dbs;
+      or_json::mArray dbs_json, documents_json;
+      bp::list buffers;
+      BOOST_FOREACH(const Document & document, documents)
       {
-        return boost::python::make_tuple();
+        or_json::mObject document_json;
+        document_json["_id"] = document.id();
+        document_json["_rev"] = document.rev();
+        document_json["fields"] = document.fields();
+
+        int db_index = -1;
+        if (document.db())
+        {
+          db_index = std::find(dbs.begin(), dbs.end(), document.db()) - dbs.begin();
+          if (db_index == int(dbs.size()))
+          {
+            dbs.push_back(document.db());
+            dbs_json.push_back(document.db()->parameters().raw());
+          }
+        }
+        document_json["db"] = db_index;
+
+        or_json::mArray attachments_json;
+        BOOST_FOREACH(const AttachmentName & attachment_name, document.cached_attachment_names())
+        {
+          or_json::mObject attachment_json;
+          MimeType mime_type;
+          std::string data;
+          document.get_cached_attachment(attachment_name, mime_type, data);
+          attachment_json["name"] = attachment_name;
+          attachment_json["type"] = mime_type;
+          attachments_json.push_back(attachment_json);
+
+          if (pickle_buffer.is_none())
+            buffers.append(common::PickleBytes(data));
+          else
+            buffers.append(pickle_buffer(StringMemoryView(data, DocumentPtr())));
+        }
+        document_json["attachments"] = attachments_json;
+        documents_json.push_back(document_json);
       }
 
-      static boost::python::tuple
-      getstate(const ObjectDbParameters& db_params)
+      or_json::mObject header;
+      header["version"] = DOCUMENTS_PICKLE_VERSION;
+      header["dbs"] = dbs_json;
+      header["documents"] = documents_json;
+      return bp::make_tuple(or_json::write(header), buffers);
+    }
+
+    /** Re-create Documents from the state given by PickleDocuments
+     * @param state the (header, buffers) tuple
+     * @param documents the re-created documents
+     */
+    void
+    UnpickleDocuments(const bp::tuple & state, Documents & documents)
+    {
+      if (bp::len(state) != 2)
       {
-        // TODO
-        return boost::python::make_tuple();
+        PyErr_SetObject(PyExc_ValueError, ("expected 2-item tuple in call to __setstate__; got %s" % state).ptr());
+        bp::throw_error_already_set();
       }
+      or_json::mValue header_value;
+      or_json::read(std::string(bp::extract<std::string>(state[0])), header_value);
+      const or_json::mObject & header = header_value.get_obj();
+      if (JsonMember(header, "version").get_int() != DOCUMENTS_PICKLE_VERSION)
+        throw std::runtime_error("Unsupported version of pickled Documents.");
+      bp::object buffers = state[1];
+
+      // the unpickled documents live in another process: leave the journals of the tiered DBs to the original one
+      std::vector<ObjectDbPtr> dbs;
+      BOOST_FOREACH(const or_json::mValue & db_json, JsonMember(header, "dbs").get_array())
+        dbs.push_back(ObjectDbParameters(db_json.get_obj()).secondary().generateDb());
 
-      static
-      void
-      setstate(ObjectDbParameters& db_params, boost::python::tuple state)
+      documents.clear();
+      size_t buffer_index = 0;
+      BOOST_FOREACH(const or_json::mValue & document_value, JsonMember(header, "documents").get_array())
       {
-        using namespace boost::python;
-        // TODO
+        const or_json::mObject & document_json = document_value.get_obj();
+        Document document;
+        int db_index = JsonMember(document_json, "db").get_int();
+        if (db_index >= int(dbs.size()))
+          throw std::runtime_error("Invalid DB in pickled Documents.");
+        if (db_index >= 0)
+          document.set_db(dbs[db_index]);
+        document.SetIdRev(JsonMember(document_json, "_id").get_str(), JsonMember(document_json, "_rev").get_str());
+        document.set_fields(JsonMember(document_json, "fields").get_obj());
+
+        BOOST_FOREACH(const or_json::mValue & attachment_value, JsonMember(document_json, "attachments").get_array())
+        {
+          const or_json::mObject & attachment_json = attachment_value.get_obj();
+          // read the buffer in place
+          common::BinaryReader reader(buffers[buffer_index++]);
+          size_t size = reader.remaining();
+          boost::iostreams::stream<boost::iostreams::array_source> stream(reader.Advance(size), size);
+          document.set_attachment_stream(JsonMember(attachment_json, "name").get_str(), stream,
+                                         JsonMember(attachment_json, "type").get_str());
+        }
+        documents.push_back(document);
       }
-    };
+    }
+
+    bp::tuple
+    DocumentsReduceEx(const bp::object & self, int protocol)
+    {
+      const Documents & documents = bp::extract<const Documents &>(self);
+      return bp::make_tuple(self.attr("__class__"), bp::make_tuple(), PickleDocuments(documents, protocol));
+    }
+
+    void
+    DocumentsSetState(Documents & documents, const bp::tuple & state)
+    {
+      UnpickleDocuments(state, documents);
+    }
+
+    bp::tuple
+    DocumentReduceEx(const bp::object & self, int protocol)
+    {
+      const Document & document = bp::extract<const Document &>(self);
+      return bp::make_tuple(self.attr("__class__"), bp::make_tuple(),
+                            PickleDocuments(Documents(1, document), protocol));
+    }
+
+    void
+    DocumentSetState(Document & document, const bp::tuple & state)
+    {
+      Documents documents;
+      UnpickleDocuments(state, documents);
+      if (documents.size() != 1)
+        throw std::runtime_error("Expected a single pickled Document.");
+      document = documents[0];
+    }
 
     void
     wrap_db_documents()
@@ -116,12 +298,22 @@ namespace object_recognition_core
       bp::class_<Document, DocumentPtr> DocumentClass("Document");
       DocumentClass.def(bp::init<>()).def(bp::init<Document>());
       DocumentClass.def("id", &Document::id, bp::return_value_policy<bp::return_by_value>());
+      DocumentClass.def("fields", DocumentFields);
+      DocumentClass.def("set_field", DocumentSetField);
+      DocumentClass.def("set_fields", DocumentSetFields);
+      // the attachments are given as memoryviews sharing the C++ memory, e.g. for numpy.asarray
+      DocumentClass.def("get_attachment_buffer", DocumentAttachmentBuffer);
+      DocumentClass.def("get_attachment_mat", DocumentAttachmentMat);
+      DocumentClass.def("get_attachment_image", DocumentAttachmentImage);
+      DocumentClass.def("__reduce_ex__", DocumentReduceEx);
+      DocumentClass.def("__setstate__", DocumentSetState);
 
       bp::class_<Documents, DocumentsPtr> DocumentsClass("Documents");
       DocumentsClass.def("__init__", bp::make_constructor(DocumentsConstructor));
       DocumentsClass.def(boost::python::vector_indexing_suite<Documents>());
       DocumentsClass.def("size", &Documents::size);
-      DocumentsClass.def_pickle(db_documents_pickle_suite());
+      DocumentsClass.def("__reduce_ex__", DocumentsReduceEx);
+      DocumentsClass.def("__setstate__", DocumentsSetState);
     }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,89 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <sstream>
+#include <string>
+
+#include <boost/python.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/gc.h>
+
+namespace bp = boost::python;
+
+namespace object_recognition_core
+{
+  namespace db
+  {
+    typedef boost::shared_ptr<GarbageCollector> GarbageCollectorPtr;
+
+    /** Function used to create a GarbageCollector from Python
+     * @param db the ObjectDb to clean
+     * @return
+     */
+    GarbageCollectorPtr
+    GarbageCollectorConstructor(const ObjectDbPtr & db)
+    {
+      return GarbageCollectorPtr(new GarbageCollector(db));
+    }
+
+    std::string
+    report(const GarbageCollectorPtr & gc)
+    {
+      std::stringstream ss;
+      ss << gc->report();
+      return ss.str();
+    }
+
+    size_t
+    reclaimable_bytes(const GarbageCollectorPtr & gc)
+    {
+      return gc->report().reclaimable_bytes_;
+    }
+
+    void
+    wrap_db_gc()
+    {
+      bp::class_<GarbageCollector, GarbageCollectorPtr, boost::noncopyable> GarbageCollectorClass("GarbageCollector",
+                                                                                                 bp::no_init);
+      GarbageCollectorClass.def("__init__", bp::make_constructor(GarbageCollectorConstructor));
+      GarbageCollectorClass.def("scan", &GarbageCollector::Scan, "Scan the DB to find orphans and duplicates.");
+      GarbageCollectorClass.def("collect", &GarbageCollector::Collect, "Delete what the last scan found.");
+      GarbageCollectorClass.def("report", report, "The report of the last scan, as a string.");
+      GarbageCollectorClass.add_property("reclaimable_bytes", reclaimable_bytes,
+                                         "The number of bytes the collection would free.");
+    }
+  }
+}
@@ -87,7 +87,7 @@ namespace object_recognition_core
       static boost::python::tuple
       getstate(const ObjectDbParameters& db_params)
       {
-        return boost::python::make_tuple(common::JsonToBpDict(db_params.raw()));
+        return boost::python::make_tuple(or_json::write(db_params.raw()));
       }
 
       static
@@ -101,7 +101,12 @@ namespace object_recognition_core
           throw_error_already_set();
         }
 
-        db_params = ObjectDbParameters(common::BpDictToJson(extract<bp::dict>(state[3])));
+        // the parameters are pickled as JSON, older pickles have a dictionary
+        extract<std::string> json(state[0]);
+        if (json.check())
+          db_params = ObjectDbParameters(json());
+        else
+          db_params = ObjectDbParameters(common::BpDictToJson(extract<bp::dict>(state[0])));
       }
     };
 
@@ -128,7 +133,8 @@ namespace object_recognition_core
       ObjectDbParametersClass.def_pickle(db_parameters_pickle_suite());
       bp::enum_<ObjectDbParameters::ObjectDbType>("ObjectDbTypes").value("COUCHDB", ObjectDbParameters::COUCHDB).value(
           "EMPTY", ObjectDbParameters::EMPTY).value("FILESYSTEM", ObjectDbParameters::FILESYSTEM).value(
-          "NONCORE", ObjectDbParameters::NONCORE);
+          "SHARDED", ObjectDbParameters::SHARDED).value("TIERED", ObjectDbParameters::TIERED).value(
+          "LATENCY", ObjectDbParameters::LATENCY).value("NONCORE", ObjectDbParameters::NONCORE);
     }
   }
 }
@@ -0,0 +1,298 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/python.hpp>
+#include <boost/python/stl_iterator.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <object_recognition_core/common/dict_json_conversion.h>
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/view.h>
+
+#include "python_gil.h"
+
+namespace bp = boost::python;
+
+namespace object_recognition_core
+{
+  namespace db
+  {
+    /** Iterate from Python over the results of a query, page by page: the next page is fetched (and parsed) in a
+     * background thread while Python consumes the current one, and the GIL is released while waiting for it.
+     * The DBs are not thread safe: the background thread works on its own instance of the DB
+     */
+    class DocumentPages: boost::noncopyable
+    {
+    public:
+      typedef boost::function<void(const ObjectDbPtr & db, int limit_rows, int start_offset, int& total_rows,
+                                   int& offset, std::vector<Document> & view_elements)> Query;
+
+      /**
+       * @param db the DB to query
+       * @param query the query to run on a given DB for each page
+       * @param page_size the number of documents to fetch per request
+       * @param do_load_fields if true, the full documents are loaded (in bulk) for each page, otherwise the documents
+       *        only contain what the query returns
+       */
+      DocumentPages(const ObjectDbPtr & db, const Query & query, int page_size, bool do_load_fields)
+          :
+            db_(db),
+            query_(query),
+            page_size_(page_size),
+            do_load_fields_(do_load_fields),
+            start_offset_(0),
+            position_(0),
+            has_next_page_(true)
+      {
+        if (page_size_ <= 0)
+          throw std::runtime_error("The page size must be strictly positive.");
+        fetch_db_ = FetchDb(db_->parameters());
+        Prefetch();
+      }
+
+      ~DocumentPages()
+      {
+        if (thread_.joinable())
+        {
+          ScopedGILRelease gil_release;
+          thread_.join();
+        }
+      }
+
+      /** @return the next document, or raise StopIteration in Python */
+      Document
+      next()
+      {
+        if (position_ >= current_page_.size())
+        {
+          if (!has_next_page_)
+            StopIteration();
+          if (fetch_db_)
+          {
+            ScopedGILRelease gil_release;
+            thread_.join();
+          }
+          else
+            // a DB implemented in Python is queried in this thread, with the GIL
+            Fetch(db_, start_offset_);
+          if (!error_.empty())
+          {
+            has_next_page_ = false;
+            throw std::runtime_error(error_);
+          }
+
+          current_page_.swap(next_page_);
+          next_page_.clear();
+          position_ = 0;
+          start_offset_ += current_page_.size();
+          // a short page is the last one
+          has_next_page_ = (current_page_.size() == size_t(page_size_));
+          if (has_next_page_)
+            Prefetch();
+          if (current_page_.empty())
+            StopIteration();
+        }
+
+        return current_page_[position_++];
+      }
+
+    private:
+      static void
+      StopIteration()
+      {
+        PyErr_SetNone(PyExc_StopIteration);
+        bp::throw_error_already_set();
+      }
+
+      /** @return a new instance of the DB for the background thread, or nothing if it cannot be created (the DBs
+       * not implemented in C++). It only reads: the tiered DBs, even nested ones, leave their journal to the original
+       */
+      static ObjectDbPtr
+      FetchDb(const ObjectDbParameters & parameters)
+      {
+        if (parameters.type() == ObjectDbParameters::NONCORE)
+          return ObjectDbPtr();
+        return parameters.secondary().generateDb();
+      }
+
+      /** Start fetching the page after the current one */
+      void
+      Prefetch()
+      {
+        if (fetch_db_)
+          thread_ = boost::thread(boost::bind(&DocumentPages::Fetch, this, fetch_db_, start_offset_));
+      }
+
+      /** Fetch a page, usually in the background thread: exceptions cannot cross threads so they are kept as a
+       * message
+       * @param db the DB to fetch from
+       */
+      void
+      Fetch(const ObjectDbPtr & db, int start_offset)
+      {
+        try
+        {
+          // the offset returned by the DB is not always the one of the filtered results (e.g. for keyed CouchDB
+          // views) so the pages are counted here
+          int total_rows, offset;
+          query_(db, page_size_, start_offset, total_rows, offset, next_page_);
+
+          if (do_load_fields_ && !next_page_.empty())
+          {
+            std::vector<DocumentId> document_ids;
+            document_ids.reserve(next_page_.size());
+            BOOST_FOREACH(const Document & document, next_page_)
+              document_ids.push_back(document.id());
+            std::vector<or_json::mObject> fields;
+            db->load_fields_bulk(document_ids, fields);
+            for (size_t i = 0; i < next_page_.size(); ++i)
+            {
+              next_page_[i].ClearAllFields();
+              next_page_[i].set_fields(fields[i]);
+            }
+          }
+
+          BOOST_FOREACH(Document & document, next_page_)
+            document.set_db(db_);
+        } catch (std::exception & e)
+        {
+          error_ = e.what();
+        }
+      }
+
+      /** The DB of the caller, that the documents are attached to */
+      ObjectDbPtr db_;
+      /** The DB the pages are fetched from in the background thread */
+      ObjectDbPtr fetch_db_;
+      Query query_;
+      int page_size_;
+      bool do_load_fields_;
+      /** The offset of the page being fetched */
+      int start_offset_;
+
+      std::vector<Document> current_page_;
+      size_t position_;
+      /** The page filled by the background thread */
+      std::vector<Document> next_page_;
+      bool has_next_page_;
+      boost::thread thread_;
+      std::string error_;
+    };
+    typedef boost::shared_ptr<DocumentPages> DocumentPagesPtr;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    DocumentPages &
+    DocumentPagesIter(DocumentPages & pages)
+    {
+      return pages;
+    }
+
+    /** Iterate over the models of a given method, for one object or for all of them
+     * @param db the DB to query
+     * @param method the method of the models (e.g. 'TOD')
+     * @param object_id the id of the object, or an empty string for all the objects
+     * @param page_size the number of documents to fetch per request
+     */
+    DocumentPagesPtr
+    QueryModels(const ObjectDbPtr & db, const std::string & method, const ObjectId & object_id, int page_size)
+    {
+      View view(View::VIEW_MODEL_WHERE_OBJECT_ID_AND_MODEL_TYPE);
+      view.Initialize(method);
+      if (!object_id.empty())
+        view.set_key(object_id);
+      return DocumentPagesPtr(
+          new DocumentPages(db, boost::bind(&ObjectDb::QueryView, _1, view, _2, _3, _4, _5, _6), page_size, false));
+    }
+
+    /** Iterate over the observations of an object
+     * @param db the DB to query
+     * @param object_id the id of the object
+     * @param page_size the number of documents to fetch per request
+     * @param do_load_fields if true, load the full documents and not only what the view returns
+     */
+    DocumentPagesPtr
+    QueryObservations(const ObjectDbPtr & db, const ObjectId & object_id, int page_size, bool do_load_fields)
+    {
+      View view(View::VIEW_OBSERVATION_WHERE_OBJECT_ID);
+      view.set_key(object_id);
+      return DocumentPagesPtr(
+          new DocumentPages(db, boost::bind(&ObjectDb::QueryView, _1, view, _2, _3, _4, _5, _6), page_size,
+                            do_load_fields));
+    }
+
+    /** Iterate over the results of a DB specific query (e.g. a CouchDB map function)
+     * @param db the DB to query
+     * @param bp_queries a list of query strings
+     * @param page_size the number of documents to fetch per request
+     * @param do_load_fields if true, load the full documents and not only what the query returns
+     */
+    DocumentPagesPtr
+    QueryGenericFromPython(const ObjectDbPtr & db, const bp::object & bp_queries, int page_size, bool do_load_fields)
+    {
+      std::vector<std::string> queries;
+      {
+        bp::stl_input_iterator<std::string> begin(bp_queries), end;
+        std::copy(begin, end, std::back_inserter(queries));
+      }
+      return DocumentPagesPtr(
+          new DocumentPages(db, boost::bind(&ObjectDb::QueryGeneric, _1, queries, _2, _3, _4, _5, _6), page_size,
+                            do_load_fields));
+    }
+
+    void
+    wrap_db_query()
+    {
+      bp::class_<DocumentPages, DocumentPagesPtr, boost::noncopyable> DocumentPagesClass("DocumentPages", bp::no_init);
+      DocumentPagesClass.def("__iter__", DocumentPagesIter, bp::return_self<>());
+      DocumentPagesClass.def("next", &DocumentPages::next);
+      DocumentPagesClass.def("__next__", &DocumentPages::next);
+
+      bp::def("QueryModels", QueryModels,
+              (bp::arg("db"), bp::arg("method"), bp::arg("object_id") = std::string(), bp::arg("page_size") = 100));
+      bp::def("QueryObservations", QueryObservations,
+              (bp::arg("db"), bp::arg("object_id"), bp::arg("page_size") = 100, bp::arg("load_fields") = false));
+      bp::def("QueryGeneric", QueryGenericFromPython,
+              (bp::arg("db"), bp::arg("queries"), bp::arg("page_size") = 100, bp::arg("load_fields") = false));
+    }
+  }
+}
@@ -35,55 +35,7 @@
 
 #include <ecto/ecto.hpp>
 
-#include <limits>
-
-#include <opencv2/core/core.hpp>
-
-namespace object_recognition_core
-{
-  namespace filters
-  {
-    struct DepthFilter
-    {
-      static void
-      declare_params(ecto::tendrils& params)
-      {
-        params.declare<float>("d_min", "The minimal distance at which object become interesting (in meters)",
-                              -std::numeric_limits<float>::max());
-        params.declare<float>("d_max", "The maximal distance at which object become interesting (in meters)",
-                              std::numeric_limits<float>::max());
-      }
-
-      void
-      configure(const ecto::tendrils& params, const ecto::tendrils& inputs, const ecto::tendrils& outputs)
-      {
-        d_min_ = params.get<float>("d_min");
-      }
-
-      static void
-      declare_io(const ecto::tendrils& params, ecto::tendrils& inputs, ecto::tendrils& outputs)
-      {
-        inputs.declare<cv::Mat>("points3d", "The 3d points: width by height by 3 channels");
-        outputs.declare<cv::Mat>("mask", "The mask of what is within the depth range in the image");
-      }
-
-      int
-      process(const ecto::tendrils& inputs, const ecto::tendrils& outputs)
-      {
-        // Get the depth
-        std::vector<cv::Mat> channels(3);
-        cv::split(inputs.get<cv::Mat>("points3d"), channels);
-
-        cv::Mat output = ((d_min_ < channels[2]) & (channels[2] < d_max_));
-
-        outputs["mask"] << output;
-        return ecto::OK;
-      }
-    private:
-      float d_min_, d_max_;
-    };
-  }
-}
+#include "depth_filter.h"
 
 ECTO_CELL(filters, object_recognition_core::filters::DepthFilter, "depth_filter",
           "Given a depth image, return the mask of what is between two depths.")
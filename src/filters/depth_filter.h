@@ -0,0 +1,105 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <ecto/ecto.hpp>
+
+#include <limits>
+
+#include <opencv2/core/core.hpp>
+
+#include <object_recognition_core/common/mat_pool.h>
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
+
+namespace object_recognition_core
+{
+  namespace filters
+  {
+    struct DepthFilter
+    {
+      static void
+      declare_params(ecto::tendrils& params)
+      {
+        params.declare<float>("d_min", "The minimal distance at which object become interesting (in meters)",
+                              -std::numeric_limits<float>::max());
+        params.declare<float>("d_max", "The maximal distance at which object become interesting (in meters)",
+                              std::numeric_limits<float>::max());
+      }
+
+      void
+      configure(const ecto::tendrils& params, const ecto::tendrils& inputs, const ecto::tendrils& outputs)
+      {
+        d_min_ = params.get<float>("d_min");
+        d_max_ = params.get<float>("d_max");
+      }
+
+      static void
+      declare_io(const ecto::tendrils& params, ecto::tendrils& inputs, ecto::tendrils& outputs)
+      {
+        inputs.declare<cv::Mat>("points3d", "The 3d points: width by height by 3 channels");
+        outputs.declare<cv::Mat>("mask", "The mask of what is within the depth range in the image");
+      }
+
+      int
+      process(const ecto::tendrils& inputs, const ecto::tendrils& outputs)
+      {
+        ORK_TRACE_SCOPE("cell", "DepthFilter::process");
+        ORK_METRICS_CELL_LATENCY("DepthFilter");
+        ORK_STARTUP_FIRST_CALL("DepthFilter::process");
+        // Get the depth in a buffer that is reused from frame to frame
+        const cv::Mat & points3d = inputs.get<cv::Mat>("points3d");
+        depth_.create(points3d.size(), CV_MAKETYPE(points3d.depth(), 1));
+        int from_to[] = { 2, 0 };
+        cv::mixChannels(&points3d, 1, &depth_, 1, from_to, 1);
+
+        // The mask goes downstream so it comes from the pool, to be recycled once it is released
+        cv::Mat output = common::MatPool::Instance().Acquire(points3d.size(), CV_8UC1);
+        cv::compare(depth_, double(d_min_), output, cv::CMP_GT);
+        cv::compare(depth_, double(d_max_), below_max_, cv::CMP_LT);
+        cv::bitwise_and(output, below_max_, output);
+
+        outputs["mask"] << output;
+        return ecto::OK;
+      }
+    private:
+      float d_min_, d_max_;
+      /** Temporary buffers */
+      cv::Mat depth_, below_max_;
+    };
+  }
+}
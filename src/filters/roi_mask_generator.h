@@ -0,0 +1,165 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <ecto/ecto.hpp>
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <object_recognition_core/common/mat_pool.h>
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/pose_result.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
+#include <object_recognition_core/db/db.h>
+
+namespace object_recognition_core
+{
+  namespace filters
+  {
+    /** Cell that projects the objects found on a previous frame in the image and outputs the mask of the regions where
+     * they should be now: a disk per object, of the size of its bounding sphere (the "radius" field of its document if
+     * it has one), dilated by a motion margin. Region-aware detectors can then only search those regions
+     */
+    struct RoiMaskGenerator
+    {
+      static void
+      declare_params(ecto::tendrils& params)
+      {
+        params.declare(&RoiMaskGenerator::default_radius_, "default_radius",
+                       "The radius of the bounding sphere of the objects without any in the DB, in meters.", 0.1f);
+        params.declare(&RoiMaskGenerator::margin_, "margin",
+                       "The margin around each projected object, for its motion since the last frame, in pixels.", 20);
+        params.declare(&RoiMaskGenerator::full_frame_when_empty_, "full_frame_when_empty",
+                       "Whether to output a full mask when there are no previous objects, to look for new ones.", true);
+      }
+
+      static void
+      declare_io(const ecto::tendrils& params, ecto::tendrils& inputs, ecto::tendrils& outputs)
+      {
+        inputs.declare(&RoiMaskGenerator::pose_results_, "pose_results", "The objects found on a previous frame");
+        inputs.declare(&RoiMaskGenerator::K_, "K", "The camera intrinsics matrix.");
+        inputs.declare(&RoiMaskGenerator::image_, "image", "An image of the current frame, for the size of the mask.");
+        outputs.declare(&RoiMaskGenerator::mask_, "mask", "The mask of the regions where the objects should be.");
+      }
+
+      int
+      process(const ecto::tendrils& inputs, const ecto::tendrils& outputs)
+      {
+        ORK_TRACE_SCOPE("cell", "RoiMaskGenerator::process");
+        ORK_METRICS_CELL_LATENCY("RoiMaskGenerator");
+        ORK_STARTUP_FIRST_CALL("RoiMaskGenerator::process");
+
+        cv::Mat mask = common::MatPool::Instance().Acquire(image_->size(), CV_8UC1);
+        // Without previous objects or calibration, there is no region to focus on
+        if (pose_results_->empty() || K_->empty())
+        {
+          bool is_full = pose_results_->empty() ? *full_frame_when_empty_ : true;
+          mask.setTo(cv::Scalar::all(is_full ? 255 : 0));
+          *mask_ = mask;
+          return ecto::OK;
+        }
+
+        mask.setTo(cv::Scalar::all(0));
+        cv::Mat_<double> K;
+        K_->convertTo(K, CV_64F);
+        for (size_t i = 0; i < pose_results_->size(); ++i)
+        {
+          const common::PoseResult & pose_result = (*pose_results_)[i];
+          cv::Vec3f T = pose_result.T<cv::Vec3f>();
+          double radius = Radius(pose_result);
+
+          // The camera is inside the bounding sphere: the object can be anywhere
+          if (T[2] <= radius)
+          {
+            mask.setTo(cv::Scalar::all(255));
+            break;
+          }
+
+          cv::Point center(cvRound(K(0, 0) * T[0] / T[2] + K(0, 2)), cvRound(K(1, 1) * T[1] / T[2] + K(1, 2)));
+          int radius_pixels = cvRound(std::max(K(0, 0), K(1, 1)) * radius / (T[2] - radius)) + *margin_;
+          cv::circle(mask, center, radius_pixels, cv::Scalar::all(255), -1);
+        }
+        *mask_ = mask;
+
+        return ecto::OK;
+      }
+    private:
+      /** @return the radius of the bounding sphere of an object, from the DB if it is known */
+      double
+      Radius(const common::PoseResult & pose_result)
+      {
+        std::map<db::ObjectId, double>::const_iterator iter = radii_.find(pose_result.object_id());
+        if (iter != radii_.end())
+          return iter->second;
+
+        double radius = *default_radius_;
+        if (pose_result.db())
+        {
+          try
+          {
+            // only the fields are needed: the attachments (e.g. meshes) are not loaded
+            or_json::mObject fields;
+            pose_result.db()->load_fields(pose_result.object_id(), fields);
+            or_json::mObject::const_iterator field = fields.find("radius");
+            if (field != fields.end())
+              radius = field->second.get_real();
+          } catch (std::exception &)
+          {
+            // the object is not in the DB or its radius is not a number: keep the default size
+          }
+        }
+        radii_[pose_result.object_id()] = radius;
+        return radius;
+      }
+
+      ecto::spore<float> default_radius_;
+      ecto::spore<int> margin_;
+      ecto::spore<bool> full_frame_when_empty_;
+      ecto::spore<std::vector<common::PoseResult> > pose_results_;
+      ecto::spore<cv::Mat> K_, image_, mask_;
+
+      /** The radius of each object, to only ask the DB once */
+      std::map<db::ObjectId, double> radii_;
+    };
+  }
+}
@@ -0,0 +1,196 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <limits>
+
+#include <ecto/ecto.hpp>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
+
+namespace object_recognition_core
+{
+  namespace filters
+  {
+    /** Cell that tells whether the scene changed since the last frame that was processed, by comparing a tiny signature
+     * of the RGB and depth images: the means of a grid of blocks (cv::resize with INTER_AREA, which is vectorized).
+     * Its "changed" output is meant to gate the detection pipelines (see the "gate" key of the configuration files):
+     * when it is false, they are skipped and their previous results are output again
+     */
+    struct SceneChangeGate
+    {
+      static void
+      declare_params(ecto::tendrils& params)
+      {
+        params.declare(&SceneChangeGate::grid_width_, "grid_width", "The number of blocks in the width of the images.",
+                       16);
+        params.declare(&SceneChangeGate::grid_height_, "grid_height",
+                       "The number of blocks in the height of the images.", 12);
+        params.declare(&SceneChangeGate::image_threshold_, "image_threshold",
+                       "The change of the mean of a block of the image above which the scene changed, in gray levels.",
+                       6.0f);
+        params.declare(&SceneChangeGate::depth_threshold_, "depth_threshold",
+                       "The change of the mean of a block of the depth above which the scene changed, in meters.",
+                       0.02f);
+        params.declare(&SceneChangeGate::max_skipped_, "max_skipped",
+                       "The maximum number of consecutive frames to skip, 0 for no limit.", 30);
+      }
+
+      static void
+      declare_io(const ecto::tendrils& params, ecto::tendrils& inputs, ecto::tendrils& outputs)
+      {
+        inputs.declare(&SceneChangeGate::image_, "image", "The RGB image.");
+        inputs.declare(&SceneChangeGate::depth_, "depth", "The depth image, in meters (float) or millimeters.");
+        outputs.declare(&SceneChangeGate::changed_, "changed",
+                        "Whether the scene changed since the last frame that was processed.");
+      }
+
+      void
+      configure(const ecto::tendrils& params, const ecto::tendrils& inputs, const ecto::tendrils& outputs)
+      {
+        n_skipped_ = 0;
+      }
+
+      int
+      process(const ecto::tendrils& inputs, const ecto::tendrils& outputs)
+      {
+        ORK_TRACE_SCOPE("cell", "SceneChangeGate::process");
+        ORK_METRICS_CELL_LATENCY("SceneChangeGate");
+        ORK_STARTUP_FIRST_CALL("SceneChangeGate::process");
+        static const char * const help = "Frames seen by a SceneChangeGate, by whether the scene changed";
+        static common::Counter & n_changed = common::MetricsRegistry::Instance().counter(
+            "ork_scene_gate_frames_total", "changed=\"true\"", help);
+        static common::Counter & n_unchanged = common::MetricsRegistry::Instance().counter(
+            "ork_scene_gate_frames_total", "changed=\"false\"", help);
+
+        Signature(*image_, image_signature_);
+        DepthSignature(*depth_, depth_signature_);
+
+        bool changed = IsDifferent(image_signature_, last_image_signature_, *image_threshold_)
+                       || IsDifferent(depth_signature_, last_depth_signature_, *depth_threshold_)
+                       || (image_signature_.empty() && depth_signature_.empty())
+                       || ((*max_skipped_ > 0) && (n_skipped_ >= *max_skipped_));
+
+        if (changed)
+        {
+          n_changed.Increment();
+          n_skipped_ = 0;
+          // Compare to the last processed frame and not to the last frame so that slow changes add up
+          cv::swap(image_signature_, last_image_signature_);
+          cv::swap(depth_signature_, last_depth_signature_);
+        }
+        else
+        {
+          n_unchanged.Increment();
+          ++n_skipped_;
+        }
+        *changed_ = changed;
+
+        return ecto::OK;
+      }
+    private:
+      /** Compute the means of the blocks of an image, as floats */
+      void
+      Signature(const cv::Mat & image, cv::Mat & signature) const
+      {
+        if (image.empty())
+        {
+          signature = cv::Mat();
+          return;
+        }
+        cv::resize(image, blocks_, cv::Size(*grid_width_, *grid_height_), 0, 0, cv::INTER_AREA);
+        blocks_.convertTo(signature, CV_MAKETYPE(CV_32F, image.channels()));
+      }
+
+      /** Compute the means of the valid depths (neither NaN nor 0) of the blocks of a depth image, in meters. The
+       * blocks without any valid depth are NaN
+       */
+      void
+      DepthSignature(const cv::Mat & depth, cv::Mat & signature) const
+      {
+        if (depth.empty())
+        {
+          signature = cv::Mat();
+          return;
+        }
+        depth.convertTo(depth_meters_, CV_32F, (depth.depth() == CV_16U) ? 0.001 : 1.0);
+        cv::patchNaNs(depth_meters_, 0);
+        cv::compare(depth_meters_, 0, mask_, cv::CMP_NE);
+        mask_.convertTo(valid_, CV_32F, 1.0 / 255);
+
+        // the block means of the depths (invalid ones being 0) divided by the fraction of valid depths in each block
+        cv::Size grid(*grid_width_, *grid_height_);
+        cv::resize(depth_meters_, blocks_, grid, 0, 0, cv::INTER_AREA);
+        cv::resize(valid_, valid_blocks_, grid, 0, 0, cv::INTER_AREA);
+        cv::divide(blocks_, valid_blocks_, signature);
+        cv::compare(valid_blocks_, 0, mask_, cv::CMP_EQ);
+        signature.setTo(std::numeric_limits<float>::quiet_NaN(), mask_);
+      }
+
+      /** @return true if the mean of any block of any channel changed by more than a threshold. The blocks that are
+       * NaN in either signature are ignored
+       */
+      bool
+      IsDifferent(const cv::Mat & signature, const cv::Mat & last_signature, float threshold) const
+      {
+        if (signature.empty())
+          return false;
+        if ((signature.size() != last_signature.size()) || (signature.type() != last_signature.type()))
+          return true;
+        cv::absdiff(signature, last_signature, difference_);
+        cv::patchNaNs(difference_, 0);
+        return cv::norm(difference_, cv::NORM_INF) > threshold;
+      }
+
+      ecto::spore<int> grid_width_, grid_height_;
+      ecto::spore<float> image_threshold_, depth_threshold_;
+      ecto::spore<int> max_skipped_;
+      ecto::spore<cv::Mat> image_, depth_;
+      ecto::spore<bool> changed_;
+
+      /** The signatures of the current frame and of the last processed frame */
+      cv::Mat image_signature_, depth_signature_, last_image_signature_, last_depth_signature_;
+      /** Temporary buffers */
+      mutable cv::Mat blocks_, depth_meters_, mask_, valid_, valid_blocks_, difference_;
+      int n_skipped_;
+    };
+  }
+}
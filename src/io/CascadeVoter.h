@@ -0,0 +1,176 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <ecto/ecto.hpp>
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
+#include <object_recognition_core/common/pose_result.h>
+
+namespace object_recognition_core
+{
+  namespace voters
+  {
+    /** Cell that decides whether the next, more expensive, stage of a cascade of pipelines has to run on that frame:
+     * only if the previous stages found too few objects or were not confident enough. Its needs_detection output is
+     * meant to gate the pipelines of the next stage and, with cascade_pose_results, to feed a CascadeMerge
+     */
+    struct CascadeVoter
+    {
+      static void
+      declare_params(ecto::tendrils& p)
+      {
+        p.declare(&CascadeVoter::min_confidence_, "min_confidence",
+                  "Run the next stage if any result of the previous stages has a lower confidence.", 0.8f);
+        p.declare(&CascadeVoter::min_objects_, "min_objects",
+                  "Run the next stage if the previous stages found fewer objects.", 1);
+      }
+
+      static void
+      declare_io(const ecto::tendrils& p, ecto::tendrils& inputs, ecto::tendrils& outputs)
+      {
+        inputs.declare(&CascadeVoter::input_pose_results_, "pose_results", "The results of the previous stages");
+        outputs.declare(&CascadeVoter::needs_detection_, "needs_detection", "Whether the next stage has to run");
+        outputs.declare(&CascadeVoter::output_pose_results_, "cascade_pose_results",
+                        "The results of the previous stages, for a CascadeMerge");
+      }
+
+      int
+      process(const ecto::tendrils& in, const ecto::tendrils& out)
+      {
+        ORK_TRACE_SCOPE("cell", "CascadeVoter::process");
+        ORK_METRICS_CELL_LATENCY("CascadeVoter");
+        ORK_STARTUP_FIRST_CALL("CascadeVoter::process");
+        static const char * const help = "Frames for which a CascadeVoter ran the next stage (escalated) or not";
+        static common::Counter & n_escalated = common::MetricsRegistry::Instance().counter(
+            "ork_cascade_frames_total", "escalated=\"true\"", help);
+        static common::Counter & n_stopped = common::MetricsRegistry::Instance().counter(
+            "ork_cascade_frames_total", "escalated=\"false\"", help);
+
+        bool needs_detection = input_pose_results_->size() < (size_t) (*min_objects_);
+        for (size_t i = 0; (i < input_pose_results_->size()) && !needs_detection; ++i)
+          needs_detection = (*input_pose_results_)[i].confidence() < *min_confidence_;
+
+        if (needs_detection)
+          n_escalated.Increment();
+        else
+          n_stopped.Increment();
+        *needs_detection_ = needs_detection;
+        *output_pose_results_ = *input_pose_results_;
+
+        return ecto::OK;
+      }
+
+      ecto::spore<float> min_confidence_;
+      ecto::spore<int> min_objects_;
+      ecto::spore<std::vector<common::PoseResult> > input_pose_results_;
+      ecto::spore<bool> needs_detection_;
+      ecto::spore<std::vector<common::PoseResult> > output_pose_results_;
+    };
+
+    /** Cell that merges the results of a stage of a cascade with the ones of the previous stages. When the stage did
+     * not run (needs_detection is false), its pose_results are the ones of an older frame and are ignored. Otherwise,
+     * its results replace the results of the previous stages for the same object instances
+     */
+    struct CascadeMerge
+    {
+      static void
+      declare_params(ecto::tendrils& p)
+      {
+        p.declare(&CascadeMerge::max_distance_, "max_distance",
+                  "The maximum distance between two results of the same object to consider them the same instance, "
+                  "in meters.", 0.05f);
+      }
+
+      static void
+      declare_io(const ecto::tendrils& p, ecto::tendrils& inputs, ecto::tendrils& outputs)
+      {
+        inputs.declare(&CascadeMerge::cascade_pose_results_, "cascade_pose_results",
+                       "The results of the previous stages, from a CascadeVoter");
+        inputs.declare(&CascadeMerge::needs_detection_, "needs_detection", "Whether the stage ran on that frame");
+        inputs.declare(&CascadeMerge::input_pose_results_, "pose_results", "The results of the stage");
+        outputs.declare(&CascadeMerge::output_pose_results_, "pose_results", "The merged results");
+      }
+
+      int
+      process(const ecto::tendrils& in, const ecto::tendrils& out)
+      {
+        ORK_TRACE_SCOPE("cell", "CascadeMerge::process");
+        ORK_METRICS_CELL_LATENCY("CascadeMerge");
+        ORK_STARTUP_FIRST_CALL("CascadeMerge::process");
+
+        std::vector<common::PoseResult> pose_results = *cascade_pose_results_;
+        if (*needs_detection_)
+        {
+          std::vector<common::PoseResult> merged(*input_pose_results_);
+          for (size_t i = 0; i < pose_results.size(); ++i)
+            if (!IsFound(pose_results[i], *input_pose_results_))
+              merged.push_back(pose_results[i]);
+          pose_results.swap(merged);
+        }
+        output_pose_results_->swap(pose_results);
+
+        return ecto::OK;
+      }
+
+    private:
+      /** @return true if the same object instance is in some results */
+      bool
+      IsFound(const common::PoseResult & pose_result,
+              const std::vector<common::PoseResult> & pose_results) const
+      {
+        cv::Vec3f T = pose_result.T<cv::Vec3f>();
+        for (size_t i = 0; i < pose_results.size(); ++i)
+          if ((pose_results[i].object_id() == pose_result.object_id())
+              && (cv::norm(pose_results[i].T<cv::Vec3f>() - T) <= *max_distance_))
+            return true;
+        return false;
+      }
+
+      ecto::spore<float> max_distance_;
+      ecto::spore<std::vector<common::PoseResult> > cascade_pose_results_;
+      ecto::spore<bool> needs_detection_;
+      ecto::spore<std::vector<common::PoseResult> > input_pose_results_;
+      ecto::spore<std::vector<common::PoseResult> > output_pose_results_;
+    };
+  }
+}
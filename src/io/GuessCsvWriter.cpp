@@ -40,6 +40,9 @@
 #include <opencv2/core/core.hpp>
 
 #include <object_recognition_core/common/pose_result.h>
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
 #include "csv.h"
 
 using ecto::tendrils;
@@ -58,6 +61,8 @@ namespace object_recognition_core
       {
         p.declare<std::string>("team_name", "The name of the team to consider");
         p.declare<int>("run_number", "The run number");
+        p.declare<bool>("binary", "If true, write a binary log instead of a CSV file: it is faster to write and to "
+                        "evaluate for long runs", false);
       }
 
       static void
@@ -71,6 +76,8 @@ namespace object_recognition_core
       {
         team_name_ = params.get<std::string>("team_name");
         run_number_ = params.get<int>("run_number");
+        binary_ = params.get<bool>("binary");
+        frame_ = 0;
       }
 
       /** Get the 2d keypoints and figure out their 3D position from the depth map
@@ -81,12 +88,21 @@ namespace object_recognition_core
       int
       process(const tendrils& inputs, const tendrils& outputs)
       {
-        // match to our objects
-        RunInfo run_info;
-        run_info.ts.set();
-        run_info.runID = run_number_;
-        run_info.name = team_name_;
-        CSVOutput csv_out = openCSV(run_info);
+        ORK_TRACE_SCOPE("cell", "GuessCsvWriter::process");
+        ORK_METRICS_CELL_LATENCY("GuessCsvWriter");
+        ORK_STARTUP_FIRST_CALL("GuessCsvWriter::process");
+        // the file is opened once per run and the frames are numbered from there
+        if (!csv_out_ && !binary_out_)
+        {
+          RunInfo run_info;
+          run_info.ts.set();
+          run_info.runID = run_number_;
+          run_info.name = team_name_;
+          if (binary_)
+            binary_out_ = openBinary(run_info);
+          else
+            csv_out_ = openCSV(run_info);
+        }
         int dID = 0; //detection id
         BOOST_FOREACH(const common::PoseResult & pose_result, *pose_results_)
             {
@@ -102,17 +118,27 @@ namespace object_recognition_core
               poseInfo.Ty = T(1);
               poseInfo.Tz = T(2);
               poseInfo.ts.set();
-              //poseInfo.frame = point_cloud.header.seq;
+              poseInfo.run = run_number_;
+              poseInfo.frame = frame_;
               poseInfo.oID = object_id;
               poseInfo.dID = dID++; //training (only one detection per frame)
-              writeCSV(csv_out, poseInfo);
+              if (binary_)
+                writeBinary(binary_out_, poseInfo);
+              else
+                writeCSV(csv_out_, poseInfo);
             }
+        ++frame_;
 
         return 0;
       }
     private:
       int run_number_;
       std::string team_name_;
+      bool binary_;
+      /** The number of the current frame, since the beginning of the run */
+      int frame_;
+      CSVOutput csv_out_;
+      BinaryOutput binary_out_;
       ecto::spore<std::vector<common::PoseResult> > pose_results_;
     };
   }
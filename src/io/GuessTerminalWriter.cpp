@@ -42,6 +42,9 @@
 #include <opencv2/core/core.hpp>
 
 #include <object_recognition_core/common/pose_result.h>
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
 
 using ecto::tendrils;
 using object_recognition_core::common::PoseResult;
@@ -77,6 +80,9 @@ namespace object_recognition_core
       int
       process(const tendrils& inputs, const tendrils& outputs)
       {
+        ORK_TRACE_SCOPE("cell", "GuessTerminalWriter::process");
+        ORK_METRICS_CELL_LATENCY("GuessTerminalWriter");
+        ORK_STARTUP_FIRST_CALL("GuessTerminalWriter::process");
         // match to our objects
         BOOST_FOREACH(const common::PoseResult & pose_result, *pose_results_)
             {
@@ -0,0 +1,125 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <ecto/ecto.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/pose_result.h>
+
+using ecto::tendrils;
+using object_recognition_core::common::Counter;
+using object_recognition_core::common::Gauge;
+using object_recognition_core::common::MetricsRegistry;
+
+namespace object_recognition_core
+{
+  namespace io
+  {
+    /** Ecto cell to put at the end of a pipeline: it counts the frames and the poses going through it, computes the
+     * frame rate and periodically writes all the metrics of the process to a file in the Prometheus text format
+     */
+    struct MetricsSink
+    {
+      static void
+      declare_params(tendrils& p)
+      {
+        p.declare(&MetricsSink::path_, "path",
+                  "The file to write the metrics to. If empty, the metrics are only updated.", "");
+        p.declare(&MetricsSink::period_, "period", "The time between two writes of the metrics, in seconds.", 10.0);
+        p.declare(&MetricsSink::name_, "name", "The value of the \"sink\" label of the metrics of that cell.", "");
+      }
+
+      static void
+      declare_io(const tendrils& params, tendrils& inputs, tendrils& outputs)
+      {
+        inputs.declare(&MetricsSink::pose_results_, "pose_results", "The results of object recognition");
+      }
+
+      void
+      configure(const tendrils& params, const tendrils& inputs, const tendrils& outputs)
+      {
+        std::string labels = name_->empty() ? "" : "sink=\"" + *name_ + "\"";
+        n_frames_ = &MetricsRegistry::Instance().counter("ork_frames_total", labels,
+                                                         "Number of frames that went through a MetricsSink");
+        n_detections_ = &MetricsRegistry::Instance().counter("ork_detections_total", labels,
+                                                             "Number of poses that went through a MetricsSink");
+        frames_per_second_ = &MetricsRegistry::Instance().gauge(
+            "ork_frames_per_second", labels, "Frame rate at a MetricsSink, over its last export period");
+        last_export_ = boost::posix_time::microsec_clock::universal_time();
+        n_frames_at_last_export_ = n_frames_->value();
+      }
+
+      int
+      process(const tendrils& inputs, const tendrils& outputs)
+      {
+        n_frames_->Increment();
+        n_detections_->Increment(pose_results_->size());
+
+        boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+        double elapsed = (now - last_export_).total_microseconds() / 1e6;
+        if (elapsed < *period_)
+          return ecto::OK;
+
+        frames_per_second_->Set((n_frames_->value() - n_frames_at_last_export_) / elapsed);
+        last_export_ = now;
+        n_frames_at_last_export_ = n_frames_->value();
+        if (!path_->empty())
+          MetricsRegistry::Instance().WritePrometheus(*path_);
+
+        return ecto::OK;
+      }
+    private:
+      ecto::spore<std::string> path_;
+      ecto::spore<double> period_;
+      ecto::spore<std::string> name_;
+      /** The object recognition results */
+      ecto::spore<std::vector<common::PoseResult> > pose_results_;
+
+      Counter * n_frames_;
+      Counter * n_detections_;
+      Gauge * frames_per_second_;
+      boost::posix_time::ptime last_export_;
+      boost::uint64_t n_frames_at_last_export_;
+    };
+  }
+}
+
+ECTO_CELL(io, object_recognition_core::io::MetricsSink, "MetricsSink",
+          "Counts the frames and detections and periodically writes the metrics of the process in the Prometheus format.")
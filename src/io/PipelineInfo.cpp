@@ -9,6 +9,9 @@
 
 #include <iostream>
 
+#include <boost/python.hpp>
+
+#include <object_recognition_core/common/dict_json_conversion.h>
 #include <object_recognition_core/common/json.hpp>
 
 using ecto::tendrils;
@@ -24,7 +27,8 @@ namespace object_recognition_core
       static void
       declare_params(tendrils& p)
       {
-        p.declare(&PipelineInfo::parameters_str_, "parameters", "The JSON parameters of the pipeline.");
+        p.declare(&PipelineInfo::parameters_dict_, "parameters", "The parameters of the pipeline, as a dict.",
+                  boost::python::dict());
       }
 
       static void
@@ -37,7 +41,9 @@ namespace object_recognition_core
       void
       configure(const tendrils& params, const tendrils& inputs, const tendrils& outputs)
       {
-        *parameters_ = object_recognition_core::to_json(*parameters_str_);
+        // the dict is converted directly, without going through a JSON string
+        *parameters_ = common::BpObjectToJson(*parameters_dict_);
+        *parameters_str_ = or_json::write(*parameters_);
       }
 
       int
@@ -46,6 +52,7 @@ namespace object_recognition_core
         return ecto::OK;
       }
     private:
+      ecto::spore<boost::python::object> parameters_dict_;
       ecto::spore<std::string> parameters_str_;
       ecto::spore<or_json::mValue> parameters_;
     };
@@ -53,4 +60,4 @@ namespace object_recognition_core
 }
 
 ECTO_CELL(io, object_recognition_core::io::PipelineInfo, "PipelineInfo",
-    "Spits out the parameters given as a JSON sting.")
+    "Spits out the parameters given as a dict, as JSON.")
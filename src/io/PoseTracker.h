@@ -0,0 +1,262 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <ecto/ecto.hpp>
+
+#include <cmath>
+#include <list>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/common/startup.h>
+#include <object_recognition_core/common/trace.h>
+#include <object_recognition_core/common/pose_result.h>
+
+namespace object_recognition_core
+{
+  namespace voters
+  {
+    /** Cell that tracks the objects found by a detector: it keeps one track per object instance, predicts its pose with
+     * a constant velocity model when the detector did not run and outputs the tracked poses at every frame. It also
+     * tells when the detector has to run again (no tracks, periodic refresh or a track that is getting too uncertain),
+     * so that a detection pipeline gated by needs_detection only runs on a fraction of the frames
+     */
+    struct PoseTracker
+    {
+      /** One tracked object instance */
+      struct Track
+      {
+        /** The last detection, for the object id, the DB and the clouds */
+        common::PoseResult pose_result_;
+        /** The predicted pose */
+        cv::Matx33f R_;
+        cv::Vec3f T_;
+        /** The pose at the last detection */
+        cv::Matx33f R_detected_;
+        cv::Vec3f T_detected_;
+        /** The motion in one frame */
+        cv::Matx33f rotation_step_;
+        cv::Vec3f translation_step_;
+        float confidence_;
+        unsigned int n_frames_since_detection_;
+        /** The number of consecutive detections that did not find that track */
+        unsigned int n_missed_;
+      };
+
+      static void
+      declare_params(ecto::tendrils& p)
+      {
+        p.declare(&PoseTracker::detection_period_, "detection_period",
+                  "The maximum number of frames between two detections.", 10);
+        p.declare(&PoseTracker::max_distance_, "max_distance",
+                  "The maximum distance between a detection and the predicted position of a track to match them, "
+                  "in meters.", 0.05f);
+        p.declare(&PoseTracker::max_missed_, "max_missed",
+                  "The number of consecutive detections a track can be missing from before it is dropped.", 1);
+        p.declare(&PoseTracker::confidence_decay_, "confidence_decay",
+                  "The factor applied to the confidence of a track at every frame without detection.", 0.95f);
+        p.declare(&PoseTracker::min_confidence_, "min_confidence",
+                  "Ask for a detection as soon as the confidence of a track, relative to its last detection, goes "
+                  "below that value.", 0.3f);
+      }
+
+      static void
+      declare_io(const ecto::tendrils& p, ecto::tendrils& inputs, ecto::tendrils& outputs)
+      {
+        inputs.declare(&PoseTracker::input_pose_results_, "pose_results", "The results of object recognition");
+        inputs.declare(&PoseTracker::detected_, "detected",
+                       "Whether the detector ran on that frame, i.e. pose_results is new. create_plasm connects it "
+                       "when the tracker gates the detector. Leave it unconnected if the detector runs at every "
+                       "frame.", true);
+
+        outputs.declare(&PoseTracker::output_pose_results_, "pose_results", "The tracked objects");
+        outputs.declare(&PoseTracker::needs_detection_, "needs_detection",
+                        "Whether the detector should run on the next frame. It is true before the first frame.", true);
+      }
+
+      void
+      configure(const ecto::tendrils& p, const ecto::tendrils& in, const ecto::tendrils& out)
+      {
+        n_frames_since_detection_ = 0;
+      }
+
+      int
+      process(const ecto::tendrils& in, const ecto::tendrils& out)
+      {
+        ORK_TRACE_SCOPE("cell", "PoseTracker::process");
+        ORK_METRICS_CELL_LATENCY("PoseTracker");
+        ORK_STARTUP_FIRST_CALL("PoseTracker::process");
+
+        // Predict where the tracks are on that frame
+        ++n_frames_since_detection_;
+        for (std::list<Track>::iterator track = tracks_.begin(); track != tracks_.end(); ++track)
+        {
+          ++track->n_frames_since_detection_;
+          track->R_ = track->rotation_step_ * track->R_;
+          track->T_ += track->translation_step_;
+        }
+
+        static const char * const help = "Frames seen by a PoseTracker, with (detected) or without a detection";
+        static common::Counter & n_frames_detected = common::MetricsRegistry::Instance().counter(
+            "ork_tracker_frames_total", "detected=\"true\"", help);
+        static common::Counter & n_frames_predicted = common::MetricsRegistry::Instance().counter(
+            "ork_tracker_frames_total", "detected=\"false\"", help);
+        if (*detected_)
+        {
+          n_frames_detected.Increment();
+          Update(*input_pose_results_);
+        }
+        else
+          n_frames_predicted.Increment();
+
+        // Output the tracks and check if any needs to be confirmed by the detector
+        bool is_uncertain = false;
+        output_pose_results_->clear();
+        output_pose_results_->reserve(tracks_.size());
+        for (std::list<Track>::const_iterator track = tracks_.begin(); track != tracks_.end(); ++track)
+        {
+          float decay = std::pow(*confidence_decay_, float(track->n_frames_since_detection_));
+          float confidence = track->confidence_ * decay;
+          is_uncertain = is_uncertain || (decay < *min_confidence_);
+
+          common::PoseResult pose_result = track->pose_result_;
+          pose_result.set_R(cv::Mat(track->R_));
+          pose_result.set_T(cv::Mat(track->T_));
+          pose_result.set_confidence(confidence);
+          output_pose_results_->push_back(pose_result);
+        }
+
+        *needs_detection_ = tracks_.empty() || is_uncertain
+                            || (n_frames_since_detection_ + 1 >= (unsigned int) (*detection_period_));
+
+        return ecto::OK;
+      }
+
+    private:
+      /** Match the detections to the closest track of the same object and update those tracks with them */
+      void
+      Update(const std::vector<common::PoseResult> & pose_results)
+      {
+        n_frames_since_detection_ = 0;
+
+        std::vector<bool> is_matched(tracks_.size(), false);
+        std::vector<std::list<Track>::iterator> tracks;
+        for (std::list<Track>::iterator track = tracks_.begin(); track != tracks_.end(); ++track)
+          tracks.push_back(track);
+
+        for (std::vector<common::PoseResult>::const_iterator pose_result = pose_results.begin();
+            pose_result != pose_results.end(); ++pose_result)
+        {
+          cv::Matx33f R = pose_result->R<cv::Matx33f>();
+          cv::Vec3f T = pose_result->T<cv::Vec3f>();
+
+          // Find the closest track of the same object that was not matched yet
+          int best = -1;
+          double best_distance = *max_distance_;
+          for (size_t i = 0; i < tracks.size(); ++i)
+          {
+            if (is_matched[i] || (tracks[i]->pose_result_.object_id() != pose_result->object_id()))
+              continue;
+            double distance = cv::norm(tracks[i]->T_ - T);
+            if (distance <= best_distance)
+            {
+              best = i;
+              best_distance = distance;
+            }
+          }
+
+          if (best < 0)
+          {
+            Track track;
+            track.R_ = track.R_detected_ = R;
+            track.T_ = track.T_detected_ = T;
+            track.rotation_step_ = cv::Matx33f::eye();
+            track.translation_step_ = cv::Vec3f(0, 0, 0);
+            Confirm(track, *pose_result);
+            tracks_.push_back(track);
+            continue;
+          }
+
+          // Estimate the motion per frame since the last detection
+          Track & track = *tracks[best];
+          float n_frames = float(track.n_frames_since_detection_);
+          track.translation_step_ = (T - track.T_detected_) * (1.0f / n_frames);
+          cv::Mat_<float> rotation_vector, rotation_step;
+          cv::Rodrigues(cv::Mat(R * track.R_detected_.t()), rotation_vector);
+          cv::Rodrigues(cv::Mat_<float>(rotation_vector / n_frames), rotation_step);
+          track.rotation_step_ = rotation_step;
+
+          track.R_ = track.R_detected_ = R;
+          track.T_ = track.T_detected_ = T;
+          Confirm(track, *pose_result);
+          is_matched[best] = true;
+        }
+
+        // Drop the tracks that the detector has not found for too long
+        for (size_t i = 0; i < tracks.size(); ++i)
+          if (!is_matched[i] && (++tracks[i]->n_missed_ > (unsigned int) (*max_missed_)))
+            tracks_.erase(tracks[i]);
+      }
+
+      static void
+      Confirm(Track & track, const common::PoseResult & pose_result)
+      {
+        track.pose_result_ = pose_result;
+        track.confidence_ = pose_result.confidence();
+        track.n_frames_since_detection_ = 0;
+        track.n_missed_ = 0;
+      }
+
+      ecto::spore<int> detection_period_;
+      ecto::spore<float> max_distance_;
+      ecto::spore<int> max_missed_;
+      ecto::spore<float> confidence_decay_;
+      ecto::spore<float> min_confidence_;
+
+      ecto::spore<std::vector<common::PoseResult> > input_pose_results_;
+      ecto::spore<bool> detected_;
+      ecto::spore<std::vector<common::PoseResult> > output_pose_results_;
+      ecto::spore<bool> needs_detection_;
+
+      std::list<Track> tracks_;
+      unsigned int n_frames_since_detection_;
+    };
+  }
+}
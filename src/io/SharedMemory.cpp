@@ -0,0 +1,194 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <ecto/ecto.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include <object_recognition_core/common/metrics.h>
+
+#include "shared_memory_ring.h"
+
+using ecto::tendrils;
+using object_recognition_core::common::Counter;
+using object_recognition_core::common::MetricsRegistry;
+
+namespace object_recognition_core
+{
+  namespace io
+  {
+    /** Ecto cell that publishes the frames of a capture pipeline in a shared memory ring so that other processes
+     * (with a SharedMemorySource) can read them without any serialization. It creates the ring and removes it when
+     * destroyed
+     */
+    struct SharedMemorySink
+    {
+      static void
+      declare_params(tendrils& p)
+      {
+        p.declare(&SharedMemorySink::name_, "name", "The name of the shared memory segment.", "ork_frames");
+        p.declare(&SharedMemorySink::n_slots_, "n_slots",
+                  "The number of frames in the ring: it has to be bigger than the number of readers.", 4);
+        p.declare(&SharedMemorySink::slot_size_, "slot_size",
+                  "The maximum size of a frame (all its matrices), in bytes.", 8 * 1024 * 1024);
+      }
+
+      static void
+      declare_io(const tendrils& params, tendrils& inputs, tendrils& outputs)
+      {
+        inputs.declare(&SharedMemorySink::image_, "image", "The RGB image.");
+        inputs.declare(&SharedMemorySink::depth_, "depth", "The depth image.");
+        inputs.declare(&SharedMemorySink::K_, "K", "The camera intrinsics matrix.");
+        inputs.declare(&SharedMemorySink::points3d_, "points3d", "The 3d points, height by width with 3 channels.");
+      }
+
+      void
+      configure(const tendrils& params, const tendrils& inputs, const tendrils& outputs)
+      {
+        ring_ = SharedMemoryRing::Create(*name_, *n_slots_, *slot_size_);
+        n_dropped_ = &MetricsRegistry::Instance().counter(
+            "ork_shared_memory_dropped_total", "segment=\"" + *name_ + "\"",
+            "Frames dropped by a SharedMemorySink as all the slots were held by readers");
+      }
+
+      int
+      process(const tendrils& inputs, const tendrils& outputs)
+      {
+        std::vector<cv::Mat> mats(4);
+        mats[0] = *image_;
+        mats[1] = *depth_;
+        mats[2] = *K_;
+        mats[3] = *points3d_;
+        if (!ring_->Write(mats))
+          n_dropped_->Increment();
+
+        return ecto::OK;
+      }
+    private:
+      ecto::spore<std::string> name_;
+      ecto::spore<int> n_slots_;
+      ecto::spore<int> slot_size_;
+      ecto::spore<cv::Mat> image_, depth_, K_, points3d_;
+
+      SharedMemoryRing::Ptr ring_;
+      /** The frames dropped because all the slots were held by readers */
+      Counter * n_dropped_;
+    };
+
+    /** Ecto cell that reads the frames published by a SharedMemorySink in another process. The output matrices point
+     * directly into shared memory: they are valid until the next call to process, so copy them to keep them longer
+     */
+    struct SharedMemorySource
+    {
+      static void
+      declare_params(tendrils& p)
+      {
+        p.declare(&SharedMemorySource::name_, "name", "The name of the shared memory segment.", "ork_frames");
+        p.declare(&SharedMemorySource::timeout_, "timeout",
+                  "The time to wait for a new frame before stopping the pipeline, in seconds. Waits forever if <= 0.",
+                  10.0);
+      }
+
+      static void
+      declare_io(const tendrils& params, tendrils& inputs, tendrils& outputs)
+      {
+        outputs.declare(&SharedMemorySource::image_, "image", "The RGB image.");
+        outputs.declare(&SharedMemorySource::depth_, "depth", "The depth image.");
+        outputs.declare(&SharedMemorySource::K_, "K", "The camera intrinsics matrix.");
+        outputs.declare(&SharedMemorySource::points3d_, "points3d", "The 3d points, height by width with 3 channels.");
+        outputs.declare(&SharedMemorySource::sequence_, "sequence",
+                        "The sequence number of the frame: gaps are frames that were skipped.");
+      }
+
+      void
+      configure(const tendrils& params, const tendrils& inputs, const tendrils& outputs)
+      {
+        last_sequence_ = 0;
+      }
+
+      int
+      process(const tendrils& inputs, const tendrils& outputs)
+      {
+        boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time()
+            + boost::posix_time::microseconds(static_cast<boost::int64_t>(*timeout_ * 1e6));
+        // The writer might not have created the ring yet
+        while (!ring_)
+        {
+          ring_ = SharedMemoryRing::Open(*name_);
+          if (ring_)
+            break;
+          if ((*timeout_ > 0) && (boost::posix_time::microsec_clock::universal_time() > deadline))
+            return ecto::QUIT;
+          boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+        }
+
+        std::vector<cv::Mat> mats;
+        boost::uint64_t sequence;
+        if (!ring_->Read(last_sequence_, *timeout_, mats, sequence))
+          return ecto::QUIT;
+        if (mats.size() != 4)
+          throw std::runtime_error("Unexpected frame in the shared memory segment " + *name_);
+
+        *image_ = mats[0];
+        *depth_ = mats[1];
+        *K_ = mats[2];
+        *points3d_ = mats[3];
+        *sequence_ = sequence;
+        last_sequence_ = sequence;
+
+        return ecto::OK;
+      }
+    private:
+      ecto::spore<std::string> name_;
+      ecto::spore<double> timeout_;
+      ecto::spore<cv::Mat> image_, depth_, K_, points3d_;
+      ecto::spore<boost::uint64_t> sequence_;
+
+      SharedMemoryRing::Ptr ring_;
+      boost::uint64_t last_sequence_;
+    };
+  }
+}
+
+ECTO_CELL(io, object_recognition_core::io::SharedMemorySink, "SharedMemorySink",
+          "Publishes the frames (image, depth, K, points3d) in a shared memory ring for other processes.")
+ECTO_CELL(io, object_recognition_core::io::SharedMemorySource, "SharedMemorySource",
+          "Reads the frames (image, depth, K, points3d) published by a SharedMemorySink, without any copy.")
@@ -32,11 +32,67 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdio>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include "csv.h"
 
+namespace
+{
+  /** The first bytes of a binary log, that also define the version of its layout */
+  const char BINARY_MAGIC[] = "ORKPOSE1";
+  const size_t BINARY_MAGIC_SIZE = sizeof(BINARY_MAGIC) - 1;
+
+  std::string
+  logName(const object_recognition_core::io::RunInfo &rn, const std::string &extension)
+  {
+    return str(
+        boost::format("RUN%.4d_%s_%d%d%d_%.2d.%.2d.%.2d.%s") % rn.runID % rn.name % rn.ts.year % rn.ts.month
+        % rn.ts.day
+        % rn.ts.hour
+        % rn.ts.min
+        % rn.ts.sec
+        % extension);
+  }
+
+  template<typename T>
+  void
+  writeValue(std::ostream &out, const T &value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template<typename T>
+  bool
+  readValue(std::istream &in, T &value)
+  {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return in.gcount() == std::streamsize(sizeof(T));
+  }
+
+  template<typename T>
+  T
+  parseField(const std::string &field, const std::string &path, size_t line_number)
+  {
+    try
+    {
+      return boost::lexical_cast<T>(field);
+    } catch (const boost::bad_lexical_cast &)
+    {
+      throw std::runtime_error(str(boost::format("%s:%d: invalid value \"%s\"") % path % line_number % field));
+    }
+  }
+}
+
 namespace object_recognition_core
 {
   namespace io
@@ -45,15 +101,21 @@ namespace object_recognition_core
     void
     TimeStamp::set()
     {
-      std::time_t local = std::time(NULL);
-      std::tm *Tm = localtime(&local);
-      year = Tm->tm_year;
-      month = Tm->tm_mon;
-      day = Tm->tm_mday;
-      hour = Tm->tm_hour;
-      min = Tm->tm_min;
-      sec = Tm->tm_sec;
-      msec = 0; //FIXME get better resolution
+      boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+      std::tm Tm = boost::posix_time::to_tm(now);
+      year = Tm.tm_year + 1900;
+      month = Tm.tm_mon + 1;
+      day = Tm.tm_mday;
+      hour = Tm.tm_hour;
+      min = Tm.tm_min;
+      sec = Tm.tm_sec;
+      msec = int(now.time_of_day().fractional_seconds() * 1000 / boost::posix_time::time_duration::ticks_per_second());
+    }
+
+    double
+    TimeStamp::seconds() const
+    {
+      return hour * 3600 + min * 60 + sec + msec / 1000.0;
     }
 
     CSVOutput
@@ -62,12 +124,7 @@ namespace object_recognition_core
       boost::shared_ptr<std::ofstream> out(new std::ofstream());
 
       //! Format the name of the output file
-      std::string name = str(
-          boost::format("RUN%.4d_%s_%d%d%d_%.2d.%.2d.%.2d.csv") % rn.runID % rn.name % rn.ts.year % rn.ts.month
-          % rn.ts.day
-          % rn.ts.hour
-          % rn.ts.min
-          % rn.ts.sec);
+      std::string name = logName(rn, "csv");
       out->open(name.c_str());
       //! Print the key at the top of the file for data interpretation
       *out << "ts,Run,Frame,dID,oID,R11,R12,R13,R21,R22,R23,R31,R32,R33,Tx,Ty,Tz" << std::endl;
@@ -103,5 +160,136 @@ namespace object_recognition_core
            << "," << ps.R(2, 0) << "," << ps.R(2, 1) << "," << ps.R(2, 2) << ","; //third row
       *out << ps.Tx << "," << ps.Ty << "," << ps.Tz << std::endl;
     }
+
+    std::vector<PoseInfo>
+    readCSV(const std::string &path)
+    {
+      std::ifstream in(path.c_str());
+      if (!in)
+        throw std::runtime_error("Cannot open the CSV file " + path);
+
+      std::vector<PoseInfo> poses;
+      std::string line;
+      std::vector<std::string> fields;
+      for (size_t line_number = 1; std::getline(in, line); ++line_number)
+      {
+        boost::trim(line);
+        //! Skip the key at the top of the file and the empty lines
+        if (line.empty() || line.compare(0, 3, "ts,") == 0)
+          continue;
+        boost::split(fields, line, boost::is_any_of(","));
+        if (fields.size() != 17)
+          throw std::runtime_error(
+              str(boost::format("%s:%d: expected 17 fields, got %d") % path % line_number % fields.size()));
+        BOOST_FOREACH(std::string & field, fields)
+          boost::trim(field);
+
+        PoseInfo ps = PoseInfo();
+        if (std::sscanf(fields[0].c_str(), "%d.%d.%d.%d", &ps.ts.hour, &ps.ts.min, &ps.ts.sec, &ps.ts.msec) != 4)
+          throw std::runtime_error(
+              str(boost::format("%s:%d: invalid timestamp \"%s\"") % path % line_number % fields[0]));
+        ps.run = parseField<int>(fields[1], path, line_number);
+        ps.frame = parseField<int>(fields[2], path, line_number);
+        ps.dID = parseField<int>(fields[3], path, line_number);
+        ps.oID = fields[4];
+        //! The rotation is written row after row
+        for (int i = 0; i < 9; ++i)
+          ps.R(i / 3, i % 3) = parseField<double>(fields[5 + i], path, line_number);
+        ps.Tx = parseField<double>(fields[14], path, line_number);
+        ps.Ty = parseField<double>(fields[15], path, line_number);
+        ps.Tz = parseField<double>(fields[16], path, line_number);
+        poses.push_back(ps);
+      }
+      return poses;
+    }
+
+    BinaryOutput
+    openBinary(const RunInfo &rn)
+    {
+      BinaryOutput out(new std::ofstream());
+      std::string name = logName(rn, "bin");
+      out->open(name.c_str(), std::ios::binary);
+      out->write(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+      return out;
+    }
+
+    void
+    writeBinary(BinaryOutput out, const PoseInfo &ps)
+    {
+      //! The values are written in the native layout: the log is meant to be read back on the same machine
+      writeValue<boost::int32_t>(*out, ps.ts.hour);
+      writeValue<boost::int32_t>(*out, ps.ts.min);
+      writeValue<boost::int32_t>(*out, ps.ts.sec);
+      writeValue<boost::int32_t>(*out, ps.ts.msec);
+      writeValue<boost::int32_t>(*out, ps.run);
+      writeValue<boost::int32_t>(*out, ps.frame);
+      writeValue<boost::int32_t>(*out, ps.dID);
+      writeValue<boost::uint32_t>(*out, ps.oID.size());
+      out->write(ps.oID.data(), ps.oID.size());
+      for (int i = 0; i < 9; ++i)
+        writeValue(*out, ps.Rot[i]);
+      writeValue(*out, ps.Tx);
+      writeValue(*out, ps.Ty);
+      writeValue(*out, ps.Tz);
+    }
+
+    std::vector<PoseInfo>
+    readBinary(const std::string &path)
+    {
+      std::ifstream in(path.c_str(), std::ios::binary);
+      if (!in)
+        throw std::runtime_error("Cannot open the binary log " + path);
+      std::string magic(BINARY_MAGIC_SIZE, '\0');
+      in.read(&magic[0], magic.size());
+      if (magic != BINARY_MAGIC)
+        throw std::runtime_error(path + " is not a binary log of poses");
+
+      std::vector<PoseInfo> poses;
+      boost::int32_t values[7];
+      while (readValue(in, values[0]))
+      {
+        bool is_complete = true;
+        for (int i = 1; i < 7; ++i)
+          is_complete = is_complete && readValue(in, values[i]);
+        boost::uint32_t oID_size = 0;
+        is_complete = is_complete && readValue(in, oID_size);
+
+        PoseInfo ps = PoseInfo();
+        ps.ts.hour = values[0];
+        ps.ts.min = values[1];
+        ps.ts.sec = values[2];
+        ps.ts.msec = values[3];
+        ps.run = values[4];
+        ps.frame = values[5];
+        ps.dID = values[6];
+        if (is_complete)
+        {
+          ps.oID.resize(oID_size);
+          in.read(&ps.oID[0], oID_size);
+          is_complete = in.gcount() == std::streamsize(oID_size);
+        }
+        for (int i = 0; i < 9; ++i)
+          is_complete = is_complete && readValue(in, ps.Rot[i]);
+        is_complete = is_complete && readValue(in, ps.Tx) && readValue(in, ps.Ty) && readValue(in, ps.Tz);
+        if (!is_complete)
+          throw std::runtime_error(str(boost::format("%s: truncated record %d") % path % poses.size()));
+        poses.push_back(ps);
+      }
+      return poses;
+    }
+
+    std::vector<PoseInfo>
+    readPoses(const std::string &path)
+    {
+      std::ifstream in(path.c_str(), std::ios::binary);
+      if (!in)
+        throw std::runtime_error("Cannot open " + path);
+      std::string magic(BINARY_MAGIC_SIZE, '\0');
+      in.read(&magic[0], magic.size());
+      in.close();
+      if (magic == BINARY_MAGIC)
+        return readBinary(path);
+      return readCSV(path);
+    }
   }
 }
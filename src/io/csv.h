@@ -35,6 +35,8 @@
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 
 namespace object_recognition_core
@@ -45,6 +47,7 @@ namespace object_recognition_core
     //!
     struct TimeStamp
     {
+      //! @brief the date, e.g. 2012, 1 to 12 and 1 to 31. The CSV and binary logs do not store it: it is 0 when read
       int year;
       int month;
       int day;
@@ -57,6 +60,10 @@ namespace object_recognition_core
       //! @brief captures the current time.
       void
       set();
+
+      //! @brief the time of the day in seconds, with the milliseconds
+      double
+      seconds() const;
     };
 
     //! @brief Information regarding the current execution of the detection program
@@ -143,5 +150,45 @@ namespace object_recognition_core
     void
     writeCSV(CSVOutput out, const PoseInfo &ps);
 
+    //! @brief Read the poses of a CSV file in the format written by writeCSV, e.g. detections or ground truth
+    //!
+    //! @param path   The path of the CSV file
+    //! @return the poses, in the order of the file
+    //!
+    std::vector<PoseInfo>
+    readCSV(const std::string &path);
+
+    typedef boost::shared_ptr<std::ofstream> BinaryOutput;
+
+    //! @brief Get a handle to a binary log: the same content as the CSV file, but faster to write and read back
+    //!
+    //! @param rn   Information about the current run (run #, team name, etc.)
+    //!
+    BinaryOutput
+    openBinary(const RunInfo &rn);
+
+    //! @brief Append the detected object information to a binary log
+    //!
+    //! @param out  The handle returned by openBinary
+    //! @param ps   Information of a detected object, including the frame #
+    //!
+    void
+    writeBinary(BinaryOutput out, const PoseInfo &ps);
+
+    //! @brief Read the poses of a binary log written by writeBinary
+    //!
+    //! @param path   The path of the binary log
+    //! @return the poses, in the order of the file
+    //!
+    std::vector<PoseInfo>
+    readBinary(const std::string &path);
+
+    //! @brief Read the poses of a binary log or of a CSV file, depending on the header of the file
+    //!
+    //! @param path   The path of the file
+    //!
+    std::vector<PoseInfo>
+    readPoses(const std::string &path);
+
   }
 }
@@ -0,0 +1,110 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/** Compare the detections of a run to the ground truth, e.g.:
+ *   evaluate_detections --ground_truth truth.csv --detections RUN0001_team_1129_10.00.00.bin
+ * Both files are written by GuessCsvWriter (or by hand for the ground truth), as CSV files or binary logs.
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "evaluation.h"
+
+namespace po = boost::program_options;
+
+using object_recognition_core::io::DetectionEvaluator;
+using object_recognition_core::io::EvaluationParameters;
+using object_recognition_core::io::EvaluationResult;
+using object_recognition_core::io::readPoses;
+
+int
+main(int argc, char** argv)
+{
+  EvaluationParameters parameters;
+  std::string ground_truth_path, detections_path, frames_path;
+  double max_rotation_degrees;
+
+  po::options_description desc("Match detections to the ground truth and report the accuracy and latency");
+  desc.add_options()
+    ("help,h", "Print this help message")
+    ("ground_truth", po::value<std::string>(&ground_truth_path)->required(),
+     "The ground truth poses: the timestamps are the capture times of the frames")
+    ("detections", po::value<std::string>(&detections_path)->required(), "The detected poses")
+    ("max_translation", po::value<double>(&parameters.max_translation_error_)->default_value(0.05),
+     "The maximum translation error of a true positive, in meters")
+    ("max_rotation", po::value<double>(&max_rotation_degrees)->default_value(20),
+     "The maximum rotation error of a true positive, in degrees")
+    ("threads", po::value<int>(&parameters.n_threads_)->default_value(boost::thread::hardware_concurrency()),
+     "The number of threads evaluating the frames")
+    ("frames", po::value<std::string>(&frames_path), "If given, write the evaluation of each frame to that CSV file");
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help"))
+    {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch (const po::error & error)
+  {
+    std::cerr << error.what() << std::endl << desc << std::endl;
+    return 1;
+  }
+  parameters.max_rotation_error_ = max_rotation_degrees * M_PI / 180;
+
+  try
+  {
+    DetectionEvaluator evaluator(parameters);
+    EvaluationResult result = evaluator.Evaluate(readPoses(ground_truth_path), readPoses(detections_path));
+    std::cout << result;
+    if (!frames_path.empty())
+    {
+      std::ofstream frames(frames_path.c_str());
+      writeFrameEvaluations(result, frames);
+    }
+  } catch (const std::exception & error)
+  {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
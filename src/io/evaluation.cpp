@@ -0,0 +1,465 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "evaluation.h"
+
+namespace
+{
+  using object_recognition_core::io::PoseInfo;
+  using object_recognition_core::io::TimeStamp;
+
+  /** A uniform grid over the translations of poses, to only compare a detection to the nearby ground truth */
+  class PoseGrid
+  {
+  public:
+    PoseGrid(const std::vector<const PoseInfo*> & poses, double cell_size)
+        :
+          cell_size_(cell_size)
+    {
+      for (size_t i = 0; i < poses.size(); ++i)
+      {
+        boost::int64_t x, y, z;
+        Coordinates(*poses[i], x, y, z);
+        cells_[Key(x, y, z)].push_back(i);
+      }
+    }
+
+    /** Append the indices of the poses in the cell of a given pose and in the neighboring cells: they include all
+     * the poses within cell_size of it */
+    void
+    Neighbors(const PoseInfo & pose, std::vector<size_t> & indices) const
+    {
+      boost::int64_t x, y, z;
+      Coordinates(pose, x, y, z);
+      for (boost::int64_t dx = -1; dx <= 1; ++dx)
+        for (boost::int64_t dy = -1; dy <= 1; ++dy)
+          for (boost::int64_t dz = -1; dz <= 1; ++dz)
+          {
+            Cells::const_iterator cell = cells_.find(Key(x + dx, y + dy, z + dz));
+            if (cell != cells_.end())
+              indices.insert(indices.end(), cell->second.begin(), cell->second.end());
+          }
+    }
+
+  private:
+    typedef boost::unordered_map<boost::uint64_t, std::vector<size_t> > Cells;
+
+    void
+    Coordinates(const PoseInfo & pose, boost::int64_t & x, boost::int64_t & y, boost::int64_t & z) const
+    {
+      x = static_cast<boost::int64_t>(std::floor(pose.Tx / cell_size_));
+      y = static_cast<boost::int64_t>(std::floor(pose.Ty / cell_size_));
+      z = static_cast<boost::int64_t>(std::floor(pose.Tz / cell_size_));
+    }
+
+    /** Pack 21 bits per coordinate: far away cells can share a key, which only costs a few extra comparisons */
+    static boost::uint64_t
+    Key(boost::int64_t x, boost::int64_t y, boost::int64_t z)
+    {
+      const boost::uint64_t mask = (1 << 21) - 1;
+      return ((boost::uint64_t(x) & mask) << 42) | ((boost::uint64_t(y) & mask) << 21) | (boost::uint64_t(z) & mask);
+    }
+
+    double cell_size_;
+    Cells cells_;
+  };
+
+  /** A possible match between a ground truth pose and a detection */
+  struct Candidate
+  {
+    bool
+    operator<(const Candidate & candidate) const
+    {
+      if (translation_error_ != candidate.translation_error_)
+        return translation_error_ < candidate.translation_error_;
+      return rotation_error_ < candidate.rotation_error_;
+    }
+
+    double translation_error_;
+    double rotation_error_;
+    size_t ground_truth_;
+    size_t detection_;
+  };
+
+  const double SECONDS_PER_DAY = 24 * 3600;
+
+  /** @return the date and time of a timestamp, not_a_date_time if it has no (valid) date */
+  boost::posix_time::ptime
+  DateTime(const TimeStamp & ts)
+  {
+    try
+    {
+      return boost::posix_time::ptime(
+          boost::gregorian::date(ts.year, ts.month, ts.day),
+          boost::posix_time::hours(ts.hour) + boost::posix_time::minutes(ts.min) + boost::posix_time::seconds(ts.sec)
+          + boost::posix_time::milliseconds(ts.msec));
+    } catch (const std::out_of_range & e)
+    {
+      return boost::posix_time::ptime();
+    }
+  }
+
+  /** @return the time from a capture to a detection, in seconds. If one of them has no date (the CSV and binary logs
+   * only have the time of the day), they are taken on the same day, or on consecutive days if that would put the
+   * detection more than 12 hours before the capture
+   */
+  double
+  Latency(const TimeStamp & capture, const TimeStamp & detection)
+  {
+    boost::posix_time::ptime capture_time = DateTime(capture), detection_time = DateTime(detection);
+    if (!capture_time.is_not_a_date_time() && !detection_time.is_not_a_date_time())
+      return (detection_time - capture_time).total_microseconds() / 1e6;
+
+    double latency = detection.seconds() - capture.seconds();
+    if (latency < -SECONDS_PER_DAY / 2)
+      latency += SECONDS_PER_DAY;
+    return latency;
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace io
+  {
+    EvaluationParameters::EvaluationParameters()
+        :
+          max_translation_error_(0.05),
+          max_rotation_error_(20 * M_PI / 180),
+          n_threads_(1)
+    {
+    }
+
+    DetectionCounts::DetectionCounts()
+        :
+          true_positives_(0),
+          false_positives_(0),
+          false_negatives_(0)
+    {
+    }
+
+    DetectionCounts &
+    DetectionCounts::operator+=(const DetectionCounts & counts)
+    {
+      true_positives_ += counts.true_positives_;
+      false_positives_ += counts.false_positives_;
+      false_negatives_ += counts.false_negatives_;
+      return *this;
+    }
+
+    double
+    DetectionCounts::precision() const
+    {
+      size_t n_detections = true_positives_ + false_positives_;
+      return n_detections ? double(true_positives_) / n_detections : 1;
+    }
+
+    double
+    DetectionCounts::recall() const
+    {
+      size_t n_ground_truth = true_positives_ + false_negatives_;
+      return n_ground_truth ? double(true_positives_) / n_ground_truth : 1;
+    }
+
+    Distribution::Distribution()
+        :
+          count_(0),
+          mean_(0),
+          min_(0),
+          p50_(0),
+          p90_(0),
+          p99_(0),
+          max_(0)
+    {
+    }
+
+    Distribution
+    Distribution::Compute(std::vector<double> & values)
+    {
+      Distribution distribution;
+      if (values.empty())
+        return distribution;
+
+      std::sort(values.begin(), values.end());
+      distribution.count_ = values.size();
+      double sum = 0;
+      for (size_t i = 0; i < values.size(); ++i)
+        sum += values[i];
+      distribution.mean_ = sum / values.size();
+      distribution.min_ = values.front();
+      distribution.p50_ = values[size_t(0.50 * (values.size() - 1) + 0.5)];
+      distribution.p90_ = values[size_t(0.90 * (values.size() - 1) + 0.5)];
+      distribution.p99_ = values[size_t(0.99 * (values.size() - 1) + 0.5)];
+      distribution.max_ = values.back();
+      return distribution;
+    }
+
+    FrameEvaluation::FrameEvaluation()
+        :
+          run_(0),
+          frame_(0),
+          has_latency_(false),
+          latency_(0)
+    {
+    }
+
+    DetectionEvaluator::DetectionEvaluator(const EvaluationParameters & parameters)
+        :
+          parameters_(parameters)
+    {
+      if (parameters_.max_translation_error_ <= 0)
+        throw std::runtime_error("The maximum translation error must be positive.");
+    }
+
+    EvaluationResult
+    DetectionEvaluator::Evaluate(const std::vector<PoseInfo> & ground_truth,
+                                 const std::vector<PoseInfo> & detections) const
+    {
+      // Group the poses by frame
+      typedef std::map<std::pair<int, int>, size_t> FrameIndices;
+      FrameIndices frame_indices;
+      std::vector<std::vector<const PoseInfo*> > frame_ground_truth, frame_detections;
+      for (int is_detection = 0; is_detection < 2; ++is_detection)
+      {
+        const std::vector<PoseInfo> & poses = is_detection ? detections : ground_truth;
+        for (size_t i = 0; i < poses.size(); ++i)
+        {
+          std::pair<FrameIndices::iterator, bool> inserted = frame_indices.insert(
+              std::make_pair(std::make_pair(poses[i].run, poses[i].frame), frame_ground_truth.size()));
+          if (inserted.second)
+          {
+            frame_ground_truth.resize(frame_ground_truth.size() + 1);
+            frame_detections.resize(frame_detections.size() + 1);
+          }
+          (is_detection ? frame_detections : frame_ground_truth)[inserted.first->second].push_back(&poses[i]);
+        }
+      }
+
+      // Evaluate the frames in parallel
+      std::vector<FrameEvaluation> evaluations(frame_indices.size());
+      size_t n_threads = std::max(1, std::min(parameters_.n_threads_, int(evaluations.size())));
+      if (n_threads == 1)
+        EvaluateFrames(frame_ground_truth, frame_detections, evaluations, 0, 1);
+      else
+      {
+        boost::thread_group threads;
+        for (size_t i = 0; i < n_threads; ++i)
+          threads.create_thread(
+              boost::bind(&DetectionEvaluator::EvaluateFrames, this, boost::cref(frame_ground_truth),
+                          boost::cref(frame_detections), boost::ref(evaluations), i, n_threads));
+        threads.join_all();
+      }
+
+      // Put them back in order and aggregate them
+      EvaluationResult result;
+      std::vector<double> translation_errors, rotation_errors, latencies;
+      for (FrameIndices::const_iterator frame = frame_indices.begin(); frame != frame_indices.end(); ++frame)
+      {
+        FrameEvaluation & evaluation = evaluations[frame->second];
+        evaluation.run_ = frame->first.first;
+        evaluation.frame_ = frame->first.second;
+        for (DetectionCountsByObject::const_iterator counts = evaluation.counts_.begin();
+            counts != evaluation.counts_.end(); ++counts)
+        {
+          result.counts_ += counts->second;
+          result.object_counts_[counts->first] += counts->second;
+        }
+        translation_errors.insert(translation_errors.end(), evaluation.translation_errors_.begin(),
+                                  evaluation.translation_errors_.end());
+        rotation_errors.insert(rotation_errors.end(), evaluation.rotation_errors_.begin(),
+                               evaluation.rotation_errors_.end());
+        if (evaluation.has_latency_)
+          latencies.push_back(evaluation.latency_);
+        result.frames_.push_back(evaluation);
+      }
+      result.translation_error_ = Distribution::Compute(translation_errors);
+      result.rotation_error_ = Distribution::Compute(rotation_errors);
+      result.latency_ = Distribution::Compute(latencies);
+
+      return result;
+    }
+
+    void
+    DetectionEvaluator::EvaluateFrames(const std::vector<std::vector<const PoseInfo*> > & ground_truth,
+                                       const std::vector<std::vector<const PoseInfo*> > & detections,
+                                       std::vector<FrameEvaluation> & evaluations, size_t first, size_t step) const
+    {
+      for (size_t i = first; i < evaluations.size(); i += step)
+        EvaluateFrame(ground_truth[i], detections[i], evaluations[i]);
+    }
+
+    void
+    DetectionEvaluator::EvaluateFrame(const std::vector<const PoseInfo*> & ground_truth,
+                                      const std::vector<const PoseInfo*> & detections,
+                                      FrameEvaluation & evaluation) const
+    {
+      // Find the pairs that could match
+      PoseGrid grid(ground_truth, parameters_.max_translation_error_);
+      std::vector<Candidate> candidates;
+      std::vector<size_t> neighbors;
+      for (size_t detection = 0; detection < detections.size(); ++detection)
+      {
+        neighbors.clear();
+        grid.Neighbors(*detections[detection], neighbors);
+        for (size_t i = 0; i < neighbors.size(); ++i)
+        {
+          const PoseInfo & truth = *ground_truth[neighbors[i]];
+          if (truth.oID != detections[detection]->oID)
+            continue;
+          Candidate candidate;
+          candidate.translation_error_ = translationError(truth, *detections[detection]);
+          if (candidate.translation_error_ > parameters_.max_translation_error_)
+            continue;
+          candidate.rotation_error_ = rotationError(truth, *detections[detection]);
+          if (candidate.rotation_error_ > parameters_.max_rotation_error_)
+            continue;
+          candidate.ground_truth_ = neighbors[i];
+          candidate.detection_ = detection;
+          candidates.push_back(candidate);
+        }
+      }
+
+      // Match the closest pairs first
+      std::sort(candidates.begin(), candidates.end());
+      std::vector<bool> is_ground_truth_matched(ground_truth.size(), false), is_detection_matched(detections.size(),
+                                                                                                  false);
+      for (size_t i = 0; i < candidates.size(); ++i)
+      {
+        const Candidate & candidate = candidates[i];
+        if (is_ground_truth_matched[candidate.ground_truth_] || is_detection_matched[candidate.detection_])
+          continue;
+        is_ground_truth_matched[candidate.ground_truth_] = true;
+        is_detection_matched[candidate.detection_] = true;
+        ++evaluation.counts_[detections[candidate.detection_]->oID].true_positives_;
+        evaluation.translation_errors_.push_back(candidate.translation_error_);
+        evaluation.rotation_errors_.push_back(candidate.rotation_error_);
+      }
+      for (size_t detection = 0; detection < detections.size(); ++detection)
+        if (!is_detection_matched[detection])
+          ++evaluation.counts_[detections[detection]->oID].false_positives_;
+      for (size_t truth = 0; truth < ground_truth.size(); ++truth)
+        if (!is_ground_truth_matched[truth])
+          ++evaluation.counts_[ground_truth[truth]->oID].false_negatives_;
+
+      // The latency goes from the capture of the frame to its last detection
+      evaluation.has_latency_ = !ground_truth.empty() && !detections.empty();
+      if (evaluation.has_latency_)
+      {
+        evaluation.latency_ = Latency(ground_truth[0]->ts, detections[0]->ts);
+        for (size_t truth = 0; truth < ground_truth.size(); ++truth)
+          for (size_t detection = 0; detection < detections.size(); ++detection)
+            evaluation.latency_ = std::max(evaluation.latency_,
+                                           Latency(ground_truth[truth]->ts, detections[detection]->ts));
+      }
+    }
+
+    double
+    translationError(const PoseInfo & a, const PoseInfo & b)
+    {
+      double dx = a.Tx - b.Tx, dy = a.Ty - b.Ty, dz = a.Tz - b.Tz;
+      return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    double
+    rotationError(const PoseInfo & a, const PoseInfo & b)
+    {
+      // the trace of a^T b is 1 + 2 cos(angle)
+      double trace = 0;
+      for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+          trace += a.R(i, j) * b.R(i, j);
+      return std::acos(std::max(-1.0, std::min(1.0, (trace - 1) / 2)));
+    }
+
+    std::ostream &
+    operator<<(std::ostream & out, const EvaluationResult & result)
+    {
+      const DetectionCounts & counts = result.counts_;
+      out << boost::format("frames: %d, detections: %d, ground truth: %d\n") % result.frames_.size()
+             % (counts.true_positives_ + counts.false_positives_) % (counts.true_positives_ + counts.false_negatives_);
+      out << boost::format("precision: %.4f, recall: %.4f (%d true positives, %d false positives, "
+                           "%d false negatives)\n") % counts.precision() % counts.recall() % counts.true_positives_
+             % counts.false_positives_ % counts.false_negatives_;
+
+      const char* names[] = { "translation error (m)", "rotation error (deg)", "latency (ms)" };
+      const Distribution* distributions[] = { &result.translation_error_, &result.rotation_error_, &result.latency_ };
+      const double scales[] = { 1, 180 / M_PI, 1000 };
+      for (int i = 0; i < 3; ++i)
+      {
+        const Distribution & distribution = *distributions[i];
+        double scale = scales[i];
+        out << boost::format("%s: n %d, mean %.4g, min %.4g, p50 %.4g, p90 %.4g, p99 %.4g, max %.4g\n") % names[i]
+               % distribution.count_ % (distribution.mean_ * scale) % (distribution.min_ * scale)
+               % (distribution.p50_ * scale) % (distribution.p90_ * scale) % (distribution.p99_ * scale)
+               % (distribution.max_ * scale);
+      }
+
+      for (DetectionCountsByObject::const_iterator object = result.object_counts_.begin();
+          object != result.object_counts_.end(); ++object)
+        out << boost::format("  %s: precision %.4f, recall %.4f (%d/%d/%d)\n") % object->first
+               % object->second.precision() % object->second.recall() % object->second.true_positives_
+               % object->second.false_positives_ % object->second.false_negatives_;
+      return out;
+    }
+
+    void
+    writeFrameEvaluations(const EvaluationResult & result, std::ostream & out)
+    {
+      out << "Run,Frame,TP,FP,FN,Latency" << std::endl;
+      for (size_t i = 0; i < result.frames_.size(); ++i)
+      {
+        const FrameEvaluation & frame = result.frames_[i];
+        DetectionCounts counts;
+        for (DetectionCountsByObject::const_iterator object = frame.counts_.begin(); object != frame.counts_.end();
+            ++object)
+          counts += object->second;
+        out << frame.run_ << "," << frame.frame_ << "," << counts.true_positives_ << "," << counts.false_positives_
+            << "," << counts.false_negatives_ << ",";
+        if (frame.has_latency_)
+          out << frame.latency_;
+        out << std::endl;
+      }
+    }
+  }
+}
@@ -0,0 +1,187 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_IO_EVALUATION_H_
+#define ORK_CORE_IO_EVALUATION_H_
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "csv.h"
+
+namespace object_recognition_core
+{
+  namespace io
+  {
+    /** The thresholds under which a detection matches a ground truth pose of the same object */
+    struct EvaluationParameters
+    {
+      EvaluationParameters();
+
+      /** The maximum distance between the detected and the true translations, in meters */
+      double max_translation_error_;
+      /** The maximum angle of the rotation between the detected and the true rotations, in radians */
+      double max_rotation_error_;
+      /** The number of threads evaluating the frames */
+      int n_threads_;
+    };
+
+    /** The true positives, false positives and false negatives of a set of detections */
+    struct DetectionCounts
+    {
+      DetectionCounts();
+
+      DetectionCounts &
+      operator+=(const DetectionCounts & counts);
+
+      /** @return the ratio of the detections that match a ground truth pose, 1 if there is no detection */
+      double
+      precision() const;
+
+      /** @return the ratio of the ground truth poses that were detected, 1 if there is no ground truth */
+      double
+      recall() const;
+
+      size_t true_positives_;
+      size_t false_positives_;
+      size_t false_negatives_;
+    };
+
+    typedef std::map<std::string, DetectionCounts> DetectionCountsByObject;
+
+    /** A summary of a set of values: count, mean and percentiles */
+    struct Distribution
+    {
+      Distribution();
+
+      /** Summarize some values: they are reordered in the process */
+      static Distribution
+      Compute(std::vector<double> & values);
+
+      size_t count_;
+      double mean_;
+      double min_;
+      double p50_;
+      double p90_;
+      double p99_;
+      double max_;
+    };
+
+    /** The evaluation of the detections of one frame */
+    struct FrameEvaluation
+    {
+      FrameEvaluation();
+
+      int run_;
+      int frame_;
+      DetectionCountsByObject counts_;
+      /** The translation errors of the true positives, in meters */
+      std::vector<double> translation_errors_;
+      /** The rotation errors of the true positives, in radians */
+      std::vector<double> rotation_errors_;
+      /** If false, the frame has no detection or no ground truth and latency_ is meaningless */
+      bool has_latency_;
+      /** The time between the ground truth and the last detection of the frame, in seconds */
+      double latency_;
+    };
+
+    /** The evaluation of a whole run */
+    struct EvaluationResult
+    {
+      DetectionCounts counts_;
+      DetectionCountsByObject object_counts_;
+      Distribution translation_error_;
+      Distribution rotation_error_;
+      Distribution latency_;
+      /** One evaluation per frame, ordered by run and frame number */
+      std::vector<FrameEvaluation> frames_;
+    };
+
+    /** Match detections to ground truth poses, frame by frame, and compute the accuracy and latency of a run.
+     * Both are PoseInfo as written by GuessCsvWriter: the frames are identified by their run and frame numbers and
+     * the timestamp of a ground truth pose is the time at which its frame was captured.
+     * Within a frame, a detection can match a ground truth pose of the same object if their translations and
+     * rotations are within the thresholds: the closest pairs are matched first and each pose is matched at most once.
+     * The frames are evaluated in parallel.
+     */
+    class DetectionEvaluator
+    {
+    public:
+      explicit
+      DetectionEvaluator(const EvaluationParameters & parameters = EvaluationParameters());
+
+      EvaluationResult
+      Evaluate(const std::vector<PoseInfo> & ground_truth, const std::vector<PoseInfo> & detections) const;
+
+      /** Evaluate one frame
+       * @param ground_truth the ground truth poses of the frame
+       * @param detections the detections of the frame
+       * @param evaluation the evaluation of the frame: its run and frame numbers are not modified
+       */
+      void
+      EvaluateFrame(const std::vector<const PoseInfo*> & ground_truth, const std::vector<const PoseInfo*> & detections,
+                    FrameEvaluation & evaluation) const;
+
+    private:
+      /** Evaluate the frames first, first + step, first + 2 * step ... so that several threads can share the work */
+      void
+      EvaluateFrames(const std::vector<std::vector<const PoseInfo*> > & ground_truth,
+                     const std::vector<std::vector<const PoseInfo*> > & detections,
+                     std::vector<FrameEvaluation> & evaluations, size_t first, size_t step) const;
+
+      EvaluationParameters parameters_;
+    };
+
+    /** @return the translation distance between two poses, in meters */
+    double
+    translationError(const PoseInfo & a, const PoseInfo & b);
+
+    /** @return the angle of the rotation between two poses, in radians */
+    double
+    rotationError(const PoseInfo & a, const PoseInfo & b);
+
+    /** Print a human readable report of an evaluation */
+    std::ostream &
+    operator<<(std::ostream & out, const EvaluationResult & result);
+
+    /** Write one CSV line per frame: run, frame, true/false positives, false negatives and latency */
+    void
+    writeFrameEvaluations(const EvaluationResult & result, std::ostream & out);
+  }
+}
+
+#endif /* ORK_CORE_IO_EVALUATION_H_ */
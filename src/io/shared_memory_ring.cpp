@@ -0,0 +1,391 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+#include "shared_memory_ring.h"
+
+namespace ipc = boost::interprocess;
+
+namespace
+{
+  /** Written last by the creator of a ring, once everything is initialized */
+  const boost::uint32_t RING_MAGIC = 0x4f524b31;
+  /** The maximum number of matrices in a frame */
+  const size_t N_MATS_MAX = 8;
+  /** The alignment of the slots and of the matrices in a slot */
+  const size_t ALIGNMENT = 64;
+  /** The maximum number of readers holding a same slot */
+  const size_t N_READERS_MAX = 16;
+
+  size_t
+  Align(size_t size)
+  {
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  struct MatHeader
+  {
+    boost::int32_t rows_;
+    boost::int32_t cols_;
+    boost::int32_t type_;
+    /** The offset of the data from the beginning of the data of the slot */
+    boost::uint64_t offset_;
+  };
+
+  /** @return true if a process is still running */
+  bool
+  IsAlive(boost::int32_t pid)
+  {
+    return (kill(pid, 0) == 0) || (errno == EPERM);
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace io
+  {
+    struct SharedMemoryRingHeader
+    {
+      boost::uint32_t magic_;
+      boost::uint32_t n_slots_;
+      boost::uint64_t slot_size_;
+      /** The number of bytes between two slots (header included) */
+      boost::uint64_t slot_stride_;
+      /** Protects sequence_, latest_slot_, n_dropped_ and the writer/readers of the slots */
+      ipc::interprocess_mutex mutex_;
+      /** Notified when a new frame is published */
+      ipc::interprocess_condition condition_;
+      /** The sequence number of the latest frame, 0 if there is none */
+      boost::uint64_t sequence_;
+      boost::uint32_t latest_slot_;
+      /** The number of frames dropped because all the slots were held */
+      boost::uint64_t n_dropped_;
+    };
+
+    /** The state of a slot is only read/modified with the mutex of the ring locked. A process-shared lock would stay
+     * locked forever if a reader died while holding it, hence the readers are recorded by process id: the writer
+     * reclaims the slots held by dead processes
+     */
+    struct SharedMemorySlotHeader
+    {
+      /** @return true if no running reader holds the slot, forgetting the readers that died */
+      bool
+      IsFree()
+      {
+        bool is_free = true;
+        for (size_t i = 0; i < N_READERS_MAX; ++i)
+        {
+          if (!reader_pids_[i])
+            continue;
+          if (IsAlive(reader_pids_[i]))
+            is_free = false;
+          else
+            reader_pids_[i] = 0;
+        }
+        return is_free;
+      }
+
+      /** Record a reader holding the slot
+       * @return false if the slot is being written or too many readers hold it
+       */
+      bool
+      Hold(boost::int32_t pid)
+      {
+        if (is_written_)
+          return false;
+        for (size_t i = 0; i < N_READERS_MAX; ++i)
+          if (!reader_pids_[i])
+          {
+            reader_pids_[i] = pid;
+            return true;
+          }
+        return false;
+      }
+
+      /** Forget one hold of a reader */
+      void
+      Unhold(boost::int32_t pid)
+      {
+        for (size_t i = 0; i < N_READERS_MAX; ++i)
+          if (reader_pids_[i] == pid)
+          {
+            reader_pids_[i] = 0;
+            return;
+          }
+      }
+
+      /** True while the writer fills the slot */
+      boost::uint32_t is_written_;
+      /** The process ids of the readers holding the slot, 0 for none */
+      boost::int32_t reader_pids_[N_READERS_MAX];
+      boost::uint64_t sequence_;
+      boost::uint32_t n_mats_;
+      MatHeader mats_[N_MATS_MAX];
+
+      unsigned char *
+      data()
+      {
+        return reinterpret_cast<unsigned char*>(this) + Align(sizeof(SharedMemorySlotHeader));
+      }
+    };
+
+    SharedMemoryRing::SharedMemoryRing(const std::string & name, bool is_owner)
+        :
+          name_(name),
+          is_owner_(is_owner),
+          header_(0),
+          held_slot_(0),
+          pid_(getpid())
+    {
+    }
+
+    SharedMemoryRing::Ptr
+    SharedMemoryRing::Create(const std::string & name, unsigned int n_slots, size_t slot_size)
+    {
+      if (n_slots < 2)
+        throw std::runtime_error("A shared memory ring needs at least 2 slots.");
+
+      ipc::shared_memory_object::remove(name.c_str());
+      Ptr ring(new SharedMemoryRing(name, true));
+      ipc::shared_memory_object shared_memory(ipc::create_only, name.c_str(), ipc::read_write);
+      ring->shared_memory_.swap(shared_memory);
+
+      size_t slot_stride = Align(sizeof(SharedMemorySlotHeader)) + Align(slot_size);
+      ring->shared_memory_.truncate(Align(sizeof(SharedMemoryRingHeader)) + n_slots * slot_stride);
+      ipc::mapped_region region(ring->shared_memory_, ipc::read_write);
+      ring->region_.swap(region);
+
+      // truncate zero-fills the segment so the magic number is only valid once everything is constructed
+      ring->header_ = new (ring->region_.get_address()) SharedMemoryRingHeader();
+      ring->header_->n_slots_ = n_slots;
+      ring->header_->slot_size_ = slot_size;
+      ring->header_->slot_stride_ = slot_stride;
+      ring->header_->sequence_ = 0;
+      ring->header_->latest_slot_ = 0;
+      ring->header_->n_dropped_ = 0;
+      for (unsigned int i = 0; i < n_slots; ++i)
+      {
+        SharedMemorySlotHeader * slot = new (ring->slot(i)) SharedMemorySlotHeader();
+        slot->is_written_ = 0;
+        std::fill(slot->reader_pids_, slot->reader_pids_ + N_READERS_MAX, 0);
+        slot->sequence_ = 0;
+        slot->n_mats_ = 0;
+      }
+      __sync_synchronize();
+      ring->header_->magic_ = RING_MAGIC;
+
+      return ring;
+    }
+
+    SharedMemoryRing::Ptr
+    SharedMemoryRing::Open(const std::string & name)
+    {
+      Ptr ring(new SharedMemoryRing(name, false));
+      try
+      {
+        ipc::shared_memory_object shared_memory(ipc::open_only, name.c_str(), ipc::read_write);
+        ring->shared_memory_.swap(shared_memory);
+        ipc::mapped_region region(ring->shared_memory_, ipc::read_write);
+        ring->region_.swap(region);
+      } catch (ipc::interprocess_exception &)
+      {
+        return Ptr();
+      }
+
+      if (ring->region_.get_size() < sizeof(SharedMemoryRingHeader))
+        return Ptr();
+      ring->header_ = static_cast<SharedMemoryRingHeader*>(ring->region_.get_address());
+      if (ring->header_->magic_ != RING_MAGIC)
+        return Ptr();
+      __sync_synchronize();
+
+      return ring;
+    }
+
+    SharedMemoryRing::~SharedMemoryRing()
+    {
+      Release();
+      if (is_owner_)
+        ipc::shared_memory_object::remove(name_.c_str());
+    }
+
+    SharedMemorySlotHeader *
+    SharedMemoryRing::slot(unsigned int index) const
+    {
+      unsigned char * slots = static_cast<unsigned char*>(region_.get_address())
+                              + Align(sizeof(SharedMemoryRingHeader));
+      return reinterpret_cast<SharedMemorySlotHeader*>(slots + index * header_->slot_stride_);
+    }
+
+    size_t
+    SharedMemoryRing::slot_size() const
+    {
+      return header_->slot_size_;
+    }
+
+    boost::uint64_t
+    SharedMemoryRing::n_dropped() const
+    {
+      ipc::scoped_lock<ipc::interprocess_mutex> lock(header_->mutex_);
+      return header_->n_dropped_;
+    }
+
+    bool
+    SharedMemoryRing::Write(const std::vector<cv::Mat> & mats)
+    {
+      if (mats.size() > N_MATS_MAX)
+        throw std::runtime_error("Too many matrices for a shared memory slot.");
+      size_t size = 0;
+      for (size_t i = 0; i < mats.size(); ++i)
+        size += Align(mats[i].total() * mats[i].elemSize());
+      if (size > header_->slot_size_)
+        throw std::runtime_error("The frame does not fit in a shared memory slot: increase the slot size.");
+
+      // Find a slot that no reader is using, starting from the oldest one
+      unsigned int n_slots = header_->n_slots_;
+      unsigned int index = 0;
+      SharedMemorySlotHeader * free_slot = 0;
+      {
+        ipc::scoped_lock<ipc::interprocess_mutex> lock(header_->mutex_);
+        index = header_->latest_slot_;
+        for (unsigned int i = 1; i <= n_slots; ++i)
+        {
+          index = (index + 1) % n_slots;
+          if (slot(index)->IsFree())
+          {
+            free_slot = slot(index);
+            free_slot->is_written_ = 1;
+            break;
+          }
+        }
+        if (!free_slot)
+        {
+          ++header_->n_dropped_;
+          return false;
+        }
+      }
+
+      size_t offset = 0;
+      for (size_t i = 0; i < mats.size(); ++i)
+      {
+        MatHeader & mat_header = free_slot->mats_[i];
+        mat_header.rows_ = mats[i].rows;
+        mat_header.cols_ = mats[i].cols;
+        mat_header.type_ = mats[i].type();
+        mat_header.offset_ = offset;
+        if (!mats[i].empty())
+        {
+          // copyTo does not reallocate as the destination has the right size and type
+          cv::Mat destination(mats[i].rows, mats[i].cols, mats[i].type(), free_slot->data() + offset);
+          mats[i].copyTo(destination);
+        }
+        offset += Align(mats[i].total() * mats[i].elemSize());
+      }
+      free_slot->n_mats_ = mats.size();
+
+      ipc::scoped_lock<ipc::interprocess_mutex> lock(header_->mutex_);
+      free_slot->sequence_ = header_->sequence_ + 1;
+      free_slot->is_written_ = 0;
+      header_->sequence_ = free_slot->sequence_;
+      header_->latest_slot_ = index;
+      header_->condition_.notify_all();
+
+      return true;
+    }
+
+    bool
+    SharedMemoryRing::Read(boost::uint64_t last_sequence, double timeout, std::vector<cv::Mat> & mats,
+                           boost::uint64_t & sequence)
+    {
+      Release();
+
+      boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time()
+          + boost::posix_time::microseconds(static_cast<boost::int64_t>(timeout * 1e6));
+      {
+        ipc::scoped_lock<ipc::interprocess_mutex> lock(header_->mutex_);
+        while (true)
+        {
+          // The latest slot can only be being written if the writer wrapped around and is filling it again
+          if (header_->sequence_ > last_sequence && slot(header_->latest_slot_)->Hold(pid_))
+          {
+            held_slot_ = slot(header_->latest_slot_);
+            break;
+          }
+          if (timeout <= 0)
+            header_->condition_.wait(lock);
+          else if (!header_->condition_.timed_wait(lock, deadline))
+            return false;
+        }
+      }
+
+      sequence = held_slot_->sequence_;
+      mats.resize(held_slot_->n_mats_);
+      for (size_t i = 0; i < mats.size(); ++i)
+      {
+        const MatHeader & mat_header = held_slot_->mats_[i];
+        if (mat_header.rows_ * mat_header.cols_ == 0)
+          mats[i] = cv::Mat();
+        else
+          mats[i] = cv::Mat(mat_header.rows_, mat_header.cols_, mat_header.type_,
+                            held_slot_->data() + mat_header.offset_);
+      }
+
+      return true;
+    }
+
+    void
+    SharedMemoryRing::Release()
+    {
+      if (!held_slot_)
+        return;
+      ipc::scoped_lock<ipc::interprocess_mutex> lock(header_->mutex_);
+      held_slot_->Unhold(pid_);
+      held_slot_ = 0;
+    }
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_IO_SHARED_MEMORY_RING_H_
+#define ORK_CORE_IO_SHARED_MEMORY_RING_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace object_recognition_core
+{
+  namespace io
+  {
+    struct SharedMemoryRingHeader;
+    struct SharedMemorySlotHeader;
+
+    /** A ring of preallocated slots in POSIX shared memory to move frames (a few cv::Mat) between processes.
+     * There is one writer, that creates the ring, and any number of readers. The writer copies the matrices of a
+     * frame in a free slot and publishes it with a new sequence number. A reader holds the slot of the latest frame
+     * and gets cv::Mat headers that point directly into shared memory: the slot cannot be overwritten until the reader
+     * releases it (which it does when it reads the next frame).
+     * The writer never blocks: it skips the slots held by readers and drops the frame if all of them are held. The
+     * slots held by readers that died are reclaimed.
+     */
+    class SharedMemoryRing: boost::noncopyable
+    {
+    public:
+      typedef boost::shared_ptr<SharedMemoryRing> Ptr;
+
+      /** Create a ring, replacing any previous ring with the same name. That is what a writer does
+       * @param name the name of the shared memory segment
+       * @param n_slots the number of slots in the ring: it has to be bigger than the number of readers
+       * @param slot_size the number of bytes of the data of one slot
+       */
+      static Ptr
+      Create(const std::string & name, unsigned int n_slots, size_t slot_size);
+
+      /** Open an existing ring. That is what a reader does
+       * @param name the name of the shared memory segment
+       * @return the ring, or an empty pointer if it does not exist (or is not initialized) yet
+       */
+      static Ptr
+      Open(const std::string & name);
+
+      /** Release the slot held by a reader and remove the shared memory segment if we created it. Processes that
+       * already mapped it can keep on using it
+       */
+      ~SharedMemoryRing();
+
+      /** Copy some matrices in a free slot and publish them as the latest frame
+       * @param mats the matrices to copy: they can be empty and do not need to be continuous
+       * @return false if all the slots were held by readers and the frame was dropped
+       */
+      bool
+      Write(const std::vector<cv::Mat> & mats);
+
+      /** Wait for a frame more recent than a given one and get the matrices of the latest frame, without any copy.
+       * The slot of the frame is held until the next call to Read or Release
+       * @param last_sequence the sequence number of the last frame that was read (0 for none)
+       * @param timeout the maximum time to wait for a new frame, in seconds. Waits forever if <= 0
+       * @param mats the matrices of the frame, pointing into shared memory
+       * @param sequence the sequence number of the returned frame
+       * @return false if no new frame arrived before the timeout
+       */
+      bool
+      Read(boost::uint64_t last_sequence, double timeout, std::vector<cv::Mat> & mats, boost::uint64_t & sequence);
+
+      /** Release the slot held by the last Read: the matrices it returned should not be used anymore */
+      void
+      Release();
+
+      /** @return the number of bytes of the data of one slot */
+      size_t
+      slot_size() const;
+
+      /** @return the number of frames the writer dropped because all the slots were held by readers */
+      boost::uint64_t
+      n_dropped() const;
+
+    private:
+      SharedMemoryRing(const std::string & name, bool is_owner);
+
+      SharedMemorySlotHeader *
+      slot(unsigned int index) const;
+
+      std::string name_;
+      bool is_owner_;
+      boost::interprocess::shared_memory_object shared_memory_;
+      boost::interprocess::mapped_region region_;
+      SharedMemoryRingHeader * header_;
+      /** The slot held by a reader, if any */
+      SharedMemorySlotHeader * held_slot_;
+      /** The id of the current process, recorded in the slots it holds */
+      boost::int32_t pid_;
+    };
+  }
+}
+
+#endif /* ORK_CORE_IO_SHARED_MEMORY_RING_H_ */
@@ -0,0 +1,106 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <object_recognition_core/common/mat_pool.h>
+
+using object_recognition_core::common::MatPool;
+
+TEST(OR_common_mat_pool, Reuse)
+{
+  MatPool pool;
+  cv::Mat a = pool.Acquire(10, 20, CV_8UC1);
+  ASSERT_EQ(10, a.rows);
+  ASSERT_EQ(20, a.cols);
+  ASSERT_EQ(CV_8UC1, a.type());
+  const uchar * data = a.data;
+
+  // A buffer in use is not handed out again
+  cv::Mat b = pool.Acquire(10, 20, CV_8UC1);
+  EXPECT_NE(data, b.data);
+  EXPECT_EQ(2u, pool.size());
+
+  // Once released, it is
+  a.release();
+  cv::Mat c = pool.Acquire(10, 20, CV_8UC1);
+  EXPECT_EQ(data, c.data);
+  EXPECT_EQ(2u, pool.size());
+
+  // Another size or type is another class
+  EXPECT_NE(data, pool.Acquire(20, 10, CV_8UC1).data);
+  EXPECT_NE(data, pool.Acquire(10, 20, CV_16UC1).data);
+  EXPECT_EQ(4u, pool.size());
+}
+
+TEST(OR_common_mat_pool, RefCount)
+{
+  MatPool pool;
+  cv::Mat a = pool.Acquire(10, 20, CV_32FC3);
+  const uchar * data = a.data;
+
+  // Any copy or region of the buffer keeps it in use
+  cv::Mat copy = a, roi = a(cv::Rect(0, 0, 5, 5));
+  a.release();
+  EXPECT_NE(data, pool.Acquire(10, 20, CV_32FC3).data);
+  copy.release();
+  EXPECT_NE(data, pool.Acquire(10, 20, CV_32FC3).data);
+  roi.release();
+  EXPECT_EQ(data, pool.Acquire(10, 20, CV_32FC3).data);
+}
+
+TEST(OR_common_mat_pool, MaxBuffers)
+{
+  MatPool pool(2);
+  cv::Mat a = pool.Acquire(10, 20, CV_8UC1), b = pool.Acquire(10, 20, CV_8UC1), c = pool.Acquire(10, 20, CV_8UC1);
+  EXPECT_NE(a.data, c.data);
+  EXPECT_NE(b.data, c.data);
+  EXPECT_EQ(2u, pool.size());
+
+  // The buffers that are not pooled are just freed
+  c.release();
+  cv::Mat d = pool.Acquire(10, 20, CV_8UC1);
+  EXPECT_NE(a.data, d.data);
+  EXPECT_NE(b.data, d.data);
+  EXPECT_EQ(2u, pool.size());
+
+  // The buffers in use stay valid after a Clear
+  pool.Clear();
+  EXPECT_EQ(0u, pool.size());
+  a.setTo(cv::Scalar(1));
+  EXPECT_EQ(1, a.at<uchar>(9, 19));
+}
@@ -0,0 +1,147 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <sstream>
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+#include <gtest/gtest.h>
+
+#include <object_recognition_core/common/json_spirit/json_spirit.h>
+#include <object_recognition_core/common/startup.h>
+
+using object_recognition_core::common::StartupPhase;
+using object_recognition_core::common::StartupTimeline;
+
+namespace
+{
+  /** @return the line of the table that shows a phase, empty if there is none */
+  std::string
+  TableLine(const std::string & table, const std::string & name)
+  {
+    std::istringstream stream(table);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+      size_t position = line.find(name + " ");
+      if ((position != std::string::npos) && (line.find_first_not_of(" *") == position))
+        return line;
+    }
+    return "";
+  }
+
+  /** @return the indentation of the name of a phase in the table */
+  size_t
+  TableDepth(const std::string & table, const std::string & name)
+  {
+    return TableLine(table, name).find_first_not_of(" ") / 2;
+  }
+
+  /** @return the event of that name in a Chrome trace */
+  or_json::mObject
+  TraceEvent(const or_json::mArray & events, const std::string & name)
+  {
+    for (or_json::mArray::const_iterator event = events.begin(); event != events.end(); ++event)
+      if (event->get_obj().find("name")->second.get_str() == name)
+        return event->get_obj();
+    ADD_FAILURE() << name << " is not in the trace";
+    return or_json::mObject();
+  }
+}
+
+TEST(OR_common_startup, Nesting)
+{
+  StartupTimeline & timeline = StartupTimeline::Instance();
+  timeline.Begin("nesting_outer");
+  {
+    StartupPhase inner("nesting_inner");
+    timeline.Mark("nesting_event");
+  }
+  // End() only closes the last phase of that name
+  timeline.Begin("nesting_outer");
+  timeline.End("nesting_outer");
+  std::stringstream open_table;
+  timeline.WriteTable(open_table);
+  EXPECT_NE(std::string::npos, TableLine(open_table.str(), "nesting_outer").find("running"));
+  timeline.End("nesting_outer");
+  // ending an unknown phase does nothing
+  timeline.End("nesting_unknown");
+
+  std::stringstream table;
+  timeline.WriteTable(table);
+  EXPECT_EQ(std::string::npos, TableLine(table.str(), "nesting_outer").find("running"));
+  EXPECT_EQ(0u, TableDepth(table.str(), "nesting_outer"));
+  EXPECT_EQ(1u, TableDepth(table.str(), "nesting_inner"));
+  EXPECT_EQ(2u, TableDepth(table.str(), "nesting_event"));
+  EXPECT_NE(std::string::npos, TableLine(table.str(), "nesting_event").find("* nesting_event"));
+  EXPECT_EQ("", TableLine(table.str(), "nesting_unknown"));
+}
+
+TEST(OR_common_startup, Trace)
+{
+  StartupTimeline & timeline = StartupTimeline::Instance();
+  {
+    StartupPhase outer("trace_outer");
+    {
+      StartupPhase inner("trace_inner \"quoted\"");
+      timeline.Mark("trace_event");
+    }
+  }
+
+  std::stringstream trace;
+  timeline.WriteTrace(trace);
+  or_json::mValue value;
+  ASSERT_TRUE(or_json::read(trace.str(), value)) << trace.str();
+  const or_json::mArray & events = value.get_obj().find("traceEvents")->second.get_array();
+
+  or_json::mObject outer = TraceEvent(events, "trace_outer");
+  or_json::mObject inner = TraceEvent(events, "trace_inner \"quoted\"");
+  or_json::mObject event = TraceEvent(events, "trace_event");
+  ASSERT_FALSE(outer.empty() || inner.empty() || event.empty());
+  EXPECT_EQ("X", outer["ph"].get_str());
+  EXPECT_EQ("X", inner["ph"].get_str());
+  EXPECT_EQ("i", event["ph"].get_str());
+  EXPECT_EQ(outer["tid"].get_int(), inner["tid"].get_int());
+  EXPECT_EQ(inner["tid"].get_int(), event["tid"].get_int());
+
+  // The inner phase and the event are within the outer phase
+  boost::int64_t outer_start = outer["ts"].get_int64(), outer_end = outer_start + outer["dur"].get_int64();
+  boost::int64_t inner_start = inner["ts"].get_int64(), inner_end = inner_start + inner["dur"].get_int64();
+  EXPECT_LE(outer_start, inner_start);
+  EXPECT_LE(inner_end, outer_end);
+  EXPECT_LE(inner_start, event["ts"].get_int64());
+  EXPECT_LE(event["ts"].get_int64(), inner_end);
+}
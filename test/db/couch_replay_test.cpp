@@ -0,0 +1,227 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <gtest/gtest.h>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/document.h>
+#include <object_recognition_core/db/view.h>
+
+#include "http_stub.h"
+
+using object_recognition_core::db::Document;
+using object_recognition_core::db::ObjectDbParameters;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::test::HttpExchange;
+using object_recognition_core::test::HttpStub;
+using object_recognition_core::test::HttpTape;
+
+namespace
+{
+  ObjectDbPtr
+  couch_db(const std::string & root)
+  {
+    ObjectDbParameters params(ObjectDbParameters::COUCHDB);
+    params.set_parameter("root", root);
+    params.set_parameter("collection", "test_it");
+    return params.generateDb();
+  }
+
+  /** What CouchDB answers when a document is created and read back */
+  HttpTape
+  persist_load_tape()
+  {
+    HttpTape tape;
+    tape.Add(HttpExchange("GET", "/test_it", "", HttpExchange::JsonResponse("200 OK", "{\"db_name\":\"test_it\"}")));
+    tape.Add(
+        HttpExchange("POST", "/test_it", "",
+                     HttpExchange::JsonResponse("201 Created", "{\"ok\":true,\"id\":\"abc\",\"rev\":\"1-def\"}"),
+                     20000));
+    tape.Add(
+        HttpExchange("GET", "/test_it/abc", "",
+                     HttpExchange::JsonResponse("200 OK", "{\"_id\":\"abc\",\"_rev\":\"1-def\",\"foo\":\"UuU\"}")));
+    return tape;
+  }
+
+  /** Create a document and read it back */
+  void
+  persist_load(const ObjectDbPtr & db)
+  {
+    std::string id;
+    {
+      Document doc;
+      doc.set_db(db);
+      doc.set_field("foo", "UuU");
+      doc.Persist();
+      id = doc.id();
+    }
+    Document doc;
+    doc.set_db(db);
+    doc.set_document_id(id);
+    doc.load_fields();
+    EXPECT_EQ(doc.get_field<std::string>("foo"), std::string("UuU"));
+  }
+}
+
+TEST(OR_db_replay, CouchPersistLoad)
+{
+  HttpStub stub(persist_load_tape());
+  persist_load(couch_db(stub.root()));
+  EXPECT_EQ(stub.n_unmatched(), 0);
+  EXPECT_EQ(stub.tape().n_remaining(), 0);
+}
+
+TEST(OR_db_replay, CouchTimingFidelity)
+{
+  HttpStub stub(persist_load_tape(), true);
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  persist_load(couch_db(stub.root()));
+  boost::posix_time::time_duration duration = boost::posix_time::microsec_clock::universal_time() - start;
+  EXPECT_GE(duration.total_milliseconds(), 20);
+}
+
+TEST(OR_db_replay, CouchUnrecorded)
+{
+  HttpStub stub((HttpTape()));
+  ObjectDbPtr db = couch_db(stub.root());
+  or_json::mObject fields;
+  EXPECT_THROW(db->load_fields("abc", fields), std::runtime_error);
+  EXPECT_EQ(stub.n_unmatched(), 1);
+}
+
+TEST(OR_db_replay, CouchLooping)
+{
+  HttpTape tape = persist_load_tape();
+  tape.set_is_looping(true);
+  tape.Add(
+      HttpExchange("GET", "/test_it/_design/observations/_view/by_object_id?*", "",
+                   HttpExchange::JsonResponse("200 OK", "{\"total_rows\":0,\"offset\":0,\"rows\":[]}")));
+  HttpStub stub(tape);
+  ObjectDbPtr db = couch_db(stub.root());
+  for (int i = 0; i < 3; ++i)
+    persist_load(db);
+  object_recognition_core::db::View view(object_recognition_core::db::View::VIEW_OBSERVATION_WHERE_OBJECT_ID);
+  view.set_key("object_0");
+  int total_rows = -1, offset = -1;
+  std::vector<Document> view_elements;
+  db->QueryView(view, 0, 0, total_rows, offset, view_elements);
+  EXPECT_EQ(total_rows, 0);
+  EXPECT_EQ(stub.n_unmatched(), 0);
+  EXPECT_EQ(stub.tape().n_remaining(), 4);
+}
+
+/** A tiered DB serves views from its cache until something is written through it */
+TEST(OR_db_replay, TieredQueryAfterWrite)
+{
+  const std::string view_page = HttpExchange::JsonResponse("200 OK", "{\"total_rows\":0,\"offset\":0,\"rows\":[]}");
+  HttpTape tape;
+  tape.Add(HttpExchange("GET", "/test_it/_design/observations/_view/by_object_id?*", "", view_page));
+  tape.Add(HttpExchange("GET", "/test_it", "", HttpExchange::JsonResponse("200 OK", "{\"db_name\":\"test_it\"}")));
+  tape.Add(
+      HttpExchange("POST", "/test_it", "",
+                   HttpExchange::JsonResponse("201 Created", "{\"ok\":true,\"id\":\"abc\",\"rev\":\"1-def\"}")));
+  tape.Add(HttpExchange("GET", "/test_it/_design/observations/_view/by_object_id?*", "", view_page));
+  HttpStub stub(tape);
+
+  ObjectDbParameters local(ObjectDbParameters::FILESYSTEM);
+  local.set_parameter("path", "/tmp");
+  local.set_parameter("collection", "test_it_local");
+  ObjectDbParameters remote(ObjectDbParameters::COUCHDB);
+  remote.set_parameter("root", stub.root());
+  remote.set_parameter("collection", "test_it");
+  ObjectDbParameters params(ObjectDbParameters::TIERED);
+  params.set_parameter("local", or_json::mValue(local.raw()));
+  params.set_parameter("remote", or_json::mValue(remote.raw()));
+  ObjectDbPtr db = params.generateDb();
+
+  object_recognition_core::db::View view(object_recognition_core::db::View::VIEW_OBSERVATION_WHERE_OBJECT_ID);
+  view.set_key("object_0");
+  int total_rows, offset;
+  std::vector<Document> view_elements;
+  db->QueryView(view, 0, 0, total_rows, offset, view_elements);
+  db->QueryView(view, 0, 0, total_rows, offset, view_elements);
+  EXPECT_EQ(stub.tape().n_remaining(), 3);
+
+  Document doc;
+  doc.set_db(db);
+  doc.set_field("object_id", "object_0");
+  doc.Persist();
+  db->QueryView(view, 0, 0, total_rows, offset, view_elements);
+  EXPECT_EQ(stub.n_unmatched(), 0);
+  EXPECT_EQ(stub.tape().n_remaining(), 0);
+
+  local.generateDb()->DeleteCollection("test_it_local");
+}
+
+/** A tiered DB only accepts a filesystem local DB */
+TEST(OR_db_replay, TieredLocalType)
+{
+  ObjectDbParameters params(ObjectDbParameters::TIERED);
+  params.set_parameter("local", or_json::mValue(ObjectDbParameters(ObjectDbParameters::COUCHDB).raw()));
+  EXPECT_THROW(params.generateDb(), std::runtime_error);
+}
+
+/** Set ORK_COUCH_TAPE to record the exchanges with the CouchDB on localhost:5984 in that file, and check that they
+ * can be replayed: the tape can then be used for benchmarks that do not need a server
+ */
+TEST(OR_db_replay, CouchRecordReplay)
+{
+  const char * tape_path = std::getenv("ORK_COUCH_TAPE");
+  if (!tape_path)
+    return;
+
+  {
+    HttpStub stub("localhost", 5984);
+    ObjectDbPtr db = couch_db(stub.root());
+    db->DeleteCollection("test_it");
+    persist_load(db);
+    db->DeleteCollection("test_it");
+    stub.tape().Save(tape_path);
+  }
+
+  HttpTape tape;
+  tape.Load(tape_path);
+  HttpStub stub(tape);
+  ObjectDbPtr db = couch_db(stub.root());
+  db->DeleteCollection("test_it");
+  persist_load(db);
+  db->DeleteCollection("test_it");
+  EXPECT_EQ(stub.n_unmatched(), 0);
+}
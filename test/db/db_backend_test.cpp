@@ -0,0 +1,386 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <gtest/gtest.h>
+
+#include <object_recognition_core/common/metrics.h>
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/document.h>
+#include <object_recognition_core/db/model_utils.h>
+
+using object_recognition_core::db::Document;
+using object_recognition_core::db::DocumentId;
+using object_recognition_core::db::Documents;
+using object_recognition_core::db::ObjectDbParameters;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::db::RevisionId;
+
+/** Tests of the backends that only need the filesystem: unlike db_test.cpp, they do not need a CouchDB server */
+
+namespace
+{
+  /** @return the parameters of a filesystem DB in /tmp */
+  or_json::mObject
+  filesystem_params(const std::string & collection)
+  {
+    ObjectDbParameters params(ObjectDbParameters::FILESYSTEM);
+    params.set_parameter("path", "/tmp");
+    params.set_parameter("collection", collection);
+    return params.raw();
+  }
+}
+
+TEST(OR_db_backend, ShardedColocation)
+{
+  or_json::mArray shards;
+  for (int i = 0; i < 3; ++i)
+    shards.push_back(filesystem_params("test_it_shard_" + boost::lexical_cast<std::string>(i)));
+  ObjectDbParameters db_params(ObjectDbParameters::SHARDED);
+  db_params.set_parameter("shards", or_json::mValue(shards));
+  ObjectDbPtr db = db_params.generateDb();
+  EXPECT_EQ(db->type(), std::string("sharded"));
+
+  Document object;
+  object.set_db(db);
+  object.set_field("Type", "Object");
+  object.Persist();
+
+  // The documents of an object have to be on the shard of the object
+  std::vector<std::string> ids;
+  for (int i = 0; i < 10; ++i)
+  {
+    Document observation;
+    observation.set_db(db);
+    observation.set_field("Type", "Observation");
+    observation.set_field("object_id", object.id());
+    observation.Persist();
+    ids.push_back(observation.id());
+  }
+
+  BOOST_FOREACH(const or_json::mValue & shard, shards)
+  {
+    ObjectDbPtr shard_db = ObjectDbParameters(shard.get_obj()).generateDb();
+    bool has_object = true;
+    try
+    {
+      or_json::mObject fields;
+      shard_db->load_fields(object.id(), fields);
+    } catch (std::runtime_error& e)
+    {
+      has_object = false;
+    }
+    BOOST_FOREACH(const std::string & id, ids)
+    {
+      bool has_observation = true;
+      try
+      {
+        or_json::mObject fields;
+        shard_db->load_fields(id, fields);
+      } catch (std::runtime_error& e)
+      {
+        has_observation = false;
+      }
+      EXPECT_EQ(has_object, has_observation);
+    }
+  }
+
+  // And the documents are found through the sharded DB
+  BOOST_FOREACH(const std::string & id, ids)
+  {
+    Document observation;
+    observation.set_db(db);
+    observation.set_document_id(id);
+    observation.load_fields();
+    EXPECT_EQ(observation.get_field<std::string>("object_id"), object.id());
+  }
+
+  for (int i = 0; i < 3; ++i)
+    db->DeleteCollection("test_it_shard_" + boost::lexical_cast<std::string>(i));
+}
+
+TEST(OR_db_backend, DocumentLoadBulk)
+{
+  ObjectDbPtr db = ObjectDbParameters(filesystem_params("test_it_bulk")).generateDb();
+  std::vector<DocumentId> ids;
+  for (int i = 0; i < 3; ++i)
+  {
+    Document doc;
+    doc.set_db(db);
+    doc.set_field("x", double(i));
+    doc.Persist();
+    ids.push_back(doc.id());
+  }
+  // the documents come back in the order of the ids
+  std::reverse(ids.begin(), ids.end());
+  Documents documents = LoadDocuments(db, ids);
+  ASSERT_EQ(documents.size(), 3);
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(documents[i].id(), ids[i]);
+    EXPECT_EQ(documents[i].get_field<double>("x"), double(2 - i));
+  }
+  ids.push_back("missing_document");
+  EXPECT_THROW(LoadDocuments(db, ids), std::runtime_error);
+  db->DeleteCollection("test_it_bulk");
+}
+
+TEST(OR_db_backend, TieredWriteBack)
+{
+  or_json::mObject local = filesystem_params("test_it_local");
+  or_json::mObject remote = filesystem_params("test_it_remote");
+  ObjectDbParameters db_params(ObjectDbParameters::TIERED);
+  db_params.set_parameter("local", or_json::mValue(local));
+  db_params.set_parameter("remote", or_json::mValue(remote));
+  db_params.set_parameter("write_mode", "back");
+  db_params.set_parameter("queue_path", "/tmp/test_it_queue");
+  db_params.set_parameter("flush_size", or_json::mValue(10));
+  ObjectDbPtr db = db_params.generateDb();
+  ObjectDbPtr remote_db = ObjectDbParameters(remote).generateDb();
+
+  Document doc;
+  doc.set_db(db);
+  doc.set_field("foo", "UuU");
+  doc.Persist();
+
+  // The write is only local until the journal is replayed
+  or_json::mObject fields;
+  EXPECT_THROW(remote_db->load_fields(doc.id(), fields), std::runtime_error);
+  db->load_fields(doc.id(), fields);
+  EXPECT_EQ(fields["foo"].get_str(), std::string("UuU"));
+
+  // The journal is replayed when the DB is destroyed
+  doc.set_db(ObjectDbPtr());
+  db.reset();
+  remote_db->load_fields(doc.id(), fields);
+  EXPECT_EQ(fields["foo"].get_str(), std::string("UuU"));
+
+  remote_db->DeleteCollection("test_it_local");
+  remote_db->DeleteCollection("test_it_remote");
+  boost::filesystem::remove_all("/tmp/test_it_queue");
+}
+
+/** The local copies of the documents and attachments are checked against the remote DB once they are stale */
+TEST(OR_db_backend, TieredStaleness)
+{
+  or_json::mObject remote = filesystem_params("test_it_remote");
+  ObjectDbParameters db_params(ObjectDbParameters::TIERED);
+  db_params.set_parameter("local", or_json::mValue(filesystem_params("test_it_local")));
+  db_params.set_parameter("remote", or_json::mValue(remote));
+  db_params.set_parameter("max_staleness", or_json::mValue(60));
+  ObjectDbPtr db = db_params.generateDb();
+  ObjectDbPtr remote_db = ObjectDbParameters(remote).generateDb();
+
+  Document doc;
+  doc.set_db(db);
+  doc.set_field("foo", "UuU");
+  doc.Persist();
+  std::stringstream attachment("old");
+  RevisionId revision_id;
+  db->set_attachment_stream(doc.id(), "data", "text/plain", attachment, revision_id);
+
+  // Another client changes the document in the remote DB
+  or_json::mObject fields;
+  remote_db->load_fields(doc.id(), fields);
+  fields["foo"] = "OoO";
+  remote_db->persist_fields(doc.id(), fields, revision_id);
+  std::stringstream new_attachment("new");
+  remote_db->set_attachment_stream(doc.id(), "data", "text/plain", new_attachment, revision_id);
+
+  // The local copy is fresh enough to be served
+  db->load_fields(doc.id(), fields);
+  EXPECT_EQ(fields["foo"].get_str(), std::string("UuU"));
+  std::stringstream data;
+  db->get_attachment_stream(doc.id(), "", "data", "text/plain", data);
+  EXPECT_EQ(data.str(), std::string("old"));
+
+  // A new instance has never checked it: reading the attachment first also brings the new fields
+  db = db_params.generateDb();
+  data.str("");
+  db->get_attachment_stream(doc.id(), "", "data", "text/plain", data);
+  EXPECT_EQ(data.str(), std::string("new"));
+  db->load_fields(doc.id(), fields);
+  EXPECT_EQ(fields["foo"].get_str(), std::string("OoO"));
+
+  // And so does reading the fields first, also in bulk
+  fields["foo"] = "AaA";
+  remote_db->persist_fields(doc.id(), fields, revision_id);
+  db = db_params.generateDb();
+  std::vector<or_json::mObject> bulk_fields;
+  db->load_fields_bulk(std::vector<DocumentId>(1, doc.id()), bulk_fields);
+  ASSERT_EQ(bulk_fields.size(), 1);
+  EXPECT_EQ(bulk_fields[0]["foo"].get_str(), std::string("AaA"));
+  ObjectDbParameters(filesystem_params("test_it_local")).generateDb()->load_fields(doc.id(), fields);
+  EXPECT_EQ(fields["foo"].get_str(), std::string("AaA"));
+
+  remote_db->DeleteCollection("test_it_local");
+  remote_db->DeleteCollection("test_it_remote");
+}
+
+/** Another instance of a DB, e.g. an unpickled one, leaves the journal of a nested write-back tiered DB alone */
+TEST(OR_db_backend, TieredSecondary)
+{
+  const std::string queue_path = "/tmp/test_it_secondary_queue";
+  or_json::mObject remote = filesystem_params("test_it_remote");
+  ObjectDbParameters tiered_params(ObjectDbParameters::TIERED);
+  tiered_params.set_parameter("local", or_json::mValue(filesystem_params("test_it_local")));
+  tiered_params.set_parameter("remote", or_json::mValue(remote));
+  tiered_params.set_parameter("write_mode", "back");
+  tiered_params.set_parameter("queue_path", queue_path);
+  tiered_params.set_parameter("flush_size", or_json::mValue(10));
+  ObjectDbParameters latency_params(ObjectDbParameters::LATENCY);
+  latency_params.set_parameter("db", or_json::mValue(tiered_params.raw()));
+  ObjectDbParameters db_params(ObjectDbParameters::SHARDED);
+  db_params.set_parameter("shards", or_json::mValue(or_json::mArray(1, latency_params.raw())));
+  ObjectDbPtr db = db_params.generateDb();
+  ObjectDbPtr remote_db = ObjectDbParameters(remote).generateDb();
+
+  Document doc;
+  doc.set_db(db);
+  doc.set_field("foo", "UuU");
+  doc.Persist();
+  size_t n_journaled = std::distance(boost::filesystem::directory_iterator(queue_path),
+                                     boost::filesystem::directory_iterator());
+  EXPECT_EQ(n_journaled, 1);
+
+  // the tiered DB of the secondary instance writes through and does not touch the journal, even when destroyed
+  ObjectDbParameters secondary_params = db_params.secondary();
+  const or_json::mObject secondary_tiered =
+      secondary_params.at("shards").get_array()[0].get_obj().find("db")->second.get_obj();
+  EXPECT_EQ(secondary_tiered.find("write_mode")->second.get_str(), std::string("through"));
+  EXPECT_EQ(secondary_tiered.find("queue_path")->second.get_str(), std::string(""));
+  secondary_params.generateDb().reset();
+  EXPECT_EQ(size_t(std::distance(boost::filesystem::directory_iterator(queue_path),
+                                 boost::filesystem::directory_iterator())), n_journaled);
+  or_json::mObject fields;
+  EXPECT_THROW(remote_db->load_fields(doc.id(), fields), std::runtime_error);
+
+  // the original instance still replays it
+  doc.set_db(ObjectDbPtr());
+  db.reset();
+  remote_db->load_fields(doc.id(), fields);
+  EXPECT_EQ(fields["foo"].get_str(), std::string("UuU"));
+
+  remote_db->DeleteCollection("test_it_local");
+  remote_db->DeleteCollection("test_it_remote");
+  boost::filesystem::remove_all(queue_path);
+}
+
+TEST(OR_db_backend, LatencyInjection)
+{
+  or_json::mObject methods, load_fields;
+  load_fields["latency_ms"] = 50;
+  methods["load_fields"] = load_fields;
+  ObjectDbParameters db_params(ObjectDbParameters::LATENCY);
+  db_params.set_parameter("latency_ms", or_json::mValue(5));
+  db_params.set_parameter("methods", or_json::mValue(methods));
+  ObjectDbPtr db = db_params.generateDb();
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  or_json::mObject fields;
+  db->load_fields("any_id", fields);
+  boost::posix_time::time_duration load_duration = boost::posix_time::microsec_clock::universal_time() - start;
+  EXPECT_GE(load_duration.total_milliseconds(), 50);
+
+  start = boost::posix_time::microsec_clock::universal_time();
+  db->Status();
+  boost::posix_time::time_duration status_duration = boost::posix_time::microsec_clock::universal_time() - start;
+  EXPECT_GE(status_duration.total_milliseconds(), 5);
+  EXPECT_LT(status_duration.total_milliseconds(), 50);
+}
+
+TEST(OR_db_backend, FaultInjection)
+{
+  ObjectDbParameters db_params(ObjectDbParameters::LATENCY);
+  db_params.set_parameter("error_rate", or_json::mValue(0.5));
+  db_params.set_parameter("seed", or_json::mValue(42));
+
+  // The same seed gives the same failures
+  std::vector<bool> failures[2];
+  for (int i = 0; i < 2; ++i)
+  {
+    ObjectDbPtr db = db_params.generateDb();
+    for (int j = 0; j < 100; ++j)
+    {
+      try
+      {
+        db->Status();
+        failures[i].push_back(false);
+      } catch (std::runtime_error& e)
+      {
+        EXPECT_EQ(std::string(e.what()), std::string("Injected failure in Status"));
+        failures[i].push_back(true);
+      }
+    }
+  }
+  EXPECT_TRUE(failures[0] == failures[1]);
+  size_t n_failures = std::count(failures[0].begin(), failures[0].end(), true);
+  EXPECT_GT(n_failures, 20);
+  EXPECT_LT(n_failures, 80);
+}
+
+TEST(OR_db_backend, MetricsHistogram)
+{
+  using object_recognition_core::common::Histogram;
+  using object_recognition_core::common::MetricsRegistry;
+
+  Histogram histogram;
+  for (boost::uint64_t i = 1; i <= 10000; ++i)
+    histogram.Record(i);
+  EXPECT_EQ(histogram.count(), 10000u);
+  EXPECT_EQ(histogram.sum(), 10000u * 10001u / 2);
+  // The buckets are within 1/16 of the values
+  EXPECT_NEAR(histogram.Quantile(0.5), 5000, 5000 / 16);
+  EXPECT_NEAR(histogram.Quantile(0.99), 9900, 9900 / 16);
+
+  // The failures injected by the latency DB are counted by method
+  ObjectDbParameters db_params(ObjectDbParameters::LATENCY);
+  db_params.set_parameter("error_rate", or_json::mValue(1.0));
+  ObjectDbPtr db = db_params.generateDb();
+  EXPECT_THROW(db->Status(), std::runtime_error);
+  std::stringstream metrics;
+  MetricsRegistry::Instance().WritePrometheus(metrics);
+  EXPECT_NE(metrics.str().find("# TYPE ork_latency_injected_failures_total counter"), std::string::npos);
+  EXPECT_NE(metrics.str().find("ork_latency_injected_failures_total{method=\"Status\"}"), std::string::npos);
+}
@@ -0,0 +1,175 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <object_recognition_core/db/db.h>
+#include <object_recognition_core/db/gc.h>
+
+#include "http_stub.h"
+
+using object_recognition_core::db::GarbageCollector;
+using object_recognition_core::db::ObjectDbParameters;
+using object_recognition_core::db::ObjectDbPtr;
+using object_recognition_core::test::HttpExchange;
+using object_recognition_core::test::HttpStub;
+using object_recognition_core::test::HttpTape;
+
+namespace
+{
+  ObjectDbPtr
+  couch_db(const std::string & root)
+  {
+    ObjectDbParameters params(ObjectDbParameters::COUCHDB);
+    params.set_parameter("root", root);
+    params.set_parameter("collection", "test_it");
+    return params.generateDb();
+  }
+
+  /** A row of the temporary view of the scan: the key is the revision and the value the document */
+  std::string
+  view_row(const std::string & id, const std::string & rev, const std::string & fields)
+  {
+    return "{\"id\":\"" + id + "\",\"key\":\"" + rev + "\",\"value\":{\"_id\":\"" + id + "\",\"_rev\":\"" + rev
+           + "\"," + fields + "}}";
+  }
+
+  /** A DB with an object and its session, observation and model, plus:
+   *  - a model of an object that was deleted and an observation of a session that was deleted: orphans
+   *  - a copy of the model: a duplicate
+   *  - an object without models
+   */
+  HttpTape
+  scan_tape()
+  {
+    std::vector<std::string> rows;
+    rows.push_back(view_row("object_0", "1-a", "\"Type\":\"Object\",\"name\":\"cup\""));
+    rows.push_back(view_row("object_1", "1-b", "\"Type\":\"Object\",\"name\":\"can\""));
+    rows.push_back(view_row("session_0", "1-c", "\"Type\":\"Session\",\"object_id\":\"object_0\""));
+    rows.push_back(
+        view_row("observation_0", "1-d",
+                 "\"Type\":\"Observation\",\"object_id\":\"object_0\",\"session_id\":\"session_0\""));
+    rows.push_back(
+        view_row("observation_1", "1-e",
+                 "\"Type\":\"Observation\",\"object_id\":\"object_0\",\"session_id\":\"session_1\""));
+    rows.push_back(view_row("model_0", "1-f", "\"Type\":\"Model\",\"object_id\":\"object_0\",\"method\":\"TOD\""));
+    rows.push_back(view_row("model_0_copy", "1-g", "\"Type\":\"Model\",\"object_id\":\"object_0\",\"method\":\"TOD\""));
+    rows.push_back(view_row("model_1", "1-h", "\"Type\":\"Model\",\"object_id\":\"object_2\",\"method\":\"TOD\""));
+
+    std::string body = "{\"total_rows\":8,\"offset\":0,\"rows\":[";
+    for (size_t i = 0; i < rows.size(); ++i)
+      body += ((i == 0) ? "" : ",") + rows[i];
+    body += "]}";
+
+    HttpTape tape;
+    tape.Add(
+        HttpExchange("POST", "/test_it/_temp_view?limit=100&skip=0", "", HttpExchange::JsonResponse("200 OK", body)));
+    return tape;
+  }
+}
+
+TEST(OR_db_gc, Scan)
+{
+  HttpStub stub(scan_tape());
+  GarbageCollector gc(couch_db(stub.root()));
+  gc.Scan();
+  EXPECT_EQ(stub.n_unmatched(), 0);
+
+  const object_recognition_core::db::GarbageReport & report = gc.report();
+  EXPECT_EQ(report.n_documents_, 8);
+  ASSERT_EQ(report.orphans_.size(), 2);
+  EXPECT_EQ(report.orphans_[0], "model_1");
+  EXPECT_EQ(report.orphans_[1], "observation_1");
+  ASSERT_EQ(report.duplicates_.size(), 1);
+  EXPECT_EQ(report.duplicates_[0], "model_0_copy");
+  ASSERT_EQ(report.objects_without_models_.size(), 1);
+  EXPECT_EQ(report.objects_without_models_[0], "object_1");
+  EXPECT_GT(report.reclaimable_bytes_, 0);
+}
+
+TEST(OR_db_gc, Collect)
+{
+  HttpTape tape = scan_tape();
+  // the orphans and duplicates are deleted in one request, with their revisions
+  tape.Add(
+      HttpExchange(
+          "POST", "/test_it/_bulk_docs",
+          "{\"docs\":[{\"_deleted\":true,\"_id\":\"model_1\",\"_rev\":\"1-h\"},"
+          "{\"_deleted\":true,\"_id\":\"observation_1\",\"_rev\":\"1-e\"},"
+          "{\"_deleted\":true,\"_id\":\"model_0_copy\",\"_rev\":\"1-g\"}]}",
+          HttpExchange::JsonResponse("201 Created",
+                                     "[{\"ok\":true,\"id\":\"model_1\",\"rev\":\"2-h\"},"
+                                     "{\"ok\":true,\"id\":\"observation_1\",\"rev\":\"2-e\"},"
+                                     "{\"ok\":true,\"id\":\"model_0_copy\",\"rev\":\"2-g\"}]")));
+  HttpStub stub(tape);
+  GarbageCollector gc(couch_db(stub.root()));
+  gc.Scan();
+  gc.Collect();
+  EXPECT_EQ(stub.n_unmatched(), 0);
+  EXPECT_EQ(stub.tape().n_remaining(), 0);
+  EXPECT_TRUE(gc.report().orphans_.empty());
+  EXPECT_TRUE(gc.report().duplicates_.empty());
+  EXPECT_EQ(gc.report().reclaimable_bytes_, 0);
+}
+
+TEST(OR_db_gc, CollectConflict)
+{
+  HttpTape tape = scan_tape();
+  tape.Add(
+      HttpExchange("POST", "/test_it/_bulk_docs", "",
+                   HttpExchange::JsonResponse("201 Created",
+                                              "[{\"ok\":true,\"id\":\"model_1\",\"rev\":\"2-h\"},"
+                                              "{\"id\":\"observation_1\",\"error\":\"conflict\"},"
+                                              "{\"ok\":true,\"id\":\"model_0_copy\",\"rev\":\"2-g\"}]")));
+  HttpStub stub(tape);
+  GarbageCollector gc(couch_db(stub.root()));
+  gc.Scan();
+  EXPECT_THROW(gc.Collect(), std::runtime_error);
+  EXPECT_EQ(stub.n_unmatched(), 0);
+}
+
+/** The scan needs QueryGeneric, that the filesystem DB does not implement */
+TEST(OR_db_gc, FilesystemDb)
+{
+  ObjectDbParameters params(ObjectDbParameters::FILESYSTEM);
+  params.set_parameter("path", "/tmp");
+  params.set_parameter("collection", "test_it_gc");
+  ObjectDbPtr db = params.generateDb();
+  EXPECT_THROW(GarbageCollector gc(db), std::runtime_error);
+  db->DeleteCollection("test_it_gc");
+}
@@ -0,0 +1,521 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "http_stub.h"
+
+using boost::asio::ip::tcp;
+
+namespace
+{
+  const std::string TAPE_MAGIC = "ORKTAPE1";
+
+  /** @return the value of a header, empty if it is not there. Names are case insensitive */
+  std::string
+  HeaderValue(const std::vector<std::string> & headers, const std::string & name)
+  {
+    BOOST_FOREACH(const std::string & header, headers)
+    {
+      size_t colon = header.find(':');
+      if ((colon != name.size()) || (colon == std::string::npos))
+        continue;
+      bool is_same = true;
+      for (size_t i = 0; is_same && (i < colon); ++i)
+        is_same = (::tolower(header[i]) == ::tolower(name[i]));
+      if (!is_same)
+        continue;
+      size_t start = header.find_first_not_of(' ', colon + 1);
+      return (start == std::string::npos) ? std::string() : header.substr(start);
+    }
+    return std::string();
+  }
+
+  /** @return true if a target matches the one of an exchange, which can end with a '*' to match any suffix */
+  bool
+  IsSameTarget(const std::string & exchange_target, const std::string & target)
+  {
+    if (exchange_target.empty() || (exchange_target[exchange_target.size() - 1] != '*'))
+      return exchange_target == target;
+    return target.compare(0, exchange_target.size() - 1, exchange_target, 0, exchange_target.size() - 1) == 0;
+  }
+
+  /** @return true if the header only concerns one connection and must not be forwarded/recorded as is */
+  bool
+  IsHopByHop(const std::string & header)
+  {
+    static const char * names[] = { "transfer-encoding", "content-length", "connection", "expect", "keep-alive" };
+    std::string name = header.substr(0, header.find(':'));
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    return std::find(names, names + sizeof(names) / sizeof(names[0]), name) != names + sizeof(names) / sizeof(names[0]);
+  }
+
+  /** A connection with its read buffer, to read HTTP messages from it
+   */
+  class Reader
+  {
+  public:
+    Reader(tcp::socket & socket)
+        :
+          socket_(socket)
+    {
+    }
+
+    /** Read the start line and the headers of a message
+     * @return false if the connection was closed
+     */
+    bool
+    ReadHead(std::string & start_line, std::vector<std::string> & headers)
+    {
+      boost::system::error_code error;
+      size_t n_bytes = boost::asio::read_until(socket_, buffer_, "\r\n\r\n", error);
+      if (error)
+        return false;
+      std::string head = Extract(n_bytes);
+
+      headers.clear();
+      size_t begin = 0, end;
+      while ((end = head.find("\r\n", begin)) != std::string::npos)
+      {
+        if (end > begin)
+          headers.push_back(head.substr(begin, end - begin));
+        begin = end + 2;
+      }
+      if (headers.empty())
+        return false;
+      start_line = headers.front();
+      headers.erase(headers.begin());
+      return true;
+    }
+
+    /** Read the body of a message, given its headers
+     * @param do_read_until_eof if true, a body of unknown size goes up to the end of the connection
+     */
+    std::string
+    ReadBody(const std::vector<std::string> & headers, bool do_read_until_eof)
+    {
+      std::string body;
+      if (HeaderValue(headers, "Transfer-Encoding").find("chunked") != std::string::npos)
+      {
+        while (true)
+        {
+          size_t chunk_size = std::strtoul(ReadLine().c_str(), 0, 16);
+          if (chunk_size == 0)
+          {
+            // Skip the trailers
+            while (!ReadLine().empty())
+              ;
+            break;
+          }
+          body += ReadExactly(chunk_size);
+          ReadExactly(2);
+        }
+      }
+      else if (!HeaderValue(headers, "Content-Length").empty())
+        body = ReadExactly(boost::lexical_cast<size_t>(HeaderValue(headers, "Content-Length")));
+      else if (do_read_until_eof)
+      {
+        boost::system::error_code error;
+        boost::asio::read(socket_, buffer_, boost::asio::transfer_all(), error);
+        body = Extract(buffer_.size());
+      }
+      return body;
+    }
+  private:
+    std::string
+    Extract(size_t n_bytes)
+    {
+      std::string data(n_bytes, '\0');
+      std::istream stream(&buffer_);
+      stream.read(&data[0], n_bytes);
+      return data;
+    }
+
+    std::string
+    ReadExactly(size_t n_bytes)
+    {
+      if (buffer_.size() < n_bytes)
+        boost::asio::read(socket_, buffer_, boost::asio::transfer_exactly(n_bytes - buffer_.size()));
+      return Extract(n_bytes);
+    }
+
+    std::string
+    ReadLine()
+    {
+      size_t n_bytes = boost::asio::read_until(socket_, buffer_, "\r\n");
+      std::string line = Extract(n_bytes);
+      return line.substr(0, line.size() - 2);
+    }
+
+    tcp::socket & socket_;
+    boost::asio::streambuf buffer_;
+  };
+
+  void
+  WriteUint64(std::ostream & stream, boost::uint64_t value)
+  {
+    // Little endian, whatever the machine
+    for (int i = 0; i < 8; ++i)
+      stream.put(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+
+  boost::uint64_t
+  ReadUint64(std::istream & stream)
+  {
+    boost::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+      value |= static_cast<boost::uint64_t>(static_cast<unsigned char>(stream.get())) << (8 * i);
+    return value;
+  }
+
+  void
+  WriteString(std::ostream & stream, const std::string & value)
+  {
+    WriteUint64(stream, value.size());
+    stream.write(value.data(), value.size());
+  }
+
+  std::string
+  ReadString(std::istream & stream)
+  {
+    std::string value(ReadUint64(stream), '\0');
+    if (!value.empty())
+      stream.read(&value[0], value.size());
+    return value;
+  }
+}
+
+namespace object_recognition_core
+{
+  namespace test
+  {
+    std::string
+    HttpExchange::JsonResponse(const std::string & status, const std::string & body)
+    {
+      return "HTTP/1.1 " + status + "\r\nServer: ork-http-stub\r\nContent-Type: application/json\r\nContent-Length: "
+             + boost::lexical_cast<std::string>(body.size()) + "\r\n\r\n" + body;
+    }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    void
+    HttpTape::Load(const std::string & path)
+    {
+      std::ifstream file(path.c_str(), std::ios::binary);
+      std::string magic(TAPE_MAGIC.size(), '\0');
+      file.read(&magic[0], magic.size());
+      if (!file || (magic != TAPE_MAGIC))
+        throw std::runtime_error("Not a tape: " + path);
+
+      exchanges_.clear();
+      is_replayed_.clear();
+      boost::uint64_t n_exchanges = ReadUint64(file);
+      for (boost::uint64_t i = 0; i < n_exchanges; ++i)
+      {
+        HttpExchange exchange;
+        exchange.method_ = ReadString(file);
+        exchange.target_ = ReadString(file);
+        exchange.request_body_ = ReadString(file);
+        exchange.response_ = ReadString(file);
+        exchange.duration_us_ = ReadUint64(file);
+        if (!file)
+          throw std::runtime_error("Truncated tape: " + path);
+        Add(exchange);
+      }
+    }
+
+    void
+    HttpTape::Save(const std::string & path) const
+    {
+      std::ofstream file(path.c_str(), std::ios::binary);
+      file.write(TAPE_MAGIC.data(), TAPE_MAGIC.size());
+      WriteUint64(file, exchanges_.size());
+      BOOST_FOREACH(const HttpExchange & exchange, exchanges_)
+      {
+        WriteString(file, exchange.method_);
+        WriteString(file, exchange.target_);
+        WriteString(file, exchange.request_body_);
+        WriteString(file, exchange.response_);
+        WriteUint64(file, exchange.duration_us_);
+      }
+      file.close();
+      if (!file)
+        throw std::runtime_error("Could not write the tape: " + path);
+    }
+
+    void
+    HttpTape::Add(const HttpExchange & exchange)
+    {
+      exchanges_.push_back(exchange);
+      is_replayed_.push_back(false);
+    }
+
+    bool
+    HttpTape::Match(const std::string & method, const std::string & target, const std::string & body,
+                    HttpExchange & exchange)
+    {
+      for (int do_match_body = 1; do_match_body >= 0; --do_match_body)
+        for (size_t i = 0; i < exchanges_.size(); ++i)
+        {
+          if (is_replayed_[i] || (exchanges_[i].method_ != method) || !IsSameTarget(exchanges_[i].target_, target))
+            continue;
+          if (do_match_body && (exchanges_[i].request_body_ != body))
+            continue;
+          is_replayed_[i] = !is_looping_;
+          exchange = exchanges_[i];
+          return true;
+        }
+      return false;
+    }
+
+    size_t
+    HttpTape::n_remaining() const
+    {
+      return std::count(is_replayed_.begin(), is_replayed_.end(), false);
+    }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    HttpStub::HttpStub(const HttpTape & tape, bool do_keep_timing)
+        :
+          mode_(REPLAY),
+          do_keep_timing_(do_keep_timing),
+          upstream_port_(0),
+          acceptor_(io_service_),
+          is_running_(false),
+          tape_(tape),
+          n_unmatched_(0)
+    {
+      Start();
+    }
+
+    HttpStub::HttpStub(const std::string & upstream_host, unsigned short upstream_port)
+        :
+          mode_(RECORD),
+          do_keep_timing_(false),
+          upstream_host_(upstream_host),
+          upstream_port_(upstream_port),
+          acceptor_(io_service_),
+          is_running_(false),
+          n_unmatched_(0)
+    {
+      Start();
+    }
+
+    HttpStub::~HttpStub()
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        is_running_ = false;
+        // Unblock the connections waiting for a request
+        BOOST_FOREACH(tcp::socket * socket, sockets_)
+        {
+          boost::system::error_code error;
+          socket->shutdown(tcp::socket::shutdown_both, error);
+        }
+      }
+      // Unblock the acceptor
+      {
+        boost::system::error_code error;
+        tcp::socket socket(io_service_);
+        socket.connect(acceptor_.local_endpoint(), error);
+      }
+      accept_thread_.join();
+      connection_threads_.join_all();
+    }
+
+    std::string
+    HttpStub::root() const
+    {
+      return "http://127.0.0.1:" + boost::lexical_cast<std::string>(acceptor_.local_endpoint().port());
+    }
+
+    HttpTape
+    HttpStub::tape() const
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      return tape_;
+    }
+
+    size_t
+    HttpStub::n_unmatched() const
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      return n_unmatched_;
+    }
+
+    void
+    HttpStub::Start()
+    {
+      tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), 0);
+      acceptor_.open(endpoint.protocol());
+      acceptor_.set_option(tcp::acceptor::reuse_address(true));
+      acceptor_.bind(endpoint);
+      acceptor_.listen();
+      is_running_ = true;
+      accept_thread_ = boost::thread(boost::bind(&HttpStub::Accept, this));
+    }
+
+    void
+    HttpStub::Accept()
+    {
+      while (true)
+      {
+        boost::shared_ptr<tcp::socket> socket(new tcp::socket(io_service_));
+        boost::system::error_code error;
+        acceptor_.accept(*socket, error);
+
+        boost::mutex::scoped_lock lock(mutex_);
+        if (!is_running_)
+          break;
+        if (error)
+          continue;
+        sockets_.insert(socket.get());
+        connection_threads_.create_thread(boost::bind(&HttpStub::Serve, this, socket));
+      }
+    }
+
+    void
+    HttpStub::Serve(boost::shared_ptr<tcp::socket> socket)
+    {
+      Reader reader(*socket);
+      try
+      {
+        std::string start_line;
+        std::vector<std::string> headers;
+        while (reader.ReadHead(start_line, headers))
+        {
+          std::istringstream request_line(start_line);
+          std::string method, target;
+          request_line >> method >> target;
+
+          // libcurl waits for that before sending the body of PUT/POST
+          if (HeaderValue(headers, "Expect") == "100-continue")
+            boost::asio::write(*socket, boost::asio::buffer(std::string("HTTP/1.1 100 Continue\r\n\r\n")));
+          std::string body = reader.ReadBody(headers, false);
+
+          std::string response;
+          boost::uint64_t duration_us = Respond(method, target, headers, body, response);
+          if (duration_us)
+            boost::this_thread::sleep(boost::posix_time::microseconds(duration_us));
+          boost::asio::write(*socket, boost::asio::buffer(response));
+
+          if (HeaderValue(headers, "Connection") == "close")
+            break;
+        }
+      } catch (std::exception & e)
+      {
+        // The connection was closed in the middle of a request
+      }
+
+      boost::mutex::scoped_lock lock(mutex_);
+      sockets_.erase(socket.get());
+    }
+
+    boost::uint64_t
+    HttpStub::Respond(const std::string & method, const std::string & target, const std::vector<std::string> & headers,
+                      const std::string & body, std::string & response)
+    {
+      if (mode_ == REPLAY)
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        HttpExchange exchange;
+        if (tape_.Match(method, target, body, exchange))
+        {
+          response = exchange.response_;
+          return do_keep_timing_ ? exchange.duration_us_ : 0;
+        }
+        ++n_unmatched_;
+        response = HttpExchange::JsonResponse("501 Not Implemented",
+                                              "{\"error\":\"not_recorded\",\"reason\":\"" + method + " " + target
+                                              + "\"}");
+        return 0;
+      }
+
+      // Forward the request with its whole body and read the whole response
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+      tcp::resolver resolver(io_service_);
+      tcp::resolver::query query(upstream_host_, boost::lexical_cast<std::string>(upstream_port_));
+      tcp::socket upstream(io_service_);
+      boost::asio::connect(upstream, resolver.resolve(query));
+
+      std::string request = method + " " + target + " HTTP/1.1\r\n";
+      BOOST_FOREACH(const std::string & header, headers)
+        if (!IsHopByHop(header))
+          request += header + "\r\n";
+      request += "Content-Length: " + boost::lexical_cast<std::string>(body.size()) + "\r\n";
+      request += "Connection: close\r\n\r\n" + body;
+      boost::asio::write(upstream, boost::asio::buffer(request));
+
+      Reader reader(upstream);
+      std::string status_line;
+      std::vector<std::string> response_headers;
+      if (!reader.ReadHead(status_line, response_headers))
+        throw std::runtime_error("No response from " + upstream_host_);
+      std::istringstream status_stream(status_line);
+      std::string version;
+      int status_code = 0;
+      status_stream >> version >> status_code;
+      bool has_body = (method != "HEAD") && (status_code >= 200) && (status_code != 204) && (status_code != 304);
+      std::string response_body = has_body ? reader.ReadBody(response_headers, true) : std::string();
+
+      // Always answer with a Content-Length as the body is known
+      response = status_line + "\r\n";
+      BOOST_FOREACH(const std::string & header, response_headers)
+        if (!IsHopByHop(header))
+          response += header + "\r\n";
+      std::string content_length = has_body ? boost::lexical_cast<std::string>(response_body.size()) :
+                                              HeaderValue(response_headers, "Content-Length");
+      if (!content_length.empty())
+        response += "Content-Length: " + content_length + "\r\n";
+      response += "\r\n" + response_body;
+
+      boost::posix_time::time_duration duration = boost::posix_time::microsec_clock::universal_time() - start;
+      boost::mutex::scoped_lock lock(mutex_);
+      tape_.Add(HttpExchange(method, target, body, response, duration.total_microseconds()));
+      return 0;
+    }
+  }
+}
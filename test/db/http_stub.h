@@ -0,0 +1,221 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ORK_CORE_TEST_DB_HTTP_STUB_H_
+#define ORK_CORE_TEST_DB_HTTP_STUB_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace object_recognition_core
+{
+  namespace test
+  {
+    /** A request received by the stub and the response it got/gives for it
+     */
+    struct HttpExchange
+    {
+      HttpExchange()
+          :
+            duration_us_(0)
+      {
+      }
+
+      HttpExchange(const std::string & method, const std::string & target, const std::string & request_body,
+                   const std::string & response, boost::uint64_t duration_us = 0)
+          :
+            method_(method),
+            target_(target),
+            request_body_(request_body),
+            response_(response),
+            duration_us_(duration_us)
+      {
+      }
+
+      /** Build a complete HTTP response
+       * @param status e.g. "200 OK"
+       * @param body the JSON body of the response
+       */
+      static std::string
+      JsonResponse(const std::string & status, const std::string & body);
+
+      std::string method_;
+      /** The request target, e.g. /object_recognition/_design/models/_view/by_object_id?limit=100&skip=0
+       * A target ending with a '*' matches any target starting with what precedes it */
+      std::string target_;
+      std::string request_body_;
+      /** The whole response: status line, headers and body (always sent with a Content-Length) */
+      std::string response_;
+      /** The time the server took to answer */
+      boost::uint64_t duration_us_;
+    };
+
+    /** A sequence of HTTP exchanges that can be saved to/loaded from a binary file
+     */
+    class HttpTape
+    {
+    public:
+      HttpTape()
+          :
+            is_looping_(false)
+      {
+      }
+
+      void
+      Load(const std::string & path);
+
+      void
+      Save(const std::string & path) const;
+
+      void
+      Add(const HttpExchange & exchange);
+
+      /** Find the response to a request: the first exchange not replayed yet with the same method, target and body,
+       * or with only the same method and target (bodies can hold random data, e.g. temporary ids)
+       * @return true if an exchange was found, and consumed unless the tape is looping
+       */
+      bool
+      Match(const std::string & method, const std::string & target, const std::string & body,
+            HttpExchange & exchange);
+
+      /** @return the exchanges not replayed yet */
+      size_t
+      n_remaining() const;
+
+      const std::vector<HttpExchange> &
+      exchanges() const
+      {
+        return exchanges_;
+      }
+
+      /** If looping, the exchanges are never consumed: a same request always gets the same response, e.g. to
+       * answer the same requests over and over in a benchmark
+       */
+      void
+      set_is_looping(bool is_looping)
+      {
+        is_looping_ = is_looping;
+      }
+    private:
+      std::vector<HttpExchange> exchanges_;
+      std::vector<bool> is_replayed_;
+      bool is_looping_;
+    };
+
+    /** An HTTP server running in its own threads that either:
+     *  - RECORD: forwards all the requests to an upstream server (e.g. CouchDB on localhost:5984) and records them
+     *  - REPLAY: answers the requests from a tape, optionally taking the time the upstream server took
+     * Give root() as the "root" of a CouchDB ObjectDb to use it. It understands what libcurl sends: keep-alive
+     * connections, chunked bodies and "Expect: 100-continue".
+     */
+    class HttpStub: boost::noncopyable
+    {
+    public:
+      enum Mode
+      {
+        RECORD, REPLAY
+      };
+
+      /** Create a stub replaying a tape
+       * @param tape the exchanges to replay
+       * @param do_keep_timing if true, each response waits for as long as it did when recorded
+       */
+      HttpStub(const HttpTape & tape, bool do_keep_timing = false);
+
+      /** Create a stub recording its exchanges with a server
+       * @param upstream_host the server to forward the requests to
+       * @param upstream_port the port of that server
+       */
+      HttpStub(const std::string & upstream_host, unsigned short upstream_port);
+
+      /** Stop the server */
+      ~HttpStub();
+
+      /** @return the URL of the server, e.g. http://127.0.0.1:34567 */
+      std::string
+      root() const;
+
+      /** @return the exchanges recorded or left to replay */
+      HttpTape
+      tape() const;
+
+      /** @return the number of requests that could not be answered from the tape */
+      size_t
+      n_unmatched() const;
+    private:
+      void
+      Start();
+
+      void
+      Accept();
+
+      void
+      Serve(boost::shared_ptr<boost::asio::ip::tcp::socket> socket);
+
+      /** Get the response to a request
+       * @return the duration to wait for before sending the response
+       */
+      boost::uint64_t
+      Respond(const std::string & method, const std::string & target, const std::vector<std::string> & headers,
+              const std::string & body, std::string & response);
+
+      Mode mode_;
+      bool do_keep_timing_;
+      std::string upstream_host_;
+      unsigned short upstream_port_;
+
+      boost::asio::io_service io_service_;
+      boost::asio::ip::tcp::acceptor acceptor_;
+      boost::thread accept_thread_;
+      boost::thread_group connection_threads_;
+
+      mutable boost::mutex mutex_;
+      bool is_running_;
+      HttpTape tape_;
+      size_t n_unmatched_;
+      /** The connections being served, to close them when stopping */
+      std::set<boost::asio::ip::tcp::socket *> sockets_;
+    };
+  }
+}
+
+#endif /* ORK_CORE_TEST_DB_HTTP_STUB_H_ */
@@ -0,0 +1,165 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include <ecto/ecto.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include "scene_change_gate.h"
+
+using object_recognition_core::filters::SceneChangeGate;
+
+namespace
+{
+  /** A gate on a 4x3 grid: the blocks of the 40x30 test images are 10x10 */
+  ecto::cell::ptr
+  gate(int max_skipped = 0)
+  {
+    ecto::cell::ptr cell(new ecto::cell_<SceneChangeGate>());
+    cell->declare_params();
+    cell->parameters["grid_width"] << 4;
+    cell->parameters["grid_height"] << 3;
+    cell->parameters["image_threshold"] << 6.0f;
+    cell->parameters["depth_threshold"] << 0.02f;
+    cell->parameters["max_skipped"] << max_skipped;
+    cell->declare_io();
+    cell->configure();
+    return cell;
+  }
+
+  bool
+  changed(ecto::cell::ptr & cell, const cv::Mat & image, const cv::Mat & depth)
+  {
+    cell->inputs["image"] << image;
+    cell->inputs["depth"] << depth;
+    cell->process();
+    return cell->outputs.get<bool>("changed");
+  }
+
+  cv::Mat
+  image(unsigned char value)
+  {
+    return cv::Mat(30, 40, CV_8UC3, cv::Scalar::all(value));
+  }
+
+  cv::Mat
+  depth(float value)
+  {
+    return cv::Mat(30, 40, CV_32F, cv::Scalar(value));
+  }
+
+  /** @return a copy of an image with one of its blocks set to a value */
+  cv::Mat
+  with_block(const cv::Mat & image, const cv::Scalar & value)
+  {
+    cv::Mat result = image.clone();
+    result(cv::Rect(10, 10, 10, 10)).setTo(value);
+    return result;
+  }
+}
+
+TEST(OR_filters_scene_change_gate, Image)
+{
+  ecto::cell::ptr cell = gate();
+  EXPECT_TRUE(changed(cell, image(100), cv::Mat()));
+  EXPECT_FALSE(changed(cell, image(100), cv::Mat()));
+
+  // A change of one block above the threshold
+  EXPECT_TRUE(changed(cell, with_block(image(100), cv::Scalar::all(110)), cv::Mat()));
+  EXPECT_TRUE(changed(cell, image(100), cv::Mat()));
+
+  // A change of one pixel only moves the mean of its block by 1
+  cv::Mat pixel = image(100);
+  pixel.at<cv::Vec3b>(15, 15) = cv::Vec3b(200, 200, 200);
+  EXPECT_FALSE(changed(cell, pixel, cv::Mat()));
+
+  // The frames are compared to the last processed one: slow changes add up
+  EXPECT_FALSE(changed(cell, with_block(image(100), cv::Scalar::all(104)), cv::Mat()));
+  EXPECT_TRUE(changed(cell, with_block(image(100), cv::Scalar::all(108)), cv::Mat()));
+
+  // A different size is a change
+  EXPECT_TRUE(changed(cell, cv::Mat(30, 40, CV_8UC1, cv::Scalar(100)), cv::Mat()));
+}
+
+TEST(OR_filters_scene_change_gate, Depth)
+{
+  ecto::cell::ptr cell = gate();
+  EXPECT_TRUE(changed(cell, cv::Mat(), depth(1)));
+  EXPECT_FALSE(changed(cell, cv::Mat(), depth(1.01f)));
+  EXPECT_TRUE(changed(cell, cv::Mat(), with_block(depth(1), cv::Scalar(1.1))));
+
+  // Millimeters
+  EXPECT_FALSE(changed(cell, cv::Mat(), with_block(cv::Mat(30, 40, CV_16U, cv::Scalar(1000)), cv::Scalar(1100))));
+  EXPECT_TRUE(changed(cell, cv::Mat(), cv::Mat(30, 40, CV_16U, cv::Scalar(1000))));
+}
+
+TEST(OR_filters_scene_change_gate, InvalidDepth)
+{
+  ecto::cell::ptr cell = gate();
+  EXPECT_TRUE(changed(cell, cv::Mat(), depth(1)));
+
+  // NaN and 0 are not valid depths: the mean of a block is the mean of its valid depths
+  cv::Mat holes = depth(1);
+  holes(cv::Rect(0, 0, 5, 10)).setTo(cv::Scalar(std::numeric_limits<float>::quiet_NaN()));
+  holes(cv::Rect(10, 0, 5, 10)).setTo(cv::Scalar(0));
+  EXPECT_FALSE(changed(cell, cv::Mat(), holes));
+
+  // The blocks without any valid depth are ignored
+  EXPECT_FALSE(changed(cell, cv::Mat(), with_block(depth(1), cv::Scalar(0))));
+  EXPECT_FALSE(changed(cell, cv::Mat(), with_block(depth(1), cv::Scalar(std::numeric_limits<float>::quiet_NaN()))));
+
+  // A few valid depths are enough to see a change
+  cv::Mat far = with_block(depth(1), cv::Scalar(0));
+  far(cv::Rect(10, 10, 2, 2)).setTo(cv::Scalar(2));
+  EXPECT_TRUE(changed(cell, cv::Mat(), far));
+}
+
+TEST(OR_filters_scene_change_gate, MaxSkipped)
+{
+  ecto::cell::ptr cell = gate(2);
+  EXPECT_TRUE(changed(cell, image(100), depth(1)));
+  EXPECT_FALSE(changed(cell, image(100), depth(1)));
+  EXPECT_FALSE(changed(cell, image(100), depth(1)));
+  EXPECT_TRUE(changed(cell, image(100), depth(1)));
+  EXPECT_FALSE(changed(cell, image(100), depth(1)));
+
+  // Without any image, every frame is processed
+  EXPECT_TRUE(changed(cell, cv::Mat(), cv::Mat()));
+  EXPECT_TRUE(changed(cell, cv::Mat(), cv::Mat()));
+}
@@ -0,0 +1,148 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ecto/ecto.hpp>
+
+#include "CascadeVoter.h"
+
+using object_recognition_core::common::PoseResult;
+using object_recognition_core::voters::CascadeMerge;
+using object_recognition_core::voters::CascadeVoter;
+
+namespace
+{
+  PoseResult
+  pose(const std::string & object_id, float x, float confidence)
+  {
+    float R[] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    float T[] = { x, 0, 1 };
+    PoseResult pose_result;
+    pose_result.set_object_id(object_recognition_core::db::ObjectDbPtr(), object_id);
+    pose_result.set_R(std::vector<float>(R, R + 9));
+    pose_result.set_T(std::vector<float>(T, T + 3));
+    pose_result.set_confidence(confidence);
+    return pose_result;
+  }
+
+  /** @return whether a CascadeVoter asks for the next stage on some results */
+  bool
+  vote(ecto::cell::ptr & cell, const std::vector<PoseResult> & pose_results)
+  {
+    cell->inputs["pose_results"] << pose_results;
+    cell->process();
+    return cell->outputs.get<bool>("needs_detection");
+  }
+
+  const std::vector<PoseResult> &
+  merge(ecto::cell::ptr & cell, const std::vector<PoseResult> & cascade_pose_results, bool needs_detection,
+        const std::vector<PoseResult> & pose_results)
+  {
+    cell->inputs["cascade_pose_results"] << cascade_pose_results;
+    cell->inputs["needs_detection"] << needs_detection;
+    cell->inputs["pose_results"] << pose_results;
+    cell->process();
+    return cell->outputs.get<std::vector<PoseResult> >("pose_results");
+  }
+}
+
+TEST(OR_io_cascade, Voter)
+{
+  ecto::cell::ptr cell(new ecto::cell_<CascadeVoter>());
+  cell->declare_params();
+  cell->parameters["min_confidence"] << 0.8f;
+  cell->parameters["min_objects"] << 2;
+  cell->declare_io();
+  cell->configure();
+
+  std::vector<PoseResult> pose_results;
+  EXPECT_TRUE(vote(cell, pose_results));
+  pose_results.push_back(pose("A", 0, 0.9f));
+  EXPECT_TRUE(vote(cell, pose_results));
+
+  // Enough confident results: the cascade stops there
+  pose_results.push_back(pose("B", 0.5f, 0.8f));
+  EXPECT_FALSE(vote(cell, pose_results));
+  const std::vector<PoseResult> & cascade_pose_results = cell->outputs.get<std::vector<PoseResult> >(
+      "cascade_pose_results");
+  ASSERT_EQ(2u, cascade_pose_results.size());
+  EXPECT_EQ("A", cascade_pose_results[0].object_id());
+  EXPECT_EQ("B", cascade_pose_results[1].object_id());
+
+  // A single result that is not confident enough
+  pose_results.push_back(pose("C", 1, 0.5f));
+  EXPECT_TRUE(vote(cell, pose_results));
+}
+
+TEST(OR_io_cascade, Merge)
+{
+  ecto::cell::ptr cell(new ecto::cell_<CascadeMerge>());
+  cell->declare_params();
+  cell->parameters["max_distance"] << 0.05f;
+  cell->declare_io();
+  cell->configure();
+
+  std::vector<PoseResult> cascade_pose_results, pose_results;
+  cascade_pose_results.push_back(pose("A", 0, 0.5f));
+  cascade_pose_results.push_back(pose("B", 0.5f, 0.9f));
+  pose_results.push_back(pose("A", 0.01f, 0.95f));
+  pose_results.push_back(pose("C", 1, 0.9f));
+
+  // The stage did not run: its results are from an older frame
+  std::vector<PoseResult> results = merge(cell, cascade_pose_results, false, pose_results);
+  ASSERT_EQ(2u, results.size());
+  EXPECT_EQ("A", results[0].object_id());
+  EXPECT_FLOAT_EQ(0.5f, results[0].confidence());
+  EXPECT_EQ("B", results[1].object_id());
+
+  // The result of the stage replaces the one of the same instance and the others are kept
+  results = merge(cell, cascade_pose_results, true, pose_results);
+  ASSERT_EQ(3u, results.size());
+  EXPECT_EQ("A", results[0].object_id());
+  EXPECT_FLOAT_EQ(0.95f, results[0].confidence());
+  EXPECT_EQ("C", results[1].object_id());
+  EXPECT_EQ("B", results[2].object_id());
+
+  // Another instance of the same object, further than max_distance, is kept
+  cascade_pose_results[0] = pose("A", 0.2f, 0.5f);
+  results = merge(cell, cascade_pose_results, true, pose_results);
+  ASSERT_EQ(4u, results.size());
+  EXPECT_EQ("A", results[2].object_id());
+  EXPECT_FLOAT_EQ(0.5f, results[2].confidence());
+}
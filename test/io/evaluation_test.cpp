@@ -0,0 +1,246 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "evaluation.h"
+
+using object_recognition_core::io::DetectionCounts;
+using object_recognition_core::io::DetectionEvaluator;
+using object_recognition_core::io::EvaluationParameters;
+using object_recognition_core::io::EvaluationResult;
+using object_recognition_core::io::PoseInfo;
+
+namespace
+{
+  /** A pose rotated around z, captured/detected at a given time of the day */
+  PoseInfo
+  pose(int run, int frame, const std::string & object_id, double x, double y, double z, double angle_degrees = 0,
+       int hour = 12, int min = 0, int sec = 0, int msec = 0)
+  {
+    PoseInfo pose;
+    pose.run = run;
+    pose.frame = frame;
+    pose.dID = 0;
+    pose.oID = object_id;
+    pose.Tx = x;
+    pose.Ty = y;
+    pose.Tz = z;
+    double angle = angle_degrees * M_PI / 180, c = std::cos(angle), s = std::sin(angle);
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j)
+        pose.R(i, j) = (i == j) ? 1 : 0;
+    pose.R(0, 0) = c;
+    pose.R(0, 1) = -s;
+    pose.R(1, 0) = s;
+    pose.R(1, 1) = c;
+    pose.ts.year = 2012;
+    pose.ts.month = 1;
+    pose.ts.day = 1;
+    pose.ts.hour = hour;
+    pose.ts.min = min;
+    pose.ts.sec = sec;
+    pose.ts.msec = msec;
+    return pose;
+  }
+
+  void
+  expect_counts(const DetectionCounts & counts, size_t true_positives, size_t false_positives,
+                size_t false_negatives)
+  {
+    EXPECT_EQ(counts.true_positives_, true_positives);
+    EXPECT_EQ(counts.false_positives_, false_positives);
+    EXPECT_EQ(counts.false_negatives_, false_negatives);
+  }
+}
+
+TEST(OR_io_evaluation, Counts)
+{
+  std::vector<PoseInfo> ground_truth, detections;
+  ground_truth.push_back(pose(1, 0, "cup", 0, 0, 1));
+  ground_truth.push_back(pose(1, 0, "can", 0.5, 0, 1));
+  // close enough to the cup
+  detections.push_back(pose(1, 0, "cup", 0.01, 0, 1, 5));
+  // too far from the can
+  detections.push_back(pose(1, 0, "can", 0.5, 0.2, 1));
+  // not in the frame
+  detections.push_back(pose(1, 0, "box", 0, 0, 1));
+
+  EvaluationResult result = DetectionEvaluator().Evaluate(ground_truth, detections);
+  expect_counts(result.counts_, 1, 2, 1);
+  ASSERT_EQ(result.object_counts_.size(), 3);
+  expect_counts(result.object_counts_["cup"], 1, 0, 0);
+  expect_counts(result.object_counts_["can"], 0, 1, 1);
+  expect_counts(result.object_counts_["box"], 0, 1, 0);
+  EXPECT_DOUBLE_EQ(result.counts_.precision(), 1.0 / 3);
+  EXPECT_DOUBLE_EQ(result.counts_.recall(), 1.0 / 2);
+
+  ASSERT_EQ(result.translation_error_.count_, 1);
+  EXPECT_NEAR(result.translation_error_.mean_, 0.01, 1e-9);
+  EXPECT_NEAR(result.rotation_error_.mean_, 5 * M_PI / 180, 1e-9);
+}
+
+TEST(OR_io_evaluation, RotationThreshold)
+{
+  std::vector<PoseInfo> ground_truth, detections;
+  ground_truth.push_back(pose(1, 0, "cup", 0, 0, 1));
+  detections.push_back(pose(1, 0, "cup", 0, 0, 1, 30));
+
+  EvaluationParameters parameters;
+  expect_counts(DetectionEvaluator(parameters).Evaluate(ground_truth, detections).counts_, 0, 1, 1);
+  parameters.max_rotation_error_ = 45 * M_PI / 180;
+  expect_counts(DetectionEvaluator(parameters).Evaluate(ground_truth, detections).counts_, 1, 0, 0);
+}
+
+/** The closest pairs are matched first and each pose is matched at most once */
+TEST(OR_io_evaluation, Matching)
+{
+  std::vector<PoseInfo> ground_truth, detections;
+  ground_truth.push_back(pose(1, 0, "cup", 0, 0, 1));
+  ground_truth.push_back(pose(1, 0, "cup", 0.03, 0, 1));
+  // closer to the second cup than the other detection is to the first one
+  detections.push_back(pose(1, 0, "cup", 0.025, 0, 1));
+  detections.push_back(pose(1, 0, "cup", 0, 0, 1));
+  // a second detection of the same cup
+  detections.push_back(pose(1, 0, "cup", 0.001, 0, 1));
+
+  EvaluationResult result = DetectionEvaluator().Evaluate(ground_truth, detections);
+  expect_counts(result.counts_, 2, 1, 0);
+  ASSERT_EQ(result.translation_error_.count_, 2);
+  EXPECT_NEAR(result.translation_error_.max_, 0.005, 1e-9);
+}
+
+/** The poses are only compared within a frame */
+TEST(OR_io_evaluation, Frames)
+{
+  std::vector<PoseInfo> ground_truth, detections;
+  ground_truth.push_back(pose(1, 0, "cup", 0, 0, 1));
+  ground_truth.push_back(pose(2, 0, "cup", 0, 0, 1));
+  detections.push_back(pose(1, 1, "cup", 0, 0, 1));
+  detections.push_back(pose(2, 0, "cup", 0, 0, 1));
+
+  EvaluationResult result = DetectionEvaluator().Evaluate(ground_truth, detections);
+  expect_counts(result.counts_, 1, 1, 1);
+  ASSERT_EQ(result.frames_.size(), 3);
+  EXPECT_EQ(result.frames_[0].run_, 1);
+  EXPECT_EQ(result.frames_[0].frame_, 0);
+  expect_counts(result.frames_[0].counts_["cup"], 0, 0, 1);
+  EXPECT_EQ(result.frames_[1].frame_, 1);
+  expect_counts(result.frames_[1].counts_["cup"], 0, 1, 0);
+  EXPECT_EQ(result.frames_[2].run_, 2);
+  expect_counts(result.frames_[2].counts_["cup"], 1, 0, 0);
+}
+
+/** The latency goes from the capture to the last detection of a frame, even across midnight */
+TEST(OR_io_evaluation, Latency)
+{
+  std::vector<PoseInfo> ground_truth, detections;
+  ground_truth.push_back(pose(1, 0, "cup", 0, 0, 1, 0, 12, 0, 0, 0));
+  detections.push_back(pose(1, 0, "cup", 0, 0, 1, 0, 12, 0, 0, 100));
+  detections.push_back(pose(1, 0, "can", 1, 0, 1, 0, 12, 0, 0, 250));
+  // over midnight
+  ground_truth.push_back(pose(1, 1, "cup", 0, 0, 1, 0, 23, 59, 59, 900));
+  detections.push_back(pose(1, 1, "cup", 0, 0, 1, 0, 0, 0, 0, 100));
+  ++detections.back().ts.day;
+  // no detection: no latency
+  ground_truth.push_back(pose(1, 2, "cup", 0, 0, 1, 0, 12, 0, 1, 0));
+  // more than a day, which only the dates tell
+  ground_truth.push_back(pose(1, 3, "cup", 0, 0, 1, 0, 12, 0, 0, 0));
+  detections.push_back(pose(1, 3, "cup", 0, 0, 1, 0, 12, 0, 0, 500));
+  detections.back().ts.day += 2;
+  // no date, as read from a CSV or binary log: the time of the day is assumed to wrap around midnight
+  ground_truth.push_back(pose(1, 4, "cup", 0, 0, 1, 0, 23, 59, 59, 900));
+  detections.push_back(pose(1, 4, "cup", 0, 0, 1, 0, 0, 0, 0, 300));
+  ground_truth.back().ts.year = ground_truth.back().ts.month = ground_truth.back().ts.day = 0;
+  detections.back().ts.year = detections.back().ts.month = detections.back().ts.day = 0;
+
+  EvaluationResult result = DetectionEvaluator().Evaluate(ground_truth, detections);
+  ASSERT_EQ(result.frames_.size(), 5);
+  ASSERT_TRUE(result.frames_[0].has_latency_);
+  EXPECT_NEAR(result.frames_[0].latency_, 0.25, 1e-6);
+  ASSERT_TRUE(result.frames_[1].has_latency_);
+  EXPECT_NEAR(result.frames_[1].latency_, 0.2, 1e-6);
+  EXPECT_FALSE(result.frames_[2].has_latency_);
+  ASSERT_TRUE(result.frames_[3].has_latency_);
+  EXPECT_NEAR(result.frames_[3].latency_, 2 * 24 * 3600 + 0.5, 1e-6);
+  ASSERT_TRUE(result.frames_[4].has_latency_);
+  EXPECT_NEAR(result.frames_[4].latency_, 0.4, 1e-6);
+  EXPECT_EQ(result.latency_.count_, 4);
+  EXPECT_NEAR(result.latency_.max_, 2 * 24 * 3600 + 0.5, 1e-6);
+}
+
+/** Several threads give the same results as one */
+TEST(OR_io_evaluation, Threads)
+{
+  std::vector<PoseInfo> ground_truth, detections;
+  for (int run = 0; run < 2; ++run)
+    for (int frame = 0; frame < 100; ++frame)
+    {
+      ground_truth.push_back(pose(run, frame, "cup", 0, 0, 1, 0, 12, 0, 0, 0));
+      ground_truth.push_back(pose(run, frame, "can", 0.5, 0, 1, 0, 12, 0, 0, 0));
+      // one frame out of three misses the can, one out of five has a wrong cup
+      detections.push_back(pose(run, frame, "cup", (frame % 5) ? 0.01 : 0.2, 0, 1, 0, 12, 0, 0, frame));
+      if (frame % 3)
+        detections.push_back(pose(run, frame, "can", 0.5, 0.01, 1, 0, 12, 0, 0, frame));
+    }
+
+  EvaluationParameters parameters;
+  EvaluationResult single = DetectionEvaluator(parameters).Evaluate(ground_truth, detections);
+  parameters.n_threads_ = 4;
+  EvaluationResult multiple = DetectionEvaluator(parameters).Evaluate(ground_truth, detections);
+
+  expect_counts(single.counts_, 2 * (80 + 66), 2 * 20, 2 * (20 + 34));
+  expect_counts(multiple.counts_, single.counts_.true_positives_, single.counts_.false_positives_,
+                single.counts_.false_negatives_);
+  ASSERT_EQ(multiple.frames_.size(), single.frames_.size());
+  for (size_t i = 0; i < single.frames_.size(); ++i)
+  {
+    EXPECT_EQ(multiple.frames_[i].run_, single.frames_[i].run_);
+    EXPECT_EQ(multiple.frames_[i].frame_, single.frames_[i].frame_);
+    EXPECT_EQ(multiple.frames_[i].latency_, single.frames_[i].latency_);
+  }
+  EXPECT_EQ(multiple.latency_.mean_, single.latency_.mean_);
+}
+
+TEST(OR_io_evaluation, Parameters)
+{
+  EvaluationParameters parameters;
+  parameters.max_translation_error_ = 0;
+  EXPECT_THROW(DetectionEvaluator evaluator(parameters), std::runtime_error);
+}
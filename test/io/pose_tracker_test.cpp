@@ -0,0 +1,200 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ecto/ecto.hpp>
+
+#include "PoseTracker.h"
+
+using object_recognition_core::common::PoseResult;
+using object_recognition_core::voters::PoseTracker;
+
+namespace
+{
+  /** A pose rotated around z, with a given confidence */
+  PoseResult
+  pose(const std::string & object_id, float x, float y, float z, float angle_degrees = 0, float confidence = 1)
+  {
+    float angle = angle_degrees * float(M_PI) / 180, c = std::cos(angle), s = std::sin(angle);
+    float R[] = { c, -s, 0, s, c, 0, 0, 0, 1 };
+    float T[] = { x, y, z };
+    PoseResult pose_result;
+    pose_result.set_object_id(object_recognition_core::db::ObjectDbPtr(), object_id);
+    pose_result.set_R(std::vector<float>(R, R + 9));
+    pose_result.set_T(std::vector<float>(T, T + 3));
+    pose_result.set_confidence(confidence);
+    return pose_result;
+  }
+
+  ecto::cell::ptr
+  tracker(int detection_period = 100, int max_missed = 1, float confidence_decay = 0.95f)
+  {
+    ecto::cell::ptr cell(new ecto::cell_<PoseTracker>());
+    cell->declare_params();
+    cell->parameters["detection_period"] << detection_period;
+    cell->parameters["max_missed"] << max_missed;
+    cell->parameters["confidence_decay"] << confidence_decay;
+    cell->declare_io();
+    cell->configure();
+    return cell;
+  }
+
+  /** Process a frame on which the detector ran */
+  const std::vector<PoseResult> &
+  detect(ecto::cell::ptr & cell, const std::vector<PoseResult> & pose_results)
+  {
+    cell->inputs["detected"] << true;
+    cell->inputs["pose_results"] << pose_results;
+    cell->process();
+    return cell->outputs.get<std::vector<PoseResult> >("pose_results");
+  }
+
+  /** Process a frame on which the detector did not run */
+  const std::vector<PoseResult> &
+  predict(ecto::cell::ptr & cell)
+  {
+    cell->inputs["detected"] << false;
+    cell->process();
+    return cell->outputs.get<std::vector<PoseResult> >("pose_results");
+  }
+
+  bool
+  needs_detection(const ecto::cell::ptr & cell)
+  {
+    return cell->outputs.get<bool>("needs_detection");
+  }
+}
+
+TEST(OR_io_pose_tracker, ConstantVelocity)
+{
+  ecto::cell::ptr cell = tracker();
+  std::vector<PoseResult> results = detect(cell, std::vector<PoseResult>(1, pose("A", 0, 0, 1)));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_FLOAT_EQ(0, results[0].T()[0]);
+
+  // Without any motion estimate yet, the track does not move
+  results = predict(cell);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_FLOAT_EQ(0, results[0].T()[0]);
+
+  // 2 frames after the first detection: 1 cm and 1 degree per frame
+  results = detect(cell, std::vector<PoseResult>(1, pose("A", 0.02f, 0, 1, 2)));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_NEAR(0.02, results[0].T()[0], 1e-5);
+
+  results = predict(cell);
+  results = predict(cell);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ("A", results[0].object_id());
+  EXPECT_NEAR(0.04, results[0].T()[0], 1e-5);
+  EXPECT_NEAR(0, results[0].T()[1], 1e-5);
+  EXPECT_NEAR(1, results[0].T()[2], 1e-5);
+  // R is stored row by row: R[3] is the sine of the angle around z
+  EXPECT_NEAR(std::sin(4 * M_PI / 180), results[0].R()[3], 1e-4);
+  EXPECT_NEAR(std::cos(4 * M_PI / 180), results[0].R()[0], 1e-4);
+}
+
+TEST(OR_io_pose_tracker, Matching)
+{
+  ecto::cell::ptr cell = tracker();
+  std::vector<PoseResult> pose_results;
+  pose_results.push_back(pose("A", 0, 0, 1));
+  pose_results.push_back(pose("B", 0, 0, 1));
+  EXPECT_EQ(2u, detect(cell, pose_results).size());
+
+  // A detection too far from the track is a new instance of the object: the old track is missed once but kept
+  pose_results[0] = pose("A", 0.5f, 0, 1);
+  EXPECT_EQ(3u, detect(cell, pose_results).size());
+}
+
+TEST(OR_io_pose_tracker, Expiry)
+{
+  ecto::cell::ptr cell = tracker(100, 1);
+  detect(cell, std::vector<PoseResult>(1, pose("A", 0, 0, 1)));
+
+  // The track survives the frames without detection and max_missed detections without it
+  EXPECT_EQ(1u, predict(cell).size());
+  EXPECT_EQ(1u, detect(cell, std::vector<PoseResult>()).size());
+  EXPECT_EQ(1u, predict(cell).size());
+  EXPECT_TRUE(detect(cell, std::vector<PoseResult>()).empty());
+  EXPECT_TRUE(needs_detection(cell));
+
+  // A detection resets the number of misses
+  detect(cell, std::vector<PoseResult>(1, pose("A", 0, 0, 1)));
+  EXPECT_EQ(1u, detect(cell, std::vector<PoseResult>()).size());
+  EXPECT_EQ(1u, detect(cell, std::vector<PoseResult>(1, pose("A", 0, 0, 1))).size());
+  EXPECT_EQ(1u, detect(cell, std::vector<PoseResult>()).size());
+}
+
+TEST(OR_io_pose_tracker, NeedsDetectionPeriod)
+{
+  ecto::cell::ptr cell = tracker(3);
+  EXPECT_TRUE(needs_detection(cell));
+
+  // Nothing to track
+  detect(cell, std::vector<PoseResult>());
+  EXPECT_TRUE(needs_detection(cell));
+
+  // The detector runs every 3 frames
+  detect(cell, std::vector<PoseResult>(1, pose("A", 0, 0, 1)));
+  EXPECT_FALSE(needs_detection(cell));
+  predict(cell);
+  EXPECT_FALSE(needs_detection(cell));
+  predict(cell);
+  EXPECT_TRUE(needs_detection(cell));
+}
+
+TEST(OR_io_pose_tracker, NeedsDetectionConfidence)
+{
+  // The confidence is halved at every frame without detection and a detection is needed below 0.3
+  ecto::cell::ptr cell = tracker(100, 1, 0.5f);
+  detect(cell, std::vector<PoseResult>(1, pose("A", 0, 0, 1, 0, 0.8f)));
+  EXPECT_FALSE(needs_detection(cell));
+
+  std::vector<PoseResult> results = predict(cell);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_FLOAT_EQ(0.4f, results[0].confidence());
+  EXPECT_FALSE(needs_detection(cell));
+
+  results = predict(cell);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_FLOAT_EQ(0.2f, results[0].confidence());
+  EXPECT_TRUE(needs_detection(cell));
+}
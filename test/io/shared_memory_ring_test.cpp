@@ -0,0 +1,211 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <gtest/gtest.h>
+
+#include "shared_memory_ring.h"
+
+using object_recognition_core::io::SharedMemoryRing;
+
+namespace
+{
+  /** A name of ring unique to the process, for the tests not to interfere */
+  std::string
+  RingName()
+  {
+    return "ork_test_ring_" + boost::lexical_cast<std::string>(getpid());
+  }
+
+  /** A frame of one matrix filled with a given value */
+  std::vector<cv::Mat>
+  Frame(unsigned char value)
+  {
+    std::vector<cv::Mat> mats(1, cv::Mat(4, 5, CV_8UC1));
+    std::memset(mats[0].data, value, mats[0].total() * mats[0].elemSize());
+    return mats;
+  }
+
+  /** @return the value the matrix of a frame is filled with, or -1 if it is not filled uniformly */
+  int
+  Value(const std::vector<cv::Mat> & mats)
+  {
+    if (mats.size() != 1 || mats[0].empty())
+      return -1;
+    size_t size = mats[0].total() * mats[0].elemSize();
+    for (size_t i = 1; i < size; ++i)
+      if (mats[0].data[i] != mats[0].data[0])
+        return -1;
+    return mats[0].data[0];
+  }
+}
+
+TEST(OR_io_shared_memory_ring, WriteRead)
+{
+  SharedMemoryRing::Ptr writer = SharedMemoryRing::Create(RingName(), 3, 1024);
+  SharedMemoryRing::Ptr reader = SharedMemoryRing::Open(RingName());
+  ASSERT_TRUE(reader);
+  EXPECT_FALSE(SharedMemoryRing::Open(RingName() + "_missing"));
+
+  std::vector<cv::Mat> mats;
+  boost::uint64_t sequence = 0;
+  EXPECT_FALSE(reader->Read(0, 0.01, mats, sequence));
+
+  std::vector<cv::Mat> frame = Frame(7);
+  cv::Mat depth(2, 3, CV_32FC1);
+  std::memset(depth.data, 1, depth.total() * depth.elemSize());
+  frame.push_back(cv::Mat());
+  frame.push_back(depth);
+  ASSERT_TRUE(writer->Write(frame));
+  ASSERT_TRUE(reader->Read(0, 0.01, mats, sequence));
+  EXPECT_EQ(1u, sequence);
+  ASSERT_EQ(3u, mats.size());
+  EXPECT_EQ(0, std::memcmp(frame[0].data, mats[0].data, frame[0].total() * frame[0].elemSize()));
+  EXPECT_TRUE(mats[1].empty());
+  EXPECT_EQ(2, mats[2].rows);
+  EXPECT_EQ(3, mats[2].cols);
+  EXPECT_EQ(depth.type(), mats[2].type());
+  EXPECT_EQ(0, std::memcmp(depth.data, mats[2].data, depth.total() * depth.elemSize()));
+
+  // No new frame
+  EXPECT_FALSE(reader->Read(sequence, 0.01, mats, sequence));
+
+  // Only the latest frame is read
+  ASSERT_TRUE(writer->Write(Frame(8)));
+  ASSERT_TRUE(writer->Write(Frame(9)));
+  ASSERT_TRUE(reader->Read(1, 0.01, mats, sequence));
+  EXPECT_EQ(3u, sequence);
+  EXPECT_EQ(9, Value(mats));
+
+  EXPECT_THROW(writer->Write(std::vector<cv::Mat>(1, cv::Mat(64, 64, CV_8UC1))), std::runtime_error);
+  EXPECT_EQ(0u, writer->n_dropped());
+}
+
+TEST(OR_io_shared_memory_ring, HeldSlotSkipped)
+{
+  SharedMemoryRing::Ptr writer = SharedMemoryRing::Create(RingName(), 2, 1024);
+  SharedMemoryRing::Ptr reader_1 = SharedMemoryRing::Open(RingName());
+  SharedMemoryRing::Ptr reader_2 = SharedMemoryRing::Open(RingName());
+  std::vector<cv::Mat> mats_1, mats_2;
+  boost::uint64_t sequence_1 = 0, sequence_2 = 0;
+
+  ASSERT_TRUE(writer->Write(Frame(1)));
+  ASSERT_TRUE(reader_1->Read(0, 0.01, mats_1, sequence_1));
+
+  // The writer keeps on overwriting the slot that is not held
+  ASSERT_TRUE(writer->Write(Frame(2)));
+  ASSERT_TRUE(writer->Write(Frame(3)));
+  ASSERT_TRUE(writer->Write(Frame(4)));
+  EXPECT_EQ(1, Value(mats_1));
+  ASSERT_TRUE(reader_2->Read(0, 0.01, mats_2, sequence_2));
+  EXPECT_EQ(4u, sequence_2);
+  EXPECT_EQ(4, Value(mats_2));
+
+  // Once released, the slot is used again
+  reader_1->Release();
+  reader_2->Release();
+  ASSERT_TRUE(writer->Write(Frame(5)));
+  ASSERT_TRUE(reader_1->Read(sequence_1, 0.01, mats_1, sequence_1));
+  EXPECT_EQ(5u, sequence_1);
+  EXPECT_EQ(5, Value(mats_1));
+  EXPECT_EQ(0u, writer->n_dropped());
+}
+
+TEST(OR_io_shared_memory_ring, DropCounting)
+{
+  SharedMemoryRing::Ptr writer = SharedMemoryRing::Create(RingName(), 2, 1024);
+  SharedMemoryRing::Ptr reader_1 = SharedMemoryRing::Open(RingName());
+  SharedMemoryRing::Ptr reader_2 = SharedMemoryRing::Open(RingName());
+  std::vector<cv::Mat> mats_1, mats_2;
+  boost::uint64_t sequence_1 = 0, sequence_2 = 0;
+
+  ASSERT_TRUE(writer->Write(Frame(1)));
+  ASSERT_TRUE(reader_1->Read(0, 0.01, mats_1, sequence_1));
+  ASSERT_TRUE(writer->Write(Frame(2)));
+  ASSERT_TRUE(reader_2->Read(sequence_1, 0.01, mats_2, sequence_2));
+
+  // All the slots are held
+  EXPECT_FALSE(writer->Write(Frame(3)));
+  EXPECT_FALSE(writer->Write(Frame(4)));
+  EXPECT_EQ(2u, writer->n_dropped());
+  EXPECT_EQ(2u, reader_1->n_dropped());
+  EXPECT_EQ(1, Value(mats_1));
+  EXPECT_EQ(2, Value(mats_2));
+
+  reader_1.reset();
+  EXPECT_TRUE(writer->Write(Frame(5)));
+  EXPECT_EQ(2u, writer->n_dropped());
+}
+
+TEST(OR_io_shared_memory_ring, DeadReaderReclaimed)
+{
+  std::string name = RingName();
+  SharedMemoryRing::Ptr writer = SharedMemoryRing::Create(name, 2, 1024);
+  ASSERT_TRUE(writer->Write(Frame(1)));
+
+  // A reader holds the slot of the first frame and dies without releasing it
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0)
+  {
+    SharedMemoryRing::Ptr reader = SharedMemoryRing::Open(name);
+    std::vector<cv::Mat> mats;
+    boost::uint64_t sequence;
+    _exit((reader && reader->Read(0, 1, mats, sequence)) ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+
+  ASSERT_TRUE(writer->Write(Frame(2)));
+  SharedMemoryRing::Ptr reader = SharedMemoryRing::Open(name);
+  std::vector<cv::Mat> mats;
+  boost::uint64_t sequence = 0;
+  ASSERT_TRUE(reader->Read(0, 0.01, mats, sequence));
+  EXPECT_EQ(2, Value(mats));
+
+  // The only other slot is held by a dead process: it is reclaimed
+  EXPECT_TRUE(writer->Write(Frame(3)));
+  EXPECT_EQ(0u, writer->n_dropped());
+}
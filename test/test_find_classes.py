@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+"""
+This script tests the index of the classes that find_classes caches: it is only used if the files of the packages did
+not change, and it is always rewritten as a whole
+"""
+
+import json
+import os
+import shutil
+import sys
+import tempfile
+import time
+
+from object_recognition_core.utils.find_classes import find_classes
+
+PACKAGE = 'ork_find_classes_test'
+
+def write_module(root, name, content, mtime):
+    path = os.path.join(root, PACKAGE, name + '.py')
+    with open(path, 'w') as module_file:
+        module_file.write(content)
+    os.utime(path, (mtime, mtime))
+
+def forget_modules():
+    """
+    Forget the imported modules of the package, except the one of the base class that the test holds
+    """
+    for name in [PACKAGE + '.foo', PACKAGE + '.bar']:
+        sys.modules.pop(name, None)
+
+def class_names(classes):
+    return sorted([class_class.__name__ for class_class in classes])
+
+if __name__ == '__main__':
+    # the modules change within the same second: do not let stale bytecode hide that
+    sys.dont_write_bytecode = True
+    root = tempfile.mkdtemp()
+    try:
+        index_path = os.path.join(root, 'cache', 'cell_index.json')
+        os.environ['ORK_CELL_INDEX'] = index_path
+        sys.path.insert(0, root)
+
+        now = time.time() - 100
+        os.mkdir(os.path.join(root, PACKAGE))
+        write_module(root, '__init__', '', now)
+        write_module(root, 'base', 'class Base(object):\n    pass\n', now)
+        write_module(root, 'foo', 'from %s.base import Base\nclass Foo(Base):\n    pass\n' % PACKAGE, now)
+        write_module(root, 'bar', 'from %s.base import Base\nclass Bar(Base):\n    pass\n' % PACKAGE, now)
+        from ork_find_classes_test.base import Base
+
+        # the first lookup imports everything and writes the index
+        assert class_names(find_classes([PACKAGE], [Base], 'Foo')) == ['Foo']
+        with open(index_path) as index_file:
+            index = json.load(index_file)
+        assert len(index) == 1
+        classes = list(index.values())[0]['classes']
+        assert classes['Foo'] == [PACKAGE + '.foo'], classes
+        assert classes['Bar'] == [PACKAGE + '.bar'], classes
+        # the index is written to a temporary file that is renamed
+        assert os.listdir(os.path.dirname(index_path)) == ['cell_index.json']
+
+        # with an up to date index, only the module defining the class is imported
+        forget_modules()
+        assert class_names(find_classes([PACKAGE], [Base], 'Foo')) == ['Foo']
+        assert PACKAGE + '.foo' in sys.modules
+        assert PACKAGE + '.bar' not in sys.modules
+
+        # once a file changes, the index is outdated: everything is imported again and the index is rewritten
+        forget_modules()
+        write_module(root, 'bar', 'from %s.base import Base\nclass Bar(Base):\n    pass\nclass Foo(Base):\n    pass\n'
+                     % PACKAGE, now + 10)
+        assert class_names(find_classes([PACKAGE], [], 'Foo')) == ['Foo', 'Foo']
+        assert PACKAGE + '.bar' in sys.modules
+        with open(index_path) as index_file:
+            classes = list(json.load(index_file).values())[0]['classes']
+        assert sorted(classes['Foo']) == [PACKAGE + '.bar', PACKAGE + '.foo'], classes
+
+        # a corrupted index is ignored and replaced by a valid one
+        with open(index_path, 'w') as index_file:
+            index_file.write('{"truncated": ')
+        forget_modules()
+        assert class_names(find_classes([PACKAGE], [], 'Bar')) == ['Bar']
+        with open(index_path) as index_file:
+            assert len(json.load(index_file)) == 1
+        assert os.listdir(os.path.dirname(index_path)) == ['cell_index.json']
+    finally:
+        shutil.rmtree(root)